@@ -0,0 +1,299 @@
+#include "BackgroundModel.h"
+#include "WorkerPool.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#if defined(_M_X64) || defined(_M_AMD64) || defined(__x86_64__) || defined(__SSE2__)
+#define BACKGROUNDMODEL_SSE2 1
+#include <emmintrin.h>
+#endif
+
+namespace BackgroundModel
+{
+
+static const int kComponents = 3;                   // mixture Gaussians per pixel
+static const uint16_t kInitVar = 16 << 8;           // new components start at sigma 4
+static const uint16_t kMinVar = 2 << 8;             // sensor noise floor
+static const uint32_t kBackgroundWeight = 45875;    // 0.7: heaviest components covering this much are background
+
+// Rounded (v * a) >> 16.
+static inline uint32_t scale(uint32_t v, uint32_t a)
+{
+    return (v * a + 32768u) >> 16;
+}
+
+// Squared deviation in 8.8 levels^2 from an 8.8 deviation. Up to 24 bits: the
+// classification compares it unsaturated, the variance learns it clamped to 16.
+static inline uint32_t square(uint32_t d)
+{
+    const uint32_t d4 = d >> 4;
+    return d4 * d4;
+}
+
+// threshold^2 * variance, 8.8 levels^2.
+static inline uint32_t limit(uint32_t var, uint32_t k2)
+{
+    return (var * k2) >> 8;
+}
+
+// Soft mask value: 255 * deviation / (2 * threshold deviation), 128 at the threshold.
+static inline uint8_t soft(uint32_t sq, uint32_t thr)
+{
+    const float v = 127.5f * std::sqrt((float)sq / (float)thr);
+    return (uint8_t)std::min(255.0f, v + 0.5f);
+}
+
+// Running mean / variance step toward x, 8.8 in and out.
+static inline uint16_t approach(uint32_t cur, uint32_t x, uint32_t a)
+{
+    return (uint16_t)(x >= cur ? cur + scale(x - cur, a) : cur - scale(cur - x, a));
+}
+
+#if defined(BACKGROUNDMODEL_SSE2)
+// Rounded (v * a) >> 16 for unsigned 16-bit lanes: the high half plus the low half's top bit.
+static inline __m128i scale8(__m128i v, __m128i a)
+{
+    return _mm_add_epi16(_mm_mulhi_epu16(v, a), _mm_srli_epi16(_mm_mullo_epi16(v, a), 15));
+}
+
+static inline __m128i approach8(__m128i cur, __m128i x, __m128i a)
+{
+    const __m128i up = _mm_subs_epu16(x, cur);
+    const __m128i down = _mm_subs_epu16(cur, x);
+    return _mm_sub_epi16(_mm_add_epi16(cur, scale8(up, a)), scale8(down, a));
+}
+
+// Lanes that are not zero -> 0xFFFF.
+static inline __m128i nonZero8(__m128i v)
+{
+    return _mm_xor_si128(_mm_cmpeq_epi16(v, _mm_setzero_si128()), _mm_set1_epi16(-1));
+}
+
+// Full 32-bit products of unsigned 16-bit lanes, low four and high four.
+static inline void product8(__m128i a, __m128i b, __m128i& lo, __m128i& hi)
+{
+    const __m128i pl = _mm_mullo_epi16(a, b);
+    const __m128i ph = _mm_mulhi_epu16(a, b);
+    lo = _mm_unpacklo_epi16(pl, ph);
+    hi = _mm_unpackhi_epi16(pl, ph);
+}
+
+static inline __m128 soft4(__m128i sq, __m128i thr)
+{
+    const __m128 v = _mm_mul_ps(_mm_set1_ps(127.5f), _mm_sqrt_ps(_mm_div_ps(_mm_cvtepi32_ps(sq), _mm_cvtepi32_ps(thr))));
+    return _mm_min_ps(_mm_add_ps(v, _mm_set1_ps(0.5f)), _mm_set1_ps(255.0f));
+}
+#endif
+
+void Model::reset()
+{
+    _seeded = false;
+    _w = _h = 0;
+    _mean.clear();
+    _var.clear();
+    _weight.clear();
+}
+
+void Model::seed(const uint8_t* src, size_t pitch, int w, int h, Mode mode)
+{
+    const size_t n = (size_t)w * (size_t)h;
+    const int planes = mode == Mode::Mixture ? kComponents : 1;
+    _w = w;
+    _h = h;
+    _mode = mode;
+    _mean.assign(n * planes, 0);
+    _var.assign(n * planes, kInitVar);
+    if (mode == Mode::Mixture)
+    {
+        _weight.assign(n * planes, 0);
+        std::fill(_weight.begin(), _weight.begin() + n, (uint16_t)65535);
+    }
+    else
+        _weight.clear();
+
+    for (int y = 0; y < h; ++y)
+    {
+        const uint8_t* row = src + (size_t)y * pitch;
+        uint16_t* m = _mean.data() + (size_t)y * w;
+        for (int x = 0; x < w; ++x)
+            m[x] = (uint16_t)(row[x] << 8);
+    }
+    _seeded = true;
+}
+
+void Model::averageRows(const uint8_t* src, size_t pitch, const Params& p, uint8_t* mask, size_t maskPitch, int y0, int y1)
+{
+    const uint32_t a = (uint32_t)std::max(1.0f, std::min(32768.0f, std::round(p.learningRate * 65536.0f)));
+    const uint32_t k2 = (uint32_t)std::max(1.0f, std::min(65535.0f, std::round(p.threshold * p.threshold * 256.0f)));
+
+    for (int y = y0; y < y1; ++y)
+    {
+        const uint8_t* row = src + (size_t)y * pitch;
+        uint16_t* mean = _mean.data() + (size_t)y * _w;
+        uint16_t* var = _var.data() + (size_t)y * _w;
+        uint8_t* out = mask + (size_t)y * maskPitch;
+        int x = 0;
+#if defined(BACKGROUNDMODEL_SSE2)
+        const __m128i va = _mm_set1_epi16((short)a);
+        const __m128i vk2 = _mm_set1_epi16((short)k2);
+        const __m128i vmin = _mm_set1_epi16((short)kMinVar);
+        const __m128i zero = _mm_setzero_si128();
+        for (; x + 8 <= _w; x += 8)
+        {
+            const __m128i px = _mm_slli_epi16(_mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i*)(row + x)), zero), 8);
+            const __m128i m = _mm_loadu_si128((const __m128i*)(mean + x));
+            const __m128i v = _mm_loadu_si128((const __m128i*)(var + x));
+
+            // Squared deviation and threshold^2 * variance (both 8.8) in 32-bit lanes;
+            // neither fits 16 bits once the deviation passes 16 levels.
+            const __m128i d4 = _mm_srli_epi16(_mm_or_si128(_mm_subs_epu16(px, m), _mm_subs_epu16(m, px)), 4);
+            __m128i sqLo, sqHi, thrLo, thrHi;
+            product8(d4, d4, sqLo, sqHi);
+            product8(v, vk2, thrLo, thrHi);
+            thrLo = _mm_srli_epi32(thrLo, 8);
+            thrHi = _mm_srli_epi32(thrHi, 8);
+
+            __m128i out8;
+            if (p.softMask)
+            {
+                const __m128i s16 = _mm_packs_epi32(_mm_cvttps_epi32(soft4(sqLo, thrLo)), _mm_cvttps_epi32(soft4(sqHi, thrHi)));
+                out8 = _mm_packus_epi16(s16, s16);
+            }
+            else
+            {
+                const __m128i fg = _mm_packs_epi32(_mm_cmpgt_epi32(sqLo, thrLo), _mm_cmpgt_epi32(sqHi, thrHi));
+                out8 = _mm_packs_epi16(fg, fg);
+            }
+            _mm_storel_epi64((__m128i*)(out + x), out8);
+
+            // The variance learns the squared deviation clamped to 16 bits.
+            const __m128i sq = _mm_or_si128(_mm_mullo_epi16(d4, d4), nonZero8(_mm_mulhi_epu16(d4, d4)));
+            _mm_storeu_si128((__m128i*)(mean + x), approach8(m, px, va));
+            const __m128i nv = approach8(v, sq, va);
+            _mm_storeu_si128((__m128i*)(var + x), _mm_add_epi16(_mm_subs_epu16(nv, vmin), vmin));
+        }
+#endif
+        for (; x < _w; ++x)
+        {
+            const uint32_t px = (uint32_t)row[x] << 8;
+            const uint32_t m = mean[x], v = var[x];
+            const uint32_t sq = square(px > m ? px - m : m - px);
+            const uint32_t thr = limit(v, k2);
+            out[x] = p.softMask ? soft(sq, thr) : (sq > thr ? 255 : 0);
+            mean[x] = approach(m, px, a);
+            var[x] = std::max<uint16_t>(approach(v, std::min(sq, 65535u), a), kMinVar);
+        }
+    }
+}
+
+void Model::mixtureRows(const uint8_t* src, size_t pitch, const Params& p, uint8_t* mask, size_t maskPitch, int y0, int y1)
+{
+    const uint32_t a = (uint32_t)std::max(1.0f, std::min(32768.0f, std::round(p.learningRate * 65536.0f)));
+    const uint32_t k2 = (uint32_t)std::max(1.0f, std::min(65535.0f, std::round(p.threshold * p.threshold * 256.0f)));
+    const size_t n = (size_t)_w * (size_t)_h;
+
+    for (int y = y0; y < y1; ++y)
+    {
+        const uint8_t* row = src + (size_t)y * pitch;
+        uint8_t* out = mask + (size_t)y * maskPitch;
+        uint16_t* meanRow[kComponents];
+        uint16_t* varRow[kComponents];
+        uint16_t* weightRow[kComponents];
+        for (int k = 0; k < kComponents; ++k)
+        {
+            meanRow[k] = _mean.data() + k * n + (size_t)y * _w;
+            varRow[k] = _var.data() + k * n + (size_t)y * _w;
+            weightRow[k] = _weight.data() + k * n + (size_t)y * _w;
+        }
+        for (int x = 0; x < _w; ++x)
+        {
+            uint16_t* mean[kComponents] = { meanRow[0] + x, meanRow[1] + x, meanRow[2] + x };
+            uint16_t* var[kComponents] = { varRow[0] + x, varRow[1] + x, varRow[2] + x };
+            uint16_t* weight[kComponents] = { weightRow[0] + x, weightRow[1] + x, weightRow[2] + x };
+
+            // Heaviest first: the first component within the threshold in weight order
+            // matches, so young components born from noise don't steal the background's pixels.
+            int order[kComponents] = { 0, 1, 2 };
+            if (*weight[order[1]] > *weight[order[0]]) std::swap(order[0], order[1]);
+            if (*weight[order[2]] > *weight[order[1]]) std::swap(order[1], order[2]);
+            if (*weight[order[1]] > *weight[order[0]]) std::swap(order[0], order[1]);
+
+            const uint32_t px = (uint32_t)row[x] << 8;
+            int best = -1;
+            uint32_t bestSq = 0, bestThr = 1;
+            bool background = false;
+            uint32_t covered = 0;   // weight of the components ahead of this one
+            for (int j = 0; j < kComponents && best < 0; ++j)
+            {
+                const int k = order[j];
+                if (*weight[k] == 0)
+                    break;
+                const uint32_t m = *mean[k];
+                const uint32_t sq = square(px > m ? px - m : m - px);
+                const uint32_t thr = limit(*var[k], k2);
+                if (sq <= thr)
+                {
+                    best = k;
+                    bestSq = sq;
+                    bestThr = thr;
+                    background = covered < kBackgroundWeight;   // among the heaviest covering 70%
+                }
+                covered += *weight[k];
+            }
+            if (p.softMask)
+                out[x] = background ? soft(bestSq, bestThr) : 255;
+            else
+                out[x] = background ? 0 : 255;
+
+            for (int k = 0; k < kComponents; ++k)
+                *weight[k] = (uint16_t)(k == best ? *weight[k] + scale(65535u - *weight[k], a) : *weight[k] - scale(*weight[k], a));
+            if (best >= 0)
+            {
+                *mean[best] = approach(*mean[best], px, a);
+                *var[best] = std::max<uint16_t>(approach(*var[best], std::min(bestSq, 65535u), a), kMinVar);
+                continue;
+            }
+
+            // Nothing matched: the lightest component restarts at this value. The weights
+            // are not renormalized; every update pulls their sum back toward one.
+            const int j = order[kComponents - 1];
+            *mean[j] = (uint16_t)px;
+            *var[j] = kInitVar;
+            *weight[j] = (uint16_t)a;
+        }
+    }
+}
+
+void Model::update(const uint8_t* src, size_t pitch, int w, int h, const Params& p, uint8_t* mask, size_t maskPitch)
+{
+    if (!src || !mask || w <= 0 || h <= 0)
+        return;
+    if (!_seeded || w != _w || h != _h || p.mode != _mode)
+    {
+        seed(src, pitch, w, h, p.mode);
+        for (int y = 0; y < h; ++y)
+            std::memset(mask + (size_t)y * maskPitch, 0, (size_t)w);
+        return;
+    }
+
+    // Same banding as Demosaic::bilinear; the mixture does more per pixel, so it
+    // splits at a smaller band.
+    const int kRowsPerBand = _mode == Mode::Mixture ? 16 : 64;
+    WorkerPool& pool = WorkerPool::instance();
+    const int bands = std::max(1, std::min(pool.threadCount() + 1, h / kRowsPerBand));
+    const int rowsPerBand = (h + bands - 1) / bands;
+
+    pool.parallelFor(bands, [&](int b)
+        {
+            const int y0 = b * rowsPerBand;
+            const int y1 = std::min(h, y0 + rowsPerBand);
+            if (_mode == Mode::Mixture)
+                mixtureRows(src, pitch, p, mask, maskPitch, y0, y1);
+            else
+                averageRows(src, pitch, p, mask, maskPitch, y0, y1);
+        });
+}
+
+}
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Per-pixel background model on 8-bit mono frames, producing a foreground mask.
+//
+// Everything is fixed point: means and variances are 8.8 (gray levels, levels^2),
+// mixture weights 0.16, and the learning rate is applied as a rounded 0.16 multiply,
+// so a slow model still converges to within 1 / (512 * rate) levels. Variances
+// saturate at 256 levels^2 (sigma 16), which only matters for pixels that are hardly
+// background anyway.
+//
+// RunningAverage keeps one mean and variance per pixel and runs 8 pixels per SSE2
+// iteration. Mixture keeps three weighted Gaussians per pixel (Stauffer-Grimson), so
+// swaying foliage or flickering screens become background; it is scalar and costs
+// about ten times more. Both split the frame into row bands across the WorkerPool.
+namespace BackgroundModel
+{
+    enum class Mode
+    {
+        RunningAverage,
+        Mixture,
+    };
+
+    struct Params
+    {
+        bool enabled = false;
+        Mode mode = Mode::RunningAverage;
+        float learningRate = 0.01f; // weight of each update, 1/65536 .. 0.5
+        int decimation = 1;         // the capture hook feeds the model every Nth frame
+        float threshold = 3.0f;     // foreground beyond this many standard deviations
+        bool softMask = false;      // 255 * deviation / (2 * threshold) instead of 0/255
+    };
+
+    class Model
+    {
+    public:
+        // Classifies a w x h frame against the model, writes the mask (0 = background),
+        // then learns the frame. The first frame, and any frame after a size or mode
+        // change, seeds the model and reads as all background.
+        void update(const uint8_t* src, size_t pitch, int w, int h, const Params& p, uint8_t* mask, size_t maskPitch);
+
+        // Drops the model; the next update seeds a new one.
+        void reset();
+
+    private:
+        void seed(const uint8_t* src, size_t pitch, int w, int h, Mode mode);
+        void averageRows(const uint8_t* src, size_t pitch, const Params& p, uint8_t* mask, size_t maskPitch, int y0, int y1);
+        void mixtureRows(const uint8_t* src, size_t pitch, const Params& p, uint8_t* mask, size_t maskPitch, int y0, int y1);
+
+        int _w = 0;
+        int _h = 0;
+        Mode _mode = Mode::RunningAverage;
+        bool _seeded = false;
+
+        // Planes of _w * _h; the mixture stores kComponents planes of each, component-major.
+        std::vector<uint16_t> _mean;
+        std::vector<uint16_t> _var;
+        std::vector<uint16_t> _weight;  // mixture only
+    };
+}
@@ -0,0 +1,109 @@
+#include "BandwidthPlanner.h"
+
+#include <algorithm>
+#include <cmath>
+#include <map>
+
+namespace BandwidthPlanner
+{
+
+// Per packet on the wire beyond the IP packet: preamble/SFD 8, MAC header 14, FCS 4, IFG 12.
+static const double kEthernetFraming = 38.0;
+// Inside GevSCPSPacketSize: IPv4 20 + UDP 8 + GVSP 8.
+static const int kPacketHeaders = 36;
+// GVSP leader and trailer payloads (image payload type), rounded up.
+static const double kLeaderTrailerPayload = 64.0;
+
+double frameWireBytes(const Camera& cam, int* packets)
+{
+    const int payload = std::max(1, cam.packetSize - kPacketHeaders);
+    const double imageBytes = std::ceil((double)cam.width * cam.height * cam.wireBits / 8.0);
+    const int n = (int)std::ceil(imageBytes / payload);
+    if (packets)
+        *packets = n;
+
+    const double dataPackets = imageBytes + n * (kPacketHeaders + kEthernetFraming);
+    const double leaderTrailer = kLeaderTrailerPayload + 2.0 * (kPacketHeaders + kEthernetFraming);
+    return dataPackets + leaderTrailer;
+}
+
+Plan plan(const std::vector<Camera>& cams, const Link& link)
+{
+    Plan out;
+    out.cameras.resize(cams.size());
+
+    std::map<int, std::vector<size_t>> byPort;
+    for (size_t i = 0; i < cams.size(); ++i)
+    {
+        const Camera& c = cams[i];
+        CameraPlan& p = out.cameras[i];
+        p.camIdx = c.camIdx;
+        p.port = c.port;
+        p.frameBytes = frameWireBytes(c, &p.packetsPerFrame);
+        p.requestedFps = std::max(0.0, c.requestedFps);
+        byPort[c.port].push_back(i);
+    }
+
+    const double capacityBps = std::max(1.0, link.capacityMbps) * 1e6 / 8.0;   // bytes per second
+    const double budgetBps = capacityBps * std::max(0.0, std::min(1.0, link.maxUtilization));
+
+    for (auto& entry : byPort)
+    {
+        std::vector<size_t>& idx = entry.second;
+
+        // Max-min fair share: serve the smallest demands first, each capped at an equal
+        // split of what is still available.
+        std::sort(idx.begin(), idx.end(), [&](size_t a, size_t b)
+            {
+                const CameraPlan& pa = out.cameras[a];
+                const CameraPlan& pb = out.cameras[b];
+                return pa.frameBytes * pa.requestedFps < pb.frameBytes * pb.requestedFps;
+            });
+
+        PortPlan port;
+        port.port = entry.first;
+        port.cameras = (int)idx.size();
+
+        double remaining = budgetBps;
+        size_t left = idx.size();
+        for (size_t i : idx)
+        {
+            CameraPlan& p = out.cameras[i];
+            const double demand = p.frameBytes * p.requestedFps;
+            const double share = remaining / (double)left--;
+            const double granted = std::min(demand, share);
+
+            // Cameras take a rate in hundredths of a frame; round down so the budget holds.
+            p.capFps = granted < demand ? std::floor(granted / p.frameBytes * 100.0) / 100.0 : p.requestedFps;
+            p.capped = p.capFps < p.requestedFps;
+            p.mbps = p.frameBytes * p.capFps * 8.0 / 1e6;
+            remaining -= p.frameBytes * p.capFps;
+
+            port.requestedMbps += demand * 8.0 / 1e6;
+            port.plannedMbps += p.mbps;
+        }
+        port.utilization = port.plannedMbps * 1e6 / 8.0 / capacityBps;
+
+        // Leave gaps for the other cameras' packets, but never so wide that the camera
+        // can no longer send a whole frame within its frame period.
+        for (size_t i : idx)
+        {
+            CameraPlan& p = out.cameras[i];
+            const Camera& c = cams[i];
+            const double packetNs = (c.packetSize + kEthernetFraming) * 1e9 / capacityBps;
+            double delayNs = packetNs * (double)(port.cameras - 1);
+            if (p.capFps > 0.0 && p.packetsPerFrame > 0)
+            {
+                const double periodNs = 1e9 / p.capFps;
+                delayNs = std::min(delayNs, periodNs / p.packetsPerFrame - packetNs);
+            }
+            p.interPacketDelayNs = std::max(0.0, delayNs);
+        }
+
+        out.ports.push_back(port);
+    }
+
+    return out;
+}
+
+}
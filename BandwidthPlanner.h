@@ -0,0 +1,64 @@
+#pragma once
+
+#include <vector>
+
+// GigE Vision bandwidth budgeting for cameras that share links.
+//
+// Pure arithmetic with no MIL or TouchDesigner dependency, so plans can be computed
+// for synthetic camera inventories offline. Each link's budget is shared max-min
+// fairly: cameras asking for less than an equal share keep their request, the rest
+// split what is left. Inter-packet delays spread each camera's packets so the
+// cameras on one link interleave instead of bursting into the switch buffers.
+namespace BandwidthPlanner
+{
+    struct Camera
+    {
+        int camIdx = 0;
+        int port = 0;               // link the camera shares with others
+        int width = 0;
+        int height = 0;
+        int wireBits = 8;           // bits per pixel on the wire (12 for Mono12p, 16 for Mono16)
+        double requestedFps = 30.0;
+        int packetSize = 1500;      // GevSCPSPacketSize: IP packet size, headers included
+    };
+
+    struct Link
+    {
+        double capacityMbps = 1000.0;
+        double maxUtilization = 0.9;    // fraction of capacity the plan may fill
+    };
+
+    struct CameraPlan
+    {
+        int camIdx = 0;
+        int port = 0;
+        int packetsPerFrame = 0;
+        double frameBytes = 0.0;        // on the wire, framing and headers included
+        double requestedFps = 0.0;
+        double capFps = 0.0;            // feasible rate, <= requestedFps
+        double mbps = 0.0;              // link load at capFps
+        double interPacketDelayNs = 0.0;
+        bool capped = false;
+    };
+
+    struct PortPlan
+    {
+        int port = 0;
+        int cameras = 0;
+        double requestedMbps = 0.0;
+        double plannedMbps = 0.0;
+        double utilization = 0.0;       // plannedMbps / capacity
+    };
+
+    struct Plan
+    {
+        std::vector<CameraPlan> cameras;    // same order as the input
+        std::vector<PortPlan> ports;        // ascending port number
+    };
+
+    // Bytes one frame occupies on the link, including the leader/trailer packets and
+    // per-packet Ethernet/IP/UDP/GVSP overhead. 'packets' receives the data packet count.
+    double frameWireBytes(const Camera& cam, int* packets = nullptr);
+
+    Plan plan(const std::vector<Camera>& cams, const Link& link);
+}
@@ -7,9 +7,15 @@
 #include "BasicFilterTOP.h"
 #include "MilManager.h"
 #include "Parameters.h"
+#include "WorkerPool.h"
 
+#include <cstdio>
 #include <cstring>
+#include <cmath>
+#include <cctype>
 #include <algorithm>
+#include <atomic>
+#include <sstream>
 
 using namespace TD;
 
@@ -53,6 +59,27 @@ BasicFilterTOP::BasicFilterTOP(const OP_NodeInfo* info, TOP_Context* context)
 BasicFilterTOP::~BasicFilterTOP()
 {
 	// Optional: keep MIL system alive across instances for faster reloads.
+	MilManager& mil = MilManager::instance();
+	for (int cam : myHeldCams)
+		mil.releaseCamera(cam);
+	if (myExporting)
+		mil.setFrameExport(false, myParams.shmPrefix, myParams.shmSlots);
+	if (myDetecting)
+		mil.setBlobDetection(BlobDetector::Params());
+	if (myMasking)
+		mil.setBackgroundModel(BackgroundModel::Params());
+	if (myTracking)
+		mil.setTracking(Tracker::Params());
+	if (myTriangulating)
+		mil.setTriangulation(Triangulation::Params(), Calibration::Rig());
+	if (myCalibrating)
+		mil.setCalibrationCapture(CalibrationSolver::Params());
+	if (myUndistorting)
+		mil.setUndistortion(false, Calibration::Rig());
+	if (myFlatFielding)
+		mil.setFlatField(false, myParams.flatFolder);
+	if (myDenoising)
+		mil.setDenoise(Denoise::Params());
 }
 
 void BasicFilterTOP::getWarningString(OP_String* warning, void* reserved)
@@ -69,12 +96,91 @@ void BasicFilterTOP::getErrorString(OP_String* error, void* reserved)
 
 void BasicFilterTOP::getInfoPopupString(OP_String* info, void* reserved)
 {
-	if (info)
-		info->setString(myInfo.c_str());
+	if (!info)
+		return;
+
+	// Built on demand rather than every cook.
+	std::ostringstream os;
+	os << source().summaryLine();
+	if (!myInfo.empty())
+		os << "\n" << myInfo;
+
+	// Per-thread scheduling latency, last completed one-second window.
+	auto line = [&os](const char* what, size_t i, const ThreadTuning::LatencyStats::Window& w)
+		{
+			if (w.count > 0)
+				os << "\n" << what << " " << i << ": mean " << (int)w.meanUs << " us, max " << (int)w.maxUs << " us (" << w.count << ")";
+		};
+	const auto hooks = myDaemon ? std::vector<ThreadTuning::LatencyStats::Window>() : MilManager::instance().hookLatency();
+	for (size_t i = 0; i < hooks.size(); ++i)
+		line("hook jitter cam", i, hooks[i]);
+	const auto workers = WorkerPool::instance().latency();
+	for (size_t i = 0; i < workers.size(); ++i)
+		line("worker latency", i, workers[i]);
+
+	const FrameArena::Stats arena = FrameArena::instance().stats();
+	os << "\nframe arena: " << (arena.slabBytes >> 20) << " MB in " << arena.slabs << " slabs ("
+		<< (arena.largePageBytes >> 20) << " MB large pages), slots " << arena.slotsInUse << " used / "
+		<< arena.slotsFree << " free";
+
+	info->setString(os.str().c_str());
+}
+
+// Folds per-thread windows into one: count-weighted mean, overall max.
+static ThreadTuning::LatencyStats::Window worstOf(const std::vector<ThreadTuning::LatencyStats::Window>& ws)
+{
+	ThreadTuning::LatencyStats::Window out;
+	double sum = 0.0;
+	for (const auto& w : ws)
+	{
+		out.count += w.count;
+		sum += w.meanUs * (double)w.count;
+		out.maxUs = std::max(out.maxUs, w.maxUs);
+	}
+	out.meanUs = out.count ? sum / (double)out.count : 0.0;
+	return out;
 }
 
 void BasicFilterTOP::pulsePressed(const char* name, void* reserved)
 {
+	if (std::strcmp(name, CalibSolveName) == 0 || std::strcmp(name, CalibClearName) == 0)
+	{
+		MilManager& mil = MilManager::instance();
+		if (std::strcmp(name, CalibClearName) == 0)
+		{
+			mil.clearCalibrationViews();
+			mySolveStatus.clear();
+		}
+		else if (myParams.calibrationFile.empty())
+			mySolveStatus = "Solving calibration needs a Calibration File to write";
+		else if (mil.startCalibrationSolve(myParams.calibrationFile))
+		{
+			mySolveStatus = "Solving calibration...";
+			myCalibration.solving = true;	// poll until it finishes, even with capture off
+		}
+		else
+			mySolveStatus = mil.lastError();
+		return;
+	}
+	if (std::strcmp(name, CaptureDarkName) == 0 || std::strcmp(name, CaptureFlatName) == 0)
+	{
+		const FlatField::Reference kind = std::strcmp(name, CaptureDarkName) == 0 ? FlatField::Reference::Dark : FlatField::Reference::Flat;
+		MilManager& mil = MilManager::instance();
+		myFlatStatus.clear();
+		if (myDaemon)
+			myFlatStatus = "References can't be captured through the capture daemon; capture them with Frame Source = In-Process";
+		else if (!myFlatFielding)
+			myFlatStatus = "Turn Flat-Field Correction on to capture references";
+		else if (!mil.captureFlatReference(kind, myParams.flatFrames))
+			myFlatStatus = mil.lastError();
+		return;
+	}
+
+		if (myDaemon)
+		{
+			myWarning = "Cameras belong to the capture daemon; run it with --dump to probe devices.";
+			return;
+		}
 
 		MilManager& mil = MilManager::instance();
 		const bool verbose = myParams.debugLevel >= 2;
@@ -84,6 +190,267 @@ void BasicFilterTOP::pulsePressed(const char* name, void* reserved)
 	
 }
 
+// Fixed channels, then per camera: blob count, detect time, frame sequence and
+// blobMax x (x, y, area, w, h, r); while tracking, also track count, track time and
+// blobMax x (id, x, y, vx, vy). While triangulating, point count, solve time and
+// triMaxPoints x (x, y, z, err, views) follow the cameras. While capturing calibration
+// boards, snapshot, view and camera counts and the last solve's error come last.
+static const int32_t kFixedChans = 9;
+static const int32_t kCamChans = 3;
+static const int32_t kBlobFields = 6;
+static const int32_t kTrackChans = 2;
+static const int32_t kTrackFields = 5;
+static const int32_t kPointChans = 2;
+static const int32_t kPointFields = 5;
+static const int32_t kCalibChans = 4;
+
+int32_t BasicFilterTOP::getNumInfoCHOPChans(void* reserved)
+{
+	const int32_t tracking = myTracks.empty() ? 0 : kTrackChans + kTrackFields * myParams.blobMax;
+	const int32_t points = myTriangulating && myDetecting ? kPointChans + kPointFields * myParams.triMaxPoints : 0;
+	const int32_t calib = myCalibrating ? kCalibChans : 0;
+	return kFixedChans + (int32_t)myBlobs.size() * (kCamChans + kBlobFields * myParams.blobMax + tracking) + points + calib;
+}
+
+void BasicFilterTOP::getInfoCHOPChan(int32_t index, OP_InfoCHOPChan* chan, void* reserved)
+{
+	switch (index)
+	{
+	case 0:
+		chan->name->setString("tiles_updated");
+		chan->value = (float)myTilesUpdated;
+		break;
+	case 1:
+		chan->name->setString("tiles_total");
+		chan->value = (float)myTileSeqs.size();
+		break;
+	case 2:
+		chan->name->setString("profile_switch_ms");
+		chan->value = (float)myProfileSwitchMs;
+		break;
+	case 3:
+		chan->name->setString("cameras_lost");
+		chan->value = (float)myHealth.lost;
+		break;
+	case 4:
+		chan->name->setString("reconnects");
+		chan->value = (float)myHealth.reconnects;
+		break;
+	case 5:
+		chan->name->setString("hook_jitter_mean_us");
+		chan->value = (float)myHookLatency.meanUs;
+		break;
+	case 6:
+		chan->name->setString("hook_jitter_max_us");
+		chan->value = (float)myHookLatency.maxUs;
+		break;
+	case 7:
+		chan->name->setString("worker_latency_mean_us");
+		chan->value = (float)myWorkerLatency.meanUs;
+		break;
+	case 8:
+		chan->name->setString("worker_latency_max_us");
+		chan->value = (float)myWorkerLatency.maxUs;
+		break;
+	default:
+	{
+		const int32_t blobChans = kCamChans + kBlobFields * myParams.blobMax;
+		const int32_t perCam = blobChans + (myTracks.empty() ? 0 : kTrackChans + kTrackFields * myParams.blobMax);
+		const int32_t cam = (index - kFixedChans) / perCam;
+		const int32_t field = (index - kFixedChans) % perCam;
+		if (cam >= (int32_t)myBlobs.size())
+		{
+			const int32_t field = index - kFixedChans - (int32_t)myBlobs.size() * perCam;
+			const int32_t points = myTriangulating && myDetecting ? kPointChans + kPointFields * myParams.triMaxPoints : 0;
+			if (field < points)
+				getPointChan(field, chan);
+			else
+				getCalibChan(field - points, chan);
+			break;
+		}
+
+		const BlobDetector::Result& r = myBlobs[cam];
+		const std::string prefix = "cam" + std::to_string(cam) + "_";
+		if (field >= blobChans)
+		{
+			getTrackChan(cam, field - blobChans, prefix, chan);
+			break;
+		}
+		if (field == 0)
+		{
+			chan->name->setString((prefix + "blobs").c_str());
+			chan->value = (float)r.blobs.size();
+			break;
+		}
+		if (field == 1)
+		{
+			chan->name->setString((prefix + "detect_us").c_str());
+			chan->value = (float)r.detectUs;
+			break;
+		}
+		if (field == 2)
+		{
+			// Capture sequence of the frame the list came from; steps by more than one when frames were skipped.
+			chan->name->setString((prefix + "frame").c_str());
+			chan->value = (float)r.frameSeq;
+			break;
+		}
+
+		// Slots past the detected count read 0. Marker mode reports the refined position
+		// and radius; otherwise the threshold centroid and the radius of an equal-area disc.
+		static const char* names[kBlobFields] = { "x", "y", "area", "w", "h", "r" };
+		const int32_t blob = (field - kCamChans) / kBlobFields;
+		const int32_t f = (field - kCamChans) % kBlobFields;
+		chan->name->setString((prefix + "blob" + std::to_string(blob) + "_" + names[f]).c_str());
+		chan->value = 0.0f;
+		if (blob < (int32_t)r.blobs.size())
+		{
+			const BlobDetector::Blob& b = r.blobs[blob];
+			float x = b.cx, y = b.cy, radius = std::sqrt((float)b.area / 3.14159265f);
+			if (blob < (int32_t)r.markers.size())
+			{
+				const BlobDetector::Marker& m = r.markers[blob];
+				x = m.x;
+				y = m.y;
+				radius = m.radius;
+			}
+			const float v[kBlobFields] = { x, y, (float)b.area, (float)(b.x1 - b.x0 + 1), (float)(b.y1 - b.y0 + 1), radius };
+			chan->value = v[f];
+		}
+		break;
+	}
+	}
+}
+
+void BasicFilterTOP::getTrackChan(int32_t cam, int32_t field, const std::string& prefix, OP_InfoCHOPChan* chan)
+{
+	const Tracker::Result* r = cam < (int32_t)myTracks.size() ? &myTracks[cam] : nullptr;
+	if (field == 0)
+	{
+		chan->name->setString((prefix + "tracks").c_str());
+		chan->value = r ? (float)r->tracks.size() : 0.0f;
+		return;
+	}
+	if (field == 1)
+	{
+		chan->name->setString((prefix + "track_us").c_str());
+		chan->value = r ? (float)r->trackUs : 0.0f;
+		return;
+	}
+
+	// Confirmed tracks in ascending ID, so a slot keeps its track until an older one
+	// ends; unused slots read 0 (IDs start at 1). Velocity is in pixels per second.
+	static const char* names[kTrackFields] = { "id", "x", "y", "vx", "vy" };
+	const int32_t slot = (field - kTrackChans) / kTrackFields;
+	const int32_t f = (field - kTrackChans) % kTrackFields;
+	chan->name->setString((prefix + "track" + std::to_string(slot) + "_" + names[f]).c_str());
+	chan->value = 0.0f;
+	if (r && slot < (int32_t)r->tracks.size())
+	{
+		const Tracker::Track& t = r->tracks[slot];
+		const float v[kTrackFields] = { (float)t.id, t.x, t.y, t.vx, t.vy };
+		chan->value = v[f];
+	}
+}
+
+void BasicFilterTOP::getPointChan(int32_t field, OP_InfoCHOPChan* chan)
+{
+	if (field == 0)
+	{
+		chan->name->setString("points");
+		chan->value = (float)myPoints.points.size();
+		return;
+	}
+	if (field == 1)
+	{
+		chan->name->setString("triangulate_us");
+		chan->value = (float)myPoints.solveUs;
+		return;
+	}
+
+	// Most views first; unused slots read 0. Positions are in the calibration's units,
+	// the error is the RMS reprojection error in pixels.
+	static const char* names[kPointFields] = { "x", "y", "z", "err", "views" };
+	const int32_t slot = (field - kPointChans) / kPointFields;
+	const int32_t f = (field - kPointChans) % kPointFields;
+	chan->name->setString(("point" + std::to_string(slot) + "_" + names[f]).c_str());
+	chan->value = 0.0f;
+	if (slot < (int32_t)myPoints.points.size())
+	{
+		const Triangulation::Point& pt = myPoints.points[slot];
+		const float v[kPointFields] = { pt.x, pt.y, pt.z, pt.error, (float)pt.views };
+		chan->value = v[f];
+	}
+}
+
+void BasicFilterTOP::getCalibChan(int32_t field, OP_InfoCHOPChan* chan)
+{
+	static const char* names[kCalibChans] = { "calib_snapshots", "calib_views", "calib_cameras", "calib_rms" };
+	const float v[kCalibChans] = { (float)myCalibration.snapshots, (float)myCalibration.views,
+		(float)myCalibration.cameras, (float)myCalibration.rms };
+	chan->name->setString(names[field]);
+	chan->value = v[field];
+}
+
+bool BasicFilterTOP::getInfoDATSize(OP_InfoDATSize* infoSize, void* reserved)
+{
+	if (myPlan.cameras.empty())
+		return false;
+
+	// Header, one row per camera, then one summary row per port.
+	infoSize->rows = 1 + (int32_t)myPlan.cameras.size() + (int32_t)myPlan.ports.size();
+	infoSize->cols = 10;
+	infoSize->byColumn = false;
+	return true;
+}
+
+void BasicFilterTOP::getInfoDATEntries(int32_t index, int32_t nEntries, OP_InfoDATEntries* entries, void* reserved)
+{
+	static const char* header[] = { "cam", "port", "packets", "frame_kb", "req_fps", "cap_fps", "req_mbps", "mbps", "ipd_ns", "util" };
+	const int numCols = 10;
+	std::string cells[numCols];
+
+	auto fixed = [](double v, int decimals)
+		{
+			char buf[32];
+			std::snprintf(buf, sizeof(buf), "%.*f", decimals, v);
+			return std::string(buf);
+		};
+
+	const int32_t numCams = (int32_t)myPlan.cameras.size();
+	if (index == 0)
+	{
+		for (int i = 0; i < numCols; ++i)
+			cells[i] = header[i];
+	}
+	else if (index <= numCams)
+	{
+		const BandwidthPlanner::CameraPlan& c = myPlan.cameras[index - 1];
+		cells[0] = std::to_string(c.camIdx);
+		cells[1] = std::to_string(c.port);
+		cells[2] = std::to_string(c.packetsPerFrame);
+		cells[3] = fixed(c.frameBytes / 1024.0, 1);
+		cells[4] = fixed(c.requestedFps, 2);
+		cells[5] = fixed(c.capFps, 2);
+		cells[6] = fixed(c.frameBytes * c.requestedFps * 8.0 / 1e6, 1);
+		cells[7] = fixed(c.mbps, 1);
+		cells[8] = fixed(c.interPacketDelayNs, 0);
+		cells[9] = fixed(c.mbps / std::max(1.0, myParams.linkMbps) * 100.0, 1) + "%";
+	}
+	else if (index - numCams - 1 < (int32_t)myPlan.ports.size())
+	{
+		const BandwidthPlanner::PortPlan& p = myPlan.ports[index - numCams - 1];
+		cells[0] = "port";
+		cells[1] = std::to_string(p.port);
+		cells[6] = fixed(p.requestedMbps, 1);
+		cells[7] = fixed(p.plannedMbps, 1);
+		cells[9] = fixed(p.utilization * 100.0, 1) + "%";
+	}
+
+	for (int32_t i = 0; i < nEntries && i < numCols; ++i)
+		entries->values[i]->setString(cells[i].c_str());
+}
+
 void BasicFilterTOP::setupParameters(OP_ParameterManager* manager, void* reserved)
 {
 	SetupParameters(manager);
@@ -95,15 +462,791 @@ void BasicFilterTOP::getGeneralInfo(TOP_GeneralInfo* ginfo, const OP_Inputs* inp
 	ginfo->cookEveryFrame = true;
 }
 
+void BasicFilterTOP::reconfigure(unsigned changes)
+{
+	if ((changes & Change_Source) && applyFrameSource())
+		changes = Change_All;
+	if (myDaemon)
+	{
+		// The daemon owns the cameras and their settings; only the layout is this TOP's.
+		if (changes & (Change_Enable | Change_Camera | Change_Layout | Change_Source))
+		{
+			updateHeldCameras();
+			myFormatGen = 0;
+		}
+		// Frame processing happens in the daemon too; a toggle here would do nothing.
+		if (changes & Change_Undistort)
+			myUndistortStatus = myParams.undistort ? "Undistort Frames is ignored with the capture daemon; start it with --undistort FILE" : "";
+		if (changes & Change_FlatField)
+			myFlatStatus = myParams.flatField ? "Flat-Field Correction is ignored with the capture daemon; start it with --flat-field FOLDER" : "";
+		if (changes & Change_Denoise)
+			myDenoiseStatus = myParams.denoise ? "Temporal Denoise is ignored with the capture daemon; start it with --denoise" : "";
+		return;
+	}
+
+	// Page size first: it applies to slabs allocated from here on, rings included.
+	if (changes & Change_Memory)
+		FrameArena::instance().setLargePages(myParams.hugePages);
+	// Then profiles, so newly held cameras are allocated with the right DCF.
+	if (changes & Change_Dcf)
+		registerDcfProfiles();
+	if (changes & (Change_Enable | Change_Camera | Change_Layout))
+	{
+		updateHeldCameras();
+		myFormatGen = 0;	// force renegotiation
+	}
+	if (changes & Change_Dcf)
+		applyDcfProfile(myHeldCams);
+	if (changes & Change_Bayer)
+		applyBayerMap();
+	if (changes & (Change_Geometry | Change_Camera))
+		applyGeometry();
+	if (changes & Change_Bandwidth)
+		planBandwidth();
+	if (changes & Change_Threads)
+		applyThreadTuning();
+	if (changes & Change_Export)
+		applyFrameExport();
+	if (changes & Change_Blobs)
+		applyBlobDetection();
+	if (changes & Change_Tracking)
+		applyTracking();
+	// Triangulation follows undistortion: undistorted frames have no lens distortion left.
+	if (changes & Change_Undistort)
+		applyUndistortion();
+	if (changes & Change_FlatField)
+		applyFlatField();
+	if (changes & Change_Denoise)
+		applyDenoise();
+	if (changes & (Change_Triangulation | Change_Undistort))
+		applyTriangulation();
+	if (changes & Change_Calibration)
+		applyCalibration();
+	if (changes & Change_Background)
+		applyBackgroundModel();
+}
+
+FrameSource& BasicFilterTOP::source()
+{
+	if (myDaemon)
+		return *myDaemon;
+	return MilManager::instance();
+}
+
+bool BasicFilterTOP::applyFrameSource()
+{
+	const bool wasDaemon = myDaemon != nullptr;
+	myDaemon.reset();
+	if (myParams.frameSource != FrameSource_Daemon)
+		return wasDaemon;
+
+	// Leave the in-process side alone: release our cameras and any export we started,
+	// which would otherwise publish under the daemon's names.
+	myDaemon = std::make_unique<DaemonClient>(myParams.shmPrefix);
+	updateHeldCameras();
+	if (myExporting)
+	{
+		MilManager::instance().setFrameExport(false, myParams.shmPrefix, myParams.shmSlots);
+		myExporting = false;
+	}
+	if (myDetecting)
+	{
+		MilManager::instance().setBlobDetection(BlobDetector::Params());
+		myDetecting = false;
+	}
+	if (myMasking)
+	{
+		MilManager::instance().setBackgroundModel(BackgroundModel::Params());
+		myMasking = false;
+	}
+	if (myTracking)
+	{
+		MilManager::instance().setTracking(Tracker::Params());
+		myTracking = false;
+	}
+	if (myTriangulating)
+	{
+		MilManager::instance().setTriangulation(Triangulation::Params(), Calibration::Rig());
+		myTriangulating = false;
+	}
+	if (myCalibrating)
+	{
+		MilManager::instance().setCalibrationCapture(CalibrationSolver::Params());
+		myCalibrating = false;
+	}
+	if (myUndistorting)
+	{
+		MilManager::instance().setUndistortion(false, Calibration::Rig());
+		myUndistorting = false;
+	}
+	if (myFlatFielding)
+	{
+		MilManager::instance().setFlatField(false, myParams.flatFolder);
+		myFlatFielding = false;
+		myFlatField = MilManager::FlatFieldStatus();
+	}
+	if (myDenoising)
+	{
+		MilManager::instance().setDenoise(Denoise::Params());
+		myDenoising = false;
+	}
+	myBlobs.clear();
+	myTracks.clear();
+	myPoints = Triangulation::Result();
+	myExportStatus.clear();
+	myPlan = BandwidthPlanner::Plan();
+	return false;
+}
+
+void BasicFilterTOP::applyFrameExport()
+{
+	MilManager& mil = MilManager::instance();
+	myExportStatus.clear();
+
+	// Only the TOP that turned export on may turn it off; others with the toggle
+	// at its default leave it alone.
+	if (!mil.builtWithMil() || (!myParams.shmExport && !myExporting))
+		return;
+	if (!mil.setFrameExport(myParams.shmExport, myParams.shmPrefix, myParams.shmSlots))
+		myExportStatus = mil.lastError();
+	myExporting = myParams.shmExport;
+}
+
+void BasicFilterTOP::applyBlobDetection()
+{
+	MilManager& mil = MilManager::instance();
+	if (!mil.builtWithMil() || (!myParams.blobDetect && !myDetecting))
+		return;
+
+	BlobDetector::Params p;
+	p.enabled = myParams.blobDetect;
+	p.threshold = myParams.blobThreshold;
+	p.minArea = myParams.blobMinArea;
+	p.maxArea = myParams.blobMaxArea;
+	p.maxBlobs = myParams.blobMax;
+	p.markers = myParams.blobMarkers;
+	p.circleFit = myParams.blobCircleFit;
+	mil.setBlobDetection(p);
+	myDetecting = myParams.blobDetect;
+	if (!myDetecting)
+		myBlobs.clear();
+}
+
+void BasicFilterTOP::applyTracking()
+{
+	MilManager& mil = MilManager::instance();
+	if (!mil.builtWithMil() || (!myParams.tracking && !myTracking))
+		return;
+
+	Tracker::Params p;
+	p.enabled = myParams.tracking;
+	p.measurementSigma = (float)myParams.trackNoise;
+	p.accelSigma = (float)myParams.trackAccel;
+	p.gateSigma = (float)myParams.trackGate;
+	p.confirmHits = myParams.trackConfirm;
+	p.maxMisses = myParams.trackCoast;
+	p.maxTracks = myParams.trackMax;
+	mil.setTracking(p);
+	myTracking = myParams.tracking;
+	if (!myTracking)
+		myTracks.clear();
+}
+
+void BasicFilterTOP::applyTriangulation()
+{
+	MilManager& mil = MilManager::instance();
+	myCalibStatus.clear();
+	if (!mil.builtWithMil() || (!myParams.triangulate && !myTriangulating))
+		return;
+
+	Triangulation::Params p;
+	p.enabled = myParams.triangulate;
+	p.epipolarTolerance = (float)myParams.triEpipolar;
+	p.maxError = (float)myParams.triMaxError;
+	p.minViews = myParams.triMinViews;
+	p.mergeDistance = (float)myParams.triMerge;
+	p.syncWindowMs = (float)myParams.triSyncMs;
+	p.maxPoints = myParams.triMaxPoints;
+	Calibration::Rig rig;
+	if (p.enabled)
+	{
+		std::string err;
+		if (myParams.calibrationFile.empty())
+			err = "Triangulation needs a Calibration File";
+		else if (!Calibration::load(myParams.calibrationFile, rig, err))
+			err = "Calibration File: " + err;
+		if (!err.empty())
+		{
+			myCalibStatus = err;
+			p.enabled = false;
+			if (!myTriangulating)
+				return;
+		}
+		if (myUndistorting)
+		{
+			for (auto& c : rig.cameras)
+				c.k1 = c.k2 = c.k3 = c.p1 = c.p2 = 0.0;
+		}
+	}
+	mil.setTriangulation(p, rig);
+	myTriangulating = p.enabled;
+	if (!myTriangulating)
+		myPoints = Triangulation::Result();
+}
+
+void BasicFilterTOP::applyCalibration()
+{
+	MilManager& mil = MilManager::instance();
+	if (!mil.builtWithMil() || (!myParams.calibrate && !myCalibrating))
+		return;
+
+	CalibrationSolver::Params p;
+	p.enabled = myParams.calibrate;
+	p.cols = myParams.calibCols;
+	p.rows = myParams.calibRows;
+	p.square = myParams.calibSquare;
+	p.rateHz = myParams.calibRateHz;
+	p.maxSnapshots = myParams.calibMax;
+	// Solves another TOP finished earlier aren't this one's to report.
+	if (p.enabled && !myCalibrating)
+		myCalibSolves = mil.calibrationStatus().solves;
+	mil.setCalibrationCapture(p);
+	myCalibrating = p.enabled;
+}
+
+void BasicFilterTOP::applyUndistortion()
+{
+	MilManager& mil = MilManager::instance();
+	myUndistortStatus.clear();
+	if (!mil.builtWithMil() || (!myParams.undistort && !myUndistorting))
+		return;
+
+	bool enable = myParams.undistort;
+	Calibration::Rig rig;
+	if (enable)
+	{
+		std::string err;
+		if (myParams.calibrationFile.empty())
+			err = "Undistortion needs a Calibration File";
+		else if (!Calibration::load(myParams.calibrationFile, rig, err))
+			err = "Calibration File: " + err;
+		if (!err.empty())
+		{
+			myUndistortStatus = err;
+			enable = false;
+			if (!myUndistorting)
+				return;
+		}
+	}
+	mil.setUndistortion(enable, rig);
+	myUndistorting = enable;
+}
+
+void BasicFilterTOP::applyFlatField()
+{
+	MilManager& mil = MilManager::instance();
+	myFlatStatus.clear();
+	if (!mil.builtWithMil() || (!myParams.flatField && !myFlatFielding))
+		return;
+
+	bool enable = myParams.flatField;
+	if (enable && myParams.flatFolder.empty())
+	{
+		myFlatStatus = "Flat-Field Correction needs a Flat-Field Folder";
+		enable = false;
+		if (!myFlatFielding)
+			return;
+	}
+	mil.setFlatField(enable, myParams.flatFolder);
+	myFlatFielding = enable;
+	if (!myFlatFielding)
+		myFlatField = MilManager::FlatFieldStatus();
+}
+
+void BasicFilterTOP::applyDenoise()
+{
+	MilManager& mil = MilManager::instance();
+	myDenoiseStatus.clear();
+	if (!mil.builtWithMil() || (!myParams.denoise && !myDenoising))
+		return;
+
+	Denoise::Params p;
+	p.enabled = myParams.denoise;
+	p.strength = (float)myParams.denoiseStrength;
+	p.motionThreshold = myParams.denoiseMotion;
+	mil.setDenoise(p);
+	myDenoising = myParams.denoise;
+}
+
+void BasicFilterTOP::applyBackgroundModel()
+{
+	MilManager& mil = MilManager::instance();
+	const bool on = myParams.bgModel != BackgroundMode_Off;
+	if (!mil.builtWithMil() || (!on && !myMasking))
+		return;
+
+	BackgroundModel::Params p;
+	p.enabled = on;
+	p.mode = myParams.bgModel == BackgroundMode_Mixture ? BackgroundModel::Mode::Mixture : BackgroundModel::Mode::RunningAverage;
+	p.learningRate = (float)myParams.bgLearnRate;
+	p.decimation = myParams.bgDecimation;
+	p.threshold = (float)myParams.bgThreshold;
+	p.softMask = myParams.bgSoftMask;
+	mil.setBackgroundModel(p);
+	myMasking = on;
+}
+
+void BasicFilterTOP::updateHeldCameras()
+{
+	MilManager& mil = MilManager::instance();
+
+	std::vector<int> want;
+	if (myParams.enable && !myDaemon && mil.builtWithMil())
+	{
+		if (myParams.outputMode == OutputMode_Selected)
+			want.push_back(myDevNum);
+		else
+		{
+			const int n = mil.cameraCount();
+			for (int cam = 0; cam < n; ++cam)
+				want.push_back(cam);
+		}
+	}
+
+	// Retain before releasing so a camera kept across the change never stops.
+	std::vector<int> added;
+	for (int cam : want)
+		if (std::find(myHeldCams.begin(), myHeldCams.end(), cam) == myHeldCams.end())
+			added.push_back(cam);
+	applyDcfProfile(added);
+	for (int cam : added)
+		mil.retainCamera(cam);
+	for (int cam : myHeldCams)
+		if (std::find(want.begin(), want.end(), cam) == want.end())
+			mil.releaseCamera(cam);
+	myHeldCams.swap(want);
+}
+
+void BasicFilterTOP::registerDcfProfiles()
+{
+	std::vector<MilManager::DcfProfile> profiles;
+	profiles.push_back({ std::string(), myParams.dcfPath });
+
+	// Entries look like "day=C:/dcf/day_{cam}.dcf; night=userset:UserSet1". Paths may
+	// contain spaces, so entries are split on ';' or newlines only.
+	auto trim = [](std::string s)
+		{
+			const size_t b = s.find_first_not_of(" \t\r");
+			const size_t e = s.find_last_not_of(" \t\r");
+			return b == std::string::npos ? std::string() : s.substr(b, e - b + 1);
+		};
+	std::string text = myParams.dcfProfiles;
+	std::replace(text.begin(), text.end(), '\n', ';');
+	std::istringstream in(text);
+	std::string entry;
+	while (std::getline(in, entry, ';'))
+	{
+		const size_t sep = entry.find('=');
+		if (sep == std::string::npos)
+			continue;
+		MilManager::DcfProfile p{ trim(entry.substr(0, sep)), trim(entry.substr(sep + 1)) };
+		if (!p.name.empty())
+			profiles.push_back(std::move(p));
+	}
+
+	MilManager& mil = MilManager::instance();
+	myDcfStatus.clear();
+	if (!mil.setDcfProfiles(profiles))
+		myDcfStatus = mil.lastError();
+}
+
+void BasicFilterTOP::applyDcfProfile(const std::vector<int>& cams)
+{
+	MilManager& mil = MilManager::instance();
+	double total = 0.0;
+	for (int cam : cams)
+	{
+		double ms = 0.0;
+		if (!mil.applyDcfProfile(cam, myParams.dcfProfile, ms))
+			myDcfStatus = mil.lastError();
+		total += ms;
+	}
+	if (total > 0.0)
+		myProfileSwitchMs = total;
+}
+
+void BasicFilterTOP::planBandwidth()
+{
+	MilManager& mil = MilManager::instance();
+	myPlanStatus.clear();
+
+	if (!myParams.bwPlanner)
+	{
+		// Give the cameras back their own rate and packet timing.
+		for (const BandwidthPlanner::CameraPlan& c : myPlan.cameras)
+			mil.applyStreamLimits(c.camIdx, 0.0, 0.0);
+		myPlan = BandwidthPlanner::Plan();
+		return;
+	}
+
+	std::vector<BandwidthPlanner::Camera> cams;
+	const int n = mil.cameraCount();
+	for (int cam = 0; cam < n; ++cam)
+	{
+		MilManager::CameraFormat cf;
+		if (!mil.cameraFormat(cam, cf))
+			continue;
+
+		BandwidthPlanner::Camera c;
+		c.camIdx = cam;
+		c.port = cam / myParams.camsPerPort;
+		c.width = cf.width;
+		c.height = cf.height;
+		c.wireBits = cf.wireBits;
+		c.packetSize = cf.packetSize;
+		c.requestedFps = myParams.requestedFps;
+		cams.push_back(c);
+	}
+
+	BandwidthPlanner::Link link;
+	link.capacityMbps = myParams.linkMbps;
+	link.maxUtilization = myParams.linkUtil;
+	myPlan = BandwidthPlanner::plan(cams, link);
+
+	int capped = 0;
+	for (const BandwidthPlanner::CameraPlan& c : myPlan.cameras)
+	{
+		if (!mil.applyStreamLimits(c.camIdx, c.capFps, c.interPacketDelayNs))
+			myPlanStatus = mil.lastError();
+		capped += c.capped ? 1 : 0;
+	}
+	if (capped > 0 && myPlanStatus.empty())
+		myPlanStatus = "Bandwidth planner capped " + std::to_string(capped) + " camera(s) below the requested FPS (see Info DAT).";
+}
+
+void BasicFilterTOP::applyThreadTuning()
+{
+	myThreadStatus.clear();
+
+	ThreadTuning::CpuSet captureCpus, workerCpus;
+	std::string err;
+	if (!ThreadTuning::parseCpuSet(myParams.captureCores, captureCpus, err))
+		myThreadStatus = "Capture Cores: " + err;
+	if (!ThreadTuning::parseCpuSet(myParams.workerCores, workerCpus, err))
+		myThreadStatus = "Worker Cores: " + err;
+
+	ThreadTuning::Priority priority = ThreadTuning::Priority::Normal;
+	if (myParams.capturePriority == CapturePriority_High)
+		priority = ThreadTuning::Priority::High;
+	else if (myParams.capturePriority == CapturePriority_TimeCritical)
+		priority = ThreadTuning::Priority::TimeCritical;
+
+	// A malformed list leaves that group unpinned rather than half-applied.
+	MilManager::instance().setCaptureThreads(captureCpus, priority);
+	WorkerPool::instance().configure(workerCpus, priority);
+}
+
+void BasicFilterTOP::applyBayerMap()
+{
+	MilManager& mil = MilManager::instance();
+	std::vector<int> cams;
+
+	// Entries look like "3=RGGB" or "3:rggb", separated by spaces or commas.
+	std::string text = myParams.bayerMap;
+	std::replace(text.begin(), text.end(), ',', ' ');
+	std::istringstream in(text);
+	std::string entry;
+	while (in >> entry)
+	{
+		const size_t sep = entry.find_first_of("=:");
+		if (sep == std::string::npos || sep == 0)
+			continue;
+
+		std::string mode = entry.substr(sep + 1);
+		std::transform(mode.begin(), mode.end(), mode.begin(), [](unsigned char c) { return (char)std::toupper(c); });
+
+		MilManager::BayerMode bm;
+		if (mode == "RGGB") bm = MilManager::BayerMode::RGGB;
+		else if (mode == "BGGR") bm = MilManager::BayerMode::BGGR;
+		else if (mode == "GRBG") bm = MilManager::BayerMode::GRBG;
+		else if (mode == "GBRG") bm = MilManager::BayerMode::GBRG;
+		else if (mode == "NONE" || mode == "MONO") bm = MilManager::BayerMode::None;
+		else if (mode == "AUTO") bm = MilManager::BayerMode::Auto;
+		else continue;
+
+		const int cam = std::atoi(entry.substr(0, sep).c_str());
+		mil.setBayerMode(cam, bm);
+		cams.push_back(cam);
+	}
+
+	for (int cam : myBayerCams)
+	{
+		if (std::find(cams.begin(), cams.end(), cam) == cams.end())
+			mil.setBayerMode(cam, MilManager::BayerMode::Auto);
+	}
+	myBayerCams.swap(cams);
+}
+
+void BasicFilterTOP::applyGeometry()
+{
+	MilManager::CameraGeometry g;
+	g.offsetX = std::max(0, myParams.roiX);
+	g.offsetY = std::max(0, myParams.roiY);
+	g.width = std::max(0, myParams.roiW);
+	g.height = std::max(0, myParams.roiH);
+	g.binning = myParams.binning;
+	g.decimation = myParams.decimation;
+
+	// Cameras that already carry this geometry are left alone by setCameraGeometry().
+	MilManager& mil = MilManager::instance();
+	if (myParams.geometryScope != GeometryScope_All)
+	{
+		mil.setCameraGeometry(myDevNum, g);
+		return;
+	}
+	const int n = mil.cameraCount();
+	for (int cam = 0; cam < n; ++cam)
+		mil.setCameraGeometry(cam, g);
+}
+
+void BasicFilterTOP::resolvePixelFormat(TOP_OutputFormat* format, int devNum)
+{
+	FrameSource& src = source();
+
+	int mode = myParams.pixelFormat;
+	if (mode == PixelFormat_Auto)
+	{
+		// Keep the camera's native depth: Mono16 as soon as a camera in view is deeper than 8 bits.
+		bool deep = false;
+		FrameSource::CameraFormat cf;
+		if (myParams.outputMode == OutputMode_Selected)
+			deep = src.cameraFormat(devNum, cf) && cf.bits > 8;
+		else
+		{
+			const int numCams = src.cameraCount();
+			for (int i = 0; i < numCams && !deep; ++i)
+				deep = src.cameraFormat(i, cf) && cf.bits > 8;
+		}
+		mode = deep ? PixelFormat_Mono16 : PixelFormat_RGBA8;
+	}
+
+	switch (mode)
+	{
+	case PixelFormat_Mono16:
+		myOutPixel = FrameSource::OutPixel::Mono16;
+		format->pixelFormat = OP_PixelFormat::Mono16Fixed;
+		break;
+	case PixelFormat_RGBA16:
+		myOutPixel = FrameSource::OutPixel::RGBA16;
+		format->pixelFormat = OP_PixelFormat::RGBA16Fixed;
+		break;
+	default:
+		myOutPixel = FrameSource::OutPixel::RGBA8;
+		format->pixelFormat = OP_PixelFormat::RGBA8Fixed;
+		break;
+	}
+}
+
+bool BasicFilterTOP::negotiateOutputFormat(TOP_OutputFormat* format, int devNum)
+{
+	FrameSource& src = source();
+
+	format->numColorBuffers = 1;
+	resolvePixelFormat(format, devNum);
+
+	// Foreground masks follow the camera buffers, one per camera shown.
+	myMaskBuffers = myParams.bgModel != BackgroundMode_Off && !myDaemon &&
+		(myParams.outputMode == OutputMode_Selected || myParams.outputMode == OutputMode_AllCameras);
+
+	if (myParams.outputMode == OutputMode_AllCameras)
+	{
+		// Color buffer 0 defines the TOP's own resolution; the others carry their own size.
+		const int numCams = src.cameraCount();
+		FrameSource::CameraFormat cf;
+		if (numCams <= 0 || !src.cameraFormat(0, cf))
+			return false;
+		format->width = cf.width;
+		format->height = cf.height;
+		format->numColorBuffers = myMaskBuffers ? 2 * numCams : numCams;
+		return true;
+	}
+
+	if (myParams.outputMode == OutputMode_Selected)
+	{
+		FrameSource::CameraFormat cf;
+		if (!src.cameraFormat(devNum, cf))
+			return false;
+		format->width = cf.width;
+		format->height = cf.height;
+		format->numColorBuffers = myMaskBuffers ? 2 : 1;
+		return true;
+	}
+
+	// Grid and Array: one cell/layer per discovered camera, sized to the largest camera.
+	const int numCams = src.cameraCount();
+	if (numCams <= 0)
+		return false;
+
+	std::vector<FrameSource::CameraFormat> cams(numCams);
+	myTileW = 0;
+	myTileH = 0;
+	for (int i = 0; i < numCams; ++i)
+	{
+		if (!src.cameraFormat(i, cams[i]))
+			continue;
+		myTileW = std::max(myTileW, cams[i].width);
+		myTileH = std::max(myTileH, cams[i].height);
+	}
+	if (myTileW <= 0 || myTileH <= 0)
+		return false;
+
+	if (myParams.outputMode == OutputMode_Array)
+	{
+		const size_t layerBytes = (size_t)myTileW * (size_t)myTileH * FrameSource::outPixelBytes(myOutPixel);
+		bool same = myLayers.size() == cams.size() && myLayerBytes == layerBytes;
+		for (int i = 0; same && i < numCams; ++i)
+			same = myLayers[i].camW == cams[i].width && myLayers[i].camH == cams[i].height;
+
+		if (!same)
+		{
+			myLayerBytes = layerBytes;
+			myLayers.assign(numCams, ArrayLayer());
+			for (int i = 0; i < numCams; ++i)
+			{
+				myLayers[i].offset = (size_t)i * layerBytes;
+				myLayers[i].camW = cams[i].width;
+				myLayers[i].camH = cams[i].height;
+			}
+		}
+
+		format->width = myTileW;
+		format->height = myTileH;
+		return true;
+	}
+
+	myGridCols = std::max(1, std::min(myParams.gridCols, numCams));
+	myGridRows = (numCams + myGridCols - 1) / myGridCols;
+	format->width = myGridCols * myTileW;
+	format->height = myGridRows * myTileH;
+	return true;
+}
+
+int BasicFilterTOP::uploadAllCameras(TOP_Output* output, int numCams, OP_PixelFormat pixelFormat)
+{
+	FrameSource& src = source();
+	const size_t bpp = FrameSource::outPixelBytes(myOutPixel);
+	int live = 0;
+
+	for (int i = 0; i < numCams; ++i)
+	{
+		FrameSource::CameraFormat cf;
+		if (!src.cameraFormat(i, cf) || !src.ensureStreaming(i))
+			cf.width = cf.height = 1;	// keep the buffer index populated
+
+		// Copy straight into the upload buffer; no intermediate frame.
+		const uint64_t bytes = (uint64_t)cf.width * cf.height * bpp;
+		auto buf = myContext->createOutputBuffer(bytes, TOP_BufferFlags::None, nullptr);
+		uint64_t seen = 0;
+		if (src.copyLatestFrame(i, myOutPixel, (uint8_t*)buf->data, (size_t)cf.width * bpp, cf.width, cf.height, seen))
+			++live;
+		else
+			std::memset(buf->data, 0, (size_t)bytes);
+
+		TOP_UploadInfo info;
+		info.textureDesc.width = cf.width;
+		info.textureDesc.height = cf.height;
+		info.textureDesc.pixelFormat = pixelFormat;
+		info.textureDesc.texDim = OP_TexDim::e2D;
+		info.bufferOffset = 0;
+		info.colorBufferIndex = (uint32_t)i;
+		output->uploadBuffer(&buf, info, nullptr);
+	}
+	return live;
+}
+
+void BasicFilterTOP::uploadMask(TOP_Output* output, int camIdx, uint32_t colorBufferIndex)
+{
+	// Camera-sized even before the first mask, so the buffer keeps its size.
+	FrameSource::CameraFormat cf;
+	if (!source().cameraFormat(camIdx, cf))
+		cf.width = cf.height = 1;
+
+	const uint64_t bytes = (uint64_t)cf.width * cf.height;
+	auto buf = myContext->createOutputBuffer(bytes, TOP_BufferFlags::None, nullptr);
+	uint64_t seen = 0;
+	if (!MilManager::instance().copyLatestMask(camIdx, (uint8_t*)buf->data, (size_t)cf.width, cf.width, cf.height, seen))
+		std::memset(buf->data, 0, (size_t)bytes);
+
+	TOP_UploadInfo info;
+	info.textureDesc.width = cf.width;
+	info.textureDesc.height = cf.height;
+	info.textureDesc.pixelFormat = OP_PixelFormat::Mono8Fixed;
+	info.textureDesc.texDim = OP_TexDim::e2D;
+	info.bufferOffset = 0;
+	info.colorBufferIndex = colorBufferIndex;
+	output->uploadBuffer(&buf, info, nullptr);
+}
+
+int BasicFilterTOP::uploadCameraArray(TOP_Output* output, OP_PixelFormat pixelFormat)
+{
+	FrameSource& src = source();
+	const int numLayers = (int)myLayers.size();
+	const size_t bpp = FrameSource::outPixelBytes(myOutPixel);
+	const size_t rowBytes = (size_t)myTileW * bpp;
+
+	auto buf = myContext->createOutputBuffer((uint64_t)myLayerBytes * numLayers, TOP_BufferFlags::None, nullptr);
+	uint8_t* base = (uint8_t*)buf->data;
+
+	for (int i = 0; i < numLayers; ++i)
+		src.ensureStreaming(i);
+
+	std::atomic<int> live{ 0 };
+	WorkerPool::instance().parallelFor(numLayers, [&](int i)
+		{
+			const ArrayLayer& layer = myLayers[i];
+			uint8_t* dst = base + layer.offset;
+			uint64_t seen = 0;
+			if (!src.copyLatestFrame(i, myOutPixel, dst, rowBytes, myTileW, myTileH, seen))
+			{
+				std::memset(dst, 0, myLayerBytes);
+				return;
+			}
+			++live;
+
+			// Blank the margin of cameras smaller than the layer.
+			if (layer.camW < myTileW)
+			{
+				for (int y = 0; y < layer.camH; ++y)
+					std::memset(dst + y * rowBytes + (size_t)layer.camW * bpp, 0, rowBytes - (size_t)layer.camW * bpp);
+			}
+			if (layer.camH < myTileH)
+				std::memset(dst + (size_t)layer.camH * rowBytes, 0, (size_t)(myTileH - layer.camH) * rowBytes);
+		});
+
+	TOP_UploadInfo info;
+	info.textureDesc.width = myTileW;
+	info.textureDesc.height = myTileH;
+	info.textureDesc.depth = (uint32_t)numLayers;
+	info.textureDesc.pixelFormat = pixelFormat;
+	info.textureDesc.texDim = OP_TexDim::e2DArray;
+	info.bufferOffset = 0;
+	output->uploadBuffer(&buf, info, nullptr);
+	return live.load();
+}
+
 void BasicFilterTOP::execute(TOP_Output* output, const OP_Inputs* inputs, void* reserved)
 {
-	myParams.load(inputs);
+	const unsigned loaded = myParams.load(inputs);
+	myPendingChanges |= loaded;
 	myError.clear();
 	myWarning.clear();
 	myInfo.clear();
 
 	if (!myParams.enable)
 	{
+		if (loaded & Change_Enable)
+			updateHeldCameras();	// lets idle cameras stop streaming
+
 		// Output black frame
 		const int w = 64, h = 64;
 		auto buf = myContext->createOutputBuffer((uint64_t)w*h*4, TOP_BufferFlags::None, nullptr);
@@ -121,34 +1264,138 @@ void BasicFilterTOP::execute(TOP_Output* output, const OP_Inputs* inputs, void*
 
 	MilManager& mil = MilManager::instance();
 
-	// Always keep a system summary available in the info popup.
-	myInfo = mil.summaryLine();
+	// The daemon client never touches MIL, so it also works in a build without it.
+	const bool haveSource = myParams.frameSource == FrameSource_Daemon || mil.builtWithMil();
 
 	// If we are not actually compiled with MIL, make it unmistakable.
-	if (!mil.builtWithMil())
+	if (!haveSource)
 	{
 		myError = "This build is NOT using MIL (HAVE_MIL not defined). Rebuild with HAVE_MIL + MIL include/lib paths.";
 		myWarning.clear();
 		// Fall through to error frame.
 	}
 
-	const int camIdx = std::max(0, std::min(23, myParams.cameraIndex));
-	const int devNum = myParams.deviceOffset + camIdx;
+	// Everything that changed since the last reconfigure(), including the first cook's
+	// Change_All when the TOP starts disabled.
+	const unsigned changes = myPendingChanges;
+	if (changes & Change_Camera)
+	{
+		myCamIdx = std::max(0, std::min(23, myParams.cameraIndex));
+		myDevNum = myParams.deviceOffset + myCamIdx;
+	}
+	const int camIdx = myCamIdx;
+	const int devNum = myDevNum;
+
+	if (changes && haveSource)
+	{
+		reconfigure(changes);
+		myPendingChanges = 0;
+	}
+	if (myDaemon)
+		myDaemon->refresh();
+	FrameSource& src = source();
+
+	// The output layout only depends on the parameters and the cameras' formats, so it is
+	// renegotiated when either moves. A failed negotiation is retried on the next cook.
+	if (haveSource && src.formatGeneration() != myFormatGen)
+	{
+		const uint64_t gen = src.formatGeneration();
+		myFormat = TOP_OutputFormat();
+		myFormatOk = negotiateOutputFormat(&myFormat, devNum);
+		myFormatGen = myFormatOk ? gen : 0;
+		FrameArena::instance().trim();	// size classes the old formats used
+		if (myParams.outputMode != OutputMode_Selected)
+			updateHeldCameras();	// discovery may have changed the camera count
+		if (myParams.bwPlanner && !myDaemon)
+			planBandwidth();		// frame sizes moved
+	}
 
-	bool ok = mil.builtWithMil();
-	int w=0,h=0;
+	// The daemon keeps its own watchdog and hook statistics.
+	myHealth = myDaemon ? MilManager::Health() : mil.health();
+	myHookLatency = myDaemon ? ThreadTuning::LatencyStats::Window() : worstOf(mil.hookLatency());
+	myWorkerLatency = worstOf(WorkerPool::instance().latency());
 
-	if (ok && myParams.outputMode == 1)
+	// Detections are produced off this thread; a cook only copies the small result lists.
+	if (myDetecting)
+	{
+		myBlobs.resize((size_t)std::max(0, mil.cameraCount()));
+		for (size_t cam = 0; cam < myBlobs.size(); ++cam)
+			if (!mil.latestBlobs((int)cam, myBlobs[cam]))
+				myBlobs[cam] = BlobDetector::Result();
+	}
+	if (myDetecting && myTracking)
+	{
+		myTracks.resize(myBlobs.size());
+		for (size_t cam = 0; cam < myTracks.size(); ++cam)
+			if (!mil.latestTracks((int)cam, myTracks[cam]))
+				myTracks[cam] = Tracker::Result();
+	}
+	else
+		myTracks.clear();
+	if (!myDetecting || !myTriangulating || !mil.latestPoints(myPoints))
+		myPoints = Triangulation::Result();
+	if (myFlatFielding)
+		myFlatField = mil.flatFieldStatus();
+	if (myCalibrating || myCalibration.solving)
+	{
+		myCalibration = mil.calibrationStatus();
+		if (myCalibration.solves != myCalibSolves)
+		{
+			myCalibSolves = myCalibration.solves;
+			mySolveStatus = (myCalibration.solved ? "Calibration: " : "Calibration solve failed: ") + myCalibration.message;
+			// Undistortion and triangulation reload the file that was just written.
+			if (myCalibration.solved && myParams.undistort)
+				applyUndistortion();
+			if (myCalibration.solved && myParams.triangulate)
+				applyTriangulation();
+		}
+	}
+
+	const TOP_OutputFormat& fmt = myFormat;
+	bool ok = haveSource && myFormatOk;
+	const int w = fmt.width, h = fmt.height;
+	const size_t bpp = FrameSource::outPixelBytes(myOutPixel);
+
+	myTilesUpdated = 0;
+	if (ok && myParams.outputMode == OutputMode_AllCameras)
+	{
+		// Uploads directly from each camera's frame; nothing is left for the tail below.
+		myTileSeqs.clear();
+		const int numCams = myMaskBuffers ? fmt.numColorBuffers / 2 : fmt.numColorBuffers;
+		myCamerasLive = uploadAllCameras(output, numCams, fmt.pixelFormat);
+		for (int i = 0; myMaskBuffers && i < numCams; ++i)
+			uploadMask(output, i, (uint32_t)(numCams + i));
+	}
+	else if (ok && myParams.outputMode == OutputMode_Array)
+	{
+		myTileSeqs.clear();
+		myCamerasLive = uploadCameraArray(output, fmt.pixelFormat);
+	}
+	else if (ok && myParams.outputMode == OutputMode_Grid)
 	{
-		int gridCols = myParams.gridCols;
-		int gridRows = myParams.gridCols; // or whatever it should be
-		int tileW = w / gridCols;
-		int tileH = h / gridRows;
-		ok = mil.grabGridToRGBA8(gridCols, gridRows, tileW, tileH, myRGBA, w * h * 4);
+		// A layout change invalidates the canvas; otherwise only dirty cells are redrawn.
+		const size_t need = (size_t)w * (size_t)h * bpp;
+		if (w != myW || h != myH || myFrame.size() != need)
+		{
+			if (myFrame.resize(need))
+				std::memset(myFrame.data(), 0, need);
+			myTileSeqs.clear();
+		}
+		myTilesUpdated = myFrame.empty() ? -1 :
+			src.updateGrid(myGridCols, myGridRows, myTileW, myTileH, myOutPixel, myFrame.data(), myFrame.size(), myTileSeqs);
+		ok = myTilesUpdated >= 0;
 	}
 	else if (ok)
 	{
-		ok = mil.ensureDigitizer(devNum) && mil.grabToRGBA8(devNum, w, h, myRGBA, w * h * 4);
+		myTileSeqs.clear();
+		const size_t need = (size_t)w * (size_t)h * bpp;
+		ok = myFrame.resize(need) && src.grabFrame(devNum, myOutPixel, w, h, myFrame.data(), myFrame.size());
+	}
+
+	if (ok)
+	{
+		myW = w;
+		myH = h;
 	}
 
 	// Debug status strings
@@ -156,23 +1403,76 @@ void BasicFilterTOP::execute(TOP_Output* output, const OP_Inputs* inputs, void*
 	{
 		std::string s;
 		s += "camIdx=" + std::to_string(camIdx) + " devNum=" + std::to_string(devNum);
-		s += " mode=" + std::string(myParams.outputMode == 1 ? "Grid" : "Selected");
+		static const char* modeNames[] = { "Selected", "Grid", "All", "Array" };
+		s += " mode=" + std::string(modeNames[std::max(0, std::min(3, myParams.outputMode))]);
+		s += " out=" + std::to_string(w) + "x" + std::to_string(h);
+		if (myParams.outputMode == OutputMode_AllCameras)
+		{
+			s += " buffers=" + std::to_string(fmt.numColorBuffers);
+			s += " live=" + std::to_string(myCamerasLive);
+		}
+		if (myParams.outputMode == OutputMode_Array)
+		{
+			s += " layers=" + std::to_string(myLayers.size());
+			s += " live=" + std::to_string(myCamerasLive);
+		}
+		if (myParams.outputMode == OutputMode_Grid)
+		{
+			s += " grid=" + std::to_string(myGridCols) + "x" + std::to_string(myGridRows);
+			s += " updated=" + std::to_string(myTilesUpdated);
+		}
 		s += " dcf='" + (myParams.dcfPath.empty() ? std::string("<M_DEFAULT>") : myParams.dcfPath) + "'";
-		s += " | " + mil.summaryLine();
+		if (!myParams.dcfProfile.empty())
+			s += " profile=" + myParams.dcfProfile;
+		s += " switch=" + std::to_string((int)(myProfileSwitchMs + 0.5)) + "ms";
+		s += " | " + src.summaryLine();
 		if (!ok)
-			s += " | lastError: " + mil.lastError();
+			s += " | lastError: " + src.lastError();
 		myWarning = s;
 		if (myParams.debugLevel >= 2)
 		{
 			myInfo += "\n";
-			myInfo += "\nLastError: " + mil.lastError();
+			myInfo += "\nLastError: " + src.lastError();
 			myInfo += "\nNote: use the 'Dump MIL Devices' pulse to probe digitizer indices.";
 		}
 	}
 	else if (!ok)
 	{
 		// Even if debug is off, provide an actionable error message.
-		myError = mil.lastError();
+		myError = src.lastError();
+	}
+
+	// Profile and planner problems persist until their parameters change, not just for one cook.
+	if (!myDcfStatus.empty())
+		myWarning = myWarning.empty() ? myDcfStatus : myWarning + " | " + myDcfStatus;
+	if (!myPlanStatus.empty())
+		myWarning = myWarning.empty() ? myPlanStatus : myWarning + " | " + myPlanStatus;
+	if (!myThreadStatus.empty())
+		myWarning = myWarning.empty() ? myThreadStatus : myWarning + " | " + myThreadStatus;
+	if (!myExportStatus.empty())
+		myWarning = myWarning.empty() ? myExportStatus : myWarning + " | " + myExportStatus;
+	if (!myCalibStatus.empty())
+		myWarning = myWarning.empty() ? myCalibStatus : myWarning + " | " + myCalibStatus;
+	if (!mySolveStatus.empty())
+		myWarning = myWarning.empty() ? mySolveStatus : myWarning + " | " + mySolveStatus;
+	if (!myUndistortStatus.empty())
+		myWarning = myWarning.empty() ? myUndistortStatus : myWarning + " | " + myUndistortStatus;
+	if (!myFlatStatus.empty())
+		myWarning = myWarning.empty() ? myFlatStatus : myWarning + " | " + myFlatStatus;
+	if (!myDenoiseStatus.empty())
+		myWarning = myWarning.empty() ? myDenoiseStatus : myWarning + " | " + myDenoiseStatus;
+	if (myFlatField.capturing > 0 || !myFlatField.error.empty())
+	{
+		const std::string s = myFlatField.capturing > 0
+			? "Flat field: averaging a reference on " + std::to_string(myFlatField.capturing) + " camera(s)"
+			: "Flat field: " + myFlatField.error;
+		myWarning = myWarning.empty() ? s : myWarning + " | " + s;
+	}
+	if (myUndistorting && myCalibrating)
+	{
+		// Boards seen through undistortion would calibrate the undistorted image, not the lens.
+		const std::string s = "Calibration capture sees undistorted frames; turn Undistort Frames off while capturing";
+		myWarning = myWarning.empty() ? s : myWarning + " | " + s;
 	}
 
 	if (!ok)
@@ -193,14 +1493,20 @@ void BasicFilterTOP::execute(TOP_Output* output, const OP_Inputs* inputs, void*
 		return;
 	}
 
-	auto buf = myContext->createOutputBuffer((uint64_t)w*h*4, TOP_BufferFlags::None, nullptr);
-	std::memcpy(buf->data, myRGBA.data(), (size_t)w*h*4);
+	if (myParams.outputMode == OutputMode_AllCameras || myParams.outputMode == OutputMode_Array)
+		return;
+
+	auto buf = myContext->createOutputBuffer((uint64_t)w*h*bpp, TOP_BufferFlags::None, nullptr);
+	std::memcpy(buf->data, myFrame.data(), (size_t)w*h*bpp);
 
 	TOP_UploadInfo info;
 	info.textureDesc.width = w;
 	info.textureDesc.height = h;
-	info.textureDesc.pixelFormat = OP_PixelFormat::RGBA8Fixed;
-		info.textureDesc.texDim = OP_TexDim::e2D;
+	info.textureDesc.pixelFormat = fmt.pixelFormat;
+	info.textureDesc.texDim = OP_TexDim::e2D;
 	info.bufferOffset = 0;
 	output->uploadBuffer(&buf, info, nullptr);
+
+	if (myMaskBuffers)
+		uploadMask(output, devNum, 1);
 }
@@ -9,7 +9,13 @@
 
 #include "TOP_CPlusPlusBase.h"
 #include "Parameters.h"
+#include "MilManager.h"
+#include "BandwidthPlanner.h"
+#include "ThreadTuning.h"
+#include "FrameArena.h"
+#include "DaemonClient.h"
 
+#include <memory>
 #include <vector>
 #include <string>
 
@@ -27,19 +33,187 @@ public:
 	void getInfoPopupString(TD::OP_String* info, void* reserved) override;
 	void pulsePressed(const char* name, void* reserved) override;
 
-	int32_t getNumInfoCHOPChans(void* reserved) override { return 0; }
-	void getInfoCHOPChan(int32_t index, TD::OP_InfoCHOPChan* chan, void* reserved) override {}
-	bool getInfoDATSize(TD::OP_InfoDATSize* infoSize, void* reserved) override { return false; }
-	void getInfoDATEntries(int32_t index, int32_t nEntries, TD::OP_InfoDATEntries* entries, void* reserved) override {}
+	int32_t getNumInfoCHOPChans(void* reserved) override;
+	void getInfoCHOPChan(int32_t index, TD::OP_InfoCHOPChan* chan, void* reserved) override;
+	bool getInfoDATSize(TD::OP_InfoDATSize* infoSize, void* reserved) override;
+	void getInfoDATEntries(int32_t index, int32_t nEntries, TD::OP_InfoDATEntries* entries, void* reserved) override;
 
 	void setupParameters(TD::OP_ParameterManager* manager, void* reserved) override;
 
 private:
+	// MilManager, or the capture daemon's rings when Frame Source is Capture Daemon.
+	FrameSource& source();
+
+	// Creates or drops the daemon client for the Frame Source parameter. Returns true
+	// when the TOP went back to in-process capture and must push its full configuration.
+	bool applyFrameSource();
+
+	// Derives the output size from the digitizers' cached native formats.
+	// The TOP API version this plugin targets has no getOutputFormat() callback,
+	// so the result is applied to the upload's textureDesc in execute().
+	bool negotiateOutputFormat(TD::TOP_OutputFormat* format, int devNum);
+
+	// Maps the Pixel Format parameter (and, for Auto, the cameras' native depth)
+	// to the upload format and the matching FrameSource copy-out layout.
+	void resolvePixelFormat(TD::TOP_OutputFormat* format, int devNum);
+
+	// Reconfigures only the subsystems named in a ParamChange mask.
+	void reconfigure(unsigned changes);
+
+	// Retains the cameras this TOP reads (the selected one, or all) in MilManager
+	// and releases the ones it no longer needs.
+	void updateHeldCameras();
+
+	// Parses DCF Path + DCF Profiles into MilManager's validated profile cache.
+	void registerDcfProfiles();
+
+	// Switches 'cams' to the Active DCF Profile and records the time it took.
+	void applyDcfProfile(const std::vector<int>& cams);
+
+	// Plans frame-rate caps and inter-packet delays for every discovered camera and
+	// pushes them to the cameras; with the planner off, lifts the caps it set before.
+	void planBandwidth();
+
+	// Parses Capture/Worker Cores and pushes placement and priority to the MIL hook
+	// threads and the worker pool (both process-wide: the last TOP to change wins).
+	void applyThreadTuning();
+
+	// Starts, reconfigures or (if this TOP started it) stops the shared-memory export.
+	void applyFrameExport();
+
+	// Starts, retunes or (if this TOP started it) stops blob detection on all cameras.
+	void applyBlobDetection();
+
+	// Starts, retunes or (if this TOP started it) stops tracking on all cameras.
+	void applyTracking();
+
+	// Loads the Calibration File and starts, retunes or (if this TOP started it) stops
+	// triangulation. A file that doesn't load leaves it off, with the reason as a warning.
+	void applyTriangulation();
+
+	// Starts, retunes or (if this TOP started it) stops calibration board capture.
+	void applyCalibration();
+
+	// Loads the Calibration File and starts, updates or (if this TOP started it) stops
+	// undistortion. A file that doesn't load leaves it off, with the reason as a warning.
+	void applyUndistortion();
+
+	// Starts, updates or (if this TOP started it) stops flat-field correction.
+	void applyFlatField();
+
+	// Starts, retunes or (if this TOP started it) stops the temporal denoise filter.
+	void applyDenoise();
+
+	// Starts, retunes or (if this TOP started it) stops the background model on all cameras.
+	void applyBackgroundModel();
+
+	// Parses the Bayer Map parameter and pushes per-camera modes to MilManager.
+	// Cameras dropped from the map revert to Auto.
+	void applyBayerMap();
+	void applyGeometry();
+
+	// All Cameras mode: uploads each discovered camera's newest frame as its own
+	// color buffer (index == camera index). Returns the number of cameras with a frame.
+	int uploadAllCameras(TD::TOP_Output* output, int numCams, TD::OP_PixelFormat pixelFormat);
+
+	// Array mode: packs every camera into one layer of an e2DArray texture, one
+	// parallel copy per camera using the precomputed myLayers. Returns live cameras.
+	int uploadCameraArray(TD::TOP_Output* output, TD::OP_PixelFormat pixelFormat);
+
+	// Info CHOP channels of a camera's tracks; field counts from the first track channel.
+	void getTrackChan(int32_t cam, int32_t field, const std::string& prefix, TD::OP_InfoCHOPChan* chan);
+
+	// Info CHOP channels of the 3D points, field counts from the first point channel.
+	void getPointChan(int32_t field, TD::OP_InfoCHOPChan* chan);
+
+	// Info CHOP channels of the calibration capture, field counts from the first one.
+	void getCalibChan(int32_t field, TD::OP_InfoCHOPChan* chan);
+
+	// Uploads a camera's newest foreground mask (Mono8, black until the first one) as
+	// the given color buffer.
+	void uploadMask(TD::TOP_Output* output, int camIdx, uint32_t colorBufferIndex);
+
 	TD::TOP_Context* myContext = nullptr;
 	GevIQ24Params myParams;
-	std::vector<uint8_t> myRGBA;
+	FrameArena::Slot myFrame;	// single-camera frame or grid canvas
+	FrameSource::OutPixel myOutPixel = FrameSource::OutPixel::RGBA8;
+	std::unique_ptr<DaemonClient> myDaemon;	// set while Frame Source is Capture Daemon
+	std::vector<int> myBayerCams;
+
+	// Parameter changes not yet passed to reconfigure(): kept while disabled or without a source.
+	unsigned myPendingChanges = 0;
+
+	// Derived from the parameter snapshot on change, not every cook.
+	int myCamIdx = 0;
+	int myDevNum = 0;
+	std::vector<int> myHeldCams;
+
+	// Bandwidth plan shown in the Info DAT (empty when the planner is off).
+	BandwidthPlanner::Plan myPlan;
+	std::string myPlanStatus;
+
+	// Watchdog state as of this cook, for the Info CHOP.
+	MilManager::Health myHealth;
+
+	// Worst hook jitter / worker queue latency over all threads, last completed window.
+	ThreadTuning::LatencyStats::Window myHookLatency;
+	ThreadTuning::LatencyStats::Window myWorkerLatency;
+	std::string myThreadStatus;
+	std::string myExportStatus;	// shared-memory export problem, until its parameters change
+	bool myExporting = false;	// this TOP switched the export on
+	bool myDetecting = false;	// this TOP switched blob detection on
+	bool myMasking = false;		// this TOP switched the background model on
+	bool myTracking = false;	// this TOP switched tracking on
+	bool myTriangulating = false;	// this TOP switched triangulation on
+	std::string myCalibStatus;	// calibration file problem, until its parameters change
+	bool myCalibrating = false;	// this TOP switched calibration capture on
+	MilManager::CalibrationStatus myCalibration;	// polled each cook while capturing or solving
+	uint64_t myCalibSolves = 0;	// solves already reported
+	std::string mySolveStatus;	// last calibration solve result, until the next pulse
+	bool myUndistorting = false;	// this TOP switched undistortion on
+	std::string myUndistortStatus;	// calibration file problem, until its parameters change
+	bool myFlatFielding = false;	// this TOP switched flat-field correction on
+	MilManager::FlatFieldStatus myFlatField;	// polled each cook while on
+	std::string myFlatStatus;	// setup or capture request problem, until the next change or pulse
+	bool myDenoising = false;	// this TOP switched the temporal denoise filter on
+	std::string myDenoiseStatus;	// capture daemon notice, until its parameters change
+
+	// Newest detections and tracks per camera, snapshotted each cook for the Info CHOP.
+	std::vector<BlobDetector::Result> myBlobs;
+	std::vector<Tracker::Result> myTracks;
+	Triangulation::Result myPoints;
+
+	// Last DCF profile switch that did work (all cameras), and any profile error.
+	double myProfileSwitchMs = 0.0;
+	std::string myDcfStatus;
+
+	// Negotiated output, valid while source().formatGeneration() == myFormatGen.
+	TD::TOP_OutputFormat myFormat;
+	bool myFormatOk = false;
+	uint64_t myFormatGen = 0;
+	bool myMaskBuffers = false;	// myFormat ends with one mask buffer per camera shown
 	int myW = 1280;
 	int myH = 720;
+	int myGridCols = 1;
+	int myGridRows = 1;
+	int myTileW = 0;
+	int myTileH = 0;
+
+	// Persistent grid canvas: myFrame keeps last cook's pixels and myTileSeqs the frame
+	// sequence each cell was composed from, so idle cameras cost no pixel work.
+	std::vector<uint64_t> myTileSeqs;
+	int myTilesUpdated = 0;
+	int myCamerasLive = 0;
+
+	// Array mode layer layout, rebuilt only when the camera inventory changes.
+	struct ArrayLayer
+	{
+		size_t offset = 0;		// byte offset of the layer in the upload buffer
+		int camW = 0;			// camera's native size; smaller than the layer => margin
+		int camH = 0;
+	};
+	std::vector<ArrayLayer> myLayers;
+	size_t myLayerBytes = 0;
 	std::string myStatus;
 	std::string myWarning;
 	std::string myError;
@@ -0,0 +1,387 @@
+#include "BlobDetector.h"
+
+#include <algorithm>
+#include <cmath>
+
+#if defined(_M_X64) || defined(_M_AMD64) || defined(__x86_64__) || defined(__SSE2__)
+#define BLOBDETECTOR_SSE2 1
+#include <emmintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+#endif
+
+namespace BlobDetector
+{
+
+#if defined(BLOBDETECTOR_SSE2)
+static inline int lowestBit(unsigned m)
+{
+#if defined(_MSC_VER)
+    unsigned long i;
+    _BitScanForward(&i, m);
+    return (int)i;
+#else
+    return __builtin_ctz(m);
+#endif
+}
+#endif
+
+// Sum of k^2 for k in [0, n).
+static inline uint64_t sumSquares(uint64_t n)
+{
+    return n == 0 ? 0 : (n - 1) * n * (2 * n - 1) / 6;
+}
+
+uint32_t Labeler::find(uint32_t a)
+{
+    while (_parent[a] != a)
+    {
+        _parent[a] = _parent[_parent[a]];   // path halving
+        a = _parent[a];
+    }
+    return a;
+}
+
+uint32_t Labeler::unite(uint32_t a, uint32_t b)
+{
+    a = find(a);
+    b = find(b);
+    if (a == b)
+        return a;
+    if (b < a)
+        std::swap(a, b);
+
+    // The smaller node stays root and takes over the other set's sums.
+    _parent[b] = a;
+    Moments& r = _moments[a];
+    const Moments& m = _moments[b];
+    r.area += m.area;
+    r.sx += m.sx;
+    r.sy += m.sy;
+    r.sxx += m.sxx;
+    r.sxy += m.sxy;
+    r.syy += m.syy;
+    r.x0 = std::min(r.x0, m.x0);
+    r.y0 = std::min(r.y0, m.y0);
+    r.x1 = std::max(r.x1, m.x1);
+    r.y1 = std::max(r.y1, m.y1);
+    return a;
+}
+
+void Labeler::addRun(int x0, int x1, int y)
+{
+    // 8-connectivity: a previous-row run [a0, a1) touches [x0, x1) when a0 <= x1 and a1 >= x0.
+    // Both rows are in x order, so runs left of this one never touch a later one either.
+    while (_prevPos < _prev.size() && _prev[_prevPos].x1 < x0)
+        ++_prevPos;
+
+    uint32_t set = 0;
+    for (size_t k = _prevPos; k < _prev.size() && _prev[k].x0 <= x1; ++k)
+        set = set ? unite(set, _prev[k].set) : find(_prev[k].set);
+
+    if (set == 0)
+    {
+        set = (uint32_t)_parent.size();
+        _parent.push_back(set);
+        _moments.push_back(Moments{ 0, 0, 0, 0, 0, 0, x0, y, x1 - 1, y });
+    }
+
+    // Closed-form sums over the run's pixels x0..x1-1 on row y.
+    const uint64_t n = (uint64_t)(x1 - x0);
+    const uint64_t sx = ((uint64_t)x0 + (uint64_t)x1 - 1) * n / 2;
+    const uint64_t yy = (uint64_t)y;
+    Moments& m = _moments[set];
+    m.area += n;
+    m.sx += sx;
+    m.sy += n * yy;
+    m.sxx += sumSquares((uint64_t)x1) - sumSquares((uint64_t)x0);
+    m.sxy += sx * yy;
+    m.syy += n * yy * yy;
+    m.x0 = std::min(m.x0, x0);
+    m.x1 = std::max(m.x1, x1 - 1);
+    m.y1 = std::max(m.y1, y);
+
+    _cur.push_back(Run{ x0, x1, set });
+}
+
+void Labeler::detect(const uint8_t* src, size_t pitch, int w, int h, const Params& p, std::vector<Blob>& out)
+{
+    out.clear();
+    _prev.clear();
+    _cur.clear();
+    _parent.assign(1, 0);           // node 0 is "no set"
+    _moments.assign(1, Moments{});
+    _runCount = 0;
+    if (!src || w <= 0 || h <= 0)
+        return;
+
+    const uint8_t thr = (uint8_t)std::max(0, std::min(255, p.threshold));
+#if defined(BLOBDETECTOR_SSE2)
+    const __m128i vthr = _mm_set1_epi8((char)thr);
+#endif
+
+    for (int y = 0; y < h; ++y)
+    {
+        const uint8_t* row = src + (size_t)y * pitch;
+        _prev.swap(_cur);
+        _cur.clear();
+        _prevPos = 0;
+
+        bool inRun = false;
+        int start = 0;
+        int x = 0;
+#if defined(BLOBDETECTOR_SSE2)
+        for (; x + 16 <= w; x += 16)
+        {
+            // v >= thr  <=>  max(v, thr) == v
+            const __m128i v = _mm_loadu_si128((const __m128i*)(row + x));
+            const unsigned fg = (unsigned)_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_max_epu8(v, vthr), v));
+            // Bit i set where pixel i differs from pixel i-1 (the carry-in is the run state).
+            unsigned edges = (fg ^ ((fg << 1) | (inRun ? 1u : 0u))) & 0xFFFFu;
+            while (edges)
+            {
+                const int i = lowestBit(edges);
+                edges &= edges - 1;
+                if (!inRun)
+                    start = x + i;
+                else
+                    addRun(start, x + i, y);
+                inRun = !inRun;
+            }
+        }
+#endif
+        for (; x < w; ++x)
+        {
+            const bool fg = row[x] >= thr;
+            if (fg == inRun)
+                continue;
+            if (fg)
+                start = x;
+            else
+                addRun(start, x, y);
+            inRun = fg;
+        }
+        if (inRun)
+            addRun(start, w, y);
+        _runCount += _cur.size();
+    }
+
+    const uint64_t minArea = (uint64_t)std::max(1, p.minArea);
+    const uint64_t maxArea = p.maxArea > 0 ? (uint64_t)p.maxArea : UINT64_MAX;
+    for (size_t i = 1; i < _parent.size(); ++i)
+    {
+        const Moments& m = _moments[i];
+        if (_parent[i] != i || m.area < minArea || m.area > maxArea)
+            continue;
+
+        const double a = (double)m.area;
+        const double cx = (double)m.sx / a;
+        const double cy = (double)m.sy / a;
+        Blob b;
+        b.area = (uint32_t)m.area;
+        b.cx = (float)cx;
+        b.cy = (float)cy;
+        b.x0 = m.x0;
+        b.y0 = m.y0;
+        b.x1 = m.x1;
+        b.y1 = m.y1;
+        b.mxx = (float)((double)m.sxx / a - cx * cx);
+        b.mxy = (float)((double)m.sxy / a - cx * cy);
+        b.myy = (float)((double)m.syy / a - cy * cy);
+        out.push_back(b);
+    }
+
+    const size_t keep = (size_t)std::max(0, p.maxBlobs);
+    auto larger = [](const Blob& a, const Blob& b) { return a.area > b.area; };
+    if (out.size() > keep)
+    {
+        std::partial_sort(out.begin(), out.begin() + keep, out.end(), larger);
+        out.resize(keep);
+    }
+    else
+        std::sort(out.begin(), out.end(), larger);
+}
+
+template <typename T>
+static Marker refine(const uint8_t* frame, size_t pitch, int w, int h, const Blob& b, bool circleFit)
+{
+    auto row = [&](int y) { return reinterpret_cast<const T*>(frame + (size_t)y * pitch); };
+
+    // Ring box: the bounding box grown by the margin, clipped to the frame. Its outermost
+    // pixels are the background ring, everything inside is the marker's window.
+    const int m = kMarkerMargin;
+    const int rx0 = std::max(0, b.x0 - m), ry0 = std::max(0, b.y0 - m);
+    const int rx1 = std::min(w - 1, b.x1 + m), ry1 = std::min(h - 1, b.y1 + m);
+
+    Marker mk;
+    mk.x = b.cx;
+    mk.y = b.cy;
+    mk.radius = std::sqrt((float)b.area / 3.14159265f);
+
+    // Detection jobs run on many threads at once; each keeps its own scratch.
+    thread_local std::vector<uint32_t> ring;
+    ring.clear();
+    for (int y = ry0; y <= ry1; ++y)
+    {
+        const T* r = row(y);
+        if (y == b.y0 - m || y == b.y1 + m)
+        {
+            for (int x = rx0; x <= rx1; ++x)
+                ring.push_back(r[x]);
+            continue;
+        }
+        if (rx0 == b.x0 - m)
+            ring.push_back(r[rx0]);
+        if (rx1 == b.x1 + m)
+            ring.push_back(r[rx1]);
+    }
+    float bg = 0.0f;
+    if (!ring.empty())
+    {
+        std::nth_element(ring.begin(), ring.begin() + ring.size() / 2, ring.end());
+        bg = (float)ring[ring.size() / 2];
+    }
+
+    const int wx0 = std::max(0, b.x0 - m + 1), wy0 = std::max(0, b.y0 - m + 1);
+    const int wx1 = std::min(w - 1, b.x1 + m - 1), wy1 = std::min(h - 1, b.y1 + m - 1);
+    double sw = 0.0, swx = 0.0, swy = 0.0;
+    float peak = 0.0f;
+    for (int y = wy0; y <= wy1; ++y)
+    {
+        const T* r = row(y);
+        double rw = 0.0, rwx = 0.0;
+        for (int x = wx0; x <= wx1; ++x)
+        {
+            const float v = (float)r[x];
+            peak = std::max(peak, v);
+            const float d = v - bg;
+            if (d > 0.0f)
+            {
+                rw += d;
+                rwx += (double)d * x;
+            }
+        }
+        sw += rw;
+        swx += rwx;
+        swy += rw * y;
+    }
+    mk.peak = peak;
+    mk.background = bg;
+    mk.weight = (float)sw;
+    if (sw > 0.0)
+    {
+        mk.x = (float)(swx / sw);
+        mk.y = (float)(swy / sw);
+    }
+    if (!circleFit || peak <= bg)
+        return mk;
+
+    // Half-height crossings, linearly interpolated, scanning in from both ends of every
+    // row and column of the window.
+    const float level = bg + 0.5f * (peak - bg);
+    thread_local std::vector<float> ex, ey;
+    ex.clear();
+    ey.clear();
+    for (int y = wy0; y <= wy1; ++y)
+    {
+        const T* r = row(y);
+        for (int x = wx0 + 1; x <= wx1; ++x)
+            if ((float)r[x - 1] < level && (float)r[x] >= level)
+            {
+                ex.push_back((float)(x - 1) + (level - (float)r[x - 1]) / ((float)r[x] - (float)r[x - 1]));
+                ey.push_back((float)y);
+                break;
+            }
+        for (int x = wx1 - 1; x >= wx0; --x)
+            if ((float)r[x + 1] < level && (float)r[x] >= level)
+            {
+                ex.push_back((float)x + ((float)r[x] - level) / ((float)r[x] - (float)r[x + 1]));
+                ey.push_back((float)y);
+                break;
+            }
+    }
+    for (int x = wx0; x <= wx1; ++x)
+    {
+        for (int y = wy0 + 1; y <= wy1; ++y)
+        {
+            const float a = (float)row(y - 1)[x], c = (float)row(y)[x];
+            if (a < level && c >= level)
+            {
+                ex.push_back((float)x);
+                ey.push_back((float)(y - 1) + (level - a) / (c - a));
+                break;
+            }
+        }
+        for (int y = wy1 - 1; y >= wy0; --y)
+        {
+            const float a = (float)row(y + 1)[x], c = (float)row(y)[x];
+            if (a < level && c >= level)
+            {
+                ex.push_back((float)x);
+                ey.push_back((float)y + (c - level) / (c - a));
+                break;
+            }
+        }
+    }
+    const size_t n = ex.size();
+    if (n < 6)
+        return mk;
+
+    // Kasa fit on centered points: u^2 + v^2 + D u + E v + F = 0, where the centering
+    // makes the sums of u and v vanish and decouples F.
+    double mx = 0.0, my = 0.0;
+    for (size_t i = 0; i < n; ++i)
+    {
+        mx += ex[i];
+        my += ey[i];
+    }
+    mx /= (double)n;
+    my /= (double)n;
+    double suu = 0.0, suv = 0.0, svv = 0.0, suz = 0.0, svz = 0.0, sz = 0.0;
+    for (size_t i = 0; i < n; ++i)
+    {
+        const double u = ex[i] - mx, v = ey[i] - my, z = u * u + v * v;
+        suu += u * u;
+        suv += u * v;
+        svv += v * v;
+        suz += u * z;
+        svz += v * z;
+        sz += z;
+    }
+    const double det = suu * svv - suv * suv;
+    if (det <= 1e-9 * (suu + svv) * (suu + svv))
+        return mk;
+    const double D = (-suz * svv + svz * suv) / det;
+    const double E = (-svz * suu + suz * suv) / det;
+    const double F = -sz / (double)n;
+    const double r2 = 0.25 * (D * D + E * E) - F;
+    if (r2 <= 0.0)
+        return mk;
+
+    const double cx = mx - 0.5 * D, cy = my - 0.5 * E, r = std::sqrt(r2);
+    if (cx < b.x0 - 0.5 || cx > b.x1 + 0.5 || cy < b.y0 - 0.5 || cy > b.y1 + 0.5)
+        return mk;
+    double se = 0.0;
+    for (size_t i = 0; i < n; ++i)
+    {
+        const double e = std::hypot(ex[i] - cx, ey[i] - cy) - r;
+        se += e * e;
+    }
+    mk.x = (float)cx;
+    mk.y = (float)cy;
+    mk.radius = (float)r;
+    mk.fitRms = (float)std::sqrt(se / (double)n);
+    return mk;
+}
+
+Marker refineMarker(const uint8_t* frame, size_t pitch, int bytesPerSample, int w, int h, const Blob& b, bool circleFit)
+{
+    if (!frame || w <= 0 || h <= 0)
+        return Marker();
+    if (bytesPerSample == 2)
+        return refine<uint16_t>(frame, pitch, w, h, b, circleFit);
+    return refine<uint8_t>(frame, pitch, w, h, b, circleFit);
+}
+
+}
@@ -0,0 +1,111 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Bright-blob detection on 8-bit mono frames: global threshold, 8-connected
+// components, then area, centroid, second moments and bounding box per component.
+//
+// Labeling works on run-length segments rather than pixels: each row is thresholded
+// 16 pixels at a time into runs, runs touching a run of the previous row are merged
+// with union-find, and every run adds its closed-form moment sums to its set. No
+// label image is written, so the cost follows the number of runs, not the frame size.
+// Scratch memory lives in a Labeler so a camera reuses it frame after frame.
+namespace BlobDetector
+{
+    struct Params
+    {
+        bool enabled = false;
+        int threshold = 200;    // foreground is value >= threshold
+        int minArea = 4;        // pixels; smaller components are noise
+        int maxArea = 0;        // pixels, 0 = no limit
+        int maxBlobs = 64;      // largest blobs kept per frame
+        bool markers = false;   // also refine every kept blob into a Marker (refineMarker)
+        bool circleFit = false; // markers: position from a circle fitted to the blob's edge
+    };
+
+    struct Blob
+    {
+        float cx = 0.0f;        // centroid, pixel centers at integer coordinates
+        float cy = 0.0f;
+        uint32_t area = 0;
+        int x0 = 0, y0 = 0;     // bounding box, inclusive
+        int x1 = 0, y1 = 0;
+        float mxx = 0.0f;       // central second moments (covariance of the pixel positions)
+        float mxy = 0.0f;
+        float myy = 0.0f;
+    };
+
+    // Sub-pixel position of a bright marker (e.g. a retroreflector), refined from its
+    // Blob on the full-depth frame.
+    struct Marker
+    {
+        float x = 0.0f;         // circle center when fitted, else intensity-weighted centroid
+        float y = 0.0f;
+        float radius = 0.0f;    // fitted circle, else the radius of a disc of the blob's area
+        float fitRms = -1.0f;   // circle fit residual in pixels, -1 = no fit
+        float peak = 0.0f;      // brightest sample, in frame units
+        float background = 0.0f;    // median of the ring around the blob
+        float weight = 0.0f;    // sum of background-subtracted samples
+    };
+
+    // Refines blob b on the frame it was found in. bytesPerSample is 1 (8-bit) or 2
+    // (16-bit, any left-aligned depth). The background is the median of a one-pixel ring
+    // kMarkerMargin pixels outside the bounding box; samples inside the ring weigh
+    // max(0, value - background). With circleFit, half-height crossings along rows and
+    // columns are fitted with an algebraic (Kasa) circle; a fit that is degenerate or
+    // lands outside the box falls back to the centroid.
+    constexpr int kMarkerMargin = 3;
+    Marker refineMarker(const uint8_t* frame, size_t pitch, int bytesPerSample, int w, int h, const Blob& b, bool circleFit);
+
+    // One camera's detections for one frame.
+    struct Result
+    {
+        std::vector<Blob> blobs;    // largest first
+        std::vector<Marker> markers;    // blobs[i] refined, when Params::markers
+        uint64_t frameSeq = 0;      // capture sequence the frame had
+        uint64_t timestampNs = 0;   // frame arrival, SharedFrames::nowNs() clock
+        int width = 0;
+        int height = 0;
+        double detectUs = 0.0;      // time spent in detect()
+    };
+
+    class Labeler
+    {
+    public:
+        // Replaces 'out' with the blobs of a w x h frame (pitch bytes per row).
+        void detect(const uint8_t* src, size_t pitch, int w, int h, const Params& p, std::vector<Blob>& out);
+
+        // Runs found by the last detect(), for profiling.
+        size_t runCount() const { return _runCount; }
+
+    private:
+        struct Run
+        {
+            int x0;             // first pixel
+            int x1;             // one past the last pixel
+            uint32_t set;       // union-find node
+        };
+
+        // Raw sums over a set's pixels; merged into the root on union.
+        struct Moments
+        {
+            uint64_t area;
+            uint64_t sx, sy;
+            uint64_t sxx, sxy, syy;
+            int x0, y0, x1, y1;
+        };
+
+        void addRun(int x0, int x1, int y);
+        uint32_t find(uint32_t a);
+        uint32_t unite(uint32_t a, uint32_t b);
+
+        std::vector<Run> _prev;         // runs of the previous row
+        std::vector<Run> _cur;          // runs of the row being scanned
+        std::vector<uint32_t> _parent;  // union-find; roots are the smallest node of a set
+        std::vector<Moments> _moments;  // per node, valid at roots
+        size_t _prevPos = 0;            // first previous-row run that can still touch a new run
+        size_t _runCount = 0;
+    };
+}
@@ -0,0 +1,464 @@
+#include "BoardDetector.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+
+namespace BoardDetector
+{
+
+// ChESS ring on the half-size frame: 16 samples, radius 4, in angular order.
+static const int kRing[16][2] = {
+    { 4, 0 }, { 4, 2 }, { 3, 3 }, { 2, 4 }, { 0, 4 }, { -2, 4 }, { -3, 3 }, { -4, 2 },
+    { -4, 0 }, { -4, -2 }, { -3, -3 }, { -2, -4 }, { 0, -4 }, { 2, -4 }, { 3, -3 }, { 4, -2 } };
+static const int kRingRadius = 4;
+
+// Candidates respond at least this much, and this fraction of the strongest.
+static const float kMinResponse = 40.0f;
+static const float kRelativeResponse = 0.1f;
+static const size_t kMaxCandidates = 2048;
+
+// Strongest candidates tried as the lattice seed before giving up on a frame.
+static const int kSeeds = 12;
+
+// A square side crosses at least this contrast per unit of ChESS response (which grows
+// with the board's contrast).
+static const float kSideContrast = 0.05f;
+
+// Boards seen so obliquely that a square side is shorter than this (pixels) are skipped:
+// their corners are too close together to be placed reliably.
+static const float kMinStep = 8.0f;
+
+// Largest second difference along a row or column, as a fraction of the local step.
+static const float kMaxBend = 0.3f;
+
+// A neighbor is looked for within this fraction of the predicted step to it.
+static const float kSearchRadius = 0.3f;
+
+void Detector::halfSize(const uint8_t* src, size_t pitch, int w, int h)
+{
+    _hw = w / 2;
+    _hh = h / 2;
+    _half.resize((size_t)_hw * _hh);
+    for (int y = 0; y < _hh; ++y)
+    {
+        const uint8_t* a = src + (size_t)(2 * y) * pitch;
+        const uint8_t* b = a + pitch;
+        uint8_t* d = _half.data() + (size_t)y * _hw;
+        for (int x = 0; x < _hw; ++x)
+            d[x] = (uint8_t)((a[2 * x] + a[2 * x + 1] + b[2 * x] + b[2 * x + 1] + 2) >> 2);
+    }
+}
+
+void Detector::findCandidates()
+{
+    _candidates.clear();
+    _response.assign((size_t)_hw * _hh, 0.0f);
+    const int b = kRingRadius;
+    if (_hw <= 2 * b + 2 || _hh <= 2 * b + 2)
+        return;
+
+    int offsets[16];
+    for (int n = 0; n < 16; ++n)
+        offsets[n] = kRing[n][1] * _hw + kRing[n][0];
+    float strongest = 0.0f;
+    for (int y = b; y < _hh - b; ++y)
+    {
+        const uint8_t* row = _half.data() + (size_t)y * _hw;
+        float* r = _response.data() + (size_t)y * _hw;
+        for (int x = b; x < _hw - b; ++x)
+        {
+            const uint8_t* p = row + x;
+            int s[16], total = 0;
+            for (int n = 0; n < 16; ++n)
+            {
+                s[n] = p[offsets[n]];
+                total += s[n];
+            }
+            int sum = 0, diff = 0;
+            for (int n = 0; n < 4; ++n)
+                sum += std::abs(s[n] + s[n + 8] - s[n + 4] - s[n + 12]);
+            for (int n = 0; n < 8; ++n)
+                diff += std::abs(s[n] - s[n + 8]);
+            // Ring mean against the mean of the center cross, both scaled to 16 samples.
+            const int local = p[0] + p[-1] + p[1] + p[-_hw] + p[_hw];
+            const float mean = (float)std::abs(5 * total - 16 * local) / 5.0f;
+            r[x] = (float)(sum - diff) - mean;
+            strongest = std::max(strongest, r[x]);
+        }
+    }
+
+    // Local maxima over 5x5, refined by a parabola through the neighbors.
+    const float threshold = std::max(kMinResponse, kRelativeResponse * strongest);
+    for (int y = b + 2; y < _hh - b - 2; ++y)
+    {
+        const float* r = _response.data() + (size_t)y * _hw;
+        for (int x = b + 2; x < _hw - b - 2; ++x)
+        {
+            const float v = r[x];
+            if (v < threshold)
+                continue;
+            bool peak = true;
+            for (int dy = -2; dy <= 2 && peak; ++dy)
+                for (int dx = -2; dx <= 2; ++dx)
+                {
+                    const float n = r[dy * _hw + x + dx];
+                    // Ties go to the first in scan order, so a plateau yields one corner.
+                    if (n > v || (n == v && (dy < 0 || (dy == 0 && dx < 0))))
+                    {
+                        peak = false;
+                        break;
+                    }
+                }
+            if (!peak)
+                continue;
+            auto vertex = [](float l, float c, float rr)
+            {
+                const float d = l - 2.0f * c + rr;
+                return d < 0.0f ? std::max(-0.5f, std::min(0.5f, 0.5f * (l - rr) / d)) : 0.0f;
+            };
+            const float ox = vertex(r[x - 1], v, r[x + 1]);
+            const float oy = vertex(r[x - _hw], v, r[x + _hw]);
+            // Half-size pixel x covers full pixels 2x and 2x + 1.
+            _candidates.push_back(Candidate{ 2.0f * (x + ox) + 0.5f, 2.0f * (y + oy) + 0.5f, v });
+        }
+    }
+    std::sort(_candidates.begin(), _candidates.end(), [](const Candidate& a, const Candidate& c) { return a.response > c.response; });
+    if (_candidates.size() > kMaxCandidates)
+        _candidates.resize(kMaxCandidates);
+}
+
+int Detector::nearest(float x, float y, float radius) const
+{
+    float best = radius * radius;
+    int found = -1;
+    for (int k = 0; k < (int)_candidates.size(); ++k)
+    {
+        const float dx = _candidates[k].x - x, dy = _candidates[k].y - y;
+        const float d2 = dx * dx + dy * dy;
+        if (d2 < best && _owner[k] < 0)
+        {
+            best = d2;
+            found = k;
+        }
+    }
+    return found;
+}
+
+bool Detector::adjacent(const Candidate& a, const Candidate& b) const
+{
+    // Two corners joined by a square side have the same dark and light square on either
+    // side of it all along. A square diagonal has one square on both sides, and longer
+    // jumps cross squares and sides.
+    auto sample = [this](float x, float y)
+    {
+        x = std::min((float)_hw - 1.001f, std::max(0.0f, x));
+        y = std::min((float)_hh - 1.001f, std::max(0.0f, y));
+        const int ix = (int)x, iy = (int)y;
+        const float fx = x - ix, fy = y - iy;
+        const uint8_t* p = _half.data() + (size_t)iy * _hw + ix;
+        return (1.0f - fy) * ((1.0f - fx) * p[0] + fx * p[1]) + fy * ((1.0f - fx) * p[_hw] + fx * p[_hw + 1]);
+    };
+    // Probe 1.5 half-size pixels off the side (a quarter of it on short sides), clear of
+    // the blur along it but inside squares foreshortened to a few pixels.
+    const float len = 0.5f * std::sqrt((b.x - a.x) * (b.x - a.x) + (b.y - a.y) * (b.y - a.y));
+    if (len < 2.0f)
+        return false;
+    const float off = std::min(1.5f, 0.25f * len) / len;
+    const float nx = -0.5f * off * (b.y - a.y), ny = 0.5f * off * (b.x - a.x);   // half-size frame
+    const float need = kSideContrast * std::min(a.response, b.response);
+    float sign = 0.0f;
+    for (int k = 1; k <= 3; ++k)
+    {
+        const float t = 0.25f * k;
+        const float x = 0.5f * (a.x + t * (b.x - a.x)) - 0.25f, y = 0.5f * (a.y + t * (b.y - a.y)) - 0.25f;
+        const float c = sample(x + nx, y + ny) - sample(x - nx, y - ny);
+        if (std::fabs(c) < need || c * sign < 0.0f)
+            return false;
+        sign = c;
+    }
+    return true;
+}
+
+bool Detector::grow(int seed, const Params& p, std::vector<Corner>& out)
+{
+    const int n = (int)_candidates.size();
+    _owner.assign((size_t)n, -1);
+    _nodes.clear();
+
+    // Lattice steps at the seed: its nearest neighbor along a square side, then the
+    // nearest one across it.
+    const Candidate& s = _candidates[seed];
+    int first = -1, second = -1;
+    float firstD = 1e30f, secondD = 1e30f;
+    for (int k = 0; k < n; ++k)
+    {
+        if (k == seed)
+            continue;
+        const float dx = _candidates[k].x - s.x, dy = _candidates[k].y - s.y;
+        const float d = dx * dx + dy * dy;
+        if (d < firstD && adjacent(s, _candidates[k]))
+        {
+            firstD = d;
+            first = k;
+        }
+    }
+    if (first < 0)
+        return false;
+    const float ux = _candidates[first].x - s.x, uy = _candidates[first].y - s.y;
+    for (int k = 0; k < n; ++k)
+    {
+        if (k == seed || k == first)
+            continue;
+        const float dx = _candidates[k].x - s.x, dy = _candidates[k].y - s.y;
+        const float d = dx * dx + dy * dy;
+        if (d < secondD && std::fabs(dx * ux + dy * uy) < 0.9f * std::sqrt(d * firstD) && adjacent(s, _candidates[k]))
+        {
+            secondD = d;
+            second = k;
+        }
+    }
+    if (second < 0 || secondD > 9.0f * firstD)
+        return false;
+
+    // Grow breadth-first on a (2M + 1)^2 lattice around the seed.
+    const int span = std::max(p.cols, p.rows);
+    const int side = 2 * span + 1;
+    _grid.assign((size_t)side * side, -1);
+    int iMin = 0, iMax = 0, jMin = 0, jMax = 0;
+    auto place = [&](int cand, int i, int j, float ax, float ay, float bx, float by)
+    {
+        _owner[cand] = (int)_nodes.size();
+        _grid[(size_t)(j + span) * side + (i + span)] = (int)_nodes.size();
+        _nodes.push_back(Node{ cand, i, j, ax, ay, bx, by });
+        iMin = std::min(iMin, i);
+        iMax = std::max(iMax, i);
+        jMin = std::min(jMin, j);
+        jMax = std::max(jMax, j);
+    };
+    place(seed, 0, 0, ux, uy, _candidates[second].x - s.x, _candidates[second].y - s.y);
+    auto at = [&](int i, int j) -> const Candidate*
+    {
+        if (i < -span || i > span || j < -span || j > span)
+            return nullptr;
+        const int node = _grid[(size_t)(j + span) * side + (i + span)];
+        return node < 0 ? nullptr : &_candidates[_nodes[node].candidate];
+    };
+    // Sweeps until nothing is added: a corner missed from one side may be found from another.
+    for (bool grew = true; grew;)
+    {
+        grew = false;
+        for (size_t q = 0; q < _nodes.size(); ++q)
+        {
+            static const int kDirs[4][2] = { { 1, 0 }, { -1, 0 }, { 0, 1 }, { 0, -1 } };
+            for (const auto& dir : kDirs)
+            {
+                const Node nd = _nodes[q];
+                const int i = nd.i + dir[0], j = nd.j + dir[1];
+                if (std::max(iMax, i) - std::min(iMin, i) >= span || std::max(jMax, j) - std::min(jMin, j) >= span)
+                    continue;
+                if (at(i, j))
+                    continue;
+
+                // Prediction, best first: completing a parallelogram with a found neighbor,
+                // extending a straight line of two corners, then the step stored here.
+                const Candidate& c = _candidates[nd.candidate];
+                float px = c.x + dir[0] * nd.ux + dir[1] * nd.vx, py = c.y + dir[0] * nd.uy + dir[1] * nd.vy;
+                const Candidate* across = nullptr;
+                for (int e = -1; e <= 1 && !across; e += 2)
+                {
+                    const int ei = dir[1] * e, ej = dir[0] * e;
+                    const Candidate* b = at(i + ei, j + ej);
+                    const Candidate* d = at(nd.i + ei, nd.j + ej);
+                    if (b && d)
+                    {
+                        px = c.x + b->x - d->x;
+                        py = c.y + b->y - d->y;
+                        across = b;
+                    }
+                }
+                if (!across)
+                    if (const Candidate* back = at(nd.i - dir[0], nd.j - dir[1]))
+                    {
+                        px = 2.0f * c.x - back->x;
+                        py = 2.0f * c.y - back->y;
+                    }
+                const float step = std::sqrt((px - c.x) * (px - c.x) + (py - c.y) * (py - c.y));
+                const int k = nearest(px, py, kSearchRadius * step);
+                if (k < 0 || !adjacent(c, _candidates[k]))
+                    continue;
+                // The step just taken replaces the stored one, so the lattice follows perspective.
+                const float mx = (_candidates[k].x - c.x) * (dir[0] + dir[1]), my = (_candidates[k].y - c.y) * (dir[0] + dir[1]);
+                if (dir[0] != 0)
+                    place(k, i, j, mx, my, nd.vx, nd.vy);
+                else
+                    place(k, i, j, nd.ux, nd.uy, mx, my);
+                grew = true;
+            }
+        }
+    }
+
+    int si = iMax - iMin + 1, sj = jMax - jMin + 1;
+    const bool transposed = si != p.cols;
+    if (transposed)
+        std::swap(si, sj);
+    if (si != p.cols || sj != p.rows || (int)_nodes.size() != p.cols * p.rows)
+        return false;
+
+    out.resize(_nodes.size());
+    for (const Node& nd : _nodes)
+    {
+        int i = nd.i - iMin, j = nd.j - jMin;
+        if (transposed)
+            std::swap(i, j);
+        out[(size_t)j * p.cols + i] = Corner{ _candidates[nd.candidate].x, _candidates[nd.candidate].y };
+    }
+
+    // Viewed from the front, j turns clockwise from i (image y points down).
+    const Corner& o = out[0];
+    const Corner& a = out[(size_t)p.cols - 1];
+    const Corner& b = out[(size_t)(p.rows - 1) * p.cols];
+    if ((a.x - o.x) * (b.y - o.y) - (a.y - o.y) * (b.x - o.x) < 0.0f)
+        for (int j = 0; j < p.rows / 2; ++j)
+            std::swap_ranges(out.begin() + (size_t)j * p.cols, out.begin() + (size_t)(j + 1) * p.cols,
+                out.begin() + (size_t)(p.rows - 1 - j) * p.cols);
+    return true;
+}
+
+void Detector::refine(const uint8_t* src, size_t pitch, int w, int h, float radius, Corner& c) const
+{
+    // The corner is where every gradient in the window is orthogonal to the offset from it:
+    // sum(g g^T) q = sum(g g^T p), solved repeatedly around the new estimate.
+    const int r = std::max(2, (int)radius);
+    const float sigma2 = 0.5f * r * r;
+    float qx = c.x, qy = c.y;
+    for (int it = 0; it < 10; ++it)
+    {
+        const int cx = (int)std::lround(qx), cy = (int)std::lround(qy);
+        if (cx - r < 1 || cy - r < 1 || cx + r > w - 2 || cy + r > h - 2)
+            return;
+        double a = 0.0, bb = 0.0, d = 0.0, ex = 0.0, ey = 0.0;
+        for (int dy = -r; dy <= r; ++dy)
+        {
+            const uint8_t* row = src + (size_t)(cy + dy) * pitch;
+            for (int dx = -r; dx <= r; ++dx)
+            {
+                const int x = cx + dx;
+                const float gx = 0.5f * ((float)row[x + 1] - (float)row[x - 1]);
+                const float gy = 0.5f * ((float)*(row + x + pitch) - (float)*(row + x - pitch));
+                const float wgt = std::exp(-(float)(dx * dx + dy * dy) / sigma2);
+                const double gxx = wgt * gx * gx, gxy = wgt * gx * gy, gyy = wgt * gy * gy;
+                a += gxx;
+                bb += gxy;
+                d += gyy;
+                ex += gxx * x + gxy * (cy + dy);
+                ey += gxy * x + gyy * (cy + dy);
+            }
+        }
+        const double det = a * d - bb * bb;
+        if (det <= 1e-9 * (a + d) * (a + d))
+            return;
+        const float nx = (float)((d * ex - bb * ey) / det), ny = (float)((a * ey - bb * ex) / det);
+        const float moved = std::fabs(nx - qx) + std::fabs(ny - qy);
+        qx = nx;
+        qy = ny;
+        if (moved < 0.005f)
+            break;
+    }
+    if (std::fabs(qx - c.x) > radius || std::fabs(qy - c.y) > radius)
+        return;     // wandered off to another feature; keep the coarse position
+    c.x = qx;
+    c.y = qy;
+}
+
+float Detector::cellMean(const uint8_t* src, size_t pitch, int w, int h, const Corner* quad) const
+{
+    // 3x3 mean at the center of four corners.
+    const int cx = (int)std::lround(0.25f * (quad[0].x + quad[1].x + quad[2].x + quad[3].x));
+    const int cy = (int)std::lround(0.25f * (quad[0].y + quad[1].y + quad[2].y + quad[3].y));
+    int sum = 0;
+    for (int y = std::max(0, cy - 1); y <= std::min(h - 1, cy + 1); ++y)
+        for (int x = std::max(0, cx - 1); x <= std::min(w - 1, cx + 1); ++x)
+            sum += src[(size_t)y * pitch + x];
+    return (float)sum / 9.0f;
+}
+
+bool Detector::detect(const uint8_t* src, size_t pitch, int w, int h, const Params& p, std::vector<Corner>& out)
+{
+    out.clear();
+    if (p.cols < 3 || p.rows < 3)
+        return false;
+    halfSize(src, pitch, w, h);
+    findCandidates();
+    if ((int)_candidates.size() < p.cols * p.rows)
+        return false;
+
+    const int seeds = std::min((int)_candidates.size(), kSeeds);
+    bool found = false;
+    for (int s = 0; s < seeds && !found; ++s)
+        found = grow(s, p, out);
+    if (!found)
+    {
+        out.clear();
+        return false;
+    }
+
+    // Refinement window: about a third of the shorter local square side. Neighbors are
+    // measured before any corner moves.
+    _steps.resize(out.size());
+    for (int j = 0; j < p.rows; ++j)
+        for (int i = 0; i < p.cols; ++i)
+        {
+            const Corner& c = out[(size_t)j * p.cols + i];
+            const Corner& a = out[(size_t)j * p.cols + (i + 1 < p.cols ? i + 1 : i - 1)];
+            const Corner& b = out[(size_t)(j + 1 < p.rows ? j + 1 : j - 1) * p.cols + i];
+            _steps[(size_t)j * p.cols + i] = std::sqrt(std::min((a.x - c.x) * (a.x - c.x) + (a.y - c.y) * (a.y - c.y),
+                (b.x - c.x) * (b.x - c.x) + (b.y - c.y) * (b.y - c.y)));
+        }
+    if (*std::min_element(_steps.begin(), _steps.end()) < kMinStep)
+    {
+        out.clear();
+        return false;
+    }
+    for (size_t k = 0; k < out.size(); ++k)
+        refine(src, pitch, w, h, std::min(10.0f, 0.35f * _steps[k]), out[k]);
+
+    // Rows and columns are nearly straight and evenly spaced; a corner that isn't was taken
+    // from some other feature.
+    auto bent = [&out](size_t a, size_t b, size_t c)
+    {
+        const float dx = out[a].x - 2.0f * out[b].x + out[c].x, dy = out[a].y - 2.0f * out[b].y + out[c].y;
+        const float sx = out[c].x - out[a].x, sy = out[c].y - out[a].y;
+        return 4.0f * (dx * dx + dy * dy) > kMaxBend * kMaxBend * (sx * sx + sy * sy);
+    };
+    for (int j = 0; j < p.rows; ++j)
+        for (int i = 1; i + 1 < p.cols; ++i)
+        {
+            const size_t k = (size_t)j * p.cols + i;
+            if (bent(k - 1, k, k + 1))
+            {
+                out.clear();
+                return false;
+            }
+        }
+    for (int j = 1; j + 1 < p.rows; ++j)
+        for (int i = 0; i < p.cols; ++i)
+        {
+            const size_t k = (size_t)j * p.cols + i;
+            if (bent(k - p.cols, k, k + p.cols))
+            {
+                out.clear();
+                return false;
+            }
+        }
+
+    // Corner 0 belongs to a dark square; a light one means the numbering starts at the
+    // opposite corner (a half turn keeps the handedness).
+    const Corner origin[4] = { out[0], out[1], out[(size_t)p.cols], out[(size_t)p.cols + 1] };
+    const Corner next[4] = { out[1], out[2], out[(size_t)p.cols + 1], out[(size_t)p.cols + 2] };
+    if (cellMean(src, pitch, w, h, origin) > cellMean(src, pitch, w, h, next))
+        std::reverse(out.begin(), out.end());
+    return true;
+}
+
+}
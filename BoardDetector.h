@@ -0,0 +1,78 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Checkerboard detection on 8-bit mono frames, for calibration.
+//
+// 1. X-corners (where two dark and two light squares meet) are found on a half-size copy
+//    of the frame with the ChESS response: opposite samples of a ring agree, neighboring
+//    quarter-turns disagree. Local maxima above a fraction of the strongest are candidates.
+// 2. From the strongest candidates, a lattice is grown: a missing neighbor is predicted by
+//    completing a parallelogram or extending a row or column of found corners, which
+//    follows perspective, and has to share a dark/light edge with the corner it extends.
+//    The board is found when the lattice is exactly cols x rows corners, in straight lines.
+// 3. Every corner is refined on the full frame to the point where the image gradients in
+//    a window are orthogonal to the offsets from it (the usual saddle-point refinement).
+//
+// Corners are numbered row-major, with i along the 'cols' side. When the board is viewed
+// from the front, j points 90 degrees clockwise from i. Corner 0 is the corner of a dark
+// square. With cols + rows odd (for example 9 x 6) this makes the numbering unique, so
+// several cameras agree on it. Square boards (cols == rows) stay ambiguous by 90 degrees.
+// Squares should be at least ~16 pixels wide and the whole board has to be in view.
+namespace BoardDetector
+{
+    struct Params
+    {
+        int cols = 9;           // inner corners along one side
+        int rows = 6;           // inner corners along the other
+    };
+
+    struct Corner
+    {
+        float x = 0.0f;         // pixel centers at integer coordinates
+        float y = 0.0f;
+    };
+
+    class Detector
+    {
+    public:
+        // Replaces 'out' with the cols * rows corners of the board in a w x h frame (pitch
+        // bytes per row). False, with 'out' empty, unless the whole board was found.
+        bool detect(const uint8_t* src, size_t pitch, int w, int h, const Params& p, std::vector<Corner>& out);
+
+    private:
+        struct Candidate
+        {
+            float x, y;         // full-frame pixels
+            float response;
+        };
+
+        struct Node
+        {
+            int candidate;
+            int i, j;
+            float ux, uy;       // lattice step along i here
+            float vx, vy;       // and along j
+        };
+
+        void halfSize(const uint8_t* src, size_t pitch, int w, int h);
+        void findCandidates();
+        bool adjacent(const Candidate& a, const Candidate& b) const;
+        bool grow(int seed, const Params& p, std::vector<Corner>& out);
+        int nearest(float x, float y, float radius) const;
+        void refine(const uint8_t* src, size_t pitch, int w, int h, float radius, Corner& c) const;
+        float cellMean(const uint8_t* src, size_t pitch, int w, int h, const Corner* quad) const;
+
+        int _hw = 0, _hh = 0;
+        std::vector<uint8_t> _half;         // 2x2 box-filtered frame
+        std::vector<float> _response;       // ChESS response over _half
+        std::vector<Candidate> _candidates; // strongest first
+        std::vector<int> _owner;            // candidate -> node, -1 = free
+        std::vector<Node> _nodes;
+        std::vector<int> _queue;
+        std::vector<int> _grid;             // lattice cell -> node, while growing
+        std::vector<float> _steps;          // shorter lattice step at each corner
+    };
+}
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+// Pinhole camera models of the rig and the calibration file that stores them.
+//
+// Intrinsics follow the usual 5-coefficient model (k1, k2, p1, p2, k3: radial and
+// tangential distortion of normalized coordinates). Extrinsics map world to camera,
+// x_cam = R * X + t, in whatever unit the calibration was made in (board squares are
+// usually given in millimeters). Pixel centers sit at integer coordinates, as for
+// BlobDetector's centroids.
+//
+// File format, text, one block per calibrated camera ('#' starts a comment):
+//
+//   camera 3
+//   size 1920 1200
+//   intrinsics fx fy cx cy
+//   distortion k1 k2 p1 p2 k3
+//   rotation r00 r01 r02 r10 r11 r12 r20 r21 r22
+//   translation tx ty tz
+//   rms 0.21
+namespace Calibration
+{
+    struct Camera
+    {
+        bool valid = false;     // false for cameras the file doesn't describe
+        int width = 0;
+        int height = 0;
+        double fx = 0.0, fy = 0.0;
+        double cx = 0.0, cy = 0.0;
+        double k1 = 0.0, k2 = 0.0, p1 = 0.0, p2 = 0.0, k3 = 0.0;
+        double R[9] = { 1, 0, 0, 0, 1, 0, 0, 0, 1 };   // world to camera, row-major
+        double t[3] = { 0, 0, 0 };
+        double rms = -1.0;      // reprojection residual of the solve, pixels; -1 = unknown
+    };
+
+    // Cameras by capture index; cameras past the end are uncalibrated.
+    struct Rig
+    {
+        std::vector<Camera> cameras;
+
+        const Camera* camera(int index) const
+        {
+            return index >= 0 && index < (int)cameras.size() && cameras[index].valid ? &cameras[index] : nullptr;
+        }
+    };
+
+    // Returns false and fills 'err' (with the line number) on unreadable or malformed files.
+    bool load(const std::string& path, Rig& out, std::string& err);
+    bool save(const std::string& path, const Rig& rig, std::string& err);
+
+    // Distorted pixel -> undistorted normalized coordinates (iterative inverse of distort).
+    void undistort(const Camera& c, double u, double v, double& xn, double& yn);
+
+    // Undistorted normalized coordinates -> distorted pixel.
+    void distort(const Camera& c, double xn, double yn, double& u, double& v);
+
+    // World point -> distorted pixel. False when the point is behind the camera.
+    bool project(const Camera& c, const double X[3], double& u, double& v);
+
+    // Camera center in world coordinates, -R^T t.
+    void center(const Camera& c, double C[3]);
+}
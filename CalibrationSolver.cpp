@@ -0,0 +1,890 @@
+#include "CalibrationSolver.h"
+#include "WorkerPool.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdio>
+#include <functional>
+#include <map>
+
+namespace CalibrationSolver
+{
+
+// A camera needs this many views for its intrinsics.
+static const int kMinViews = 4;
+
+// Views with an RMS error above this many times the camera's median (and above
+// kMinRejectRms pixels) are dropped before the camera is solved again.
+static const double kRejectFactor = 3.0;
+static const double kMinRejectRms = 0.5;
+
+static const int kMaxIterations = 200;
+
+static const double kPi = 3.14159265358979323846;
+
+struct Pose
+{
+    double r[3] = { 0, 0, 0 };  // Rodrigues vector
+    double t[3] = { 0, 0, 0 };
+};
+
+static void toMatrix(const double r[3], double R[9])
+{
+    const double theta = std::sqrt(r[0] * r[0] + r[1] * r[1] + r[2] * r[2]);
+    if (theta < 1e-12)
+    {
+        const double I[9] = { 1, -r[2], r[1], r[2], 1, -r[0], -r[1], r[0], 1 };
+        std::copy(I, I + 9, R);
+        return;
+    }
+    const double x = r[0] / theta, y = r[1] / theta, z = r[2] / theta;
+    const double c = std::cos(theta), s = std::sin(theta), C = 1.0 - c;
+    R[0] = c + x * x * C;     R[1] = x * y * C - z * s; R[2] = x * z * C + y * s;
+    R[3] = y * x * C + z * s; R[4] = c + y * y * C;     R[5] = y * z * C - x * s;
+    R[6] = z * x * C - y * s; R[7] = z * y * C + x * s; R[8] = c + z * z * C;
+}
+
+static void toVector(const double R[9], double r[3])
+{
+    const double c = std::max(-1.0, std::min(1.0, 0.5 * (R[0] + R[4] + R[8] - 1.0)));
+    const double theta = std::acos(c);
+    const double v[3] = { R[7] - R[5], R[2] - R[6], R[3] - R[1] };
+    if (theta < 1e-6)
+    {
+        for (int i = 0; i < 3; ++i)
+            r[i] = 0.5 * v[i];
+        return;
+    }
+    if (kPi - theta < 1e-4)
+    {
+        // Near a half turn the skew part vanishes; the axis is the largest column of R + I.
+        int k = R[0] > R[4] ? (R[0] > R[8] ? 0 : 2) : (R[4] > R[8] ? 1 : 2);
+        double a[3] = { R[k] , R[3 + k], R[6 + k] };
+        a[k] += 1.0;
+        const double n = std::sqrt(a[0] * a[0] + a[1] * a[1] + a[2] * a[2]);
+        for (int i = 0; i < 3; ++i)
+            r[i] = a[i] / n * theta;
+        return;
+    }
+    const double s = theta / (2.0 * std::sin(theta));
+    for (int i = 0; i < 3; ++i)
+        r[i] = v[i] * s;
+}
+
+static void multiply(const double A[9], const double B[9], double out[9])
+{
+    for (int i = 0; i < 3; ++i)
+        for (int j = 0; j < 3; ++j)
+            out[i * 3 + j] = A[i * 3] * B[j] + A[i * 3 + 1] * B[3 + j] + A[i * 3 + 2] * B[6 + j];
+}
+
+// Eigenvector of the smallest eigenvalue of a symmetric n x n matrix (cyclic Jacobi).
+static void smallestEigenvector(std::vector<double> A, int n, double* out)
+{
+    std::vector<double> V((size_t)n * n, 0.0);
+    for (int i = 0; i < n; ++i)
+        V[(size_t)i * n + i] = 1.0;
+    for (int sweep = 0; sweep < 60; ++sweep)
+    {
+        double off = 0.0;
+        for (int i = 0; i < n; ++i)
+            for (int j = i + 1; j < n; ++j)
+                off += A[(size_t)i * n + j] * A[(size_t)i * n + j];
+        if (off < 1e-30)
+            break;
+        for (int p = 0; p < n; ++p)
+            for (int q = p + 1; q < n; ++q)
+            {
+                const double apq = A[(size_t)p * n + q];
+                if (std::fabs(apq) < 1e-300)
+                    continue;
+                const double theta = 0.5 * (A[(size_t)q * n + q] - A[(size_t)p * n + p]) / apq;
+                const double t = (theta >= 0 ? 1.0 : -1.0) / (std::fabs(theta) + std::sqrt(theta * theta + 1.0));
+                const double c = 1.0 / std::sqrt(t * t + 1.0), s = t * c;
+                for (int k = 0; k < n; ++k)
+                {
+                    const double akp = A[(size_t)k * n + p], akq = A[(size_t)k * n + q];
+                    A[(size_t)k * n + p] = c * akp - s * akq;
+                    A[(size_t)k * n + q] = s * akp + c * akq;
+                }
+                for (int k = 0; k < n; ++k)
+                {
+                    const double apk = A[(size_t)p * n + k], aqk = A[(size_t)q * n + k];
+                    A[(size_t)p * n + k] = c * apk - s * aqk;
+                    A[(size_t)q * n + k] = s * apk + c * aqk;
+                }
+                for (int k = 0; k < n; ++k)
+                {
+                    const double vkp = V[(size_t)k * n + p], vkq = V[(size_t)k * n + q];
+                    V[(size_t)k * n + p] = c * vkp - s * vkq;
+                    V[(size_t)k * n + q] = s * vkp + c * vkq;
+                }
+            }
+    }
+    int best = 0;
+    for (int i = 1; i < n; ++i)
+        if (A[(size_t)i * n + i] < A[(size_t)best * n + best])
+            best = i;
+    for (int k = 0; k < n; ++k)
+        out[k] = V[(size_t)k * n + best];
+}
+
+// Solves A x = b for symmetric positive definite A (n x n, overwritten). False if not.
+static bool choleskySolve(std::vector<double>& A, int n, const std::vector<double>& b, std::vector<double>& x)
+{
+    for (int j = 0; j < n; ++j)
+    {
+        double d = A[(size_t)j * n + j];
+        for (int k = 0; k < j; ++k)
+            d -= A[(size_t)j * n + k] * A[(size_t)j * n + k];
+        if (d <= 0.0)
+            return false;
+        d = std::sqrt(d);
+        A[(size_t)j * n + j] = d;
+        for (int i = j + 1; i < n; ++i)
+        {
+            double s = A[(size_t)i * n + j];
+            const double* ai = &A[(size_t)i * n];
+            const double* aj = &A[(size_t)j * n];
+            for (int k = 0; k < j; ++k)
+                s -= ai[k] * aj[k];
+            A[(size_t)i * n + j] = s / d;
+        }
+    }
+    x.assign(b.begin(), b.end());
+    for (int i = 0; i < n; ++i)
+    {
+        double s = x[i];
+        for (int k = 0; k < i; ++k)
+            s -= A[(size_t)i * n + k] * x[k];
+        x[i] = s / A[(size_t)i * n + i];
+    }
+    for (int i = n - 1; i >= 0; --i)
+    {
+        double s = x[i];
+        for (int k = i + 1; k < n; ++k)
+            s -= A[(size_t)k * n + i] * x[k];
+        x[i] = s / A[(size_t)i * n + i];
+    }
+    return true;
+}
+
+// Least-squares term: residuals depending on up to two parameter ranges.
+struct Term
+{
+    int start[2];
+    int length[2];
+    int residuals;
+    std::function<void(const std::vector<double>& params, double* out)> eval;
+};
+
+// Levenberg-Marquardt with central-difference Jacobians; returns the final RMS over all
+// residual pairs (pixels).
+static double levenbergMarquardt(const std::vector<Term>& terms, std::vector<double>& params)
+{
+    const int n = (int)params.size();
+    size_t total = 0;
+    for (const Term& t : terms)
+        total += (size_t)t.residuals;
+    if (total == 0)
+        return 0.0;
+
+    std::vector<double> r(total), trial(total);
+    auto cost = [&](const std::vector<double>& p, std::vector<double>& res)
+    {
+        double c = 0.0;
+        size_t at = 0;
+        for (const Term& t : terms)
+        {
+            t.eval(p, &res[at]);
+            for (int k = 0; k < t.residuals; ++k)
+                c += res[at + k] * res[at + k];
+            at += (size_t)t.residuals;
+        }
+        return c;
+    };
+
+    double current = cost(params, r);
+    double lambda = 1e-3;
+    std::vector<double> JtJ, Jtr, A, step, next;
+    std::vector<double> J, plus, minus;
+    for (int it = 0; it < kMaxIterations; ++it)
+    {
+        JtJ.assign((size_t)n * n, 0.0);
+        Jtr.assign((size_t)n, 0.0);
+        size_t at = 0;
+        std::vector<double>& p = params;
+        for (const Term& t : terms)
+        {
+            int cols[32];
+            int m = 0;
+            for (int b = 0; b < 2; ++b)
+                for (int k = 0; k < t.length[b]; ++k)
+                    cols[m++] = t.start[b] + k;
+            J.assign((size_t)t.residuals * m, 0.0);
+            plus.resize((size_t)t.residuals);
+            minus.resize((size_t)t.residuals);
+            for (int c = 0; c < m; ++c)
+            {
+                const double keep = p[cols[c]];
+                const double h = 1e-6 * std::max(1.0, std::fabs(keep));
+                p[cols[c]] = keep + h;
+                t.eval(p, plus.data());
+                p[cols[c]] = keep - h;
+                t.eval(p, minus.data());
+                p[cols[c]] = keep;
+                for (int k = 0; k < t.residuals; ++k)
+                    J[(size_t)k * m + c] = (plus[k] - minus[k]) / (2.0 * h);
+            }
+            for (int a = 0; a < m; ++a)
+            {
+                for (int b = a; b < m; ++b)
+                {
+                    double s = 0.0;
+                    for (int k = 0; k < t.residuals; ++k)
+                        s += J[(size_t)k * m + a] * J[(size_t)k * m + b];
+                    JtJ[(size_t)cols[a] * n + cols[b]] += s;
+                    if (b != a)
+                        JtJ[(size_t)cols[b] * n + cols[a]] += s;
+                }
+                double g = 0.0;
+                for (int k = 0; k < t.residuals; ++k)
+                    g += J[(size_t)k * m + a] * r[at + k];
+                Jtr[cols[a]] += g;
+            }
+            at += (size_t)t.residuals;
+        }
+
+        bool improved = false;
+        for (int tries = 0; tries < 10 && !improved; ++tries)
+        {
+            A = JtJ;
+            for (int i = 0; i < n; ++i)
+                A[(size_t)i * n + i] += lambda * std::max(JtJ[(size_t)i * n + i], 1e-12);
+            for (double& g : Jtr)
+                g = -g;
+            const bool ok = choleskySolve(A, n, Jtr, step);
+            for (double& g : Jtr)
+                g = -g;
+            if (!ok)
+            {
+                lambda *= 10.0;
+                continue;
+            }
+            next = params;
+            for (int i = 0; i < n; ++i)
+                next[i] += step[i];
+            const double c = cost(next, trial);
+            if (c < current)
+            {
+                const double gain = (current - c) / std::max(current, 1e-300);
+                params.swap(next);
+                r.swap(trial);
+                current = c;
+                lambda = std::max(1e-9, lambda * 0.3);
+                improved = true;
+                if (gain < 1e-10)
+                    it = kMaxIterations;
+            }
+            else
+                lambda *= 10.0;
+        }
+        if (!improved)
+            break;
+    }
+    return std::sqrt(current / (double)(total / 2));
+}
+
+// Normalized DLT: board plane (X, Y) -> image, row-major 3x3.
+static bool homography(const std::vector<double>& X, const std::vector<double>& Y, const std::vector<double>& u,
+    const std::vector<double>& v, double H[9])
+{
+    const size_t n = X.size();
+    auto normalizer = [n](const std::vector<double>& a, const std::vector<double>& b, double T[9])
+    {
+        double ma = 0.0, mb = 0.0, d = 0.0;
+        for (size_t i = 0; i < n; ++i)
+        {
+            ma += a[i];
+            mb += b[i];
+        }
+        ma /= n;
+        mb /= n;
+        for (size_t i = 0; i < n; ++i)
+            d += std::sqrt((a[i] - ma) * (a[i] - ma) + (b[i] - mb) * (b[i] - mb));
+        const double s = d > 0.0 ? std::sqrt(2.0) * n / d : 1.0;
+        const double t[9] = { s, 0, -s * ma, 0, s, -s * mb, 0, 0, 1 };
+        std::copy(t, t + 9, T);
+    };
+    double Tb[9], Ti[9];
+    normalizer(X, Y, Tb);
+    normalizer(u, v, Ti);
+
+    std::vector<double> M(81, 0.0);
+    for (size_t i = 0; i < n; ++i)
+    {
+        const double x = Tb[0] * X[i] + Tb[2], y = Tb[4] * Y[i] + Tb[5];
+        const double a = Ti[0] * u[i] + Ti[2], b = Ti[4] * v[i] + Ti[5];
+        const double rows[2][9] = { { -x, -y, -1, 0, 0, 0, a * x, a * y, a }, { 0, 0, 0, -x, -y, -1, b * x, b * y, b } };
+        for (const auto& row : rows)
+            for (int j = 0; j < 9; ++j)
+                for (int k = 0; k < 9; ++k)
+                    M[j * 9 + k] += row[j] * row[k];
+    }
+    double h[9];
+    smallestEigenvector(M, 9, h);
+
+    // H = Ti^-1 Hn Tb
+    const double Tinv[9] = { 1.0 / Ti[0], 0, -Ti[2] / Ti[0], 0, 1.0 / Ti[4], -Ti[5] / Ti[4], 0, 0, 1 };
+    double tmp[9];
+    multiply(Tinv, h, tmp);
+    multiply(tmp, Tb, H);
+    if (std::fabs(H[8]) < 1e-12)
+        return false;
+    for (int i = 0; i < 9; ++i)
+        H[i] /= H[8];
+    return true;
+}
+
+// Board pose from a homography and the intrinsics (x = K [r1 r2 t] X).
+static Pose poseFromHomography(const double H[9], double fx, double fy, double cx, double cy)
+{
+    double h[3][3];     // columns of K^-1 H
+    for (int c = 0; c < 3; ++c)
+    {
+        h[c][2] = H[6 + c];
+        h[c][1] = (H[3 + c] - cy * H[6 + c]) / fy;
+        h[c][0] = (H[c] - cx * H[6 + c]) / fx;
+    }
+    double scale = 1.0 / std::sqrt(h[0][0] * h[0][0] + h[0][1] * h[0][1] + h[0][2] * h[0][2]);
+    if (h[2][2] * scale < 0.0)
+        scale = -scale;     // the board is in front of the camera
+    double r1[3], r2[3], r3[3], t[3];
+    for (int i = 0; i < 3; ++i)
+    {
+        r1[i] = h[0][i] * scale;
+        r2[i] = h[1][i] * scale;
+        t[i] = h[2][i] * scale;
+    }
+    // Gram-Schmidt; the solve polishes what is left.
+    const double d = r1[0] * r2[0] + r1[1] * r2[1] + r1[2] * r2[2];
+    for (int i = 0; i < 3; ++i)
+        r2[i] -= d * r1[i];
+    const double n2 = std::sqrt(r2[0] * r2[0] + r2[1] * r2[1] + r2[2] * r2[2]);
+    for (double& v : r2)
+        v /= n2;
+    r3[0] = r1[1] * r2[2] - r1[2] * r2[1];
+    r3[1] = r1[2] * r2[0] - r1[0] * r2[2];
+    r3[2] = r1[0] * r2[1] - r1[1] * r2[0];
+    const double R[9] = { r1[0], r2[0], r3[0], r1[1], r2[1], r3[1], r1[2], r2[2], r3[2] };
+    Pose p;
+    toVector(R, p.r);
+    std::copy(t, t + 3, p.t);
+    return p;
+}
+
+// Zhang's closed form on homographies of coordinates centered and scaled by the image
+// width; falls back to a square-pixel, centered-principal-point focal length.
+static void initialIntrinsics(const std::vector<std::vector<double>>& Hs, int width, int height, double& fx, double& fy, double& cx, double& cy)
+{
+    const double s = (double)width, ox = 0.5 * (width - 1), oy = 0.5 * (height - 1);
+    std::vector<std::array<double, 9>> Hn;
+    for (const auto& H : Hs)
+    {
+        std::array<double, 9> h;
+        for (int c = 0; c < 3; ++c)
+        {
+            h[c] = (H[c] - ox * H[6 + c]) / s;
+            h[3 + c] = (H[3 + c] - oy * H[6 + c]) / s;
+            h[6 + c] = H[6 + c];
+        }
+        Hn.push_back(h);
+    }
+    auto vij = [](const std::array<double, 9>& h, int i, int j, double v[6])
+    {
+        v[0] = h[i] * h[j];
+        v[1] = h[i] * h[3 + j] + h[3 + i] * h[j];
+        v[2] = h[3 + i] * h[3 + j];
+        v[3] = h[6 + i] * h[j] + h[i] * h[6 + j];
+        v[4] = h[6 + i] * h[3 + j] + h[3 + i] * h[6 + j];
+        v[5] = h[6 + i] * h[6 + j];
+    };
+
+    fx = fy = 0.0;
+    cx = ox;
+    cy = oy;
+    if (Hn.size() >= 3)
+    {
+        std::vector<double> M(36, 0.0);
+        for (const auto& h : Hn)
+        {
+            double v12[6], v11[6], v22[6];
+            vij(h, 0, 1, v12);
+            vij(h, 0, 0, v11);
+            vij(h, 1, 1, v22);
+            double d[6];
+            for (int k = 0; k < 6; ++k)
+                d[k] = v11[k] - v22[k];
+            for (int j = 0; j < 6; ++j)
+                for (int k = 0; k < 6; ++k)
+                    M[j * 6 + k] += v12[j] * v12[k] + d[j] * d[k];
+        }
+        double b[6];
+        smallestEigenvector(M, 6, b);
+        if (b[0] < 0.0)
+            for (double& x : b)
+                x = -x;
+        const double B11 = b[0], B12 = b[1], B22 = b[2], B13 = b[3], B23 = b[4], B33 = b[5];
+        const double den = B11 * B22 - B12 * B12;
+        if (B11 > 0.0 && den > 0.0)
+        {
+            const double v0 = (B12 * B13 - B11 * B23) / den;
+            const double lambda = B33 - (B13 * B13 + v0 * (B12 * B13 - B11 * B23)) / B11;
+            if (lambda / B11 > 0.0 && lambda * B11 / den > 0.0)
+            {
+                const double alpha = std::sqrt(lambda / B11), beta = std::sqrt(lambda * B11 / den);
+                const double u0 = -B13 * alpha * alpha / lambda;
+                if (alpha > 0.1 && beta > 0.1 && alpha < 20.0 && beta < 20.0 && std::fabs(u0) < 0.5 && std::fabs(v0) < 0.5)
+                {
+                    fx = alpha * s;
+                    fy = beta * s;
+                    cx = u0 * s + ox;
+                    cy = v0 * s + oy;
+                    return;
+                }
+            }
+        }
+    }
+
+    // Square pixels, principal point at the center: each constraint is a + f^2 c = 0.
+    double num = 0.0, den = 0.0;
+    for (const auto& h : Hn)
+    {
+        const double a1 = h[0] * h[1] + h[3] * h[4], c1 = h[6] * h[7];
+        const double a2 = h[0] * h[0] + h[3] * h[3] - h[1] * h[1] - h[4] * h[4], c2 = h[6] * h[6] - h[7] * h[7];
+        num += a1 * c1 + a2 * c2;
+        den += c1 * c1 + c2 * c2;
+    }
+    const double f2 = den > 0.0 ? -num / den : 0.0;
+    fx = fy = (f2 > 0.0 ? std::sqrt(f2) : 1.0) * s;
+}
+
+// Pinhole camera from the intrinsic block [fx fy cx cy k1 k2 p1 p2] and a pose.
+static void makeCamera(const double* in, const double* pose, int width, int height, Calibration::Camera& c)
+{
+    c.valid = true;
+    c.width = width;
+    c.height = height;
+    c.fx = in[0];
+    c.fy = in[1];
+    c.cx = in[2];
+    c.cy = in[3];
+    c.k1 = in[4];
+    c.k2 = in[5];
+    c.p1 = in[6];
+    c.p2 = in[7];
+    c.k3 = 0.0;
+    toMatrix(pose, c.R);
+    std::copy(pose + 3, pose + 6, c.t);
+}
+
+static void boardResiduals(const Calibration::Camera& c, const View& v, const std::vector<double>& object, double* out)
+{
+    const size_t n = v.corners.size();
+    for (size_t k = 0; k < n; ++k)
+    {
+        double u, w;
+        if (!Calibration::project(c, &object[k * 3], u, w))
+        {
+            u = v.corners[k].x + 1e3;   // behind the camera: a large, smooth penalty
+            w = v.corners[k].y + 1e3;
+        }
+        out[2 * k] = u - v.corners[k].x;
+        out[2 * k + 1] = w - v.corners[k].y;
+    }
+}
+
+struct CameraSolve
+{
+    int camera = -1;
+    std::vector<const View*> views;
+    std::vector<Pose> poses;    // board -> camera, per view
+    double intrinsics[8] = {};
+    double rms = 0.0;
+    std::string problem;
+    bool ok = false;
+};
+
+static double viewRms(const CameraSolve& s, size_t k, const std::vector<double>& object)
+{
+    Calibration::Camera c;
+    const View& v = *s.views[k];
+    double pose[6];
+    std::copy(s.poses[k].r, s.poses[k].r + 3, pose);
+    std::copy(s.poses[k].t, s.poses[k].t + 3, pose + 3);
+    makeCamera(s.intrinsics, pose, v.width, v.height, c);
+    std::vector<double> r(v.corners.size() * 2);
+    boardResiduals(c, v, object, r.data());
+    double sum = 0.0;
+    for (double x : r)
+        sum += x * x;
+    return std::sqrt(sum / (double)v.corners.size());
+}
+
+static void solveCamera(CameraSolve& s, const std::vector<double>& object)
+{
+    const View& first = *s.views[0];
+    const int width = first.width, height = first.height;
+
+    for (int pass = 0; pass < 2; ++pass)
+    {
+        const int nv = (int)s.views.size();
+        if (nv < kMinViews)
+        {
+            s.problem = "camera " + std::to_string(s.camera) + ": " + std::to_string(nv) + " views, needs " + std::to_string(kMinViews);
+            return;
+        }
+
+        if (pass == 0)
+        {
+            std::vector<std::vector<double>> Hs;
+            std::vector<double> X, Y, u, v;
+            for (const View* view : s.views)
+            {
+                X.clear(); Y.clear(); u.clear(); v.clear();
+                for (size_t k = 0; k < view->corners.size(); ++k)
+                {
+                    X.push_back(object[k * 3]);
+                    Y.push_back(object[k * 3 + 1]);
+                    u.push_back(view->corners[k].x);
+                    v.push_back(view->corners[k].y);
+                }
+                std::vector<double> H(9);
+                if (!homography(X, Y, u, v, H.data()))
+                    H.assign({ 1, 0, 0, 0, 1, 0, 0, 0, 1 });
+                Hs.push_back(H);
+            }
+            double fx, fy, cx, cy;
+            initialIntrinsics(Hs, width, height, fx, fy, cx, cy);
+            const double in[8] = { fx, fy, cx, cy, 0, 0, 0, 0 };
+            std::copy(in, in + 8, s.intrinsics);
+            s.poses.clear();
+            for (const auto& H : Hs)
+                s.poses.push_back(poseFromHomography(H.data(), fx, fy, cx, cy));
+        }
+
+        // Parameters: 8 intrinsics, then 6 per view.
+        std::vector<double> params(8 + 6 * (size_t)nv);
+        std::copy(s.intrinsics, s.intrinsics + 8, params.begin());
+        for (int k = 0; k < nv; ++k)
+        {
+            std::copy(s.poses[k].r, s.poses[k].r + 3, params.begin() + 8 + 6 * k);
+            std::copy(s.poses[k].t, s.poses[k].t + 3, params.begin() + 11 + 6 * k);
+        }
+        std::vector<Term> terms;
+        for (int k = 0; k < nv; ++k)
+        {
+            const View* view = s.views[k];
+            Term t;
+            t.start[0] = 0;
+            t.length[0] = 8;
+            t.start[1] = 8 + 6 * k;
+            t.length[1] = 6;
+            t.residuals = (int)view->corners.size() * 2;
+            t.eval = [view, k, &object, width, height](const std::vector<double>& p, double* out)
+            {
+                Calibration::Camera c;
+                makeCamera(p.data(), p.data() + 8 + 6 * k, width, height, c);
+                boardResiduals(c, *view, object, out);
+            };
+            terms.push_back(std::move(t));
+        }
+        s.rms = levenbergMarquardt(terms, params);
+        std::copy(params.begin(), params.begin() + 8, s.intrinsics);
+        for (int k = 0; k < nv; ++k)
+        {
+            std::copy(params.begin() + 8 + 6 * k, params.begin() + 11 + 6 * k, s.poses[k].r);
+            std::copy(params.begin() + 11 + 6 * k, params.begin() + 14 + 6 * k, s.poses[k].t);
+        }
+        if (s.intrinsics[0] <= 0.0 || s.intrinsics[1] <= 0.0)
+        {
+            s.problem = "camera " + std::to_string(s.camera) + ": solve diverged";
+            return;
+        }
+
+        if (pass == 1)
+            break;
+        std::vector<double> errors;
+        for (int k = 0; k < nv; ++k)
+            errors.push_back(viewRms(s, (size_t)k, object));
+        std::vector<double> sorted = errors;
+        std::nth_element(sorted.begin(), sorted.begin() + sorted.size() / 2, sorted.end());
+        const double limit = std::max(kMinRejectRms, kRejectFactor * sorted[sorted.size() / 2]);
+        std::vector<const View*> keptViews;
+        std::vector<Pose> keptPoses;
+        for (int k = 0; k < nv; ++k)
+            if (errors[k] <= limit)
+            {
+                keptViews.push_back(s.views[k]);
+                keptPoses.push_back(s.poses[k]);
+            }
+        if ((int)keptViews.size() == nv)
+            break;
+        s.views.swap(keptViews);
+        s.poses.swap(keptPoses);
+    }
+    s.ok = true;
+}
+
+bool solve(const Params& p, const std::vector<View>& views, Calibration::Rig& rig, Report& report, std::string& err)
+{
+    rig = Calibration::Rig();
+    report = Report();
+    err.clear();
+    const size_t corners = (size_t)p.cols * p.rows;
+    std::vector<double> object(corners * 3);
+    for (int j = 0; j < p.rows; ++j)
+        for (int i = 0; i < p.cols; ++i)
+        {
+            double* o = &object[((size_t)j * p.cols + i) * 3];
+            o[0] = i * p.square;
+            o[1] = j * p.square;
+            o[2] = 0.0;
+        }
+
+    // 1. Each camera on its own, in parallel.
+    std::map<int, size_t> slot;
+    std::vector<CameraSolve> cams;
+    for (const View& v : views)
+    {
+        if (v.camera < 0 || v.corners.size() != corners || v.width <= 0 || v.height <= 0)
+            continue;
+        auto it = slot.find(v.camera);
+        if (it == slot.end())
+        {
+            it = slot.emplace(v.camera, cams.size()).first;
+            cams.emplace_back();
+            cams.back().camera = v.camera;
+        }
+        cams[it->second].views.push_back(&v);
+    }
+    if (cams.empty())
+    {
+        err = "no board views to calibrate from";
+        return false;
+    }
+    WorkerPool::instance().parallelFor((int)cams.size(), [&](int k) { solveCamera(cams[k], object); });
+
+    std::string problems;
+    auto note = [&problems](const std::string& s)
+    {
+        problems += problems.empty() ? s : "; " + s;
+    };
+    int solved = 0;
+    for (const CameraSolve& s : cams)
+    {
+        if (s.ok)
+            ++solved;
+        else
+            note(s.problem);
+    }
+    if (solved == 0)
+    {
+        err = "no camera could be calibrated (" + problems + ")";
+        return false;
+    }
+
+    // 2. Joint solve. The snapshot most cameras saw is the world; camera and snapshot
+    // poses are seeded by walking from it over shared snapshots.
+    std::map<int, std::vector<std::pair<size_t, size_t>>> bySnapshot;     // snapshot -> (camera solve, view)
+    for (size_t c = 0; c < cams.size(); ++c)
+        if (cams[c].ok)
+            for (size_t k = 0; k < cams[c].views.size(); ++k)
+                bySnapshot[cams[c].views[k]->snapshot].emplace_back(c, k);
+    int reference = -1;
+    size_t most = 0;
+    for (const auto& s : bySnapshot)
+        if (s.second.size() > most)
+        {
+            most = s.second.size();
+            reference = s.first;
+        }
+
+    // Board -> world of the reference: a half turn about X, so Z leaves the printed face.
+    const double kFlip[9] = { 1, 0, 0, 0, -1, 0, 0, 0, -1 };
+    struct Rt
+    {
+        double R[9];
+        double t[3];
+        bool known = false;
+    };
+    std::vector<Rt> camPose(cams.size());        // world -> camera
+    std::map<int, Rt> boardPose;                  // board -> world, per snapshot
+    {
+        Rt& ref = boardPose[reference];
+        std::copy(kFlip, kFlip + 9, ref.R);
+        ref.t[0] = ref.t[1] = ref.t[2] = 0.0;
+        ref.known = true;
+    }
+    auto viewRt = [&](size_t c, size_t k, double R[9], double t[3])
+    {
+        toMatrix(cams[c].poses[k].r, R);
+        std::copy(cams[c].poses[k].t, cams[c].poses[k].t + 3, t);
+    };
+    for (bool grew = true; grew;)
+    {
+        grew = false;
+        for (auto& s : bySnapshot)
+        {
+            Rt& b = boardPose[s.first];
+            for (const auto& cv : s.second)
+            {
+                Rt& cam = camPose[cv.first];
+                double Rv[9], tv[3];
+                viewRt(cv.first, cv.second, Rv, tv);
+                if (b.known && !cam.known)
+                {
+                    // T_c = T_view * T_board^-1
+                    const double Bt[9] = { b.R[0], b.R[3], b.R[6], b.R[1], b.R[4], b.R[7], b.R[2], b.R[5], b.R[8] };
+                    multiply(Rv, Bt, cam.R);
+                    for (int i = 0; i < 3; ++i)
+                        cam.t[i] = tv[i] - (cam.R[i * 3] * b.t[0] + cam.R[i * 3 + 1] * b.t[1] + cam.R[i * 3 + 2] * b.t[2]);
+                    cam.known = true;
+                    grew = true;
+                }
+                else if (cam.known && !b.known)
+                {
+                    // T_board = T_c^-1 * T_view
+                    const double Ct[9] = { cam.R[0], cam.R[3], cam.R[6], cam.R[1], cam.R[4], cam.R[7], cam.R[2], cam.R[5], cam.R[8] };
+                    multiply(Ct, Rv, b.R);
+                    const double d[3] = { tv[0] - cam.t[0], tv[1] - cam.t[1], tv[2] - cam.t[2] };
+                    for (int i = 0; i < 3; ++i)
+                        b.t[i] = Ct[i * 3] * d[0] + Ct[i * 3 + 1] * d[1] + Ct[i * 3 + 2] * d[2];
+                    b.known = true;
+                    grew = true;
+                }
+            }
+        }
+    }
+
+    // Parameters: 6 per posed camera, then 6 per posed snapshot other than the reference.
+    std::vector<int> camParam(cams.size(), -1);
+    std::map<int, int> boardParam;
+    std::vector<double> params;
+    auto push = [&params](const double R[9], const double t[3])
+    {
+        double r[3];
+        toVector(R, r);
+        params.insert(params.end(), r, r + 3);
+        params.insert(params.end(), t, t + 3);
+    };
+    for (size_t c = 0; c < cams.size(); ++c)
+        if (cams[c].ok && camPose[c].known)
+        {
+            camParam[c] = (int)params.size();
+            push(camPose[c].R, camPose[c].t);
+        }
+    for (const auto& b : boardPose)
+        if (b.second.known && b.first != reference)
+        {
+            boardParam[b.first] = (int)params.size();
+            push(b.second.R, b.second.t);
+        }
+
+    std::vector<Term> terms;
+    std::vector<std::pair<size_t, size_t>> termView;    // (camera solve, view) per term
+    double refPose[6] = {};
+    toVector(kFlip, refPose);
+    for (const auto& s : bySnapshot)
+    {
+        if (!boardPose[s.first].known)
+            continue;
+        const int bp = s.first == reference ? -1 : boardParam[s.first];
+        for (const auto& cv : s.second)
+        {
+            const int cp = camParam[cv.first];
+            if (cp < 0)
+                continue;
+            const CameraSolve* cam = &cams[cv.first];
+            const View* view = cam->views[cv.second];
+            Term t;
+            t.start[0] = cp;
+            t.length[0] = 6;
+            t.start[1] = bp < 0 ? 0 : bp;
+            t.length[1] = bp < 0 ? 0 : 6;
+            t.residuals = (int)corners * 2;
+            t.eval = [cam, view, cp, bp, &object, &refPose](const std::vector<double>& q, double* out)
+            {
+                // Board -> camera = (world -> camera) * (board -> world).
+                const double* board = bp < 0 ? refPose : &q[bp];
+                double Rc[9], Rb[9], pose[6];
+                toMatrix(&q[cp], Rc);
+                toMatrix(board, Rb);
+                double R[9];
+                multiply(Rc, Rb, R);
+                toVector(R, pose);
+                for (int i = 0; i < 3; ++i)
+                    pose[3 + i] = Rc[i * 3] * board[3] + Rc[i * 3 + 1] * board[4] + Rc[i * 3 + 2] * board[5] + q[cp + 3 + i];
+                Calibration::Camera c;
+                makeCamera(cam->intrinsics, pose, view->width, view->height, c);
+                boardResiduals(c, *view, object, out);
+            };
+            terms.push_back(std::move(t));
+            termView.push_back(cv);
+        }
+    }
+    report.rms = levenbergMarquardt(terms, params);
+
+    // Per-camera RMS over its joint residuals.
+    std::vector<double> sum(cams.size(), 0.0);
+    std::vector<int> count(cams.size(), 0);
+    {
+        std::vector<double> r(corners * 2);
+        for (size_t k = 0; k < terms.size(); ++k)
+        {
+            terms[k].eval(params, r.data());
+            for (double x : r)
+                sum[termView[k].first] += x * x;
+            count[termView[k].first] += (int)corners;
+        }
+    }
+
+    for (size_t c = 0; c < cams.size(); ++c)
+    {
+        const CameraSolve& s = cams[c];
+        if (!s.ok)
+            continue;
+        report.views += (int)s.views.size();
+        const int index = s.camera;
+        if ((int)rig.cameras.size() <= index)
+            rig.cameras.resize((size_t)index + 1);
+        Calibration::Camera& out = rig.cameras[index];
+        const double none[6] = {};
+        makeCamera(s.intrinsics, camParam[c] >= 0 ? &params[camParam[c]] : none, s.views[0]->width, s.views[0]->height, out);
+        if (camParam[c] < 0)
+        {
+            out.valid = false;
+            out.rms = s.rms;
+            ++report.intrinsicOnly;
+            note("camera " + std::to_string(index) + ": no snapshot shared with the rig");
+            continue;
+        }
+        out.rms = count[c] ? std::sqrt(sum[c] / count[c]) : s.rms;
+        ++report.cameras;
+    }
+
+    char line[160];
+    std::snprintf(line, sizeof(line), "%d cameras, %d views, %.3f px RMS", report.cameras, report.views, report.rms);
+    report.summary = line;
+    if (!problems.empty())
+        report.summary += " (" + problems + ")";
+    if (report.cameras == 0)
+    {
+        err = "no camera could be placed in the rig (" + problems + ")";
+        return false;
+    }
+    return true;
+}
+
+}
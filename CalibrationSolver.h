@@ -0,0 +1,58 @@
+#pragma once
+
+#include "BoardDetector.h"
+#include "Calibration.h"
+
+#include <string>
+#include <vector>
+
+// Rig calibration from checkerboard views (BoardDetector corners).
+//
+// A snapshot is one instant at which several cameras may have seen the board. Every
+// camera is solved on its own first (Zhang's closed form from the board homographies,
+// then Levenberg-Marquardt over the intrinsics, distortion k1 k2 p1 p2 and one board
+// pose per view). Views far worse than the camera's median are dropped and the camera is
+// solved again. The rig is then solved jointly: camera poses and one board pose per
+// snapshot, with the intrinsics fixed, started from a breadth-first walk over the
+// cameras that shared snapshots.
+//
+// The world is the board of the snapshot most cameras saw: origin at corner 0, X along the
+// cols side, Y along the rows side, Z out of the printed face, in the units of 'square'.
+// Lay the board on the floor in view of as many cameras as possible for that snapshot.
+// Cameras that never shared a snapshot with the others keep only their intrinsics
+// (valid = false).
+namespace CalibrationSolver
+{
+    struct Params
+    {
+        bool enabled = false;   // capture (MilManager): look for the board in live frames
+        int cols = 9;           // inner corners, as BoardDetector::Params
+        int rows = 6;
+        double square = 25.0;   // square size, world units (usually mm)
+        double rateHz = 2.0;    // snapshots per second
+        int maxSnapshots = 60;  // capture stops adding snapshots past this
+    };
+
+    // One camera's sight of the board in one snapshot.
+    struct View
+    {
+        int camera = -1;
+        int snapshot = -1;
+        int width = 0;          // frame size
+        int height = 0;
+        std::vector<BoardDetector::Corner> corners;     // cols * rows, BoardDetector order
+    };
+
+    struct Report
+    {
+        int cameras = 0;        // cameras in the rig (calibrated and posed)
+        int intrinsicOnly = 0;  // solved, but not connected to the rig
+        int views = 0;          // views used
+        double rms = 0.0;       // joint reprojection error, pixels
+        std::string summary;    // one line, per-camera problems included
+    };
+
+    // Replaces 'rig' with the cameras the views calibrate. False (with 'err') when no
+    // camera could be solved at all.
+    bool solve(const Params& p, const std::vector<View>& views, Calibration::Rig& rig, Report& report, std::string& err);
+}
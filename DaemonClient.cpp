@@ -0,0 +1,194 @@
+#include "DaemonClient.h"
+
+#include <algorithm>
+#include <sstream>
+
+static const uint64_t kStaleNs = 2000000000ull;    // heartbeat age at which the daemon counts as gone
+static const uint64_t kRetryNs = 500000000ull;     // attach attempts while something is missing
+
+DaemonClient::DaemonClient(const std::string& prefix)
+    : _prefix(prefix)
+{
+    _lastError = "Capture daemon '" + _prefix + "' is not running.";
+}
+
+int DaemonClient::sourceBpp(SharedFrames::PixelFormat f)
+{
+    switch (f)
+    {
+    case SharedFrames::PixelFormat::Mono8:  return 1;
+    case SharedFrames::PixelFormat::Mono16: return 2;
+    case SharedFrames::PixelFormat::RGBA8:  return 4;
+    default:                                return 0;
+    }
+}
+
+void DaemonClient::refresh()
+{
+    const uint64_t now = SharedFrames::nowNs();
+    // Opening a name that doesn't exist is a syscall per camera; don't do it every cook.
+    const bool retry = now >= _retryAtNs;
+    if (retry)
+        _retryAtNs = now + kRetryNs;
+
+    if (!_manifest.data() && retry && _manifest.open(SharedFrames::manifestName(_prefix), false))
+    {
+        const auto* m = reinterpret_cast<const SharedFrames::Manifest*>(_manifest.data());
+        if (_manifest.size() < sizeof(SharedFrames::Manifest) || m->magic != SharedFrames::kMagic || m->version != SharedFrames::kVersion)
+            _manifest.close();
+    }
+
+    const bool wasAlive = _alive;
+    int count = 0;
+    _alive = false;
+    if (const auto* m = reinterpret_cast<const SharedFrames::Manifest*>(_manifest.data()))
+    {
+        const uint64_t beat = m->heartbeatNs.load(std::memory_order_acquire);
+        _alive = beat != 0 && now < beat + kStaleNs;
+        _pid = m->pid;
+        if (_alive)
+            count = (int)m->cameraCount.load(std::memory_order_acquire);
+        else
+        {
+            // Drop our view so a restarted daemon can publish a fresh manifest under the name.
+            _manifest.close();
+            _lastError = "Capture daemon '" + _prefix + "' (pid " + std::to_string(_pid) + ") stopped responding.";
+        }
+    }
+    else
+        _lastError = "Capture daemon '" + _prefix + "' is not running.";
+
+    if (_alive != wasAlive || count != (int)_cams.size())
+        ++_formatGen;
+    if (_alive)
+        _lastError.clear();
+
+    if ((int)_cams.size() > count)
+        _cams.resize(count);
+    while ((int)_cams.size() < count)
+        _cams.push_back(std::make_unique<Camera>());
+
+    for (int i = 0; i < count; ++i)
+    {
+        Camera& cam = *_cams[i];
+        if (!cam.reader.isOpen() && (!retry || !cam.reader.open(_prefix, i)))
+            continue;
+
+        // A lapped peek just keeps the previous format; only a real change renegotiates.
+        SharedFrames::Reader::Frame f;
+        if (!cam.reader.latest(f) || sourceBpp(f.format) == 0)
+            continue;
+
+        CameraFormat cf;
+        cf.width = (int)f.width;
+        cf.height = (int)f.height;
+        cf.bits = f.format == SharedFrames::PixelFormat::Mono16 ? 16 : 8;
+        cf.color = f.format == SharedFrames::PixelFormat::RGBA8;
+        if (!cam.hasFormat || cf.width != cam.format.width || cf.height != cam.format.height ||
+            cf.bits != cam.format.bits || cf.color != cam.format.color)
+        {
+            cam.format = cf;
+            cam.hasFormat = true;
+            ++_formatGen;
+        }
+    }
+}
+
+std::string DaemonClient::summaryLine() const
+{
+    std::ostringstream oss;
+    oss << "Capture daemon '" << _prefix << "': ";
+    if (!_alive)
+        return oss.str() + "not connected";
+
+    int withFrames = 0;
+    for (const auto& cam : _cams)
+        withFrames += cam->hasFormat ? 1 : 0;
+    oss << "pid " << _pid << ", " << _cams.size() << " camera(s), " << withFrames << " publishing";
+    return oss.str();
+}
+
+int DaemonClient::cameraCount()
+{
+    return _alive ? (int)_cams.size() : 0;
+}
+
+bool DaemonClient::cameraFormat(int camIdx, CameraFormat& out)
+{
+    if (camIdx < 0 || camIdx >= (int)_cams.size() || !_cams[camIdx]->hasFormat)
+        return false;
+    out = _cams[camIdx]->format;
+    return true;
+}
+
+bool DaemonClient::ensureStreaming(int camIdx)
+{
+    return _alive && camIdx >= 0 && camIdx < (int)_cams.size() && _cams[camIdx]->hasFormat;
+}
+
+bool DaemonClient::copyFrame(Camera& cam, OutPixel fmt, uint8_t* dst, size_t dstStride, int maxW, int maxH, uint64_t& seen)
+{
+    // The writer never waits for us: copy, then make sure the slot wasn't reused
+    // meanwhile. One retry covers a lap that landed mid-copy.
+    for (int attempt = 0; attempt < 2; ++attempt)
+    {
+        SharedFrames::Reader::Frame f;
+        if (!cam.reader.latest(f))
+            return false;
+
+        const uint64_t seq = ((uint64_t)f.generation << 40) | (f.frameNumber & ((1ull << 40) - 1));
+        const int bpp = sourceBpp(f.format);
+        if (seq == seen || bpp == 0)
+            return false;
+
+        const int copyW = std::min((int)f.width, maxW);
+        const int copyH = std::min((int)f.height, maxH);
+        for (int y = 0; y < copyH; ++y)
+            convertRow(f.data + (size_t)y * f.stride, bpp, fmt, dst + (size_t)y * dstStride, (size_t)copyW);
+
+        if (cam.reader.stillValid(f))
+        {
+            seen = seq;
+            return true;
+        }
+    }
+    return false;
+}
+
+bool DaemonClient::copyLatestFrame(int camIdx, OutPixel fmt, uint8_t* dst, size_t dstStride, int maxW, int maxH, uint64_t& seen)
+{
+    if (!_alive || !dst || camIdx < 0 || camIdx >= (int)_cams.size())
+        return false;
+    return copyFrame(*_cams[camIdx], fmt, dst, dstStride, maxW, maxH, seen);
+}
+
+bool DaemonClient::grabFrame(int camIdx, OutPixel fmt, int width, int height, uint8_t* outFrame, size_t outBytes)
+{
+    const size_t rowBytes = (size_t)width * outPixelBytes(fmt);
+    if (width <= 0 || height <= 0 || !outFrame || outBytes < rowBytes * (size_t)height)
+        return false;
+
+    CameraFormat cf;
+    if (!ensureStreaming(camIdx) || !cameraFormat(camIdx, cf))
+    {
+        if (_lastError.empty())
+            _lastError = "grabFrame: camIdx " + std::to_string(camIdx) + " has no frames from the capture daemon.";
+        return false;
+    }
+    if (cf.width != width || cf.height != height)
+    {
+        std::ostringstream em;
+        em << "grabFrame: requested " << width << "x" << height
+            << " but camIdx " << camIdx << " is " << cf.width << "x" << cf.height << ".";
+        _lastError = em.str();
+        return false;
+    }
+
+    uint64_t seen = 0;
+    if (!copyFrame(*_cams[camIdx], fmt, outFrame, rowBytes, width, height, seen))
+    {
+        _lastError = "grabFrame: camIdx " + std::to_string(camIdx) + " frame was overwritten while reading.";
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,67 @@
+#pragma once
+
+#include "FrameSource.h"
+#include "SharedFrames.h"
+
+#include <memory>
+#include <string>
+#include <vector>
+
+// FrameSource backed by the capture daemon (daemon/CaptureDaemon.cpp): reads the
+// SharedFrames rings it publishes under 'prefix' and never loads MIL. The daemon owns
+// the cameras, so a TouchDesigner crash or plugin reload does not stop acquisition,
+// and a daemon crash only blanks the TOP until it is restarted.
+//
+// Formats come from the newest frame in each ring; a camera whose ring has no frame
+// yet has no format. Not thread-safe except for copyLatestFrame() on distinct
+// cameras, which is what WorkerPool::parallelFor needs.
+class DaemonClient : public FrameSource
+{
+public:
+    explicit DaemonClient(const std::string& prefix);
+
+    // Attaches to the manifest and to camera rings that appeared since the last call,
+    // checks the daemon's heartbeat and bumps formatGeneration() when the camera count
+    // or a ring's format moved. Call once per cook, before anything else.
+    void refresh();
+
+    // Manifest found and heartbeat recent.
+    bool connected() const { return _alive; }
+
+    std::string summaryLine() const override;
+    const std::string& lastError() const override { return _lastError; }
+
+    int cameraCount() override;
+    bool cameraFormat(int camIdx, CameraFormat& out) override;
+    uint64_t formatGeneration() const override { return _formatGen; }
+
+    // True while the daemon is alive and the camera's ring holds a frame.
+    bool ensureStreaming(int camIdx) override;
+
+    // 'seen' packs the ring generation above the frame number. Any other sequence counts
+    // as new: a restarted daemon starts its generations over, so sequences can go back.
+    bool copyLatestFrame(int camIdx, OutPixel fmt, uint8_t* dst, size_t dstStride, int maxW, int maxH, uint64_t& seen) override;
+    bool grabFrame(int camIdx, OutPixel fmt, int width, int height, uint8_t* outFrame, size_t outBytes) override;
+
+private:
+    struct Camera
+    {
+        SharedFrames::Reader reader;
+        CameraFormat format;
+        bool hasFormat = false;
+    };
+
+    // Newest frame of a camera, converted, checked against the writer afterwards.
+    bool copyFrame(Camera& cam, OutPixel fmt, uint8_t* dst, size_t dstStride, int maxW, int maxH, uint64_t& seen);
+
+    static int sourceBpp(SharedFrames::PixelFormat f);
+
+    std::string _prefix;
+    SharedFrames::Mapping _manifest;
+    std::vector<std::unique_ptr<Camera>> _cams;
+    uint64_t _formatGen = 1;
+    uint64_t _retryAtNs = 0;    // next manifest open attempt while the daemon is away
+    uint32_t _pid = 0;
+    bool _alive = false;
+    std::string _lastError;
+};
@@ -0,0 +1,173 @@
+#include "Demosaic.h"
+#include "WorkerPool.h"
+
+#include <algorithm>
+
+#if defined(_M_X64) || defined(_M_AMD64) || defined(__x86_64__) || defined(__SSE2__)
+#define DEMOSAIC_SSE2 1
+#include <emmintrin.h>
+#endif
+
+namespace Demosaic
+{
+
+const char* patternName(BayerPattern p)
+{
+    switch (p)
+    {
+    case BayerPattern::RGGB: return "RGGB";
+    case BayerPattern::BGGR: return "BGGR";
+    case BayerPattern::GRBG: return "GRBG";
+    case BayerPattern::GBRG: return "GBRG";
+    case BayerPattern::None:
+    default:                 return "None";
+    }
+}
+
+// Position of the red sample inside the 2x2 cell.
+static void redPhase(BayerPattern p, int& rx, int& ry)
+{
+    switch (p)
+    {
+    case BayerPattern::BGGR: rx = 1; ry = 1; break;
+    case BayerPattern::GRBG: rx = 1; ry = 0; break;
+    case BayerPattern::GBRG: rx = 0; ry = 1; break;
+    case BayerPattern::RGGB:
+    default:                 rx = 0; ry = 0; break;
+    }
+}
+
+static inline int reflect(int i, int n)
+{
+    if (i < 0) return std::min(-i, n - 1);
+    if (i >= n) return std::max(2 * n - 2 - i, 0);
+    return i;
+}
+
+static inline uint8_t avg2(int a, int b) { return (uint8_t)((a + b + 1) >> 1); }
+
+// Same rounding as the SIMD path: mean of two pairwise means.
+static inline uint8_t avg4(int a, int b, int c, int d) { return avg2(avg2(a, b), avg2(c, d)); }
+
+static void scalarPixel(const uint8_t* up, const uint8_t* row, const uint8_t* dn, int x, int w,
+    bool redRow, bool siteCol, uint8_t* out)
+{
+    const int xl = reflect(x - 1, w);
+    const int xr = reflect(x + 1, w);
+    const uint8_t c = row[x];
+    uint8_t r, g, b;
+
+    if (siteCol)
+    {
+        // R or B sample: green from the cross, the other color from the diagonals.
+        const uint8_t cross = avg4(row[xl], row[xr], up[x], dn[x]);
+        const uint8_t diag = avg4(up[xl], up[xr], dn[xl], dn[xr]);
+        g = cross;
+        r = redRow ? c : diag;
+        b = redRow ? diag : c;
+    }
+    else
+    {
+        // Green sample: the row's color from left/right, the other from up/down.
+        const uint8_t horiz = avg2(row[xl], row[xr]);
+        const uint8_t vert = avg2(up[x], dn[x]);
+        g = c;
+        r = redRow ? horiz : vert;
+        b = redRow ? vert : horiz;
+    }
+
+    out[0] = r;
+    out[1] = g;
+    out[2] = b;
+    out[3] = 255;
+}
+
+void bilinearRows(const uint8_t* src, size_t srcPitch, int w, int h, BayerPattern pattern,
+    uint8_t* dst, size_t dstPitch, int y0, int y1)
+{
+    if (w < 2 || h < 2)
+        return;
+
+    int rx = 0, ry = 0;
+    redPhase(pattern, rx, ry);
+
+    for (int y = y0; y < y1; ++y)
+    {
+        const uint8_t* up = src + (size_t)reflect(y - 1, h) * srcPitch;
+        const uint8_t* row = src + (size_t)y * srcPitch;
+        const uint8_t* dn = src + (size_t)reflect(y + 1, h) * srcPitch;
+        uint8_t* out = dst + (size_t)y * dstPitch;
+
+        // On red rows the R/B "site" columns share the red phase; on blue rows the other one.
+        const bool redRow = (y & 1) == ry;
+        const int siteParity = redRow ? rx : 1 - rx;
+
+        int x = 0;
+        for (; x < 2 && x < w; ++x)
+            scalarPixel(up, row, dn, x, w, redRow, (x & 1) == siteParity, out + x * 4);
+
+#if defined(DEMOSAIC_SSE2)
+        // Lane 0 sits on an even column; siteMask selects the R/B site lanes.
+        const __m128i evenLanes = _mm_set1_epi16(0x00FF);
+        const __m128i siteMask = siteParity == 0 ? evenLanes : _mm_xor_si128(evenLanes, _mm_set1_epi8(-1));
+        const __m128i alpha = _mm_set1_epi8(-1);
+
+        for (; x + 17 <= w; x += 16)
+        {
+            const __m128i c = _mm_loadu_si128((const __m128i*)(row + x));
+            const __m128i l = _mm_loadu_si128((const __m128i*)(row + x - 1));
+            const __m128i r = _mm_loadu_si128((const __m128i*)(row + x + 1));
+            const __m128i u = _mm_loadu_si128((const __m128i*)(up + x));
+            const __m128i d = _mm_loadu_si128((const __m128i*)(dn + x));
+            const __m128i ul = _mm_loadu_si128((const __m128i*)(up + x - 1));
+            const __m128i ur = _mm_loadu_si128((const __m128i*)(up + x + 1));
+            const __m128i dl = _mm_loadu_si128((const __m128i*)(dn + x - 1));
+            const __m128i dr = _mm_loadu_si128((const __m128i*)(dn + x + 1));
+
+            const __m128i horiz = _mm_avg_epu8(l, r);
+            const __m128i vert = _mm_avg_epu8(u, d);
+            const __m128i cross = _mm_avg_epu8(horiz, vert);
+            const __m128i diag = _mm_avg_epu8(_mm_avg_epu8(ul, ur), _mm_avg_epu8(dl, dr));
+
+            // Site lanes: own = c, green = cross, other = diag.
+            // Green lanes: own-row color = horiz, green = c, other = vert.
+            const __m128i g = _mm_or_si128(_mm_and_si128(siteMask, cross), _mm_andnot_si128(siteMask, c));
+            const __m128i rowColor = _mm_or_si128(_mm_and_si128(siteMask, c), _mm_andnot_si128(siteMask, horiz));
+            const __m128i otherColor = _mm_or_si128(_mm_and_si128(siteMask, diag), _mm_andnot_si128(siteMask, vert));
+            const __m128i R = redRow ? rowColor : otherColor;
+            const __m128i B = redRow ? otherColor : rowColor;
+
+            const __m128i rg_lo = _mm_unpacklo_epi8(R, g);
+            const __m128i rg_hi = _mm_unpackhi_epi8(R, g);
+            const __m128i ba_lo = _mm_unpacklo_epi8(B, alpha);
+            const __m128i ba_hi = _mm_unpackhi_epi8(B, alpha);
+            __m128i* o = (__m128i*)(out + x * 4);
+            _mm_storeu_si128(o + 0, _mm_unpacklo_epi16(rg_lo, ba_lo));
+            _mm_storeu_si128(o + 1, _mm_unpackhi_epi16(rg_lo, ba_lo));
+            _mm_storeu_si128(o + 2, _mm_unpacklo_epi16(rg_hi, ba_hi));
+            _mm_storeu_si128(o + 3, _mm_unpackhi_epi16(rg_hi, ba_hi));
+        }
+#endif
+        for (; x < w; ++x)
+            scalarPixel(up, row, dn, x, w, redRow, (x & 1) == siteParity, out + x * 4);
+    }
+}
+
+void bilinear(const uint8_t* src, size_t srcPitch, int w, int h, BayerPattern pattern,
+    uint8_t* dst, size_t dstPitch)
+{
+    // ~64 rows per band keeps the per-band hand-off small next to the pixel work.
+    const int kRowsPerBand = 64;
+    WorkerPool& pool = WorkerPool::instance();
+    const int bands = std::max(1, std::min(pool.threadCount() + 1, h / kRowsPerBand));
+    const int rowsPerBand = (h + bands - 1) / bands;
+
+    pool.parallelFor(bands, [&](int b)
+        {
+            const int y0 = b * rowsPerBand;
+            const int y1 = std::min(h, y0 + rowsPerBand);
+            bilinearRows(src, srcPitch, w, h, pattern, dst, dstPitch, y0, y1);
+        });
+}
+
+}
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+
+// 8-bit Bayer mosaic -> RGBA8 demosaicing.
+//
+// Bilinear interpolation: the missing colors of each pixel are the rounded mean of
+// its nearest same-color neighbours (2 or 4). Frame edges are mirrored, which keeps
+// the CFA phase intact. The interior runs 16 pixels per SSE2 iteration.
+namespace Demosaic
+{
+    // Color of the top-left 2x2 cell, read row by row (RGGB = R G / G B).
+    enum class BayerPattern
+    {
+        None,
+        RGGB,
+        BGGR,
+        GRBG,
+        GBRG,
+    };
+
+    const char* patternName(BayerPattern p);
+
+    // Demosaics output rows [y0, y1) of a w x h mosaic. Rows outside the band are
+    // read as neighbours, so bands can be processed concurrently.
+    void bilinearRows(const uint8_t* src, size_t srcPitch, int w, int h, BayerPattern pattern,
+        uint8_t* dst, size_t dstPitch, int y0, int y1);
+
+    // Whole frame, split into row bands across the WorkerPool when it is large
+    // enough to amortize the hand-off.
+    void bilinear(const uint8_t* src, size_t srcPitch, int w, int h, BayerPattern pattern,
+        uint8_t* dst, size_t dstPitch);
+}
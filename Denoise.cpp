@@ -0,0 +1,79 @@
+#include "Denoise.h"
+
+#include <algorithm>
+#include <cmath>
+
+#if defined(_M_X64) || defined(_M_AMD64) || defined(__x86_64__) || defined(__SSE2__)
+#define DENOISE_SSE2 1
+#include <emmintrin.h>
+#endif
+
+namespace Denoise
+{
+
+static const int kWeightOne = 128;
+
+Weights weights(const Params& p)
+{
+    Weights w;
+    const float strength = std::min(1.0f, std::max(0.0f, p.strength));
+    w.minWeight = std::max(1, std::min(kWeightOne, (int)std::lround(kWeightOne * (1.0f - strength))));
+    w.threshold = std::max(2, std::min(255, p.motionThreshold));
+    w.floor = w.threshold / 2;
+    // Rounded up, so the weight reaches the whole step at the threshold.
+    const int ramp = w.threshold - w.floor;
+    w.slope = ((kWeightOne - w.minWeight) * 16 + ramp - 1) / ramp;
+    return w;
+}
+
+static inline int filterSample(const Weights& w, int src, int prev)
+{
+    const int a = std::abs(src - prev);
+    const int ramp = std::max(0, std::min(a, w.threshold) - w.floor);
+    const int k = std::min(kWeightOne, w.minWeight + ((ramp * w.slope) >> 4));
+    const int step = (a * k + kWeightOne - 1) >> 7;
+    return src > prev ? prev + step : prev - step;
+}
+
+void filterRow(const Weights& w, const uint8_t* src, const uint8_t* prev, uint8_t* dst, size_t n)
+{
+    size_t i = 0;
+#if defined(DENOISE_SSE2)
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i threshold = _mm_set1_epi8((char)w.threshold);
+    const __m128i floor = _mm_set1_epi8((char)w.floor);
+    const __m128i minWeight = _mm_set1_epi16((short)w.minWeight);
+    const __m128i slope = _mm_set1_epi16((short)w.slope);
+    const __m128i one = _mm_set1_epi16(kWeightOne);
+    const __m128i round = _mm_set1_epi16(kWeightOne - 1);
+    for (; i + 16 <= n; i += 16)
+    {
+        const __m128i s = _mm_loadu_si128((const __m128i*)(src + i));
+        const __m128i p = _mm_loadu_si128((const __m128i*)(prev + i));
+        const __m128i up = _mm_subs_epu8(s, p);
+        const __m128i down = _mm_subs_epu8(p, s);
+        const __m128i a = _mm_or_si128(up, down);
+        const __m128i ac = _mm_subs_epu8(_mm_min_epu8(a, threshold), floor);
+
+        // Weight from the difference past the floor, step from the full one; 8 samples per half.
+        __m128i step[2];
+        for (int h = 0; h < 2; ++h)
+        {
+            const __m128i a16 = h ? _mm_unpackhi_epi8(a, zero) : _mm_unpacklo_epi8(a, zero);
+            const __m128i ac16 = h ? _mm_unpackhi_epi8(ac, zero) : _mm_unpacklo_epi8(ac, zero);
+            const __m128i k = _mm_min_epi16(one, _mm_add_epi16(minWeight, _mm_srli_epi16(_mm_mullo_epi16(ac16, slope), 4)));
+            step[h] = _mm_srli_epi16(_mm_add_epi16(_mm_mullo_epi16(a16, k), round), 7);
+        }
+        const __m128i steps = _mm_packus_epi16(step[0], step[1]);
+
+        // Steps never exceed the difference, so neither side saturates past 'src'.
+        const __m128i rising = _mm_cmpeq_epi8(down, zero);
+        const __m128i out = _mm_subs_epu8(_mm_adds_epu8(p, _mm_and_si128(rising, steps)), _mm_andnot_si128(rising, steps));
+        _mm_storeu_si128((__m128i*)(dst + i), out);
+    }
+#endif
+    for (; i < n; ++i)
+        dst[i] = (uint8_t)filterSample(w, src[i], prev[i]);
+}
+
+}
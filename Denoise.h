@@ -0,0 +1,37 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+
+// Motion-adaptive temporal filtering of 8-bit frames, applied while converting a frame.
+//
+// A recursive exponential average whose only state is the previous output frame: each
+// sample moves from the previous output towards the new frame by a weight that depends
+// on their difference. Up to half of 'motionThreshold' gray levels (noise) it is
+// 1 - strength; it rises to the whole step at the threshold, so moving markers leave no
+// trails. Steps are rounded away from zero, so a still scene settles on the new level
+// instead of stopping short of it. Weights are 7-bit; the SSE2 path runs 16 samples per
+// iteration and works on any 8-bit layout (mono8, or RGBA8 channel by channel).
+namespace Denoise
+{
+    struct Params
+    {
+        bool enabled = false;
+        float strength = 0.8f;      // 0..1: weight of the previous output where nothing moves
+        int motionThreshold = 24;   // gray levels: differences this large replace the pixel
+    };
+
+    // Fixed-point form of the params, for filterRow().
+    struct Weights
+    {
+        int minWeight = 128;        // weight of the new sample at difference 0, of 128
+        int slope = 0;              // added weight per gray level past 'floor', of 128 * 16
+        int floor = 1;
+        int threshold = 2;
+    };
+
+    Weights weights(const Params& p);
+
+    // dst = prev moved towards src, for n bytes. dst may alias src or prev.
+    void filterRow(const Weights& w, const uint8_t* src, const uint8_t* prev, uint8_t* dst, size_t n);
+}
@@ -0,0 +1,274 @@
+#include "FlatField.h"
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+
+#if defined(_M_X64) || defined(_M_AMD64) || defined(__x86_64__) || defined(__SSE2__)
+#define FLATFIELD_SSE2 1
+#include <emmintrin.h>
+#endif
+
+namespace FlatField
+{
+
+static const int kGainBits = 12;
+static const int kGainOne = 1 << kGainBits;
+static const int kMaxGain = 32767;          // just under 8x
+// The madd pairs each sample with a constant that scales the offset: 256 leaves 8-bit
+// offsets 1/16 gray level steps, 16384 fits (14-bit sample * gain) + offset in 32 bits.
+static const int kOffsetScale8 = 256;
+static const int kOffsetScale14 = 16384;
+static const int kMax14 = (1 << 14) - 1;
+
+void Accumulator::reset(int w, int h, int bytesPerPixel)
+{
+    _w = w;
+    _h = h;
+    _bpp = bytesPerPixel;
+    _frames = 0;
+    _sum.assign((size_t)w * (size_t)h, 0u);
+}
+
+void Accumulator::add(const uint8_t* src, size_t pitch)
+{
+    for (int y = 0; y < _h; ++y)
+    {
+        uint32_t* s = _sum.data() + (size_t)y * _w;
+        if (_bpp == 2)
+        {
+            const uint16_t* row = reinterpret_cast<const uint16_t*>(src + (size_t)y * pitch);
+            for (int x = 0; x < _w; ++x)
+                s[x] += row[x];
+        }
+        else
+        {
+            const uint8_t* row = src + (size_t)y * pitch;
+            for (int x = 0; x < _w; ++x)
+                s[x] += row[x];
+        }
+    }
+    ++_frames;
+}
+
+void Accumulator::mean(Frame& out) const
+{
+    out.width = _w;
+    out.height = _h;
+    out.bytesPerPixel = _bpp;
+    out.samples.resize(_sum.size());
+    const uint32_t n = (uint32_t)std::max(1, _frames);
+    for (size_t i = 0; i < _sum.size(); ++i)
+        out.samples[i] = (uint16_t)((_sum[i] + n / 2) / n);
+}
+
+bool build(const Frame* dark, const Frame* flat, Table& out)
+{
+    const Frame* ref = dark ? dark : flat;
+    if (!ref || ref->width <= 0 || ref->height <= 0 || (ref->bytesPerPixel != 1 && ref->bytesPerPixel != 2))
+        return false;
+    if (dark && flat && (dark->width != flat->width || dark->height != flat->height || dark->bytesPerPixel != flat->bytesPerPixel))
+        return false;
+
+    const size_t n = (size_t)ref->width * (size_t)ref->height;
+    const bool deep = ref->bytesPerPixel == 2;
+    const double scale = deep ? 0.25 : 1.0;   // 16-bit samples are corrected at 14 bits
+    const double offsetScale = deep ? kOffsetScale14 : kOffsetScale8;
+    auto darkAt = [&](size_t i) { return dark ? dark->samples[i] * scale : 0.0; };
+
+    // Gains bring every pixel to the frame's mean response.
+    double target = 0.0;
+    if (flat)
+    {
+        for (size_t i = 0; i < n; ++i)
+            target += std::max(0.0, flat->samples[i] * scale - darkAt(i));
+        target /= (double)n;
+    }
+
+    out.width = ref->width;
+    out.height = ref->height;
+    out.bytesPerPixel = ref->bytesPerPixel;
+    out.coeffs.resize(n * 2);
+    for (size_t i = 0; i < n; ++i)
+    {
+        const double d = darkAt(i);
+        double gain = 1.0;
+        if (flat)
+        {
+            // Dead pixels have no response to scale; leave them as they are.
+            const double response = flat->samples[i] * scale - d;
+            gain = response >= 1.0 ? target / response : 1.0;
+        }
+        const long g = std::min<long>(kMaxGain, std::max<long>(0, std::lround(gain * kGainOne)));
+        // (in * g + off * scale) >> 12 == round((in - d) * gain)
+        const long off = std::lround((kGainOne / 2 - d * (double)g) / offsetScale);
+        out.coeffs[i * 2] = (int16_t)g;
+        out.coeffs[i * 2 + 1] = (int16_t)std::min<long>(32767, std::max<long>(-32768, off));
+    }
+    return true;
+}
+
+static void correctRow8(const int16_t* c, const uint8_t* src, uint8_t* dst, int w)
+{
+    int x = 0;
+#if defined(FLATFIELD_SSE2)
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i k = _mm_set1_epi16(kOffsetScale8);
+    for (; x + 16 <= w; x += 16)
+    {
+        const __m128i v = _mm_loadu_si128((const __m128i*)(src + x));
+        const __m128i lo = _mm_unpacklo_epi8(v, zero);
+        const __m128i hi = _mm_unpackhi_epi8(v, zero);
+        const __m128i* cp = (const __m128i*)(c + (size_t)x * 2);
+        // (sample, k) . (gain, offset) per pixel.
+        const __m128i r0 = _mm_srai_epi32(_mm_madd_epi16(_mm_unpacklo_epi16(lo, k), _mm_loadu_si128(cp)), kGainBits);
+        const __m128i r1 = _mm_srai_epi32(_mm_madd_epi16(_mm_unpackhi_epi16(lo, k), _mm_loadu_si128(cp + 1)), kGainBits);
+        const __m128i r2 = _mm_srai_epi32(_mm_madd_epi16(_mm_unpacklo_epi16(hi, k), _mm_loadu_si128(cp + 2)), kGainBits);
+        const __m128i r3 = _mm_srai_epi32(_mm_madd_epi16(_mm_unpackhi_epi16(hi, k), _mm_loadu_si128(cp + 3)), kGainBits);
+        _mm_storeu_si128((__m128i*)(dst + x),
+            _mm_packus_epi16(_mm_packs_epi32(r0, r1), _mm_packs_epi32(r2, r3)));
+    }
+#endif
+    for (; x < w; ++x)
+    {
+        const int v = (src[x] * c[x * 2] + c[x * 2 + 1] * kOffsetScale8) >> kGainBits;
+        dst[x] = (uint8_t)std::min(255, std::max(0, v));
+    }
+}
+
+static void correctRow16(const int16_t* c, const uint16_t* src, int bits, uint16_t* dst, int w)
+{
+    const int right = std::max(0, bits - 14);
+    const int left = std::max(0, 14 - bits);
+    int x = 0;
+#if defined(FLATFIELD_SSE2)
+    const __m128i rightCount = _mm_cvtsi32_si128(right);
+    const __m128i leftCount = _mm_cvtsi32_si128(left);
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i k = _mm_set1_epi16(kOffsetScale14);
+    const __m128i top = _mm_set1_epi16(kMax14);
+    for (; x + 8 <= w; x += 8)
+    {
+        const __m128i v = _mm_sll_epi16(_mm_srl_epi16(_mm_loadu_si128((const __m128i*)(src + x)), rightCount), leftCount);
+        const __m128i* cp = (const __m128i*)(c + (size_t)x * 2);
+        const __m128i r0 = _mm_srai_epi32(_mm_madd_epi16(_mm_unpacklo_epi16(v, k), _mm_loadu_si128(cp)), kGainBits);
+        const __m128i r1 = _mm_srai_epi32(_mm_madd_epi16(_mm_unpackhi_epi16(v, k), _mm_loadu_si128(cp + 1)), kGainBits);
+        const __m128i o = _mm_min_epi16(_mm_max_epi16(_mm_packs_epi32(r0, r1), zero), top);
+        _mm_storeu_si128((__m128i*)(dst + x), _mm_slli_epi16(o, 2));
+    }
+#endif
+    for (; x < w; ++x)
+    {
+        const int in = (src[x] >> right) << left;
+        const int v = (in * c[x * 2] + c[x * 2 + 1] * kOffsetScale14) >> kGainBits;
+        dst[x] = (uint16_t)(std::min(kMax14, std::max(0, v)) << 2);
+    }
+}
+
+void correctRow(const Table& t, int y, const uint8_t* src, int bits, uint8_t* dst)
+{
+    const int16_t* c = t.coeffs.data() + (size_t)y * t.width * 2;
+    if (t.bytesPerPixel == 2)
+        correctRow16(c, reinterpret_cast<const uint16_t*>(src), bits, reinterpret_cast<uint16_t*>(dst), t.width);
+    else
+        correctRow8(c, src, dst, t.width);
+}
+
+std::string referencePath(const std::string& folder, int camera, Reference kind)
+{
+    std::string path = folder;
+    if (!path.empty() && path.back() != '/' && path.back() != '\\')
+        path += '/';
+    return path + "cam" + std::to_string(camera) + (kind == Reference::Dark ? "_dark.pgm" : "_flat.pgm");
+}
+
+bool save(const std::string& path, const Frame& f, std::string& err)
+{
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    if (!out)
+    {
+        err = "can't write reference frame '" + path + "'";
+        return false;
+    }
+    const bool deep = f.bytesPerPixel == 2;
+    out << "P5\n" << f.width << " " << f.height << "\n" << (deep ? 65535 : 255) << "\n";
+    std::vector<uint8_t> row((size_t)f.width * (deep ? 2 : 1));
+    for (int y = 0; y < f.height; ++y)
+    {
+        const uint16_t* s = f.samples.data() + (size_t)y * f.width;
+        for (int x = 0; x < f.width; ++x)
+        {
+            if (deep)
+            {
+                row[(size_t)x * 2] = (uint8_t)(s[x] >> 8);     // PGM is big-endian
+                row[(size_t)x * 2 + 1] = (uint8_t)s[x];
+            }
+            else
+                row[x] = (uint8_t)s[x];
+        }
+        out.write(reinterpret_cast<const char*>(row.data()), (std::streamsize)row.size());
+    }
+    if (!out)
+    {
+        err = "error writing reference frame '" + path + "'";
+        return false;
+    }
+    return true;
+}
+
+bool load(const std::string& path, Frame& out, std::string& err)
+{
+    std::ifstream in(path, std::ios::binary);
+    if (!in)
+    {
+        err = "can't open reference frame '" + path + "'";
+        return false;
+    }
+    // Header fields, with '#' comments, then one whitespace byte before the samples.
+    auto field = [&in]() -> long
+    {
+        for (;;)
+        {
+            const int ch = in.peek();
+            if (ch == '#')
+                in.ignore(1 << 16, '\n');
+            else if (ch == ' ' || ch == '\t' || ch == '\r' || ch == '\n')
+                in.get();
+            else
+                break;
+        }
+        long v = -1;
+        in >> v;
+        return in ? v : -1;
+    };
+    char magic[2] = {};
+    in.read(magic, 2);
+    const long w = field(), h = field(), maxval = field();
+    if (magic[0] != 'P' || magic[1] != '5' || w <= 0 || h <= 0 || w > 65535 || h > 65535 || (maxval != 255 && maxval != 65535))
+    {
+        err = "'" + path + "' is not an 8- or 16-bit binary PGM";
+        return false;
+    }
+    in.get();
+
+    const bool deep = maxval == 65535;
+    out.width = (int)w;
+    out.height = (int)h;
+    out.bytesPerPixel = deep ? 2 : 1;
+    out.samples.resize((size_t)w * (size_t)h);
+    std::vector<uint8_t> row((size_t)w * (deep ? 2 : 1));
+    for (long y = 0; y < h; ++y)
+    {
+        if (!in.read(reinterpret_cast<char*>(row.data()), (std::streamsize)row.size()))
+        {
+            err = "'" + path + "' is truncated";
+            return false;
+        }
+        uint16_t* s = out.samples.data() + (size_t)y * w;
+        for (long x = 0; x < w; ++x)
+            s[x] = deep ? (uint16_t)((row[(size_t)x * 2] << 8) | row[(size_t)x * 2 + 1]) : row[x];
+    }
+    return true;
+}
+
+}
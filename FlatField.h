@@ -0,0 +1,73 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <vector>
+
+// Flat-field and dark-frame correction of mono frames, applied while converting a frame.
+//
+// A camera's references are the mean of a few frames with the lens capped (dark) and of
+// an evenly lit, unsaturated view (flat). They become a table of two int16 coefficients
+// per pixel, a Q12 gain and an offset, so correcting a sample is one multiply-add (SSE2
+// madd of the sample and a constant against the pair) and a saturating pack:
+//
+//   out = (in - dark) * mean(flat - dark) / (flat - dark)
+//
+// Samples are in the capture frame layout: 1 byte (mono8) or 16-bit words, left-aligned.
+// 16-bit samples are corrected at 14 bits. Gains are limited to 8x.
+namespace FlatField
+{
+    enum class Reference
+    {
+        Dark,
+        Flat,
+    };
+
+    // A reference frame, in the frame layout (8-bit values for mono8).
+    struct Frame
+    {
+        int width = 0;
+        int height = 0;
+        int bytesPerPixel = 0;          // 1 or 2
+        std::vector<uint16_t> samples;
+    };
+
+    // Sums frames for a reference.
+    class Accumulator
+    {
+    public:
+        void reset(int w, int h, int bytesPerPixel);
+        void add(const uint8_t* src, size_t pitch);
+        int frames() const { return _frames; }
+        bool matches(int w, int h, int bytesPerPixel) const { return w == _w && h == _h && bytesPerPixel == _bpp; }
+        void mean(Frame& out) const;    // rounded
+
+    private:
+        int _w = 0, _h = 0, _bpp = 0, _frames = 0;
+        std::vector<uint32_t> _sum;
+    };
+
+    struct Table
+    {
+        int width = 0;
+        int height = 0;
+        int bytesPerPixel = 0;
+        std::vector<int16_t> coeffs;    // per pixel: gain (Q12), offset
+    };
+
+    // Builds the table of a camera from its references; either may be null (no dark is a
+    // dark of 0, no flat a gain of 1). False if neither is given or their sizes differ.
+    bool build(const Frame* dark, const Frame* flat, Table& out);
+
+    // Corrects row y of a frame of the table's size. 2-byte samples in 'src' hold 'bits'
+    // significant bits, right-aligned (16 for frame-layout rows); the output is left-aligned.
+    // src may equal dst.
+    void correctRow(const Table& t, int y, const uint8_t* src, int bits, uint8_t* dst);
+
+    // <folder>/cam<N>_dark.pgm and _flat.pgm. Files are binary PGM (P5), maxval 255 for
+    // mono8 references and 65535 for 16-bit ones.
+    std::string referencePath(const std::string& folder, int camera, Reference kind);
+    bool save(const std::string& path, const Frame& f, std::string& err);
+    bool load(const std::string& path, Frame& out, std::string& err);
+}
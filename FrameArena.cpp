@@ -0,0 +1,214 @@
+#include "FrameArena.h"
+
+#include <algorithm>
+#include <Windows.h>
+
+static const size_t kSlotGranularity = 4096;   // slot sizes round up to whole pages
+static const int kGrowSlots = 2;               // slots added when acquire() finds none free
+
+// Large pages need SeLockMemoryPrivilege enabled on the process token.
+static bool enableLockMemoryPrivilege()
+{
+    HANDLE token = nullptr;
+    if (!OpenProcessToken(GetCurrentProcess(), TOKEN_ADJUST_PRIVILEGES | TOKEN_QUERY, &token))
+        return false;
+
+    TOKEN_PRIVILEGES tp = {};
+    tp.PrivilegeCount = 1;
+    tp.Privileges[0].Attributes = SE_PRIVILEGE_ENABLED;
+    bool ok = LookupPrivilegeValueW(nullptr, SE_LOCK_MEMORY_NAME, &tp.Privileges[0].Luid) != 0;
+    // AdjustTokenPrivileges succeeds even when the right isn't held; only the last error tells.
+    ok = ok && AdjustTokenPrivileges(token, FALSE, &tp, 0, nullptr, nullptr) != 0 && GetLastError() == ERROR_SUCCESS;
+    CloseHandle(token);
+    return ok;
+}
+
+FrameArena& FrameArena::instance()
+{
+    // Intentionally leaked like WorkerPool: MIL buffers created on slots may still be
+    // referenced during DLL teardown, and the OS reclaims the memory at process exit.
+    static FrameArena* g = new FrameArena();
+    return *g;
+}
+
+size_t FrameArena::slotClass(size_t bytes)
+{
+    bytes = std::max<size_t>(bytes, 1);
+    return (bytes + kSlotGranularity - 1) / kSlotGranularity * kSlotGranularity;
+}
+
+void FrameArena::setLargePages(bool on)
+{
+    std::lock_guard<std::mutex> lk(_mtx);
+    _largePages = on;
+}
+
+bool FrameArena::grow_NoLock(size_t slotBytes, int count)
+{
+    count = std::max(1, count);
+
+    bool large = false;
+    size_t granule = 64 * 1024;   // VirtualAlloc reservation granularity
+    if (_largePages)
+    {
+        if (!_largePagesTried)
+        {
+            _largePagesTried = true;
+            _largePagesOk = enableLockMemoryPrivilege() && GetLargePageMinimum() > 0;
+        }
+        if (_largePagesOk)
+        {
+            large = true;
+            granule = GetLargePageMinimum();
+        }
+    }
+
+    const size_t want = slotBytes * (size_t)count;
+    size_t bytes = (want + granule - 1) / granule * granule;
+
+    uint8_t* base = nullptr;
+    if (large)
+        base = static_cast<uint8_t*>(VirtualAlloc(nullptr, bytes, MEM_RESERVE | MEM_COMMIT | MEM_LARGE_PAGES, PAGE_READWRITE));
+    if (!base)
+    {
+        // Large pages can fail later on from fragmentation; fall back for this slab only.
+        large = false;
+        bytes = (want + 64 * 1024 - 1) / (64 * 1024) * (64 * 1024);
+        base = static_cast<uint8_t*>(VirtualAlloc(nullptr, bytes, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE));
+        if (!base)
+            return false;
+
+        // Fault every page in now rather than on the first frame.
+        for (size_t off = 0; off < bytes; off += kSlotGranularity)
+            base[off] = 0;
+    }
+
+    Slab s;
+    s.base = base;
+    s.bytes = bytes;
+    s.slotBytes = slotBytes;
+    s.slots = (int)(bytes / slotBytes);   // rounding slack becomes extra slots
+    s.freeSlots = s.slots;
+    s.large = large;
+    _slabs.push_back(s);
+
+    std::vector<uint8_t*>& list = _free[slotBytes];
+    for (int i = s.slots - 1; i >= 0; --i)
+        list.push_back(base + (size_t)i * slotBytes);
+    return true;
+}
+
+void FrameArena::reserve(size_t bytes, int count)
+{
+    const size_t cls = slotClass(bytes);
+    std::lock_guard<std::mutex> lk(_mtx);
+    const int have = (int)_free[cls].size();
+    if (have < count)
+        grow_NoLock(cls, count - have);
+}
+
+FrameArena::Slot FrameArena::acquire(size_t bytes)
+{
+    const size_t cls = slotClass(bytes);
+    Slot slot;
+
+    std::lock_guard<std::mutex> lk(_mtx);
+    std::vector<uint8_t*>& list = _free[cls];
+    if (list.empty() && !grow_NoLock(cls, kGrowSlots))
+        return slot;
+
+    uint8_t* p = list.back();
+    list.pop_back();
+    for (Slab& s : _slabs)
+    {
+        if (p >= s.base && p < s.base + s.bytes)
+        {
+            --s.freeSlots;
+            break;
+        }
+    }
+
+    slot._data = p;
+    slot._size = bytes;
+    slot._capacity = cls;
+    return slot;
+}
+
+void FrameArena::release(uint8_t* p, size_t slotBytes)
+{
+    std::lock_guard<std::mutex> lk(_mtx);
+    _free[slotBytes].push_back(p);
+    for (Slab& s : _slabs)
+    {
+        if (p >= s.base && p < s.base + s.bytes)
+        {
+            ++s.freeSlots;
+            break;
+        }
+    }
+}
+
+void FrameArena::trim()
+{
+    std::lock_guard<std::mutex> lk(_mtx);
+    for (size_t i = 0; i < _slabs.size();)
+    {
+        Slab& s = _slabs[i];
+        if (s.freeSlots != s.slots)
+        {
+            ++i;
+            continue;
+        }
+
+        std::vector<uint8_t*>& list = _free[s.slotBytes];
+        list.erase(std::remove_if(list.begin(), list.end(),
+            [&](uint8_t* p) { return p >= s.base && p < s.base + s.bytes; }), list.end());
+        if (list.empty())
+            _free.erase(s.slotBytes);
+
+        VirtualFree(s.base, 0, MEM_RELEASE);
+        _slabs.erase(_slabs.begin() + i);
+    }
+}
+
+FrameArena::Stats FrameArena::stats() const
+{
+    Stats st;
+    std::lock_guard<std::mutex> lk(_mtx);
+    for (const Slab& s : _slabs)
+    {
+        ++st.slabs;
+        st.slabBytes += s.bytes;
+        st.largePageBytes += s.large ? s.bytes : 0;
+        st.slotsInUse += (size_t)(s.slots - s.freeSlots);
+        st.slotsFree += (size_t)s.freeSlots;
+    }
+    return st;
+}
+
+void FrameArena::Slot::reset()
+{
+    if (_data)
+        FrameArena::instance().release(_data, _capacity);
+    _data = nullptr;
+    _size = 0;
+    _capacity = 0;
+}
+
+void FrameArena::Slot::swap(Slot& o) noexcept
+{
+    std::swap(_data, o._data);
+    std::swap(_size, o._size);
+    std::swap(_capacity, o._capacity);
+}
+
+bool FrameArena::Slot::resize(size_t bytes)
+{
+    if (_data && bytes <= _capacity)
+    {
+        _size = bytes;
+        return true;
+    }
+    *this = FrameArena::instance().acquire(bytes);
+    return !empty();
+}
@@ -0,0 +1,106 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <vector>
+
+// Process-wide arena of fixed-size frame slots for capture rings, conversion scratch
+// and composite canvases.
+//
+// Slots are carved out of large slabs (VirtualAlloc, optionally MEM_LARGE_PAGES) that
+// are committed and touched up front, so frame memory is 64-byte aligned, never
+// reallocated while its size holds, and does not page-fault on the capture path.
+// Slots of one rounded size share a free list; a slab is returned to the OS only by
+// trim(), once every slot in it is free.
+class FrameArena
+{
+public:
+    static constexpr size_t kAlignment = 64;
+
+    // Move-only handle to one slot; returns it to the arena on destruction.
+    class Slot
+    {
+    public:
+        Slot() = default;
+        ~Slot() { reset(); }
+        Slot(Slot&& o) noexcept { swap(o); }
+        Slot& operator=(Slot&& o) noexcept { if (this != &o) { reset(); swap(o); } return *this; }
+        Slot(const Slot&) = delete;
+        Slot& operator=(const Slot&) = delete;
+
+        uint8_t* data() const { return _data; }
+        size_t size() const { return _size; }          // bytes asked for
+        size_t capacity() const { return _capacity; }  // bytes owned (rounded size class)
+        bool empty() const { return _data == nullptr; }
+
+        void reset();
+        void swap(Slot& o) noexcept;
+
+        // Keeps the slot when 'bytes' fits, otherwise trades it for a larger one.
+        // Contents are not preserved across a trade. Returns false if the arena is out of memory.
+        bool resize(size_t bytes);
+
+    private:
+        friend class FrameArena;
+        uint8_t* _data = nullptr;
+        size_t _size = 0;
+        size_t _capacity = 0;
+    };
+
+    struct Stats
+    {
+        size_t slabs = 0;
+        size_t slabBytes = 0;
+        size_t largePageBytes = 0;  // part of slabBytes backed by large pages
+        size_t slotsInUse = 0;
+        size_t slotsFree = 0;
+    };
+
+    static FrameArena& instance();
+
+    // Applies to slabs allocated from now on. Large pages need the "Lock pages in
+    // memory" right (SeLockMemoryPrivilege); without it slabs silently use normal pages.
+    void setLargePages(bool on);
+
+    // Makes sure at least 'count' free slots of 'bytes' exist, in one slab.
+    // Called with the camera inventory so the first frames don't allocate.
+    void reserve(size_t bytes, int count);
+
+    // Empty slot when the OS refuses more memory.
+    Slot acquire(size_t bytes);
+
+    // Returns fully free slabs to the OS (after format changes left old size classes idle).
+    void trim();
+
+    Stats stats() const;
+
+private:
+    FrameArena() = default;
+    ~FrameArena() = delete;   // never destroyed, see instance()
+
+    FrameArena(const FrameArena&) = delete;
+    FrameArena& operator=(const FrameArena&) = delete;
+
+    struct Slab
+    {
+        uint8_t* base = nullptr;
+        size_t bytes = 0;
+        size_t slotBytes = 0;
+        int slots = 0;
+        int freeSlots = 0;
+        bool large = false;
+    };
+
+    static size_t slotClass(size_t bytes);
+    bool grow_NoLock(size_t slotBytes, int count);
+    void release(uint8_t* p, size_t slotBytes);
+
+    mutable std::mutex _mtx;
+    std::vector<Slab> _slabs;
+    std::map<size_t, std::vector<uint8_t*>> _free;   // by slot size class
+    bool _largePages = false;
+    bool _largePagesTried = false;
+    bool _largePagesOk = false;   // privilege enabled and GetLargePageMinimum() > 0
+};
@@ -0,0 +1,86 @@
+#include "FrameSource.h"
+#include "PixelConvert.h"
+
+#include <algorithm>
+#include <cstring>
+
+size_t FrameSource::outPixelBytes(OutPixel fmt)
+{
+    switch (fmt)
+    {
+    case OutPixel::Mono16: return 2;
+    case OutPixel::RGBA16: return 8;
+    case OutPixel::RGBA8:
+    default:               return 4;
+    }
+}
+
+void FrameSource::convertRow(const uint8_t* src, int srcBpp, OutPixel fmt, uint8_t* dst, size_t w)
+{
+    if (srcBpp == 4)
+    {
+        switch (fmt)
+        {
+        case OutPixel::RGBA8:  std::memcpy(dst, src, w * 4); break;
+        case OutPixel::Mono16: PixelConvert::rgba8ToGray16(src, reinterpret_cast<uint16_t*>(dst), w); break;
+        case OutPixel::RGBA16: PixelConvert::gray8ToGray16(src, reinterpret_cast<uint16_t*>(dst), w * 4); break;
+        }
+        return;
+    }
+
+    if (srcBpp == 1)
+    {
+        switch (fmt)
+        {
+        case OutPixel::RGBA8:  PixelConvert::gray8ToRGBA8(src, dst, w); break;
+        case OutPixel::Mono16: PixelConvert::gray8ToGray16(src, reinterpret_cast<uint16_t*>(dst), w); break;
+        case OutPixel::RGBA16: PixelConvert::gray8ToRGBA16(src, reinterpret_cast<uint16_t*>(dst), w); break;
+        }
+        return;
+    }
+
+    const uint16_t* src16 = reinterpret_cast<const uint16_t*>(src);
+    switch (fmt)
+    {
+    case OutPixel::RGBA8:  PixelConvert::gray16ToRGBA8(src16, dst, w); break;
+    case OutPixel::Mono16: std::memcpy(dst, src, w * 2); break;
+    case OutPixel::RGBA16: PixelConvert::gray16ToRGBA16(src16, reinterpret_cast<uint16_t*>(dst), w); break;
+    }
+}
+
+int FrameSource::updateGrid(int gridCols, int gridRows, int tileW, int tileH, OutPixel fmt,
+    uint8_t* canvas, size_t canvasBytes, std::vector<uint64_t>& tileSeqs)
+{
+    if (!canvas) return -1;
+    if (gridCols <= 0 || gridRows <= 0 || tileW <= 0 || tileH <= 0) return -1;
+
+    const int outW = gridCols * tileW;
+    const int outH = gridRows * tileH;
+    const size_t bpp = outPixelBytes(fmt);
+    const size_t need = (size_t)outW * (size_t)outH * bpp;
+    if (canvasBytes < need) return -1;
+
+    // Only visit cells that have a discovered camera behind them.
+    const int numCams = std::min(cameraCount(), gridCols * gridRows);
+    if ((int)tileSeqs.size() < numCams)
+        tileSeqs.resize(numCams, 0);
+
+    const size_t rowStride = (size_t)outW * bpp;
+    int updated = 0;
+
+    for (int camIdx = 0; camIdx < numCams; ++camIdx)
+    {
+        // Keeps every camera acquiring; a no-op once it is running.
+        if (!ensureStreaming(camIdx))
+            continue;
+
+        // Cameras smaller than the cell are anchored top-left; larger ones are cropped.
+        // Cells whose camera has nothing new keep last cook's pixels.
+        const int r = camIdx / gridCols;
+        const int c = camIdx % gridCols;
+        uint8_t* cell = canvas + (size_t)(r * tileH) * rowStride + (size_t)(c * tileW) * bpp;
+        if (copyLatestFrame(camIdx, fmt, cell, rowStride, tileW, tileH, tileSeqs[camIdx]))
+            ++updated;
+    }
+    return updated;
+}
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Read side of a camera set, as the TOP consumes it. MilManager captures in this
+// process; DaemonClient reads the capture daemon's shared-memory rings. Control
+// (DCF, geometry, bandwidth, threads) stays on MilManager and is not part of this.
+class FrameSource
+{
+public:
+    virtual ~FrameSource() = default;
+
+    // Camera format as published. Cached by the source so callers can size outputs
+    // without touching the hardware.
+    struct CameraFormat
+    {
+        int width = 0;
+        int height = 0;
+        int bits = 8;       // native sample depth; frames deeper than 8 bits are kept as 16-bit
+        bool color = false; // Bayer camera demosaiced to RGBA8 in the capture hook
+        int wireBits = 8;   // bits per pixel on the link (packed formats < 16)
+        int packetSize = 1500;  // GevSCPSPacketSize
+    };
+
+    // Pixel layouts the copy-out path can produce. 10/12-bit cameras are left-aligned
+    // to the full 16-bit range, so Mono16/RGBA16 show their full dynamic range.
+    enum class OutPixel
+    {
+        RGBA8,
+        Mono16,
+        RGBA16,
+    };
+    static size_t outPixelBytes(OutPixel fmt);
+
+    // Frame row as captured (srcBpp 1 = 8-bit mono, 2 = 16-bit mono, 4 = RGBA8) -> output layout.
+    static void convertRow(const uint8_t* src, int srcBpp, OutPixel fmt, uint8_t* dst, size_t w);
+
+    virtual std::string summaryLine() const = 0;
+    virtual const std::string& lastError() const = 0;
+
+    // Number of cameras the source knows about.
+    virtual int cameraCount() = 0;
+    virtual bool cameraFormat(int camIdx, CameraFormat& out) = 0;
+
+    // Bumped whenever any CameraFormat may have changed. Callers cache their layout
+    // and re-query only when this moves.
+    virtual uint64_t formatGeneration() const = 0;
+
+    // Makes sure frames are flowing for the camera; false if it can't deliver any.
+    virtual bool ensureStreaming(int camIdx) = 0;
+
+    // Copies the newest frame into dst (dstStride bytes per row) converted to 'fmt',
+    // cropped to maxW x maxH. Nothing is copied unless the frame is newer than 'seen';
+    // on copy, 'seen' is advanced to the frame's sequence. Returns true if pixels were written.
+    virtual bool copyLatestFrame(int camIdx, OutPixel fmt, uint8_t* dst, size_t dstStride, int maxW, int maxH, uint64_t& seen) = 0;
+
+    // Newest frame of one camera at exactly width x height into caller memory.
+    virtual bool grabFrame(int camIdx, OutPixel fmt, int width, int height, uint8_t* outFrame, size_t outBytes) = 0;
+
+    // Incremental grid composition into a caller-owned canvas that persists across calls.
+    // tileSeqs holds the last composed sequence per cell; only cells whose camera has a
+    // newer frame are redrawn. Returns the number of cells updated, or -1 on bad arguments.
+    int updateGrid(int gridCols, int gridRows, int tileW, int tileH, OutPixel fmt,
+        uint8_t* canvas, size_t canvasBytes, std::vector<uint64_t>& tileSeqs);
+};
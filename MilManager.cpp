@@ -1,11 +1,25 @@
 ﻿#include "MilManager.h"
+#include "PixelConvert.h"
+#include "WorkerPool.h"
 #include <type_traits>
 #include <string>
 #include <sstream>
+#include <fstream>
 #include <algorithm>
 #include <cstring>
+#include <chrono>
+#include <cmath>
 #include <Windows.h>
 
+static const int kRingSize = 4;                 // MdigProcess buffers per digitizer
+static const int kFirstFrameTimeoutMs = 1000;   // grabToRGBA8 wait for a camera's first frame
+static const int kWatchdogPeriodMs = 250;       // how often the watchdog looks at every digitizer
+static const int kStallMinMs = 3000;            // never call a camera stalled sooner than this
+static const int kStallIntervals = 20;          // ...or than this many of its own frame intervals
+static const int kRetryMinMs = 500;             // reconnect backoff, doubled per failure
+static const int kRetryMaxMs = 30000;
+static const int kStaleSetMs = 100;             // triangulation: a camera this far behind the newest no longer holds sets back
+
 static inline void setErr(MilManager& mm, std::string& dst, const std::string& msg)
 {
     dst = msg;
@@ -45,6 +59,20 @@ MilManager::MilManager()
 MilManager::~MilManager() 
 {
 #if defined(HAVE_MIL)
+    // Stop the watchdog before tearing down what it watches. join() could wait on the
+    // loader lock during DLL unload, so wait for the loop's own exit flag instead.
+    if (_watchdog.joinable())
+    {
+        {
+            std::lock_guard<std::mutex> wl(_wdMtx);
+            _wdStop = true;
+        }
+        _wdCv.notify_all();
+        for (int i = 0; i < 500 && !_wdDone.load(std::memory_order_acquire); ++i)
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        _watchdog.detach();
+    }
+
     std::lock_guard<std::recursive_mutex> lk(_mtx);
 
 
@@ -82,6 +110,29 @@ bool MilManager::ensureSystem()
 #if !defined(HAVE_MIL)
     setErr(_lastError, "MIL not compiled (HAVE_MIL not defined).");
     return false;
+#else
+    // After a failed attempt only the watchdog retries (with backoff); cooks return
+    // without touching the lock.
+    if (_sysFailed.load(std::memory_order_acquire))
+        return false;
+
+    std::lock_guard<std::recursive_mutex> lk(_mtx);
+    const bool ok = trySystem();
+    if (!ok)
+    {
+        _sysRetryDelayMs = kRetryMinMs;
+        _sysRetryAt = std::chrono::steady_clock::now() + std::chrono::milliseconds(_sysRetryDelayMs);
+        _sysFailed.store(true, std::memory_order_release);
+    }
+    startWatchdog_NoLock();
+    return ok;
+#endif
+}
+
+bool MilManager::trySystem()
+{
+#if !defined(HAVE_MIL)
+    return false;
 #else
     std::lock_guard<std::recursive_mutex> lk(_mtx);
 
@@ -318,6 +369,7 @@ bool MilManager::discoverDigitizers_NoLock()
     }
 
     _lastProbeReport = os.str();
+    _formatGen.fetch_add(1, std::memory_order_release);
 
     return !_validDigDevs.empty();
 #endif
@@ -412,8 +464,44 @@ std::string MilManager::dumpDevices() const
 }
 
 
+static std::string milStringToStd(const std::wstring& s)
+{
+    std::string out;
+    out.reserve(s.size());
+    for (wchar_t ch : s)
+        out.push_back((ch <= 0x7F) ? static_cast<char>(ch) : '?'); // ASCII-safe
+    return out;
+}
+
+// Overload for narrow strings
+static std::string milStringToStd(const std::string& s)
+{
+    return s;
+}
+
+// Parameters arrive as UTF-8; MIL paths are wide.
+static std::wstring stdToMilString(const std::string& s)
+{
+    if (s.empty()) return std::wstring();
+    const int n = MultiByteToWideChar(CP_UTF8, 0, s.c_str(), (int)s.size(), nullptr, 0);
+    std::wstring out((size_t)std::max(0, n), L'\0');
+    if (n > 0)
+        MultiByteToWideChar(CP_UTF8, 0, s.c_str(), (int)s.size(), &out[0], n);
+    return out;
+}
+
+
 #if defined(HAVE_MIL)
 
+// Loads a GenICam user set (UserSetSelector + UserSetLoad). Acquisition must be stopped.
+static bool loadUserSet(MIL_ID dig, const MIL_STRING& set)
+{
+    MappGetError(M_DEFAULT, M_GLOBAL, M_NULL);   // clear any stale error
+    MdigControlFeature(dig, M_FEATURE_VALUE, MIL_TEXT("UserSetSelector"), M_TYPE_STRING, set.c_str());
+    MdigControlFeature(dig, M_FEATURE_EXECUTE, MIL_TEXT("UserSetLoad"), M_TYPE_COMMAND, M_NULL);
+    return MappGetError(M_DEFAULT, M_GLOBAL, M_NULL) == M_NULL_ERROR;
+}
+
 bool MilManager::allocDig(int camIdx)
 {
 #if !defined(HAVE_MIL)
@@ -424,54 +512,127 @@ bool MilManager::allocDig(int camIdx)
 
     std::lock_guard<std::recursive_mutex> lk(_mtx);
 
-    if ((int)_digs.size() <= camIdx)
-        _digs.resize(camIdx + 1);
+    if (camIdx >= 0 && camIdx < (int)_digs.size())
+    {
+        // Lost cameras belong to the watchdog: fail fast instead of retrying MIL from the cook.
+        if (_digs[camIdx]->lost || _digs[camIdx]->reconnecting)
+            return false;
+        if (_digs[camIdx]->dig != M_NULL)
+            return true;
+    }
 
-    if (_digs[camIdx].dig != M_NULL)
-        return true;
+    // Make sure digitizers were discovered. Not again once some are: probing clears the
+    // list and skips devices this process already holds.
+    if (_validDigDevs.empty())
+        discoverDigitizers_NoLock();
 
-    MIL_ID dig = M_NULL;
+    // An index past the discovered cameras is a setting, not a camera to reconnect.
+    if (camIdx < 0 || camIdx >= (int)_validDigDevs.size())
+    {
+        std::ostringstream em;
+        em << "Unknown camera " << camIdx << ": " << _validDigDevs.size()
+            << " camera(s) found on the MIL system.";
+        setErr(*this, _lastError, em.str());
+        return false;
+    }
 
-    // Make sure digitizers were discovered
-    if (_validDigDevs.empty() || camIdx >= (int)_validDigDevs.size())
+    while ((int)_digs.size() <= camIdx)
     {
-        discoverDigitizers_NoLock();
+        _digs.push_back(std::make_unique<Dig>());
+        _digs.back()->slot = (int)_digs.size() - 1;
     }
 
-    // Pick correct DEV index
-    const MIL_INT dev =
-        (camIdx >= 0 && camIdx < (int)_validDigDevs.size())
-        ? _validDigDevs[camIdx]
-        : (M_DEV0 + camIdx);
+    MIL_ID dig = M_NULL;
+    const MIL_INT dev = _validDigDevs[camIdx];
 
-    MdigAlloc(_sysId, dev, MIL_TEXT("M_DEFAULT"), M_DEFAULT, &dig);
+    // The DCF comes from the camera's active profile (see applyDcfProfile).
+    const MIL_STRING& dcf = _digs[camIdx]->dcf;
+    MdigAlloc(_sysId, dev, dcf.empty() ? MIL_TEXT("M_DEFAULT") : dcf.c_str(), M_DEFAULT, &dig);
 
     if (dig == M_NULL)
     {
         std::ostringstream em;
         em << "MdigAlloc(M_DEV" << (dev - M_DEV0)
-            << ") failed on current MIL system.";
+            << ") failed on current MIL system";
+        if (!dcf.empty())
+            em << " with DCF '" << milStringToStd(dcf) << "'";
+        em << " The watchdog will retry.";
+        markLost(*_digs[camIdx]);
         setErr(*this, _lastError, em.str());
         return false;
     }
 
+    Dig& d = *_digs[camIdx];
+    d.dig = dig;
+    if (!d.userSet.empty() && !loadUserSet(dig, d.userSet))
+        d.userSet.clear();     // keep the camera usable in whatever mode the DCF left it
+    cacheNativeFormat(d);
 
-    if (dig == M_NULL)
+    if (d.w <= 0 || d.h <= 0)
     {
-        setErr(*this, _lastError, "MdigAlloc(M_GIGE_VISION) failed. No GigE cameras visible.");
+        std::ostringstream em;
+        em << "MdigInquire(M_SIZE_X/M_SIZE_Y) returned " << d.w << "x" << d.h
+            << " for M_DEV" << (dev - M_DEV0) << ". Check the camera/DCF.";
+        freeDig(camIdx);
+        markLost(d);
+        setErr(*this, _lastError, em.str());
         return false;
     }
 
-    _digs[camIdx].dig = dig;
-    _digs[camIdx].grabBuf = M_NULL;
-    _digs[camIdx].w = 0;
-    _digs[camIdx].h = 0;
-
+    _formatGen.fetch_add(1, std::memory_order_release);
     setErr(*this,_lastError, "");
     return true;
 #endif
 }
 
+void MilManager::cacheNativeFormat(Dig& d)
+{
+    const MIL_ID dig = d.dig;
+
+    // Cached once per allocation or profile switch; grabs and output sizing read it from here.
+    d.w = MdigInquire(dig, M_SIZE_X, M_NULL);
+    d.h = MdigInquire(dig, M_SIZE_Y, M_NULL);
+    d.bits = MdigInquire(dig, M_SIZE_BIT, M_NULL);
+    if (d.bits <= 0)
+        d.bits = 8;
+
+    // Deeper-than-8-bit cameras keep their range end to end. Packed GenICam formats
+    // can't be grabbed into 16-bit buffers directly, so they are unpacked in the hook.
+    d.packing = Packing::None;
+    {
+        MIL_STRING pixFmt;
+        MdigInquireFeature(dig, M_FEATURE_VALUE, MIL_TEXT("PixelFormat"), M_TYPE_STRING, pixFmt);
+        if (pixFmt == MIL_TEXT("Mono12p"))
+            d.packing = Packing::Mono12p;
+        else if (pixFmt == MIL_TEXT("Mono12Packed"))
+            d.packing = Packing::Mono12Packed;
+        else if (pixFmt == MIL_TEXT("Mono10p"))
+            d.packing = Packing::Mono10p;
+        else if (pixFmt == MIL_TEXT("Mono10Packed"))
+            d.packing = Packing::Mono10Packed;
+
+        d.detectedBayer = Demosaic::BayerPattern::None;
+        if (pixFmt == MIL_TEXT("BayerRG8"))
+            d.detectedBayer = Demosaic::BayerPattern::RGGB;
+        else if (pixFmt == MIL_TEXT("BayerBG8"))
+            d.detectedBayer = Demosaic::BayerPattern::BGGR;
+        else if (pixFmt == MIL_TEXT("BayerGR8"))
+            d.detectedBayer = Demosaic::BayerPattern::GRBG;
+        else if (pixFmt == MIL_TEXT("BayerGB8"))
+            d.detectedBayer = Demosaic::BayerPattern::GBRG;
+    }
+    if (d.packing == Packing::Mono12p || d.packing == Packing::Mono12Packed)
+        d.bits = 12;
+    else if (d.packing != Packing::None)
+        d.bits = 10;
+    updateFrameLayout(d);
+
+    d.packetSize = 0;
+    MdigInquireFeature(dig, M_FEATURE_VALUE, MIL_TEXT("GevSCPSPacketSize"), M_TYPE_INT64, &d.packetSize);
+    if (d.packetSize <= 0)
+        d.packetSize = 1500;
+}
+
 /*
 bool MilManager::allocDig(int camIdx)
 {
@@ -551,208 +712,2344 @@ void MilManager::freeDig(int camIdx)
 {
     if (camIdx < 0 || camIdx >= (int)_digs.size()) return;
 
-    auto& d = _digs[camIdx];
-    if (d.grabBuf != M_NULL) { MbufFree(d.grabBuf); d.grabBuf = M_NULL; }
+    auto& d = *_digs[camIdx];
+    stopStreaming(d);
+    freeRing(d);
     if (d.dig != M_NULL) { MdigFree(d.dig);     d.dig = M_NULL; }
     d.w = d.h = 0;
 }
-#endif
 
-bool MilManager::ensureDigitizer(int camIdx)
+// Converts one grabbed row into the Dig's frame layout (8-bit, or 16-bit left-aligned).
+static void unpackRow(MilManager::Packing packing, int bits, const uint8_t* src, uint8_t* dst, size_t w)
 {
-#if !defined(HAVE_MIL)
-    (void)camIdx;
-    return false;
-#else
-    std::lock_guard<std::recursive_mutex> lk(_mtx);
-    return allocDig(camIdx);
-#endif
+    uint16_t* dst16 = reinterpret_cast<uint16_t*>(dst);
+    switch (packing)
+    {
+    case MilManager::Packing::Mono12p:      PixelConvert::unpackMono12p(src, dst16, w); break;
+    case MilManager::Packing::Mono12Packed: PixelConvert::unpackMono12Packed(src, dst16, w); break;
+    case MilManager::Packing::Mono10p:      PixelConvert::unpackMono10p(src, dst16, w); break;
+    case MilManager::Packing::Mono10Packed: PixelConvert::unpackMono10Packed(src, dst16, w); break;
+    case MilManager::Packing::None:
+        if (bits > 8)
+            PixelConvert::shiftLeft16(reinterpret_cast<const uint16_t*>(src), dst16, w, 16 - bits);
+        else
+            std::memcpy(dst, src, w);
+        break;
+    }
 }
 
-static inline void grayToRGBA(const uint8_t* gray, int w, int h, uint8_t* rgba)
+void MilManager::tuneHookThread(Dig& d)
 {
-    const size_t n = (size_t)w * (size_t)h;
-    for (size_t i = 0; i < n; ++i)
+    // MIL may hand a digitizer a new thread (after a reconnect) or, in principle, share
+    // one; re-apply whenever the generation or the digitizer served changes.
+    struct Applied
     {
-        uint8_t g = gray[i];
-        rgba[i * 4 + 0] = g;
-        rgba[i * 4 + 1] = g;
-        rgba[i * 4 + 2] = g;
-        rgba[i * 4 + 3] = 255;
+        uint64_t gen = 0;
+        const Dig* dig = nullptr;
+    };
+    thread_local Applied applied;
+
+    MilManager& mgr = instance();
+    const uint64_t gen = mgr._captureGen.load(std::memory_order_acquire);
+    if (gen != 0 && (applied.gen != gen || applied.dig != &d))
+    {
+        ThreadTuning::CpuSet cpus;
+        ThreadTuning::Priority priority;
+        {
+            std::lock_guard<std::mutex> lk(mgr._captureMtx);
+            cpus = mgr._captureCpus;
+            priority = mgr._capturePriority;
+        }
+        ThreadTuning::tuneCurrentThread(cpus, d.slot, priority);
+        applied.gen = gen;
+        applied.dig = &d;
     }
-}
 
-bool MilManager::grabToRGBA8(int camIdx, int width, int height, std::vector<uint8_t>& outRGBA)
-{
-    if (width <= 0 || height <= 0)
+    // Scheduling jitter against the smoothed frame interval. Gaps far beyond it are
+    // dropped frames rather than late wakeups, so they only feed the average.
+    const auto now = std::chrono::steady_clock::now();
+    if (d.hookAt != std::chrono::steady_clock::time_point())
     {
-        outRGBA.clear();
-        return false;
+        const double us = std::chrono::duration<double, std::micro>(now - d.hookAt).count();
+        if (d.hookIntervalUs > 0.0 && us < 3.0 * d.hookIntervalUs)
+            d.hookJitter.add(std::abs(us - d.hookIntervalUs));
+        d.hookIntervalUs = d.hookIntervalUs > 0.0 ? 0.95 * d.hookIntervalUs + 0.05 * us : us;
     }
+    d.hookAt = now;
+}
 
-    const size_t need = (size_t)width * (size_t)height * 4u;
-    outRGBA.resize(need);
-    return grabToRGBA8(camIdx, width, height, outRGBA.data(), outRGBA.size());
+// One row of a Dig frame as 8-bit mono for analysis: high byte of 16-bit samples, luma of RGBA8.
+static void grayRow(int frameBpp, const uint8_t* src, uint8_t* dst, size_t w)
+{
+    if (frameBpp == 4)
+        PixelConvert::rgba8ToGray8(src, dst, w);
+    else if (frameBpp == 2)
+        PixelConvert::gray16ToGray8(reinterpret_cast<const uint16_t*>(src), dst, w);
+    else
+        std::memcpy(dst, src, w);
 }
 
-bool MilManager::grabToRGBA8(int camIdx, int width, int height, uint8_t* outRGBA, size_t outBytes)
+void MilManager::scheduleBlobs(Dig& d, uint64_t arrivedNs)
 {
-    if (!outRGBA) return false;
-    if (width <= 0 || height <= 0) return false;
+    MilManager& mgr = instance();
+    if (!mgr._blobEnabled.load(std::memory_order_acquire) || d.blobBusy.exchange(true, std::memory_order_acq_rel))
+        return;
 
-    const size_t need = (size_t)width * (size_t)height * 4u;
-    if (outBytes < need) return false;
+    BlobDetector::Params params;
+    {
+        std::lock_guard<std::mutex> lk(mgr._blobMtx);
+        params = mgr._blobParams;
+    }
+    Tracker::Params tracking;
+    if (mgr._trackEnabled.load(std::memory_order_acquire))
+    {
+        std::lock_guard<std::mutex> lk(mgr._trackMtx);
+        tracking = mgr._trackParams;
+        params.maxBlobs = std::max(params.maxBlobs, tracking.maxTracks);
+    }
+    if (mgr._triEnabled.load(std::memory_order_acquire))
+    {
+        // Room for clutter and for markers only some cameras see next to the points.
+        std::lock_guard<std::mutex> lk(mgr._triMtx);
+        params.maxBlobs = std::max(params.maxBlobs, 2 * mgr._triParams.maxPoints);
+    }
 
-#if !defined(HAVE_MIL)
-    std::memset(outRGBA, 0, need);
-    return false;
-#else
-    std::lock_guard<std::recursive_mutex> lk(_mtx);
+    // Mono copy of 'back' (still owned by the hook): the job must not race the next swap.
+    const int w = (int)d.w, h = (int)d.h;
+    const size_t srcStride = (size_t)w * (size_t)d.frameBpp;
+    if (!d.blobFrame.resize((size_t)w * (size_t)h))
+    {
+        d.blobBusy.store(false, std::memory_order_release);
+        return;
+    }
+    // Markers on 16-bit cameras are refined on a full-depth copy; otherwise the 8-bit
+    // frame (luma for color) is all there is.
+    const bool deep = params.markers && d.frameBpp == 2;
+    if (deep && !d.markerFrame.resize(srcStride * (size_t)h))
+    {
+        d.blobBusy.store(false, std::memory_order_release);
+        return;
+    }
+    for (int y = 0; y < h; ++y)
+    {
+        const uint8_t* src = d.back.data() + (size_t)y * srcStride;
+        grayRow(d.frameBpp, src, d.blobFrame.data() + (size_t)y * w, (size_t)w);
+        if (deep)
+            std::memcpy(d.markerFrame.data() + (size_t)y * srcStride, src, srcStride);
+    }
 
+    const uint64_t seq = d.frameSeq.load(std::memory_order_relaxed) + 1;   // the sequence this frame is published with
+    Dig* dp = &d;
+    WorkerPool::instance().submit([dp, params, tracking, deep, w, h, seq, arrivedNs]
+        {
+            Dig& d = *dp;
+            const auto t0 = std::chrono::steady_clock::now();
+            d.blobLabeler.detect(d.blobFrame.data(), (size_t)w, w, h, params, d.blobScratch);
+            d.markerScratch.clear();
+            if (params.markers)
+            {
+                const uint8_t* img = deep ? d.markerFrame.data() : d.blobFrame.data();
+                const size_t pitch = deep ? (size_t)w * 2 : (size_t)w;
+                const int bps = deep ? 2 : 1;
+                const int n = (int)d.blobScratch.size();
+                d.markerScratch.resize((size_t)n);
+                auto refineRange = [&](int begin, int end)
+                {
+                    for (int i = begin; i < end; ++i)
+                        d.markerScratch[i] = BlobDetector::refineMarker(img, pitch, bps, w, h, d.blobScratch[i], params.circleFit);
+                };
+
+                // A marker costs a few microseconds; only crowded frames are worth a batch.
+                const int kPerChunk = 16;
+                const int chunks = std::min((n + kPerChunk - 1) / kPerChunk, WorkerPool::instance().threadCount() + 1);
+                if (chunks > 1)
+                    WorkerPool::instance().parallelFor(chunks, [&](int c)
+                        {
+                            refineRange((int)((int64_t)n * c / chunks), (int)((int64_t)n * (c + 1) / chunks));
+                        });
+                else
+                    refineRange(0, n);
+            }
+            const auto t1 = std::chrono::steady_clock::now();
+            const double us = std::chrono::duration<double, std::micro>(t1 - t0).count();
 
-    if (!allocDig(camIdx))
-        return false;
+            // Tracks advance on frame arrival times, so frames skipped by detection
+            // only widen the prediction.
+            d.trackScratch.clear();
+            if (tracking.enabled)
+            {
+                const size_t n = d.blobScratch.size();
+                d.trackDets.resize(n);
+                for (size_t i = 0; i < n; ++i)
+                {
+                    const bool refined = i < d.markerScratch.size();
+                    d.trackDets[i].x = refined ? d.markerScratch[i].x : d.blobScratch[i].cx;
+                    d.trackDets[i].y = refined ? d.markerScratch[i].y : d.blobScratch[i].cy;
+                }
+                d.tracker.update(d.trackDets.data(), (int)n, arrivedNs, tracking, d.trackScratch);
+            }
+            else if (d.tracker.trackCount() != 0)
+                d.tracker.reset();
+            const double trackUs = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - t1).count();
+            if (instance()._triEnabled.load(std::memory_order_acquire))
+                instance().postTriangulation(d.slot, d.blobScratch, d.markerScratch, arrivedNs);
+            {
+                std::lock_guard<std::mutex> bl(d.blobMtx);
+                d.blobs.blobs.swap(d.blobScratch);
+                d.blobs.markers.swap(d.markerScratch);
+                d.blobs.frameSeq = seq;
+                d.blobs.timestampNs = arrivedNs;
+                d.blobs.width = w;
+                d.blobs.height = h;
+                d.blobs.detectUs = us;
+                d.tracks.tracks.swap(d.trackScratch);
+                d.tracks.frameSeq = tracking.enabled ? seq : 0;
+                d.tracks.timestampNs = arrivedNs;
+                d.tracks.trackUs = trackUs;
+            }
+            d.blobBusy.store(false, std::memory_order_release);
+        });
+}
 
-    auto& d = _digs[camIdx];
+void MilManager::scheduleBackground(Dig& d)
+{
+    MilManager& mgr = instance();
+    if (!mgr._bgEnabled.load(std::memory_order_acquire))
+        return;
 
-    // Allocate/reallocate 8-bit mono grab buffer
-    if (d.grabBuf == M_NULL || d.w != width || d.h != height)
+    BackgroundModel::Params params;
     {
-        if (d.grabBuf != M_NULL) { MbufFree(d.grabBuf); d.grabBuf = M_NULL; }
-
-        MIL_ID buf = M_NULL;
-        MbufAlloc2d(_sysId, width, height, 8 + M_UNSIGNED, M_IMAGE + M_GRAB, &buf);
-        if (buf == M_NULL)
-        {
-            setErr(*this, _lastError, "MbufAlloc2d failed.");
-            return false;
-        }
-        d.grabBuf = buf;
-        d.w = width;
-        d.h = height;
+        std::lock_guard<std::mutex> lk(mgr._bgMtx);
+        params = mgr._bgParams;
     }
+    // Decimation counts frames, not jobs: a busy camera takes the next frame instead.
+    if (d.bgSkipped + 1 < params.decimation || d.bgBusy.exchange(true, std::memory_order_acq_rel))
+    {
+        ++d.bgSkipped;
+        return;
+    }
+    d.bgSkipped = 0;
 
-    // Correct MIL signature: MdigGrab(DigId, BufId)
-    MdigGrab(d.dig, d.grabBuf);
-    MdigGrabWait(d.dig, M_GRAB_END);
-
-    std::vector<uint8_t> gray((size_t)width * (size_t)height);
-    MbufGet2d(d.grabBuf, 0, 0, width, height, gray.data());
-
-    grayToRGBA(gray.data(), width, height, outRGBA);
-    setErr(*this, _lastError, "");
-    return true;
-#endif
-}
+    const int w = (int)d.w, h = (int)d.h;
+    const size_t srcStride = (size_t)w * (size_t)d.frameBpp;
+    if (!d.bgFrame.resize((size_t)w * (size_t)h) || !d.bgMaskBack.resize((size_t)w * (size_t)h))
+    {
+        d.bgBusy.store(false, std::memory_order_release);
+        return;
+    }
+    for (int y = 0; y < h; ++y)
+        grayRow(d.frameBpp, d.back.data() + (size_t)y * srcStride, d.bgFrame.data() + (size_t)y * w, (size_t)w);
 
-static std::string milStringToStd(const std::wstring& s)
-{
-    std::string out;
-    out.reserve(s.size());
-    for (wchar_t ch : s)
-        out.push_back((ch <= 0x7F) ? static_cast<char>(ch) : '?'); // ASCII-safe
-    return out;
+    const uint64_t seq = d.frameSeq.load(std::memory_order_relaxed) + 1;
+    Dig* dp = &d;
+    WorkerPool::instance().submit([dp, params, w, h, seq]
+        {
+            Dig& d = *dp;
+            // Switched off while queued: the model is only freed by releaseBackground().
+            if (!instance()._bgEnabled.load(std::memory_order_acquire))
+            {
+                d.bgBusy.store(false, std::memory_order_release);
+                return;
+            }
+            d.bgModel.update(d.bgFrame.data(), (size_t)w, w, h, params, d.bgMaskBack.data(), (size_t)w);
+            {
+                std::lock_guard<std::mutex> bl(d.bgMtx);
+                d.bgMask.swap(d.bgMaskBack);
+                d.bgMaskSeq = seq;
+                d.bgMaskW = w;
+                d.bgMaskH = h;
+            }
+            d.bgBusy.store(false, std::memory_order_release);
+        });
 }
 
-// Overload for narrow strings
-static std::string milStringToStd(const std::string& s)
+void MilManager::releaseBackground(Dig& d)
 {
-    return s;
+    // Claim the hand-off as a hook would, so no job can be queued or running while the
+    // model is freed; a hook that still saw the model on just skips its frame.
+    bool idle = false;
+    while (!d.bgBusy.compare_exchange_weak(idle, true, std::memory_order_acq_rel))
+    {
+        idle = false;
+        std::this_thread::sleep_for(std::chrono::microseconds(100));
+    }
+    d.bgModel.reset();
+    {
+        std::lock_guard<std::mutex> bl(d.bgMtx);
+        d.bgMask.reset();
+        d.bgMaskSeq = 0;
+    }
+    d.bgBusy.store(false, std::memory_order_release);
 }
 
-std::string MilManager::diagnostics_NoLock() const
+void MilManager::scheduleBoard(Dig& d, uint64_t arrivedNs)
 {
-#if !defined(HAVE_MIL)
-    return "MIL diagnostics: HAVE_MIL not defined.\n";
-#else
-    std::ostringstream oss;
-
-    oss << "---- MIL Diagnostics ----\n";
-    oss << "app=" << (_appId != M_NULL ? "ok" : "null") << "\n";
-    oss << "sys=" << (_sysId != M_NULL ? "ok" : "null") << "\n";
-    //oss << "cachedSysDesc=" << (_cachedSysDesc.empty() ? MIL_TEXT("(empty)") : _cachedSysDesc) << "\n";
-    oss << "cachedSysDevNum=" << _cachedSysDevNum << "\n";
+    MilManager& mgr = instance();
+    if (!mgr._calibEnabled.load(std::memory_order_acquire))
+        return;
 
-    MIL_INT sysCount = 0;
-    MappInquire(M_DEFAULT, M_INSTALLED_SYSTEM_COUNT, &sysCount);
-    oss << "installedSystems=" << sysCount << "\n";
-    for (MIL_INT i = 0; i < sysCount; ++i)
+    CalibrationSolver::Params params;
+    uint64_t baseNs = 0;
+    int tick = 0;
     {
-        MIL_STRING desc;
-        MappInquire(M_DEFAULT, M_INSTALLED_SYSTEM_DESCRIPTOR + i, desc);
-        oss << "  [" << i << "] " << milStringToStd(desc) << "\n";
+        std::lock_guard<std::mutex> lk(mgr._calibMtx);
+        params = mgr._calibParams;
+        baseNs = mgr._calibBaseNs;
+        if (arrivedNs < baseNs)
+            return;
+        // The first frame of each period; periods count from 1 so 0 means none taken yet.
+        const uint64_t periodNs = (uint64_t)(1e9 / params.rateHz);
+        tick = (int)((arrivedNs - baseNs) / periodNs) + 1;
+        if (tick == d.boardTick)
+            return;
+        if ((int)mgr._calibSnapshots.size() >= params.maxSnapshots && mgr._calibSnapshots.count(tick) == 0)
+            return;
     }
+    // A busy camera tries again with its next frame, which is usually still in the period.
+    if (d.boardBusy.exchange(true, std::memory_order_acq_rel))
+        return;
+    d.boardTick = tick;
 
-    // If system allocated, probe digitizer allocation results too
-    if (_sysId != M_NULL)
+    const int w = (int)d.w, h = (int)d.h;
+    const size_t srcStride = (size_t)w * (size_t)d.frameBpp;
+    if (!d.boardFrame.resize((size_t)w * (size_t)h))
     {
-        oss << "validDigDevs=" << _validDigDevs.size() << "\n";
-        for (int k = 0; k < (int)_validDigDevs.size(); ++k)
-        {
-            oss << "  camIdx " << k << " -> M_DEV" << (int)(_validDigDevs[k] - M_DEV0) << "\n";
-        }
-
-        if (!_lastProbeReport.empty())
-        {
-            oss << "\n_lastProbeReport:\n" << _lastProbeReport << "\n";
-        }
+        d.boardBusy.store(false, std::memory_order_release);
+        return;
+    }
+    for (int y = 0; y < h; ++y)
+        grayRow(d.frameBpp, d.back.data() + (size_t)y * srcStride, d.boardFrame.data() + (size_t)y * w, (size_t)w);
 
-        // Always probe a fixed range and record alloc success/fail
-        oss << "\nProbe MdigAlloc M_DEV0..M_DEV15:\n";
-        for (int i = 0; i < 16; ++i)
+    Dig* dp = &d;
+    WorkerPool::instance().submit([dp, params, baseNs, tick, w, h]
         {
-            MIL_ID d = M_NULL;
-            MIL_INT dev = M_DEV0 + i;
-            MdigAlloc(_sysId, dev, MIL_TEXT("M_DEFAULT"), M_DEFAULT, &d);
-
-            if (d == M_NULL)
-                oss << "  M_DEV" << i << ": FAIL\n";
-            else
+            Dig& d = *dp;
+            MilManager& mgr = instance();
+            BoardDetector::Params bp;
+            bp.cols = params.cols;
+            bp.rows = params.rows;
+            CalibrationSolver::View view;
+            if (mgr._calibEnabled.load(std::memory_order_acquire)
+                && d.boardDetector.detect(d.boardFrame.data(), (size_t)w, w, h, bp, view.corners))
             {
-                oss << "  M_DEV" << i << ": OK\n";
-                MdigFree(d);
+                view.camera = d.slot;
+                view.snapshot = tick;
+                view.width = w;
+                view.height = h;
+                std::lock_guard<std::mutex> lk(mgr._calibMtx);
+                // Dropped if the views were cleared or the board changed while searching.
+                const CalibrationSolver::Params& now = mgr._calibParams;
+                const bool full = (int)mgr._calibSnapshots.size() >= now.maxSnapshots && mgr._calibSnapshots.count(tick) == 0;
+                if (mgr._calibBaseNs == baseNs && now.cols == params.cols && now.rows == params.rows && !full)
+                {
+                    mgr._calibViews.push_back(std::move(view));
+                    mgr._calibSnapshots.insert(tick);
+                }
             }
-        }
-    }
-
-    oss << "-------------------------\n";
-    return oss.str();
-#endif
+            d.boardBusy.store(false, std::memory_order_release);
+        });
 }
 
-bool MilManager::grabGridToRGBA8(int gridCols, int gridRows, int tileW, int tileH, uint8_t* outRGBA, size_t outBytes)
+void MilManager::scheduleUndistortMap(Dig& d)
 {
-    if (!outRGBA) return false;
-    if (gridCols <= 0 || gridRows <= 0 || tileW <= 0 || tileH <= 0) return false;
-
-    const int outW = gridCols * tileW;
-    const int outH = gridRows * tileH;
-    const size_t need = (size_t)outW * (size_t)outH * 4u;
-    if (outBytes < need) return false;
+    MilManager& mgr = instance();
+    const uint64_t gen = mgr._undistortGen.load(std::memory_order_acquire);
+    if (gen == d.undistortGen || d.undistortBusy.exchange(true, std::memory_order_acq_rel))
+        return;
+    d.undistortGen = gen;
 
-    std::memset(outRGBA, 0, need);
+    Calibration::Camera cam;
+    {
+        std::lock_guard<std::mutex> lk(mgr._undistortMtx);
+        if (const Calibration::Camera* c = mgr._undistortRig.camera(d.slot))
+            cam = *c;
+    }
+    Dig* dp = &d;
+    const int w = (int)d.w, h = (int)d.h;
+    // A 1920x1200 map takes a worker for ~100 ms; frames pass through meanwhile.
+    WorkerPool::instance().submit([dp, cam, w, h]
+        {
+            std::unique_ptr<Undistort::Map> map;
+            if (instance()._undistortEnabled.load(std::memory_order_acquire)
+                && cam.valid && cam.width == w && cam.height == h)
+            {
+                map.reset(new Undistort::Map());
+                if (!Undistort::build(cam, *map))
+                    map.reset();
+            }
+            {
+                std::lock_guard<std::mutex> ul(dp->undistortMtx);
+                dp->undistort.swap(map);
+            }
+            dp->undistortBusy.store(false, std::memory_order_release);
+        });
+}
 
-    std::vector<uint8_t> tile;
-    tile.resize((size_t)tileW * (size_t)tileH * 4u);
+void MilManager::scheduleFlatField(Dig& d)
+{
+    MilManager& mgr = instance();
+    if (d.frameBpp > 2 || d.flatCaptureLeft > 0 || d.flatBusy.load(std::memory_order_acquire))
+        return;
 
-    for (int r = 0; r < gridRows; ++r)
+    // A capture starts with the next frame; frames are averaged as they are converted.
+    const uint64_t captureGen = mgr._flatCaptureGen.load(std::memory_order_acquire);
+    if (captureGen != d.flatCaptureGen)
     {
-        for (int c = 0; c < gridCols; ++c)
+        d.flatCaptureGen = captureGen;
         {
-            int camIdx = r * gridCols + c;
+            std::lock_guard<std::mutex> lk(mgr._flatMtx);
+            d.flatCaptureKind = mgr._flatCaptureKind;
+            d.flatCaptureLeft = mgr._flatCaptureFrames;
+        }
+        d.flatSum.reset((int)d.w, (int)d.h, d.frameBpp);
+        mgr._flatCapturing.fetch_add(1, std::memory_order_acq_rel);
+        return;
+    }
 
-            if (!grabToRGBA8(camIdx, tileW, tileH, tile.data(), tile.size()))
-                continue;
+    const uint64_t gen = mgr._flatGen.load(std::memory_order_acquire);
+    if (gen == d.flatGen || d.flatBusy.exchange(true, std::memory_order_acq_rel))
+        return;
+    d.flatGen = gen;
 
-            for (int y = 0; y < tileH; ++y)
+    std::string folder;
+    {
+        std::lock_guard<std::mutex> lk(mgr._flatMtx);
+        folder = mgr._flatFolder;
+    }
+    Dig* dp = &d;
+    const int w = (int)d.w, h = (int)d.h, bpp = d.frameBpp;
+    WorkerPool::instance().submit([dp, folder, w, h, bpp]
+        {
+            Dig& d = *dp;
+            MilManager& mgr = instance();
+            std::string err;
+            auto loadRef = [&](FlatField::Reference kind, FlatField::Frame& f)
             {
-                const size_t srcOff = (size_t)y * (size_t)tileW * 4u;
-                const size_t dstOff = ((size_t)(r * tileH + y) * (size_t)outW + (size_t)(c * tileW)) * 4u;
-                std::memcpy(outRGBA + dstOff, tile.data() + srcOff, (size_t)tileW * 4u);
+                // A missing file is no reference; one of another size is an error.
+                f = FlatField::Frame();
+                const std::string path = FlatField::referencePath(folder, d.slot, kind);
+                if (folder.empty() || !std::ifstream(path).good())
+                    return;
+                if (!FlatField::load(path, f, err))
+                    f = FlatField::Frame();
+                else if (f.width != w || f.height != h || f.bytesPerPixel != bpp)
+                {
+                    err = "'" + path + "' doesn't match the camera's size or depth";
+                    f = FlatField::Frame();
+                }
+            };
+            loadRef(FlatField::Reference::Dark, d.flatDark);
+            loadRef(FlatField::Reference::Flat, d.flatFlat);
+
+            std::unique_ptr<FlatField::Table> table(new FlatField::Table());
+            if (!mgr._flatEnabled.load(std::memory_order_acquire)
+                || !FlatField::build(d.flatDark.width ? &d.flatDark : nullptr, d.flatFlat.width ? &d.flatFlat : nullptr, *table))
+                table.reset();
+            if (!err.empty())
+            {
+                std::lock_guard<std::mutex> lk(mgr._flatMtx);
+                mgr._flatError = err;
             }
-        }
-    }
-    return true;
+            {
+                std::lock_guard<std::mutex> fl(d.flatMtx);
+                d.flat.swap(table);
+                d.flatActive.store(d.flat != nullptr, std::memory_order_release);
+            }
+            d.flatBusy.store(false, std::memory_order_release);
+        });
+}
+
+void MilManager::captureFlatFrame(Dig& d, size_t rowBytes)
+{
+    MilManager& mgr = instance();
+    if (!d.flatSum.matches((int)d.w, (int)d.h, d.frameBpp))
+    {
+        // The format changed under a reconnect.
+        d.flatCaptureLeft = 0;
+        mgr._flatCapturing.fetch_sub(1, std::memory_order_acq_rel);
+        std::lock_guard<std::mutex> lk(mgr._flatMtx);
+        mgr._flatError = "camera " + std::to_string(d.slot) + " changed format during a reference capture";
+        return;
+    }
+    d.flatSum.add(d.back.data(), rowBytes);
+    if (--d.flatCaptureLeft > 0)
+        return;
+
+    // No load job runs while capturing, so flatBusy is free.
+    d.flatBusy.store(true, std::memory_order_release);
+    std::string folder;
+    {
+        std::lock_guard<std::mutex> lk(mgr._flatMtx);
+        folder = mgr._flatFolder;
+    }
+    Dig* dp = &d;
+    WorkerPool::instance().submit([dp, folder]
+        {
+            Dig& d = *dp;
+            MilManager& mgr = instance();
+            FlatField::Frame& ref = d.flatCaptureKind == FlatField::Reference::Dark ? d.flatDark : d.flatFlat;
+            d.flatSum.mean(ref);
+            std::string err;
+            FlatField::save(FlatField::referencePath(folder, d.slot, d.flatCaptureKind), ref, err);
+
+            // The other reference only counts if it still matches.
+            FlatField::Frame& other = &ref == &d.flatDark ? d.flatFlat : d.flatDark;
+            if (other.width != ref.width || other.height != ref.height || other.bytesPerPixel != ref.bytesPerPixel)
+                other = FlatField::Frame();
+            std::unique_ptr<FlatField::Table> table(new FlatField::Table());
+            if (!mgr._flatEnabled.load(std::memory_order_acquire)
+                || !FlatField::build(d.flatDark.width ? &d.flatDark : nullptr, d.flatFlat.width ? &d.flatFlat : nullptr, *table))
+                table.reset();
+            {
+                std::lock_guard<std::mutex> lk(mgr._flatMtx);
+                if (!err.empty())
+                    mgr._flatError = err;
+            }
+            {
+                std::lock_guard<std::mutex> fl(d.flatMtx);
+                d.flat.swap(table);
+                d.flatActive.store(d.flat != nullptr, std::memory_order_release);
+            }
+            mgr._flatCapturing.fetch_sub(1, std::memory_order_acq_rel);
+            d.flatBusy.store(false, std::memory_order_release);
+        });
+}
+
+MIL_INT MFTYPE MilManager::processingHook(MIL_INT hookType, MIL_ID eventId, void* userData)
+{
+    (void)hookType;
+    Dig& d = *static_cast<Dig*>(userData);
+    const uint64_t arrivedNs = SharedFrames::nowNs();
+
+    tuneHookThread(d);
+
+    MIL_ID buf = M_NULL;
+    MdigGetHookInfo(eventId, M_MODIFIED_BUFFER + M_BUFFER_ID, &buf);
+    if (buf == M_NULL)
+        return 0;
+
+    // Read the grab buffer in place when it is host-mapped; otherwise copy it out once.
+    void* host = nullptr;
+    MbufInquire(buf, M_HOST_ADDRESS, &host);
+    MIL_INT pitch = MbufInquire(buf, M_PITCH_BYTE, M_NULL);
+    if (host == nullptr)
+    {
+        const MIL_INT bufW = MbufInquire(buf, M_SIZE_X, M_NULL);
+        const MIL_INT bufBytes = MbufInquire(buf, M_SIZE_BIT, M_NULL) > 8 ? 2 : 1;
+        if (!d.raw.resize((size_t)bufW * (size_t)bufBytes * (size_t)d.h))
+            return 0;
+        MbufGet2d(buf, 0, 0, bufW, d.h, d.raw.data());
+        host = d.raw.data();
+        pitch = bufW * bufBytes;
+    }
+
+    // Convert without holding any lock, then publish by swapping.
+    const size_t rowBytes = (size_t)d.w * (size_t)d.frameBpp;
+    if (!d.back.resize(rowBytes * (size_t)d.h))
+        return 0;
+    const uint8_t* src = static_cast<const uint8_t*>(host);
+
+    // Flat-field tables and undistortion maps are held for the conversion, so their jobs
+    // can't swap them under it. Frames averaged into a flat-field reference get neither.
+    const FlatField::Table* flat = nullptr;
+    std::unique_lock<std::mutex> fl(d.flatMtx, std::defer_lock);
+    if (instance()._flatEnabled.load(std::memory_order_acquire))
+    {
+        scheduleFlatField(d);
+        if (d.flatCaptureLeft == 0)
+        {
+            fl.lock();
+            if (d.flat && d.flat->width == (int)d.w && d.flat->height == (int)d.h && d.flat->bytesPerPixel == d.frameBpp)
+                flat = d.flat.get();
+            else
+                fl.unlock();
+        }
+    }
+    const Undistort::Map* map = nullptr;
+    std::unique_lock<std::mutex> ul(d.undistortMtx, std::defer_lock);
+    if (d.flatCaptureLeft == 0 && instance()._undistortEnabled.load(std::memory_order_acquire))
+    {
+        scheduleUndistortMap(d);
+        ul.lock();
+        if (d.undistort && d.undistort->width == (int)d.w && d.undistort->height == (int)d.h)
+            map = d.undistort.get();
+        else
+            ul.unlock();
+    }
+
+    // The previous output is still in 'latest': only this hook replaces it, and cooks only read it.
+    const bool denoise = d.frameBpp != 2 && d.flatCaptureLeft == 0
+        && instance()._denoiseEnabled.load(std::memory_order_acquire);
+    const uint8_t* prev = nullptr;
+    Denoise::Weights weights;
+    if (denoise)
+    {
+        {
+            std::lock_guard<std::mutex> lk(instance()._denoiseMtx);
+            weights = Denoise::weights(instance()._denoiseParams);
+        }
+        if (d.denoisePrimed && d.latest.size() == rowBytes * (size_t)d.h)
+            prev = d.latest.data();
+    }
+
+    const bool unpacked = d.bayer == Demosaic::BayerPattern::None && d.packing == Packing::None;
+    if (map && !flat && unpacked)
+    {
+        // Unpacked mono is sampled straight from the grab buffer, in row bands on the pool.
+        Undistort::remap(src, (size_t)pitch, d.frameBpp, (int)d.bits, *map, d.back.data(), rowBytes);
+    }
+    else if (prev && !map && !flat && unpacked && d.frameBpp == 1)
+    {
+        // Plain mono8: new frame and previous output in, filtered frame out, in one pass.
+        for (MIL_INT y = 0; y < d.h; ++y)
+            Denoise::filterRow(weights, src + y * pitch, prev + (size_t)y * rowBytes, d.back.data() + (size_t)y * rowBytes, (size_t)d.w);
+        prev = nullptr;
+    }
+    else
+    {
+        // Bayer, packed and corrected samples are converted first, then remapped from undistortFrame.
+        uint8_t* dst = d.back.data();
+        if (map)
+        {
+            if (!d.undistortFrame.resize(rowBytes * (size_t)d.h))
+                return 0;
+            dst = d.undistortFrame.data();
+        }
+        if (d.bayer != Demosaic::BayerPattern::None)
+        {
+            // Row bands on the shared pool; this MIL thread works on a band as well.
+            Demosaic::bilinear(src, (size_t)pitch, (int)d.w, (int)d.h, d.bayer, dst, rowBytes);
+        }
+        else if (flat && unpacked)
+        {
+            for (MIL_INT y = 0; y < d.h; ++y)
+                FlatField::correctRow(*flat, (int)y, src + y * pitch, (int)d.bits, dst + (size_t)y * rowBytes);
+        }
+        else
+        {
+            // Packed rows are corrected in place while they are still in cache.
+            for (MIL_INT y = 0; y < d.h; ++y)
+            {
+                uint8_t* row = dst + (size_t)y * rowBytes;
+                unpackRow(d.packing, (int)d.bits, src + y * pitch, row, (size_t)d.w);
+                if (flat)
+                    FlatField::correctRow(*flat, (int)y, row, 16, row);
+            }
+        }
+        if (map)
+            Undistort::remap(dst, rowBytes, d.frameBpp, d.frameBpp == 2 ? 16 : 8, *map, d.back.data(), rowBytes);
+    }
+    if (ul.owns_lock())
+        ul.unlock();
+    if (fl.owns_lock())
+        fl.unlock();
+    if (prev)
+    {
+        // Other formats are filtered in place once converted (and undistorted).
+        for (MIL_INT y = 0; y < d.h; ++y)
+        {
+            uint8_t* row = d.back.data() + (size_t)y * rowBytes;
+            Denoise::filterRow(weights, row, prev + (size_t)y * rowBytes, row, rowBytes);
+        }
+    }
+    d.denoisePrimed = denoise;
+    if (d.flatCaptureLeft > 0)
+        captureFlatFrame(d, rowBytes);
+
+    scheduleBlobs(d, arrivedNs);
+    scheduleBackground(d);
+    scheduleBoard(d, arrivedNs);
+
+    {
+        std::lock_guard<std::mutex> sl(d.shmMtx);
+        if (d.shm)
+        {
+            const SharedFrames::PixelFormat fmt = d.frameBpp == 4 ? SharedFrames::PixelFormat::RGBA8
+                : d.frameBpp == 2 ? SharedFrames::PixelFormat::Mono16 : SharedFrames::PixelFormat::Mono8;
+            d.shm->publish(d.back.data(), (uint32_t)d.w, (uint32_t)d.h, (uint32_t)rowBytes, fmt, arrivedNs);
+        }
+    }
+
+    {
+        std::lock_guard<std::mutex> fl(d.frameMtx);
+        d.latest.swap(d.back);
+        d.frameSeq.fetch_add(1, std::memory_order_release);
+    }
+    d.frameCv.notify_all();
+    return 0;
+}
+
+Demosaic::BayerPattern MilManager::effectiveBayer(const Dig& d)
+{
+    // Demosaicing is 8-bit only; deeper or packed cameras stay mono.
+    if (d.bits > 8 || d.packing != Packing::None)
+        return Demosaic::BayerPattern::None;
+
+    switch (d.bayerMode)
+    {
+    case BayerMode::Auto: return d.detectedBayer;
+    case BayerMode::RGGB: return Demosaic::BayerPattern::RGGB;
+    case BayerMode::BGGR: return Demosaic::BayerPattern::BGGR;
+    case BayerMode::GRBG: return Demosaic::BayerPattern::GRBG;
+    case BayerMode::GBRG: return Demosaic::BayerPattern::GBRG;
+    default:              return Demosaic::BayerPattern::None;
+    }
+}
+
+void MilManager::updateFrameLayout(Dig& d)
+{
+    d.bayer = effectiveBayer(d);
+    if (d.bayer != Demosaic::BayerPattern::None)
+        d.frameBpp = 4;
+    else
+        d.frameBpp = d.bits > 8 ? 2 : 1;
+}
+
+// Sets an integer GenICam feature, clamped to the camera's range and snapped down to
+// its increment. Returns false if the camera does not have the feature.
+static bool setIntFeature(MIL_ID dig, const MIL_TEXT_CHAR* name, MIL_INT64 value)
+{
+    MIL_INT64 lo = 0, hi = 0, inc = 1;
+    MappGetError(M_DEFAULT, M_GLOBAL, M_NULL);   // clear any stale error
+    MdigInquireFeature(dig, M_FEATURE_MIN, name, M_TYPE_INT64, &lo);
+    MdigInquireFeature(dig, M_FEATURE_MAX, name, M_TYPE_INT64, &hi);
+    MdigInquireFeature(dig, M_FEATURE_INCREMENT, name, M_TYPE_INT64, &inc);
+    if (MappGetError(M_DEFAULT, M_GLOBAL, M_NULL) != M_NULL_ERROR)
+        return false;
+
+    if (inc <= 0) inc = 1;
+    value = std::max(lo, std::min(hi, value));
+    value = lo + (value - lo) / inc * inc;
+
+    MdigControlFeature(dig, M_FEATURE_VALUE, name, M_TYPE_INT64, &value);
+    return MappGetError(M_DEFAULT, M_GLOBAL, M_NULL) == M_NULL_ERROR;
+}
+
+// Pushes a geometry to the camera. 'prev' is what is already applied, so binning and
+// decimation are only touched when they change or are non-default. Acquisition must be stopped.
+// On a demosaiced camera offsets are snapped down to even values: an odd offset moves the
+// first pixel to another site of the color filter and the pattern would no longer match.
+static void applyGeometryFeatures(MIL_ID dig, const MilManager::CameraGeometry& g,
+    const MilManager::CameraGeometry& prev, bool bayer, std::ostringstream& skipped)
+{
+    auto apply = [&](const MIL_TEXT_CHAR* name, const char* label, MIL_INT64 v)
+        {
+            if (!setIntFeature(dig, name, v))
+                skipped << " " << label;
+        };
+
+    // Order matters: binning/decimation change the valid size range, and offsets must be
+    // cleared before growing the size, then set last.
+    if (g.binning != prev.binning || g.binning != 1)
+    {
+        apply(MIL_TEXT("BinningHorizontal"), "BinningHorizontal", std::max(1, g.binning));
+        apply(MIL_TEXT("BinningVertical"), "BinningVertical", std::max(1, g.binning));
+    }
+    if (g.decimation != prev.decimation || g.decimation != 1)
+    {
+        apply(MIL_TEXT("DecimationHorizontal"), "DecimationHorizontal", std::max(1, g.decimation));
+        apply(MIL_TEXT("DecimationVertical"), "DecimationVertical", std::max(1, g.decimation));
+    }
+    apply(MIL_TEXT("OffsetX"), "OffsetX", 0);
+    apply(MIL_TEXT("OffsetY"), "OffsetY", 0);
+
+    // 0 = full: the clamp in setIntFeature turns an oversized request into the maximum.
+    const MIL_INT64 kLarge = 1 << 20;
+    apply(MIL_TEXT("Width"), "Width", g.width > 0 ? g.width : kLarge);
+    apply(MIL_TEXT("Height"), "Height", g.height > 0 ? g.height : kLarge);
+    const int evenMask = bayer ? ~1 : ~0;
+    apply(MIL_TEXT("OffsetX"), "OffsetX", g.offsetX & evenMask);
+    apply(MIL_TEXT("OffsetY"), "OffsetY", g.offsetY & evenMask);
+}
+
+// Frame-rate cap and inter-packet delay; see applyStreamLimits().
+static void applyStreamLimitFeatures(MIL_ID dig, double fps, double interPacketDelayNs, std::ostringstream& skipped)
+{
+    // Both are writable while acquiring on GenICam cameras, so streaming is left alone.
+    MappGetError(M_DEFAULT, M_GLOBAL, M_NULL);
+    MIL_BOOL enable = fps > 0.0 ? M_TRUE : M_FALSE;
+    MdigControlFeature(dig, M_FEATURE_VALUE, MIL_TEXT("AcquisitionFrameRateEnable"), M_TYPE_BOOLEAN, &enable);
+    if (fps > 0.0)
+        MdigControlFeature(dig, M_FEATURE_VALUE, MIL_TEXT("AcquisitionFrameRate"), M_TYPE_DOUBLE, &fps);
+    if (MappGetError(M_DEFAULT, M_GLOBAL, M_NULL) != M_NULL_ERROR)
+        skipped << " AcquisitionFrameRate";
+
+    MIL_INT64 tickHz = 0;
+    MdigInquireFeature(dig, M_FEATURE_VALUE, MIL_TEXT("GevTimestampTickFrequency"), M_TYPE_INT64, &tickHz);
+    if (tickHz <= 0)
+        tickHz = 1000000000;    // most cameras count nanoseconds
+    MappGetError(M_DEFAULT, M_GLOBAL, M_NULL);
+    MIL_INT64 ticks = (MIL_INT64)(interPacketDelayNs * (double)tickHz / 1e9 + 0.5);
+    MdigControlFeature(dig, M_FEATURE_VALUE, MIL_TEXT("GevSCPD"), M_TYPE_INT64, &ticks);
+    if (MappGetError(M_DEFAULT, M_GLOBAL, M_NULL) != M_NULL_ERROR)
+        skipped << " GevSCPD";
+}
+#endif
+
+bool MilManager::setBayerMode(int camIdx, BayerMode mode)
+{
+#if !defined(HAVE_MIL)
+    (void)camIdx; (void)mode;
+    return false;
+#else
+    std::lock_guard<std::recursive_mutex> lk(_mtx);
+    if (Dig* lost = lostDig_NoLock(camIdx))
+    {
+        lost->bayerMode = mode;     // used when the watchdog reopens it
+        return false;
+    }
+    if (camIdx < 0 || !allocDig(camIdx))
+        return false;
+
+    Dig& d = *_digs[camIdx];
+    if (d.bayerMode == mode)
+        return true;
+
+    // The hook only reads the pattern, so a new mode that resolves to the same one
+    // (Auto vs. the detected pattern) leaves acquisition running.
+    d.bayerMode = mode;
+    if (effectiveBayer(d) == d.bayer)
+        return true;
+
+    const bool wasStreaming = d.streaming;
+    stopStreaming(d);
+    {
+        // Readers check the layout under frameMtx; drop the frame in the old layout.
+        std::lock_guard<std::mutex> fl(d.frameMtx);
+        updateFrameLayout(d);
+        d.latest.reset();
+    }
+    _formatGen.fetch_add(1, std::memory_order_release);
+
+    // Odd ROI offsets are only kept on mono cameras; re-push them for the new layout.
+    if ((d.geometry.offsetX | d.geometry.offsetY) & 1)
+    {
+        std::ostringstream skipped;
+        applyGeometryFeatures(d.dig, d.geometry, d.geometry, d.bayer != Demosaic::BayerPattern::None, skipped);
+    }
+    return !wasStreaming || ensureStreaming(camIdx);
+#endif
+}
+
+bool MilManager::setCameraGeometry(int camIdx, const CameraGeometry& g)
+{
+#if !defined(HAVE_MIL)
+    (void)camIdx; (void)g;
+    return false;
+#else
+    std::lock_guard<std::recursive_mutex> lk(_mtx);
+    if (Dig* lost = lostDig_NoLock(camIdx))
+    {
+        lost->geometry = g;         // applied when the watchdog reopens it
+        return false;
+    }
+    if (camIdx < 0 || !allocDig(camIdx))
+        return false;
+
+    Dig& d = *_digs[camIdx];
+    if (d.geometry == g)
+        return true;
+
+    const bool wasStreaming = d.streaming;
+    stopStreaming(d);
+
+    // Old-size buffers are useless after this; the ring is rebuilt by ensureStreaming().
+    freeRing(d);
+
+    std::ostringstream skipped;
+    applyGeometryFeatures(d.dig, g, d.geometry, d.bayer != Demosaic::BayerPattern::None, skipped);
+    d.geometry = g;
+
+    {
+        // Readers take the size under frameMtx; drop the frame at the old size.
+        std::lock_guard<std::mutex> fl(d.frameMtx);
+        d.w = MdigInquire(d.dig, M_SIZE_X, M_NULL);
+        d.h = MdigInquire(d.dig, M_SIZE_Y, M_NULL);
+        d.latest.reset();
+    }
+    _formatGen.fetch_add(1, std::memory_order_release);
+
+    if (!skipped.str().empty())
+    {
+        std::ostringstream em;
+        em << "camIdx " << camIdx << ": camera lacks or rejected geometry features:" << skipped.str()
+            << ". Now " << d.w << "x" << d.h << ".";
+        setErr(*this, _lastError, em.str());
+    }
+
+    return !wasStreaming || ensureStreaming(camIdx);
+#endif
+}
+
+bool MilManager::setDcfProfiles(const std::vector<DcfProfile>& profiles)
+{
+#if !defined(HAVE_MIL)
+    (void)profiles;
+    return false;
+#else
+    if (!ensureSystem())
+        return false;
+
+    std::lock_guard<std::recursive_mutex> lk(_mtx);
+    const int numCams = (int)_validDigDevs.size();
+    static const char kUserSet[] = "userset:";
+    const size_t kUserSetLen = sizeof(kUserSet) - 1;
+
+    std::vector<ResolvedProfile> resolved;
+    std::ostringstream bad;
+    for (const DcfProfile& p : profiles)
+    {
+        ResolvedProfile r;
+        r.name = p.name;
+        r.userSet = p.source.compare(0, kUserSetLen, kUserSet) == 0;
+
+        std::string err;
+        for (int cam = 0; cam < numCams && err.empty(); ++cam)
+        {
+            if (r.userSet)
+            {
+                const std::string set = p.source.substr(kUserSetLen);
+                if (set.empty())
+                    err = "empty user set name";
+
+                // Cameras that are not open yet are checked when they are allocated.
+                MIL_BOOL present = M_TRUE;
+                if (cam < (int)_digs.size() && _digs[cam]->dig != M_NULL)
+                    MdigInquireFeature(_digs[cam]->dig, M_FEATURE_PRESENT, MIL_TEXT("UserSetLoad"), M_TYPE_BOOLEAN, &present);
+                if (present != M_TRUE)
+                    err = "camera " + std::to_string(cam) + " has no UserSetLoad";
+                r.perCam.push_back(stdToMilString(set));
+                continue;
+            }
+
+            std::string path = p.source;
+            const size_t at = path.find("{cam}");
+            if (at != std::string::npos)
+                path.replace(at, 5, std::to_string(cam));
+
+            const MIL_STRING wpath = stdToMilString(path);
+            if (!path.empty())
+            {
+                const DWORD attr = GetFileAttributesW(wpath.c_str());
+                if (attr == INVALID_FILE_ATTRIBUTES || (attr & FILE_ATTRIBUTE_DIRECTORY))
+                    err = "no DCF file '" + path + "'";
+            }
+            r.perCam.push_back(wpath);
+        }
+
+        if (err.empty())
+            resolved.push_back(std::move(r));
+        else
+            bad << " " << (p.name.empty() ? std::string("<default>") : p.name) << ": " << err << ";";
+    }
+    _profiles.swap(resolved);
+
+    if (!bad.str().empty())
+    {
+        setErr(*this, _lastError, "Invalid DCF profiles:" + bad.str());
+        return false;
+    }
+    return true;
+#endif
+}
+
+bool MilManager::applyDcfProfile(int camIdx, const std::string& name, double& switchMs)
+{
+    switchMs = 0.0;
+#if !defined(HAVE_MIL)
+    (void)camIdx; (void)name;
+    return false;
+#else
+    const auto t0 = std::chrono::steady_clock::now();
+    if (camIdx < 0 || !ensureSystem())
+        return false;
+
+    std::lock_guard<std::recursive_mutex> lk(_mtx);
+
+    const ResolvedProfile* prof = nullptr;
+    for (const ResolvedProfile& p : _profiles)
+        if (p.name == name) { prof = &p; break; }
+    if (!prof && !name.empty())
+    {
+        setErr(*this, _lastError, "Unknown or invalid DCF profile '" + name + "'.");
+        return false;
+    }
+    if (prof && camIdx >= (int)prof->perCam.size())
+    {
+        setErr(*this, _lastError, "DCF profile '" + name + "' was validated before camIdx " + std::to_string(camIdx) + " was discovered.");
+        return false;
+    }
+
+    while ((int)_digs.size() <= camIdx)
+    {
+        _digs.push_back(std::make_unique<Dig>());
+        _digs.back()->slot = (int)_digs.size() - 1;
+    }
+    Dig& d = *_digs[camIdx];
+
+    // A user set rides on whatever DCF is loaded; a DCF profile drops any user set.
+    MIL_STRING dcf = d.dcf, userSet;
+    if (prof && prof->userSet)
+        userSet = prof->perCam[camIdx];
+    else
+        dcf = prof ? prof->perCam[camIdx] : MIL_STRING();
+
+    if (d.dcf == dcf && d.userSet == userSet)
+        return true;
+
+    if (d.dig == M_NULL || d.lost)
+    {
+        // Picked up by the first allocDig() or the watchdog's reconnect; nothing to undo.
+        d.dcf = dcf;
+        d.userSet = userSet;
+        return true;
+    }
+
+    const bool wasStreaming = d.streaming;
+    const CameraGeometry g = d.geometry;
+    bool ok = true;
+
+    if (d.dcf != dcf || userSet.empty())
+    {
+        // A DCF only takes effect at MdigAlloc, and leaving a user set needs a clean mode.
+        freeDig(camIdx);
+        {
+            std::lock_guard<std::mutex> fl(d.frameMtx);
+            d.latest.reset();
+        }
+        d.dcf = dcf;
+        d.userSet = userSet;
+        d.geometry = CameraGeometry();
+        ok = allocDig(camIdx);
+    }
+    else
+    {
+        // Same DCF, new user set: no reallocation, and the ring survives if the format does.
+        stopStreaming(d);
+        ok = loadUserSet(d.dig, userSet);
+        if (ok)
+        {
+            d.userSet = userSet;
+            d.geometry = CameraGeometry();
+
+            const MIL_INT w = d.w, h = d.h, bits = d.bits;
+            const Packing packing = d.packing;
+            {
+                std::lock_guard<std::mutex> fl(d.frameMtx);
+                cacheNativeFormat(d);
+                d.latest.reset();
+            }
+            if (w != d.w || h != d.h || bits != d.bits || packing != d.packing)
+            {
+                freeRing(d);
+            }
+            _formatGen.fetch_add(1, std::memory_order_release);
+        }
+        else
+            setErr(*this, _lastError, "UserSetLoad failed for camIdx " + std::to_string(camIdx) + ".");
+    }
+
+    // The profile defines the base mode; a geometry set from the parameters goes back on top.
+    if (ok && g != CameraGeometry())
+        setCameraGeometry(camIdx, g);
+    if (ok && wasStreaming)
+        ok = ensureStreaming(camIdx);
+
+    switchMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+    return ok;
+#endif
+}
+
+bool MilManager::applyStreamLimits(int camIdx, double fps, double interPacketDelayNs)
+{
+#if !defined(HAVE_MIL)
+    (void)camIdx; (void)fps; (void)interPacketDelayNs;
+    return false;
+#else
+    std::lock_guard<std::recursive_mutex> lk(_mtx);
+    if (Dig* lost = lostDig_NoLock(camIdx))
+    {
+        lost->fpsCap = fps;         // applied when the watchdog reopens it
+        lost->interPacketDelayNs = interPacketDelayNs;
+        return false;
+    }
+    if (camIdx < 0 || !allocDig(camIdx))
+        return false;
+
+    Dig& d = *_digs[camIdx];
+    std::ostringstream skipped;
+    applyStreamLimitFeatures(d.dig, fps, interPacketDelayNs, skipped);
+
+    // Remembered so a reconnected camera gets the same limits back.
+    d.fpsCap = fps;
+    d.interPacketDelayNs = interPacketDelayNs;
+
+    if (!skipped.str().empty())
+    {
+        setErr(*this, _lastError, "camIdx " + std::to_string(camIdx) + ": camera lacks or rejected stream features:" + skipped.str());
+        return false;
+    }
+    return true;
+#endif
+}
+
+#if defined(HAVE_MIL)
+void MilManager::stopStreaming(Dig& d)
+{
+    if (!d.streaming)
+        return;
+
+    // M_STOP waits for the hook to return, so no frame is in flight afterwards.
+    MdigProcess(d.dig, d.ring.data(), (MIL_INT)d.ring.size(), M_STOP, M_DEFAULT, processingHook, &d);
+    d.streaming = false;
+
+    // A detection job may still be reading blobFrame; its results die with the stream.
+    while (d.blobBusy.load(std::memory_order_acquire))
+        std::this_thread::sleep_for(std::chrono::microseconds(100));
+    {
+        std::lock_guard<std::mutex> bl(d.blobMtx);
+        d.blobs = BlobDetector::Result();
+        d.tracks = Tracker::Result();
+    }
+    d.tracker.reset();
+    {
+        // A stopped camera no longer holds triangulation sets back.
+        std::lock_guard<std::mutex> tl(_triMtx);
+        if (d.slot < (int)_triInputs.size())
+            _triInputs[d.slot] = TriInput();
+    }
+
+    // The next stream may have another format; the model starts over.
+    releaseBackground(d);
+
+    while (d.boardBusy.load(std::memory_order_acquire))
+        std::this_thread::sleep_for(std::chrono::microseconds(100));
+    d.boardTick = 0;
+
+    // Maps are per size; the next stream builds its own.
+    while (d.undistortBusy.load(std::memory_order_acquire))
+        std::this_thread::sleep_for(std::chrono::microseconds(100));
+    {
+        std::lock_guard<std::mutex> ul(d.undistortMtx);
+        d.undistort.reset();
+        d.undistortFrame.reset();
+    }
+    d.undistortGen = 0;
+
+    // References are reloaded for the next stream; a capture in progress is dropped.
+    while (d.flatBusy.load(std::memory_order_acquire))
+        std::this_thread::sleep_for(std::chrono::microseconds(100));
+    endFlatCapture(d);
+    {
+        std::lock_guard<std::mutex> fl(d.flatMtx);
+        d.flat.reset();
+        d.flatActive.store(false, std::memory_order_release);
+    }
+    d.flatDark = FlatField::Frame();
+    d.flatFlat = FlatField::Frame();
+    d.flatGen = 0;
+
+    d.denoisePrimed = false;
+}
+
+void MilManager::endFlatCapture(Dig& d)
+{
+    if (d.flatCaptureLeft == 0)
+        return;
+    d.flatCaptureLeft = 0;
+    d.flatSum.reset(0, 0, 0);
+    _flatCapturing.fetch_sub(1, std::memory_order_acq_rel);
+}
+#endif
+
+bool MilManager::ensureDigitizer(int camIdx)
+{
+#if !defined(HAVE_MIL)
+    (void)camIdx;
+    return false;
+#else
+    std::lock_guard<std::recursive_mutex> lk(_mtx);
+    return allocDig(camIdx);
+#endif
+}
+
+int MilManager::cameraCount()
+{
+#if !defined(HAVE_MIL)
+    return 0;
+#else
+    if (!ensureSystem())
+        return 0;
+
+    std::lock_guard<std::recursive_mutex> lk(_mtx);
+    return (int)_validDigDevs.size();
+#endif
+}
+
+bool MilManager::cameraFormat(int camIdx, CameraFormat& out)
+{
+#if !defined(HAVE_MIL)
+    (void)camIdx;
+    out = CameraFormat();
+    return false;
+#else
+    std::lock_guard<std::recursive_mutex> lk(_mtx);
+    if (camIdx < 0 || !allocDig(camIdx))
+        return false;
+
+    const auto& d = *_digs[camIdx];
+    out.width = (int)d.w;
+    out.height = (int)d.h;
+    out.bits = (int)d.bits;
+    out.color = d.frameBpp == 4;
+    out.wireBits = d.packing != Packing::None ? (int)d.bits : (d.bits > 8 ? 16 : 8);
+    out.packetSize = (int)d.packetSize;
+    return true;
+#endif
+}
+
+bool MilManager::grabToRGBA8(int camIdx, int width, int height, std::vector<uint8_t>& outRGBA)
+{
+    return grabFrame(camIdx, OutPixel::RGBA8, width, height, outRGBA);
+}
+
+bool MilManager::grabToRGBA8(int camIdx, int width, int height, uint8_t* outRGBA, size_t outBytes)
+{
+    if (!outRGBA) return false;
+    if (width <= 0 || height <= 0) return false;
+
+    const size_t need = (size_t)width * (size_t)height * 4u;
+    if (outBytes < need) return false;
+
+    std::vector<uint8_t> frame;
+    if (!grabFrame(camIdx, OutPixel::RGBA8, width, height, frame))
+    {
+        std::memset(outRGBA, 0, need);
+        return false;
+    }
+    std::memcpy(outRGBA, frame.data(), need);
+    return true;
+}
+
+bool MilManager::grabFrame(int camIdx, OutPixel fmt, int width, int height, std::vector<uint8_t>& outFrame)
+{
+    if (width <= 0 || height <= 0)
+    {
+        outFrame.clear();
+        return false;
+    }
+
+    outFrame.resize((size_t)width * outPixelBytes(fmt) * (size_t)height);
+    return grabFrame(camIdx, fmt, width, height, outFrame.data(), outFrame.size());
+}
+
+bool MilManager::grabFrame(int camIdx, OutPixel fmt, int width, int height, uint8_t* outFrame, size_t outBytes)
+{
+    const size_t rowBytes = (size_t)width * outPixelBytes(fmt);
+    if (width <= 0 || height <= 0 || !outFrame || outBytes < rowBytes * (size_t)height)
+        return false;
+
+#if !defined(HAVE_MIL)
+    (void)camIdx;
+    std::memset(outFrame, 0, outBytes);
+    return false;
+#else
+    std::lock_guard<std::recursive_mutex> lk(_mtx);
+
+    if (!ensureStreaming(camIdx))
+        return false;
+
+    auto& d = *_digs[camIdx];
+
+    // Frames are always native size; callers size their output from cameraFormat()
+    // so a mismatch means a stale caller.
+    if (d.w != width || d.h != height)
+    {
+        std::ostringstream em;
+        em << "grabFrame: requested " << width << "x" << height
+            << " but camIdx " << camIdx << " is " << d.w << "x" << d.h << ".";
+        setErr(*this, _lastError, em.str());
+        return false;
+    }
+
+    // Only the very first call on a camera waits; afterwards the newest frame is returned.
+    if (d.frameSeq.load(std::memory_order_acquire) == 0)
+    {
+        std::unique_lock<std::mutex> fl(d.frameMtx);
+        d.frameCv.wait_for(fl, std::chrono::milliseconds(kFirstFrameTimeoutMs),
+            [&] { return d.frameSeq.load(std::memory_order_acquire) != 0; });
+    }
+
+    uint64_t seen = 0;
+    if (!copyLatestFrame(camIdx, fmt, outFrame, rowBytes, width, height, seen))
+    {
+        std::ostringstream em;
+        em << "No frame from camIdx " << camIdx << " within " << kFirstFrameTimeoutMs << " ms.";
+        setErr(*this, _lastError, em.str());
+        return false;
+    }
+
+    setErr(*this, _lastError, "");
+    return true;
+#endif
+}
+
+bool MilManager::ensureStreaming(int camIdx)
+{
+#if !defined(HAVE_MIL)
+    (void)camIdx;
+    return false;
+#else
+    std::lock_guard<std::recursive_mutex> lk(_mtx);
+
+    if (camIdx < 0 || !allocDig(camIdx))
+        return false;
+
+    auto& d = *_digs[camIdx];
+    if (d.streaming)
+        return true;
+
+    if (d.ring.empty() && !allocRing(d))
+    {
+        setErr(*this, _lastError, "MbufAlloc2d failed while building the grab ring.");
+        return false;
+    }
+
+    if (_exportEnabled && !d.shm)
+        openExport_NoLock(d);
+
+    d.hookAt = std::chrono::steady_clock::time_point();   // no jitter sample across the restart
+    d.flatCaptureGen = _flatCaptureGen.load(std::memory_order_acquire);  // earlier captures aren't this stream's
+    MdigProcess(d.dig, d.ring.data(), (MIL_INT)d.ring.size(), M_START, M_ASYNCHRONOUS, processingHook, &d);
+    d.streaming = true;
+    d.watchAt = std::chrono::steady_clock::now();   // the stall clock starts now
+    return true;
+#endif
+}
+
+#if defined(HAVE_MIL)
+bool MilManager::allocRing(Dig& d)
+{
+    // Packed formats land as raw bytes (one 8-bit "pixel" per byte of the packed row).
+    MIL_INT bufW = d.w;
+    size_t sampleBytes = d.bits > 8 ? 2 : 1;
+    if (d.packing == Packing::Mono12p || d.packing == Packing::Mono12Packed || d.packing == Packing::Mono10Packed)
+    {
+        bufW = (d.w * 3 + 1) / 2;
+        sampleBytes = 1;
+    }
+    else if (d.packing == Packing::Mono10p)
+    {
+        bufW = (d.w * 10 + 7) / 8;
+        sampleBytes = 1;
+    }
+    const MIL_INT bufType = (MIL_INT)(8 * sampleBytes) + M_UNSIGNED;
+
+    // Grab buffers live on arena slots with 64-byte aligned rows; the published
+    // frame pair is reserved alongside so the first frames don't allocate either.
+    FrameArena& arena = FrameArena::instance();
+    const size_t pitch = ((size_t)bufW * sampleBytes + FrameArena::kAlignment - 1)
+        / FrameArena::kAlignment * FrameArena::kAlignment;
+    arena.reserve(pitch * (size_t)d.h, kRingSize);
+    arena.reserve((size_t)d.w * (size_t)d.h * (size_t)d.frameBpp, 2);
+
+    for (int i = 0; i < kRingSize; ++i)
+    {
+        MIL_ID buf = M_NULL;
+        FrameArena::Slot mem = arena.acquire(pitch * (size_t)d.h);
+        if (!mem.empty())
+        {
+            MbufCreate2d(_sysId, bufW, d.h, bufType, M_IMAGE + M_GRAB + M_PROC,
+                M_HOST_ADDRESS + M_PITCH_BYTE, (MIL_INT)pitch, mem.data(), &buf);
+        }
+        if (buf == M_NULL)
+        {
+            // Systems that can't grab into user memory get MIL's own buffers.
+            mem.reset();
+            MbufAlloc2d(_sysId, bufW, d.h, bufType, M_IMAGE + M_GRAB + M_PROC, &buf);
+        }
+        if (buf == M_NULL)
+        {
+            freeRing(d);
+            return false;
+        }
+        d.ring.push_back(buf);
+        d.ringMem.push_back(std::move(mem));
+    }
+    return true;
+}
+
+bool MilManager::openExport_NoLock(Dig& d)
+{
+    auto writer = std::make_unique<SharedFrames::Writer>();
+    if (!writer->open(_exportPrefix, d.slot, _exportSlots))
+    {
+        setErr(*this, _lastError, "Shared memory export: cannot create " + SharedFrames::directoryName(_exportPrefix, d.slot) + ".");
+        return false;
+    }
+    std::lock_guard<std::mutex> sl(d.shmMtx);
+    d.shm = std::move(writer);
+    return true;
+}
+
+void MilManager::freeRing(Dig& d)
+{
+    // MIL buffers first: they may point into the slots.
+    for (MIL_ID& buf : d.ring)
+        if (buf != M_NULL) { MbufFree(buf); buf = M_NULL; }
+    d.ring.clear();
+    d.ringMem.clear();
+}
+
+MilManager::Dig* MilManager::lostDig_NoLock(int camIdx)
+{
+    if (camIdx < 0 || camIdx >= (int)_digs.size())
+        return nullptr;
+    Dig& d = *_digs[camIdx];
+    return d.lost ? &d : nullptr;
+}
+
+void MilManager::markLost(Dig& d)
+{
+    if (d.lost)
+        return;
+    d.lost = true;
+    d.retryDelayMs = kRetryMinMs;
+    d.retryAt = std::chrono::steady_clock::now() + std::chrono::milliseconds(kRetryMinMs);
+}
+
+void MilManager::startWatchdog_NoLock()
+{
+    if (!_watchdog.joinable())
+        _watchdog = std::thread(&MilManager::watchdogLoop, this);
+}
+
+void MilManager::watchdogLoop()
+{
+    using Clock = std::chrono::steady_clock;
+
+    for (;;)
+    {
+        {
+            std::unique_lock<std::mutex> wl(_wdMtx);
+            if (_wdCv.wait_for(wl, std::chrono::milliseconds(kWatchdogPeriodMs), [this] { return _wdStop; }))
+                break;
+        }
+
+        // Cameras without a new frame whose presence is asked without the lock: a GigE
+        // control request to a dead camera blocks for its timeout, and cooks take _mtx.
+        struct Probe
+        {
+            int slot;
+            MIL_ID dig;
+            uint64_t seq;
+        };
+        std::vector<Probe> probes;
+        std::vector<int> due;
+        {
+            std::lock_guard<std::recursive_mutex> lk(_mtx);
+            const auto now = Clock::now();
+
+            if (_sysId == M_NULL)
+            {
+                // No system, so no cameras to keep fed: holding the lock for MsysAlloc is fine.
+                if (_sysFailed.load(std::memory_order_acquire) && now >= _sysRetryAt)
+                {
+                    _sysAllocAttempted = false;
+                    if (trySystem())
+                        _sysFailed.store(false, std::memory_order_release);
+                    else
+                    {
+                        _sysRetryDelayMs = std::min(std::max(kRetryMinMs, _sysRetryDelayMs * 2), kRetryMaxMs);
+                        _sysRetryAt = Clock::now() + std::chrono::milliseconds(_sysRetryDelayMs);
+                    }
+                }
+                continue;
+            }
+
+            for (int i = 0; i < (int)_digs.size(); ++i)
+            {
+                Dig& d = *_digs[i];
+                if (d.reconnecting)
+                    continue;
+                if (d.lost)
+                {
+                    if (now >= d.retryAt)
+                        due.push_back(i);
+                    continue;
+                }
+                if (d.dig == M_NULL || !d.streaming)
+                    continue;
+
+                const uint64_t seq = d.frameSeq.load(std::memory_order_acquire);
+                const double sinceMs = std::chrono::duration<double, std::milli>(now - d.watchAt).count();
+                if (seq != d.watchSeq)
+                {
+                    // Smoothed frame interval, so slow or triggered cameras are judged by their own pace.
+                    if (d.watchSeq != 0)
+                    {
+                        const double interval = sinceMs / (double)(seq - d.watchSeq);
+                        d.frameIntervalMs = d.frameIntervalMs > 0.0 ? 0.8 * d.frameIntervalMs + 0.2 * interval : interval;
+                    }
+                    d.watchSeq = seq;
+                    d.watchAt = now;
+                    continue;
+                }
+
+                const double stallMs = std::max((double)kStallMinMs, kStallIntervals * d.frameIntervalMs);
+                if (d.watchSeq != 0 && sinceMs > stallMs)
+                {
+                    markLost(d);
+                    d.retryAt = now;    // first attempt right away
+                    due.push_back(i);
+                }
+                else
+                    probes.push_back({ i, d.dig, seq });
+            }
+        }
+
+        for (const Probe& pr : probes)
+        {
+            if (MdigInquire(pr.dig, M_CAMERA_PRESENT, M_NULL) != M_NO)
+                continue;
+
+            // Only if the camera is still the one probed and still without frames; a digitizer
+            // freed meanwhile (profile switch) just fails the inquiry.
+            std::lock_guard<std::recursive_mutex> lk(_mtx);
+            Dig& d = *_digs[pr.slot];
+            if (d.lost || d.reconnecting || d.dig != pr.dig || !d.streaming ||
+                d.frameSeq.load(std::memory_order_acquire) != pr.seq)
+                continue;
+            markLost(d);
+            d.retryAt = Clock::now();
+            due.push_back(pr.slot);
+        }
+
+        // Reconnects run without the manager lock; the other cameras keep cooking.
+        for (int i : due)
+        {
+            {
+                std::lock_guard<std::mutex> wl(_wdMtx);
+                if (_wdStop)
+                    break;
+            }
+            reconnect(i);
+        }
+    }
+
+    _wdDone.store(true, std::memory_order_release);
+}
+
+void MilManager::reconnect(int camIdx)
+{
+    using Clock = std::chrono::steady_clock;
+
+    // Snapshot what the new digitizer needs and take the old one out of service.
+    Dig* dp = nullptr;
+    Dig fresh;      // staging: the new digitizer is built here, outside the lock
+    MIL_ID oldDig = M_NULL;
+    std::vector<MIL_ID> oldRing;
+    std::vector<FrameArena::Slot> oldRingMem;
+    bool oldStreaming = false, restart = false, hadUsers = false;
+    MIL_ID sys = M_NULL;
+    MIL_INT dev = M_DEV0;
+    MIL_STRING userSet;
+    CameraGeometry geometry;
+    bool bayerRoi = false;
+    double fps = 0.0, ipdNs = 0.0;
+    {
+        std::lock_guard<std::recursive_mutex> lk(_mtx);
+        if (camIdx < 0 || camIdx >= (int)_digs.size() || _sysId == M_NULL)
+            return;
+        Dig& d = *_digs[camIdx];
+        if (!d.lost || d.reconnecting)
+            return;
+
+        d.reconnecting = true;
+        dp = &d;
+        oldDig = d.dig;
+        oldRing.swap(d.ring);
+        oldRingMem.swap(d.ringMem);
+        oldStreaming = d.streaming;
+        hadUsers = d.users > 0;
+        restart = d.streaming || hadUsers;
+        d.dig = M_NULL;
+        d.streaming = false;
+
+        sys = _sysId;
+        dev = camIdx < (int)_validDigDevs.size() ? _validDigDevs[camIdx] : M_DEV0 + camIdx;
+        fresh.dcf = d.dcf;
+        fresh.userSet = d.userSet;
+        userSet = d.userSet;
+        fresh.bayerMode = d.bayerMode;
+        geometry = d.geometry;
+        bayerRoi = effectiveBayer(d) != Demosaic::BayerPattern::None;
+        fps = d.fpsCap;
+        ipdNs = d.interPacketDelayNs;
+    }
+    Dig& d = *dp;
+
+    // Tear down the dead digitizer; M_STOP returns once its hook is idle.
+    if (oldDig != M_NULL && oldStreaming)
+        MdigProcess(oldDig, oldRing.data(), (MIL_INT)oldRing.size(), M_STOP, M_DEFAULT, processingHook, &d);
+    for (MIL_ID buf : oldRing)
+        if (buf != M_NULL) MbufFree(buf);
+    oldRingMem.clear();
+    if (oldDig != M_NULL)
+        MdigFree(oldDig);
+
+    // Reopen and restore the camera's mode before anyone can see it.
+    MdigAlloc(sys, dev, fresh.dcf.empty() ? MIL_TEXT("M_DEFAULT") : fresh.dcf.c_str(), M_DEFAULT, &fresh.dig);
+    bool ok = fresh.dig != M_NULL && MdigInquire(fresh.dig, M_CAMERA_PRESENT, M_NULL) != M_NO;
+    std::ostringstream skipped;
+    if (ok)
+    {
+        if (!fresh.userSet.empty() && !loadUserSet(fresh.dig, fresh.userSet))
+            fresh.userSet.clear();
+        if (geometry != CameraGeometry())
+            applyGeometryFeatures(fresh.dig, geometry, CameraGeometry(), bayerRoi, skipped);
+        if (fps > 0.0 || ipdNs > 0.0)
+            applyStreamLimitFeatures(fresh.dig, fps, ipdNs, skipped);
+        cacheNativeFormat(fresh);
+        ok = fresh.w > 0 && fresh.h > 0 && allocRing(fresh);
+    }
+
+    std::lock_guard<std::recursive_mutex> lk(_mtx);
+    const auto now = Clock::now();
+    if (!ok)
+    {
+        freeRing(fresh);
+        if (fresh.dig != M_NULL)
+            MdigFree(fresh.dig);
+        d.reconnecting = false;
+        d.retryAt = now + std::chrono::milliseconds(d.retryDelayMs);
+        d.retryDelayMs = std::min(std::max(kRetryMinMs, d.retryDelayMs * 2), kRetryMaxMs);
+        return;
+    }
+
+    // Setters record into a lost Dig while this runs unlocked; what they changed goes on below.
+    const bool modeChanged = d.dcf != fresh.dcf || d.userSet != userSet;
+
+    // Swap the recovered digitizer in as one step for readers.
+    const bool formatChanged = d.w != fresh.w || d.h != fresh.h || d.bits != fresh.bits || d.frameBpp != fresh.frameBpp;
+    {
+        std::lock_guard<std::mutex> fl(d.frameMtx);
+        d.dig = fresh.dig;
+        d.ring.swap(fresh.ring);
+        d.ringMem.swap(fresh.ringMem);
+        d.w = fresh.w;
+        d.h = fresh.h;
+        d.bits = fresh.bits;
+        d.packetSize = fresh.packetSize;
+        d.packing = fresh.packing;
+        d.detectedBayer = fresh.detectedBayer;
+        d.bayer = fresh.bayer;
+        d.frameBpp = fresh.frameBpp;
+        if (!modeChanged)
+            d.userSet = fresh.userSet;
+        if (formatChanged)
+            d.latest.reset();
+    }
+    d.lost = false;
+    d.reconnecting = false;
+    d.retryDelayMs = 0;
+    d.watchSeq = d.frameSeq.load(std::memory_order_acquire);
+    d.watchAt = now;
+
+    // Only resume if someone still wants the camera (a release may have happened meanwhile).
+    if (restart && (d.users > 0 || !hadUsers))
+    {
+        d.hookAt = Clock::time_point();
+        MdigProcess(d.dig, d.ring.data(), (MIL_INT)d.ring.size(), M_START, M_ASYNCHRONOUS, processingHook, &d);
+        d.streaming = true;
+    }
+    if (formatChanged)
+        _formatGen.fetch_add(1, std::memory_order_release);
+    _reconnects.fetch_add(1, std::memory_order_relaxed);
+
+    if (!skipped.str().empty())
+        setErr(*this, _lastError, "camIdx " + std::to_string(camIdx) + " reconnected, but features were rejected:" + skipped.str());
+
+    // Settings changed while reconnecting, against what the camera was reopened with.
+    if (modeChanged)
+    {
+        // A DCF or user set only takes effect when the camera is opened; go round again.
+        markLost(d);
+        d.retryAt = now;
+        return;
+    }
+    const BayerMode mode = d.bayerMode;
+    d.bayerMode = fresh.bayerMode;
+    setBayerMode(camIdx, mode);
+    const CameraGeometry g = d.geometry;
+    d.geometry = geometry;
+    setCameraGeometry(camIdx, g);
+    if (d.fpsCap != fps || d.interPacketDelayNs != ipdNs)
+        applyStreamLimits(camIdx, d.fpsCap, d.interPacketDelayNs);
+}
+#endif
+
+bool MilManager::setFrameExport(bool enable, const std::string& prefix, int slots)
+{
+#if !defined(HAVE_MIL)
+    (void)enable; (void)prefix; (void)slots;
+    return false;
+#else
+    std::lock_guard<std::recursive_mutex> lk(_mtx);
+    slots = std::max(2, std::min(slots, 64));
+    const bool reopen = prefix != _exportPrefix || slots != _exportSlots;
+    _exportEnabled = enable && !prefix.empty();
+    _exportPrefix = prefix;
+    _exportSlots = slots;
+
+    bool ok = true;
+    for (auto& dp : _digs)
+    {
+        Dig& d = *dp;
+        if (!_exportEnabled || reopen)
+        {
+            // Readers see generation 0 and wait for the next publisher.
+            std::unique_ptr<SharedFrames::Writer> old;
+            {
+                std::lock_guard<std::mutex> sl(d.shmMtx);
+                old.swap(d.shm);
+            }
+        }
+        if (_exportEnabled && d.streaming && !d.shm)
+            ok = openExport_NoLock(d) && ok;
+    }
+    return ok;
+#endif
+}
+
+void MilManager::setCaptureThreads(const ThreadTuning::CpuSet& cpus, ThreadTuning::Priority priority)
+{
+    std::lock_guard<std::mutex> lk(_captureMtx);
+    if (_captureGen.load(std::memory_order_relaxed) != 0 && cpus == _captureCpus && priority == _capturePriority)
+        return;
+    _captureCpus = cpus;
+    _capturePriority = priority;
+    _captureGen.fetch_add(1, std::memory_order_release);
+}
+
+void MilManager::setBlobDetection(const BlobDetector::Params& p)
+{
+    {
+        std::lock_guard<std::mutex> lk(_blobMtx);
+        _blobParams = p;
+    }
+    _blobEnabled.store(p.enabled, std::memory_order_release);
+}
+
+bool MilManager::latestBlobs(int camIdx, BlobDetector::Result& out) const
+{
+#if !defined(HAVE_MIL)
+    (void)camIdx; (void)out;
+    return false;
+#else
+    const Dig* dp = nullptr;
+    {
+        std::lock_guard<std::recursive_mutex> lk(_mtx);
+        if (camIdx < 0 || camIdx >= (int)_digs.size())
+            return false;
+        dp = _digs[camIdx].get();
+    }
+
+    std::lock_guard<std::mutex> bl(dp->blobMtx);
+    if (dp->blobs.frameSeq == 0)
+        return false;
+    // Reuses out.blobs' storage.
+    out.blobs.assign(dp->blobs.blobs.begin(), dp->blobs.blobs.end());
+    out.markers.assign(dp->blobs.markers.begin(), dp->blobs.markers.end());
+    out.frameSeq = dp->blobs.frameSeq;
+    out.timestampNs = dp->blobs.timestampNs;
+    out.width = dp->blobs.width;
+    out.height = dp->blobs.height;
+    out.detectUs = dp->blobs.detectUs;
+    return true;
+#endif
+}
+
+void MilManager::setTracking(const Tracker::Params& p)
+{
+    {
+        std::lock_guard<std::mutex> lk(_trackMtx);
+        _trackParams = p;
+        _trackParams.confirmHits = std::max(1, p.confirmHits);
+        _trackParams.maxMisses = std::max(0, p.maxMisses);
+        _trackParams.maxTracks = std::max(1, p.maxTracks);
+    }
+    _trackEnabled.store(p.enabled, std::memory_order_release);
+}
+
+bool MilManager::latestTracks(int camIdx, Tracker::Result& out) const
+{
+#if !defined(HAVE_MIL)
+    (void)camIdx; (void)out;
+    return false;
+#else
+    const Dig* dp = nullptr;
+    {
+        std::lock_guard<std::recursive_mutex> lk(_mtx);
+        if (camIdx < 0 || camIdx >= (int)_digs.size())
+            return false;
+        dp = _digs[camIdx].get();
+    }
+
+    std::lock_guard<std::mutex> bl(dp->blobMtx);
+    if (dp->tracks.frameSeq == 0)
+        return false;
+    out.tracks.assign(dp->tracks.tracks.begin(), dp->tracks.tracks.end());
+    out.frameSeq = dp->tracks.frameSeq;
+    out.timestampNs = dp->tracks.timestampNs;
+    out.trackUs = dp->tracks.trackUs;
+    return true;
+#endif
+}
+
+void MilManager::setTriangulation(const Triangulation::Params& p, const Calibration::Rig& rig)
+{
+    {
+        std::lock_guard<std::mutex> lk(_triMtx);
+        _triParams = p;
+        _triParams.minViews = std::max(2, p.minViews);
+        _triParams.maxPoints = std::max(1, p.maxPoints);
+        _triParams.syncWindowMs = std::max(0.0f, p.syncWindowMs);
+        _triRig = rig;
+        if (!p.enabled)
+            _triInputs.clear();
+    }
+    _triEnabled.store(p.enabled, std::memory_order_release);
+    if (!p.enabled)
+    {
+        std::lock_guard<std::mutex> pl(_pointsMtx);
+        _points = Triangulation::Result();
+    }
+}
+
+bool MilManager::latestPoints(Triangulation::Result& out) const
+{
+    std::lock_guard<std::mutex> pl(_pointsMtx);
+    if (_points.timestampNs == 0)
+        return false;
+    out.points.assign(_points.points.begin(), _points.points.end());
+    out.timestampNs = _points.timestampNs;
+    out.cameras = _points.cameras;
+    out.candidates = _points.candidates;
+    out.solveUs = _points.solveUs;
+    return true;
+}
+
+#if defined(HAVE_MIL)
+void MilManager::postTriangulation(int camIdx, const std::vector<BlobDetector::Blob>& blobs,
+    const std::vector<BlobDetector::Marker>& markers, uint64_t arrivedNs)
+{
+    {
+        std::lock_guard<std::mutex> lk(_triMtx);
+        if (!_triRig.camera(camIdx))
+            return;
+        if ((int)_triInputs.size() <= camIdx)
+            _triInputs.resize((size_t)camIdx + 1);
+        TriInput& in = _triInputs[camIdx];
+        const size_t n = blobs.size();
+        in.view.camera = camIdx;
+        in.view.u.resize(n);
+        in.view.v.resize(n);
+        for (size_t i = 0; i < n; ++i)
+        {
+            const bool refined = i < markers.size();
+            in.view.u[i] = refined ? markers[i].x : blobs[i].cx;
+            in.view.v[i] = refined ? markers[i].y : blobs[i].cy;
+        }
+        in.timestampNs = arrivedNs;
+        in.fresh = true;
+    }
+    scheduleTriangulation();
+}
+
+void MilManager::scheduleTriangulation()
+{
+    if (_triBusy.exchange(true, std::memory_order_acq_rel))
+        return;     // the running solve looks again when it ends
+
+    {
+        std::lock_guard<std::mutex> lk(_triMtx);
+        uint64_t newest = 0;
+        for (const TriInput& in : _triInputs)
+            newest = std::max(newest, in.timestampNs);
+        const uint64_t staleNs = (uint64_t)kStaleSetMs * 1000000ull;
+        const uint64_t windowNs = (uint64_t)((double)_triParams.syncWindowMs * 1e6);
+        bool ready = newest != 0 && _triEnabled.load(std::memory_order_acquire);
+        for (const TriInput& in : _triInputs)
+            if (in.timestampNs != 0 && !in.fresh && in.timestampNs + staleNs >= newest)
+                ready = false;
+        if (!ready)
+        {
+            _triBusy.store(false, std::memory_order_release);
+            return;
+        }
+
+        _triSet.clear();
+        for (TriInput& in : _triInputs)
+        {
+            if (in.fresh && in.timestampNs + windowNs >= newest)
+                _triSet.push_back(in.view);
+            in.fresh = false;
+        }
+        _triSetParams = _triParams;
+        _triSetRig = _triRig;
+        _triSetNs = newest;
+    }
+
+    WorkerPool::instance().submit([this]
+        {
+            const auto t0 = std::chrono::steady_clock::now();
+            _triSolver.solve(_triSetRig, _triSet, _triSetParams, _triScratch);
+            const double us = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - t0).count();
+            if (_triEnabled.load(std::memory_order_acquire))
+            {
+                std::lock_guard<std::mutex> pl(_pointsMtx);
+                _points.points.swap(_triScratch);
+                _points.timestampNs = _triSetNs;
+                _points.cameras = (int)_triSet.size();
+                _points.candidates = _triSolver.candidateCount();
+                _points.solveUs = us;
+            }
+            _triBusy.store(false, std::memory_order_release);
+            // Cameras may have completed the next set while this one was solved.
+            scheduleTriangulation();
+        });
+}
+#endif
+
+void MilManager::setBackgroundModel(const BackgroundModel::Params& p)
+{
+    {
+        std::lock_guard<std::mutex> lk(_bgMtx);
+        _bgParams = p;
+        _bgParams.decimation = std::max(1, p.decimation);
+    }
+    _bgEnabled.store(p.enabled, std::memory_order_release);
+#if defined(HAVE_MIL)
+    if (p.enabled)
+        return;
+
+    // A model is 4 bytes per pixel (18 for the mixture) per camera; don't keep them while off.
+    std::lock_guard<std::recursive_mutex> lk(_mtx);
+    for (auto& d : _digs)
+        releaseBackground(*d);
+#endif
+}
+
+bool MilManager::copyLatestMask(int camIdx, uint8_t* dst, size_t dstStride, int maxW, int maxH, uint64_t& seen) const
+{
+#if !defined(HAVE_MIL)
+    (void)camIdx; (void)dst; (void)dstStride; (void)maxW; (void)maxH; (void)seen;
+    return false;
+#else
+    if (!dst)
+        return false;
+    const Dig* dp = nullptr;
+    {
+        std::lock_guard<std::recursive_mutex> lk(_mtx);
+        if (camIdx < 0 || camIdx >= (int)_digs.size())
+            return false;
+        dp = _digs[camIdx].get();
+    }
+
+    std::lock_guard<std::mutex> bl(dp->bgMtx);
+    if (dp->bgMaskSeq == 0 || dp->bgMaskSeq <= seen)
+        return false;
+    const int w = std::min(dp->bgMaskW, maxW);
+    const int h = std::min(dp->bgMaskH, maxH);
+    for (int y = 0; y < h; ++y)
+        std::memcpy(dst + (size_t)y * dstStride, dp->bgMask.data() + (size_t)y * dp->bgMaskW, (size_t)w);
+    seen = dp->bgMaskSeq;
+    return true;
+#endif
+}
+
+void MilManager::setCalibrationCapture(const CalibrationSolver::Params& p)
+{
+    {
+        std::lock_guard<std::mutex> lk(_calibMtx);
+        // Views of another board can't be solved together.
+        if (p.cols != _calibParams.cols || p.rows != _calibParams.rows)
+        {
+            _calibViews.clear();
+            _calibSnapshots.clear();
+            _calibBaseNs = SharedFrames::nowNs();
+        }
+        else if (p.enabled && !_calibEnabled.load(std::memory_order_relaxed))
+        {
+            // Periods restart from now, after the ones already captured.
+            const int last = _calibSnapshots.empty() ? 0 : *_calibSnapshots.rbegin();
+            const uint64_t periodNs = (uint64_t)(1e9 / std::max(0.01, p.rateHz));
+            _calibBaseNs = SharedFrames::nowNs() - (uint64_t)last * periodNs;
+        }
+        _calibParams = p;
+        _calibParams.rateHz = std::max(0.01, p.rateHz);
+        _calibParams.maxSnapshots = std::max(1, p.maxSnapshots);
+    }
+    _calibEnabled.store(p.enabled, std::memory_order_release);
+#if defined(HAVE_MIL)
+    if (p.enabled)
+        return;
+
+    // Board frames are a mono copy per camera; don't keep them while off.
+    std::lock_guard<std::recursive_mutex> lk(_mtx);
+    for (auto& d : _digs)
+    {
+        while (d->boardBusy.load(std::memory_order_acquire))
+            std::this_thread::sleep_for(std::chrono::microseconds(100));
+        d->boardFrame.reset();
+        d->boardTick = 0;
+    }
+#endif
+}
+
+void MilManager::clearCalibrationViews()
+{
+    std::lock_guard<std::mutex> lk(_calibMtx);
+    _calibViews.clear();
+    _calibSnapshots.clear();
+    _calibBaseNs = SharedFrames::nowNs();
+}
+
+MilManager::CalibrationStatus MilManager::calibrationStatus() const
+{
+    std::lock_guard<std::mutex> lk(_calibMtx);
+    CalibrationStatus s = _calibResult;
+    s.snapshots = (int)_calibSnapshots.size();
+    s.views = (int)_calibViews.size();
+    std::set<int> cameras;
+    for (const auto& v : _calibViews)
+        cameras.insert(v.camera);
+    s.cameras = (int)cameras.size();
+    s.solving = _calibSolving.load(std::memory_order_acquire);
+    return s;
+}
+
+bool MilManager::startCalibrationSolve(const std::string& path)
+{
+    if (_calibSolving.exchange(true, std::memory_order_acq_rel))
+    {
+        std::lock_guard<std::recursive_mutex> lk(_mtx);
+        setErr(*this, _lastError, "A calibration solve is already running.");
+        return false;
+    }
+
+    auto views = std::make_shared<std::vector<CalibrationSolver::View>>();
+    CalibrationSolver::Params params;
+    {
+        std::lock_guard<std::mutex> lk(_calibMtx);
+        *views = _calibViews;
+        params = _calibParams;
+    }
+    if (views->empty())
+    {
+        _calibSolving.store(false, std::memory_order_release);
+        std::lock_guard<std::recursive_mutex> lk(_mtx);
+        setErr(*this, _lastError, "No calibration views captured yet.");
+        return false;
+    }
+
+    // Takes a worker for up to a few seconds with many views; the other workers, and the
+    // solve's own parallelFor, keep the cameras' jobs going.
+    WorkerPool::instance().submit([this, views, params, path]
+        {
+            Calibration::Rig rig;
+            CalibrationSolver::Report report;
+            std::string err;
+            const bool ok = CalibrationSolver::solve(params, *views, rig, report, err)
+                && Calibration::save(path, rig, err);
+
+            std::lock_guard<std::mutex> lk(_calibMtx);
+            ++_calibResult.solves;
+            _calibResult.solved = ok;
+            _calibResult.rms = ok ? report.rms : 0.0;
+            _calibResult.message = ok ? report.summary : err;
+            _calibSolving.store(false, std::memory_order_release);
+        });
+    return true;
+}
+
+void MilManager::setUndistortion(bool enable, const Calibration::Rig& rig)
+{
+    {
+        std::lock_guard<std::mutex> lk(_undistortMtx);
+        _undistortRig = rig;
+    }
+    _undistortEnabled.store(enable, std::memory_order_release);
+    _undistortGen.fetch_add(1, std::memory_order_release);
+#if defined(HAVE_MIL)
+    if (enable)
+        return;
+
+    // Maps take 4 bytes per pixel; don't keep them while off.
+    std::lock_guard<std::recursive_mutex> lk(_mtx);
+    for (auto& d : _digs)
+    {
+        while (d->undistortBusy.load(std::memory_order_acquire))
+            std::this_thread::sleep_for(std::chrono::microseconds(100));
+        std::lock_guard<std::mutex> ul(d->undistortMtx);
+        d->undistort.reset();
+        d->undistortFrame.reset();
+    }
+#endif
+}
+
+void MilManager::setFlatField(bool enable, const std::string& folder)
+{
+    {
+        std::lock_guard<std::mutex> lk(_flatMtx);
+        _flatFolder = folder;
+        _flatError.clear();
+    }
+    _flatEnabled.store(enable, std::memory_order_release);
+    _flatGen.fetch_add(1, std::memory_order_release);
+#if defined(HAVE_MIL)
+    if (enable)
+        return;
+
+    // Tables take 4 bytes per pixel; don't keep them while off. Captures still running
+    // finish and save their reference.
+    std::lock_guard<std::recursive_mutex> lk(_mtx);
+    for (auto& d : _digs)
+    {
+        while (d->flatBusy.load(std::memory_order_acquire))
+            std::this_thread::sleep_for(std::chrono::microseconds(100));
+        std::lock_guard<std::mutex> fl(d->flatMtx);
+        d->flat.reset();
+        d->flatActive.store(false, std::memory_order_release);
+    }
+#endif
+}
+
+void MilManager::setDenoise(const Denoise::Params& p)
+{
+    {
+        std::lock_guard<std::mutex> lk(_denoiseMtx);
+        _denoiseParams = p;
+    }
+    _denoiseEnabled.store(p.enabled, std::memory_order_release);
+}
+
+bool MilManager::captureFlatReference(FlatField::Reference kind, int frames)
+{
+    if (!_flatEnabled.load(std::memory_order_acquire))
+    {
+        std::lock_guard<std::recursive_mutex> lk(_mtx);
+        setErr(*this, _lastError, "Flat-field correction is off.");
+        return false;
+    }
+    {
+        std::lock_guard<std::mutex> lk(_flatMtx);
+        _flatCaptureKind = kind;
+        _flatCaptureFrames = std::max(1, frames);
+        _flatError.clear();
+    }
+    _flatCaptureGen.fetch_add(1, std::memory_order_release);
+    return true;
+}
+
+MilManager::FlatFieldStatus MilManager::flatFieldStatus() const
+{
+    FlatFieldStatus s;
+    s.capturing = _flatCapturing.load(std::memory_order_acquire);
+    {
+        std::lock_guard<std::mutex> lk(_flatMtx);
+        s.error = _flatError;
+    }
+#if defined(HAVE_MIL)
+    std::lock_guard<std::recursive_mutex> lk(_mtx);
+    for (const auto& d : _digs)
+        s.corrected += d->flatActive.load(std::memory_order_acquire) ? 1 : 0;
+#endif
+    return s;
+}
+
+std::vector<ThreadTuning::LatencyStats::Window> MilManager::hookLatency() const
+{
+    std::vector<ThreadTuning::LatencyStats::Window> out;
+#if defined(HAVE_MIL)
+    std::lock_guard<std::recursive_mutex> lk(_mtx);
+    out.reserve(_digs.size());
+    for (const auto& d : _digs)
+        out.push_back(d->hookJitter.last());
+#endif
+    return out;
+}
+
+MilManager::Health MilManager::health() const
+{
+    Health h;
+#if defined(HAVE_MIL)
+    std::lock_guard<std::recursive_mutex> lk(_mtx);
+    for (const auto& d : _digs)
+        if (d->lost || d->reconnecting)
+            ++h.lost;
+    h.reconnects = _reconnects.load(std::memory_order_relaxed);
+#endif
+    return h;
+}
+
+void MilManager::retainCamera(int camIdx)
+{
+#if !defined(HAVE_MIL)
+    (void)camIdx;
+#else
+    std::lock_guard<std::recursive_mutex> lk(_mtx);
+    if (camIdx < 0)
+        return;
+
+    // A camera that fails to open is still counted, so the watchdog starts it once it is back.
+    allocDig(camIdx);
+    if (camIdx < (int)_digs.size())
+        ++_digs[camIdx]->users;
+#endif
+}
+
+void MilManager::releaseCamera(int camIdx)
+{
+#if !defined(HAVE_MIL)
+    (void)camIdx;
+#else
+    std::lock_guard<std::recursive_mutex> lk(_mtx);
+    if (camIdx < 0 || camIdx >= (int)_digs.size())
+        return;
+
+    Dig& d = *_digs[camIdx];
+    if (d.users <= 0 || --d.users > 0 || d.lost || d.reconnecting)
+        return;
+
+    // Nobody reads this camera any more: stop spending link bandwidth and ring memory on it.
+    stopStreaming(d);
+    freeRing(d);
+#endif
+}
+
+uint64_t MilManager::frameSequence(int camIdx) const
+{
+#if !defined(HAVE_MIL)
+    (void)camIdx;
+    return 0;
+#else
+    std::lock_guard<std::recursive_mutex> lk(_mtx);
+    if (camIdx < 0 || camIdx >= (int)_digs.size())
+        return 0;
+    return _digs[camIdx]->frameSeq.load(std::memory_order_acquire);
+#endif
+}
+
+bool MilManager::copyLatestFrame(int camIdx, OutPixel fmt, uint8_t* dst, size_t dstStride, int maxW, int maxH, uint64_t& seen)
+{
+#if !defined(HAVE_MIL)
+    (void)camIdx; (void)fmt; (void)dst; (void)dstStride; (void)maxW; (void)maxH; (void)seen;
+    return false;
+#else
+    Dig* dp = nullptr;
+    {
+        std::lock_guard<std::recursive_mutex> lk(_mtx);
+        if (camIdx < 0 || camIdx >= (int)_digs.size())
+            return false;
+        dp = _digs[camIdx].get();
+    }
+    Dig& d = *dp;
+
+    // Cheap check before taking the frame lock: idle cameras cost one atomic load.
+    if (d.frameSeq.load(std::memory_order_acquire) <= seen)
+        return false;
+
+    std::lock_guard<std::mutex> fl(d.frameMtx);
+    const uint64_t seq = d.frameSeq.load(std::memory_order_acquire);
+    if (seq <= seen || d.latest.empty())
+        return false;
+
+    const int copyW = std::min((int)d.w, maxW);
+    const int copyH = std::min((int)d.h, maxH);
+    const size_t srcStride = (size_t)d.w * (size_t)d.frameBpp;
+    for (int y = 0; y < copyH; ++y)
+        convertRow(d.latest.data() + (size_t)y * srcStride, d.frameBpp, fmt, dst + (size_t)y * dstStride, (size_t)copyW);
+
+    seen = seq;
+    return true;
+#endif
+}
+
+std::string MilManager::diagnostics_NoLock() const
+{
+#if !defined(HAVE_MIL)
+    return "MIL diagnostics: HAVE_MIL not defined.\n";
+#else
+    std::ostringstream oss;
+
+    oss << "---- MIL Diagnostics ----\n";
+    oss << "app=" << (_appId != M_NULL ? "ok" : "null") << "\n";
+    oss << "sys=" << (_sysId != M_NULL ? "ok" : "null") << "\n";
+    //oss << "cachedSysDesc=" << (_cachedSysDesc.empty() ? MIL_TEXT("(empty)") : _cachedSysDesc) << "\n";
+    oss << "cachedSysDevNum=" << _cachedSysDevNum << "\n";
+
+    MIL_INT sysCount = 0;
+    MappInquire(M_DEFAULT, M_INSTALLED_SYSTEM_COUNT, &sysCount);
+    oss << "installedSystems=" << sysCount << "\n";
+    for (MIL_INT i = 0; i < sysCount; ++i)
+    {
+        MIL_STRING desc;
+        MappInquire(M_DEFAULT, M_INSTALLED_SYSTEM_DESCRIPTOR + i, desc);
+        oss << "  [" << i << "] " << milStringToStd(desc) << "\n";
+    }
+
+    // If system allocated, probe digitizer allocation results too
+    if (_sysId != M_NULL)
+    {
+        oss << "validDigDevs=" << _validDigDevs.size() << "\n";
+        for (int k = 0; k < (int)_validDigDevs.size(); ++k)
+        {
+            oss << "  camIdx " << k << " -> M_DEV" << (int)(_validDigDevs[k] - M_DEV0) << "\n";
+        }
+
+        if (!_lastProbeReport.empty())
+        {
+            oss << "\n_lastProbeReport:\n" << _lastProbeReport << "\n";
+        }
+
+        // Always probe a fixed range and record alloc success/fail
+        oss << "\nProbe MdigAlloc M_DEV0..M_DEV15:\n";
+        for (int i = 0; i < 16; ++i)
+        {
+            MIL_ID d = M_NULL;
+            MIL_INT dev = M_DEV0 + i;
+            MdigAlloc(_sysId, dev, MIL_TEXT("M_DEFAULT"), M_DEFAULT, &d);
+
+            if (d == M_NULL)
+                oss << "  M_DEV" << i << ": FAIL\n";
+            else
+            {
+                oss << "  M_DEV" << i << ": OK\n";
+                MdigFree(d);
+            }
+        }
+    }
+
+    oss << "-------------------------\n";
+    return oss.str();
+#endif
+}
+
+
+bool MilManager::grabGridToRGBA8(int gridCols, int gridRows, int tileW, int tileH, uint8_t* outRGBA, size_t outBytes)
+{
+    if (!outRGBA) return false;
+    if (gridCols <= 0 || gridRows <= 0 || tileW <= 0 || tileH <= 0) return false;
+
+    const size_t need = (size_t)gridCols * (size_t)tileW * (size_t)gridRows * (size_t)tileH * 4u;
+    if (outBytes < need) return false;
+
+    // Full rebuild: blank canvas and no remembered sequences.
+    std::memset(outRGBA, 0, need);
+    std::vector<uint64_t> tileSeqs;
+    return updateGrid(gridCols, gridRows, tileW, tileH, OutPixel::RGBA8, outRGBA, outBytes, tileSeqs) >= 0;
 }
 
 bool MilManager::grabGridToRGBA8(int gridCols, int gridRows, int tileW, int tileH, std::vector<uint8_t>& outRGBA)
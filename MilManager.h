@@ -1,8 +1,14 @@
-#pragma once
+﻿#pragma once
 
 #include <string>
 #include <vector>
 #include <mutex>
+#include <memory>
+#include <atomic>
+#include <condition_variable>
+#include <chrono>
+#include <thread>
+#include <set>
 
 #include <cstdint>
 
@@ -10,7 +16,21 @@
 #include <mil.h>
 #endif
 
-class MilManager
+#include "Demosaic.h"
+#include "ThreadTuning.h"
+#include "FrameArena.h"
+#include "SharedFrames.h"
+#include "FrameSource.h"
+#include "BlobDetector.h"
+#include "Tracker.h"
+#include "Triangulation.h"
+#include "BackgroundModel.h"
+#include "CalibrationSolver.h"
+#include "Undistort.h"
+#include "FlatField.h"
+#include "Denoise.h"
+
+class MilManager : public FrameSource
 {
 
 public:
@@ -19,17 +39,249 @@ public:
 
 
     bool builtWithMil() const;
-    std::string summaryLine() const;
+    std::string summaryLine() const override;
     std::string dumpDevices() const;
 
     std::string diagnostics_NoLock() const;
 
     // optional but useful for UI logs
-    const std::string& lastError() const;
+    const std::string& lastError() const override;
 
     // Ensure digitizer allocated (camIdx: 0 => M_DEV0, 1 => M_DEV1, etc.)
     bool ensureDigitizer(int camIdx);
 
+    // CameraFormat and OutPixel come from FrameSource. Formats are queried once when the
+    // digitizer is allocated and cached until it is freed.
+
+    // Camera-side PixelFormat packing; packed formats are grabbed as raw bytes and
+    // unpacked to 16-bit in the processing hook.
+    enum class Packing
+    {
+        None,
+        Mono12p,
+        Mono12Packed,
+        Mono10p,
+        Mono10Packed,
+    };
+
+    // Per-camera Bayer handling. Auto follows the camera's PixelFormat (BayerRG8 etc.);
+    // the explicit patterns override it, e.g. for cameras that report Mono8 on a color sensor.
+    enum class BayerMode
+    {
+        Auto,
+        None,
+        RGGB,
+        BGGR,
+        GRBG,
+        GBRG,
+    };
+
+    // Applies a Bayer mode to a camera, restarting its acquisition only if the
+    // effective pattern changes.
+    bool setBayerMode(int camIdx, BayerMode mode);
+
+    // Camera-side region of interest, binning and decimation. Applied on the camera
+    // through GenICam features, so only the reduced image crosses the wire. Width or
+    // height 0 means "as large as the sensor allows after binning/decimation".
+    struct CameraGeometry
+    {
+        int offsetX = 0;
+        int offsetY = 0;
+        int width = 0;
+        int height = 0;
+        int binning = 1;        // horizontal and vertical
+        int decimation = 1;     // horizontal and vertical
+
+        bool operator==(const CameraGeometry& o) const
+        {
+            return offsetX == o.offsetX && offsetY == o.offsetY && width == o.width && height == o.height
+                && binning == o.binning && decimation == o.decimation;
+        }
+        bool operator!=(const CameraGeometry& o) const { return !(*this == o); }
+    };
+
+    // Reconfigures the camera if 'g' differs from what is applied. Acquisition is
+    // stopped, the grab ring is rebuilt at the new native size and restarted; the
+    // cached CameraFormat follows. Features the camera lacks are skipped and reported
+    // through lastError() while the rest still apply.
+    bool setCameraGeometry(int camIdx, const CameraGeometry& g);
+
+    // --- DCF profiles ----------------------------------------------------------
+    // A named camera mode. 'source' is one of:
+    //   ""                 M_DEFAULT
+    //   "path/to/x.dcf"    a DCF file; "{cam}" is replaced by the camera index
+    //   "userset:Name"     a GenICam user set loaded on the camera (no reallocation)
+    struct DcfProfile
+    {
+        std::string name;
+        std::string source;
+    };
+
+    // Validates every profile for every discovered camera (DCF files must exist, user
+    // sets need UserSetLoad on allocated cameras) and caches the resolved per-camera
+    // sources. Invalid profiles are dropped and listed in lastError(); returns false then.
+    bool setDcfProfiles(const std::vector<DcfProfile>& profiles);
+
+    // Switches a camera to a cached profile ("" = the unnamed profile if one was set, else M_DEFAULT).
+    // Does nothing if the camera already runs that source; a user set only restarts
+    // acquisition, a DCF reallocates the digitizer. Bayer mode and geometry are kept.
+    // An unallocated camera just records the profile for its first MdigAlloc.
+    // switchMs receives the wall time spent.
+    bool applyDcfProfile(int camIdx, const std::string& name, double& switchMs);
+
+    // Caps the camera's frame rate (AcquisitionFrameRate; fps <= 0 lifts the cap) and sets
+    // its inter-packet delay (GevSCPD, converted from ns with the camera's tick frequency).
+    // Features the camera lacks are reported through lastError(); the rest still apply.
+    bool applyStreamLimits(int camIdx, double fps, double interPacketDelayNs);
+
+    // --- Reconnect watchdog -----------------------------------------------------
+    // A background thread (started with the system) watches every digitizer. A camera
+    // that disappears (M_CAMERA_PRESENT = no), stalls far beyond its own frame interval,
+    // or fails to allocate is marked lost: cook-side calls then fail fast instead of
+    // retrying MIL, and the watchdog reopens it with exponential backoff, entirely
+    // outside the manager lock. The recovered digitizer (DCF/user set, geometry, rate
+    // limits restored) is swapped in under the lock in one step. The MIL system itself
+    // is retried the same way.
+    struct Health
+    {
+        int lost = 0;               // cameras currently waiting for a reconnect
+        uint32_t reconnects = 0;    // successful reconnects since start
+    };
+    Health health() const;
+
+    // --- Capture thread placement -------------------------------------------------
+    // Pins each camera's processing hook thread (camera N gets cpus.cores[N % size], or
+    // any core of a NUMA node, ideally the one next to the NIC) and sets its priority.
+    // Hook threads pick the change up on their next frame.
+    void setCaptureThreads(const ThreadTuning::CpuSet& cpus, ThreadTuning::Priority priority);
+
+    // Per-camera hook scheduling jitter: how far each hook start strays from the
+    // camera's smoothed frame interval. Cameras that never streamed report zeros.
+    std::vector<ThreadTuning::LatencyStats::Window> hookLatency() const;
+
+    // --- Shared-memory export ---------------------------------------------------------
+    // Publishes every streaming camera's frames, as the hook produces them, into
+    // SharedFrames rings "<prefix>.cam<N>" for other processes (see SharedFrames.h).
+    // Independent of any cook rate. Returns false if a camera's ring could not be created.
+    bool setFrameExport(bool enable, const std::string& prefix, int slots);
+
+    // --- Blob detection ---------------------------------------------------------------
+    // Runs BlobDetector on every streaming camera's frames (as 8-bit mono) on the
+    // WorkerPool, one job per camera at a time. Frames arriving while a camera's job
+    // still runs are skipped by detection only, so capture never waits for it.
+    // With p.markers each blob is also refined to sub-pixel precision on the frame's
+    // native depth, blobs spread over the pool when there are many.
+    void setBlobDetection(const BlobDetector::Params& p);
+
+    // Newest detections of a camera; false until it has produced some.
+    bool latestBlobs(int camIdx, BlobDetector::Result& out) const;
+
+    // --- Tracking ---------------------------------------------------------------------
+    // Feeds every camera's detections (markers when refined, else blob centroids) to a
+    // per-camera Tracker::MultiTracker at the end of its detection job, so tracking
+    // only runs while blob detection does. While on, detection keeps at least
+    // p.maxTracks blobs. Switching it off drops every camera's tracks and their IDs.
+    void setTracking(const Tracker::Params& p);
+
+    // Newest confirmed tracks of a camera; false until it has produced some.
+    bool latestTracks(int camIdx, Tracker::Result& out) const;
+
+    // --- Triangulation ----------------------------------------------------------------
+    // Combines the detections (markers when refined, else blob centroids) of every camera
+    // the rig calibrates into 3D points with Triangulation::Solver on the WorkerPool, one
+    // solve at a time, so it only runs while blob detection does. A set is solved once
+    // every posting camera has new detections: cameras more than p.syncWindowMs behind
+    // the newest sit that set out, and a camera silent for kStaleSetMs stops holding sets
+    // back. Camera N of the rig is capture index N. While on, detection keeps at least
+    // 2 * p.maxPoints blobs. Switching it off drops the points.
+    void setTriangulation(const Triangulation::Params& p, const Calibration::Rig& rig);
+
+    // Newest points; false until a set has been solved.
+    bool latestPoints(Triangulation::Result& out) const;
+
+    // --- Background model -------------------------------------------------------------
+    // Keeps a BackgroundModel per streaming camera, fed every p.decimation-th frame (as
+    // 8-bit mono) on the WorkerPool, one job per camera at a time as for blob detection.
+    // Switching it off waits for running jobs and frees every camera's model.
+    void setBackgroundModel(const BackgroundModel::Params& p);
+
+    // Copies a camera's newest foreground mask (8-bit, camera size, 0 = background)
+    // when it is newer than 'seen', which is updated. False if there is none or no newer one.
+    bool copyLatestMask(int camIdx, uint8_t* dst, size_t dstStride, int maxW, int maxH, uint64_t& seen) const;
+
+    // --- Calibration capture ----------------------------------------------------------
+    // While p.enabled, every streaming camera looks for the board (BoardDetector, as 8-bit
+    // mono) in the first frame of each 1 / p.rateHz period, one job per camera at a time
+    // on the WorkerPool. Boards found in the same period form a snapshot, so hold the board
+    // still for a moment at each position. No snapshots are added past p.maxSnapshots.
+    // Views are kept until clearCalibrationViews() or a change of board size.
+    void setCalibrationCapture(const CalibrationSolver::Params& p);
+    void clearCalibrationViews();
+
+    struct CalibrationStatus
+    {
+        int snapshots = 0;      // captured snapshots
+        int views = 0;
+        int cameras = 0;        // cameras with at least one view
+        bool solving = false;
+        uint64_t solves = 0;    // finished solves; the fields below describe the last one
+        bool solved = false;    // it succeeded and wrote its file
+        double rms = 0.0;       // pixels
+        std::string message;    // report summary, or why it failed
+    };
+    CalibrationStatus calibrationStatus() const;
+
+    // Solves the captured views with CalibrationSolver on the WorkerPool and writes the rig
+    // to 'path' (Calibration::save). False (lastError) when a solve is already running or
+    // there is nothing to solve.
+    bool startCalibrationSolve(const std::string& path);
+
+    // --- Undistortion -----------------------------------------------------------------
+    // While enabled, cameras the rig calibrates at their streaming size deliver undistorted
+    // frames (Undistort, in the conversion pass), so detection, the background model, the
+    // export and cooks all see them. A camera builds its map on the WorkerPool with the
+    // first frame after a change and passes frames through until it is ready; cameras the
+    // rig doesn't describe, or at another size, always pass through.
+    void setUndistortion(bool enable, const Calibration::Rig& rig);
+
+    // --- Flat-field correction --------------------------------------------------------
+    // While enabled, mono cameras with references in 'folder' (FlatField::referencePath,
+    // camera N is capture index N) at their streaming size and depth are corrected in the
+    // conversion pass, before undistortion. References load on the WorkerPool with a
+    // camera's first frame after a change. Color cameras are not corrected.
+    void setFlatField(bool enable, const std::string& folder);
+
+    // Averages the next 'frames' frames of every streaming mono camera into a reference,
+    // saves it to the folder and rebuilds the camera's table. Those frames are delivered
+    // uncorrected and not undistorted. False (lastError) while correction is off.
+    bool captureFlatReference(FlatField::Reference kind, int frames);
+
+    struct FlatFieldStatus
+    {
+        int capturing = 0;      // cameras still averaging a reference
+        int corrected = 0;      // cameras with a table in use
+        std::string error;      // last load or save problem, until the next change
+    };
+    FlatFieldStatus flatFieldStatus() const;
+
+    // --- Temporal denoise -------------------------------------------------------------
+    // While p.enabled, every camera's 8-bit frames (mono8, RGBA8) are filtered against its
+    // previous output, which is still in the camera's frame storage, as the hook converts
+    // them: plain mono8 in one pass from the grab buffer, other formats in place after
+    // conversion. The first frame after a start or a change passes through. 16-bit frames
+    // and frames averaged into a flat-field reference are not filtered.
+    void setDenoise(const Denoise::Params& p);
+
+    // Number of digitizers found by discovery (allocates the system on first use).
+    int cameraCount() override;
+
+    // Allocates the digitizer if needed and returns its cached native format.
+    bool cameraFormat(int camIdx, CameraFormat& out) override;
+
+    // Bumped whenever discovery, allocation, Bayer mode or geometry changes any
+    // CameraFormat. Callers cache their layout and re-query only when this moves.
+    uint64_t formatGeneration() const override { return _formatGen.load(std::memory_order_acquire); }
+
     // Convenience overloads (use whichever your BasicFilterTOP uses)
     bool grabToRGBA8(int camIdx, int width, int height, std::vector<uint8_t>& outRGBA);
     bool grabToRGBA8(int camIdx, int width, int height, uint8_t* outRGBA, size_t outBytes);
@@ -37,6 +289,35 @@ public:
     bool grabGridToRGBA8(int gridCols, int gridRows, int tileW, int tileH, std::vector<uint8_t>& outRGBA);
     bool grabGridToRGBA8(int gridCols, int gridRows, int tileW, int tileH, uint8_t* outRGBA, size_t outBytes);
 
+    // --- Streaming acquisition ----------------------------------------------
+    // Digitizers run continuously (MdigProcess) once touched; every completed frame is
+    // copied out by the processing hook and published with a per-camera sequence number.
+
+    // Starts MdigProcess on the digitizer if it is not already running.
+    bool ensureStreaming(int camIdx) override;
+
+    // Reference counts for TOP instances using a camera. When the last holder releases
+    // it, acquisition stops and its grab ring is freed (the digitizer stays allocated,
+    // with its Bayer mode and geometry); the next ensureStreaming() restarts it.
+    void retainCamera(int camIdx);
+    void releaseCamera(int camIdx);
+
+    // Sequence number of the newest published frame (0 = nothing received yet).
+    uint64_t frameSequence(int camIdx) const;
+
+    // See FrameSource::copyLatestFrame; 'seen' is the per-camera frame sequence.
+    bool copyLatestFrame(int camIdx, OutPixel fmt, uint8_t* dst, size_t dstStride, int maxW, int maxH, uint64_t& seen) override;
+    bool copyLatestRGBA8(int camIdx, uint8_t* dst, size_t dstStride, int maxW, int maxH, uint64_t& seen)
+    {
+        return copyLatestFrame(camIdx, OutPixel::RGBA8, dst, dstStride, maxW, maxH, seen);
+    }
+
+    // Like grabToRGBA8, for any OutPixel layout. outFrame is resized to width*height pixels.
+    bool grabFrame(int camIdx, OutPixel fmt, int width, int height, std::vector<uint8_t>& outFrame);
+    // Same into caller memory (e.g. a FrameArena slot) of at least width*height pixels.
+    bool grabFrame(int camIdx, OutPixel fmt, int width, int height, uint8_t* outFrame, size_t outBytes) override;
+
+
 
     // --- Compatibility shims -------------------------------------------------
  // Some older call sites pass extra "unused" parameters (e.g. logging flags,
@@ -118,13 +399,160 @@ private:
     struct Dig
     {
         MIL_ID dig = M_NULL;
-        MIL_ID grabBuf = M_NULL;   // 8-bit mono buffer (simple + robust)
-        MIL_INT w = 0;
+        std::vector<MIL_ID> ring;  // 8-bit mono grab buffers cycled by MdigProcess
+        std::vector<FrameArena::Slot> ringMem;   // host memory behind 'ring' (empty slot: MIL-allocated)
+        bool streaming = false;
+        MIL_INT w = 0;             // native size, cached at allocDig()
         MIL_INT h = 0;
+        MIL_INT bits = 8;          // native pixel depth (M_SIZE_BIT)
+        MIL_INT64 packetSize = 1500;   // GevSCPSPacketSize
+        Packing packing = Packing::None;
+        int frameBpp = 1;          // bytes per pixel of 'latest': 1 (8-bit), 2 (10..16-bit), 4 (RGBA8)
+        BayerMode bayerMode = BayerMode::Auto;
+        Demosaic::BayerPattern detectedBayer = Demosaic::BayerPattern::None;   // from PixelFormat
+        Demosaic::BayerPattern bayer = Demosaic::BayerPattern::None;           // effective
+        CameraGeometry geometry;   // last geometry pushed to the camera
+        int users = 0;             // retainCamera() count
+        MIL_STRING dcf;            // DCF used by MdigAlloc (empty = M_DEFAULT)
+        MIL_STRING userSet;        // user set loaded on top of it (empty = none)
+        double fpsCap = 0.0;           // last applyStreamLimits(), restored on reconnect
+        double interPacketDelayNs = 0.0;
+
+        // Watchdog state, guarded by _mtx. While 'lost' or 'reconnecting' only the
+        // watchdog touches the MIL objects; cook-side calls see the camera as unavailable.
+        bool lost = false;
+        bool reconnecting = false;
+        int retryDelayMs = 0;
+        std::chrono::steady_clock::time_point retryAt;
+        uint64_t watchSeq = 0;                          // frameSeq last seen by the watchdog
+        std::chrono::steady_clock::time_point watchAt;  // when it last moved
+        double frameIntervalMs = 0.0;                   // smoothed, for the stall threshold
+        FrameArena::Slot raw;      // MbufGet2d fallback when the ring has no host address
+
+        // Hook thread bookkeeping, touched only by the hook (stats are internally locked).
+        int slot = 0;              // camera index, picks the core from the capture set
+        std::chrono::steady_clock::time_point hookAt;
+        double hookIntervalUs = 0.0;
+        ThreadTuning::LatencyStats hookJitter;
+
+        // Written by the processing hook (MIL thread), read by cooks.
+        // 'back' is filled outside the lock and swapped into 'latest'.
+        std::mutex frameMtx;
+        std::condition_variable frameCv;
+        FrameArena::Slot latest;
+        FrameArena::Slot back;
+        std::atomic<uint64_t> frameSeq{ 0 };
+
+        // Shared-memory publisher; the hook publishes under shmMtx, setFrameExport() swaps it.
+        std::mutex shmMtx;
+        std::unique_ptr<SharedFrames::Writer> shm;
+
+        // Blob detection: the hook copies a mono frame into blobFrame only while no job
+        // is in flight (blobBusy); the job publishes into 'blobs' under blobMtx.
+        // markerFrame keeps 16-bit cameras' full depth for marker refinement.
+        std::atomic<bool> blobBusy{ false };
+        FrameArena::Slot blobFrame;
+        FrameArena::Slot markerFrame;
+        BlobDetector::Labeler blobLabeler;
+        std::vector<BlobDetector::Blob> blobScratch;
+        std::vector<BlobDetector::Marker> markerScratch;
+        mutable std::mutex blobMtx;
+        BlobDetector::Result blobs;
+
+        // Tracking, run by the detection job after refinement; 'tracks' is published
+        // under blobMtx together with 'blobs'.
+        Tracker::MultiTracker tracker;
+        std::vector<Tracker::Detection> trackDets;
+        std::vector<Tracker::Track> trackScratch;
+        Tracker::Result tracks;
+
+        // Background model, same hand-off as blob detection: the job classifies bgFrame
+        // into bgMaskBack, then swaps it into bgMask under bgMtx.
+        std::atomic<bool> bgBusy{ false };
+        int bgSkipped = 0;          // frames since the model was last fed (hook thread only)
+        FrameArena::Slot bgFrame;
+        FrameArena::Slot bgMaskBack;
+        BackgroundModel::Model bgModel;
+        mutable std::mutex bgMtx;
+        FrameArena::Slot bgMask;
+        uint64_t bgMaskSeq = 0;     // capture sequence of bgMask, 0 = none
+        int bgMaskW = 0;
+        int bgMaskH = 0;
+
+        // Calibration board search, same hand-off as blob detection. boardTick is the
+        // capture period the last frame was taken from (hook thread).
+        std::atomic<bool> boardBusy{ false };
+        int boardTick = 0;
+        FrameArena::Slot boardFrame;
+        BoardDetector::Detector boardDetector;
+
+        // Undistortion map, built by a pool job (undistortBusy) when undistortGen is behind
+        // the manager's. The hook converts under undistortMtx; formats that can't be
+        // remapped straight from the grab buffer are converted into undistortFrame first.
+        std::atomic<bool> undistortBusy{ false };
+        uint64_t undistortGen = 0;  // generation of the last build started (hook thread)
+        std::mutex undistortMtx;
+        std::unique_ptr<Undistort::Map> undistort;
+        FrameArena::Slot undistortFrame;
+
+        // Flat-field correction, same hand-off as the undistortion map: a pool job (flatBusy)
+        // loads the references, or averages a finished capture, and swaps the table in under
+        // flatMtx. A capture is armed when flatCaptureGen is behind the manager's.
+        std::atomic<bool> flatBusy{ false };
+        std::atomic<bool> flatActive{ false };  // a table is in place
+        uint64_t flatGen = 0;           // generation of the last load started (hook thread)
+        uint64_t flatCaptureGen = 0;    // last capture request taken (hook thread)
+        int flatCaptureLeft = 0;        // frames still to average (hook thread)
+        FlatField::Reference flatCaptureKind = FlatField::Reference::Dark;
+        FlatField::Accumulator flatSum;
+        FlatField::Frame flatDark;      // references, used by the job holding flatBusy
+        FlatField::Frame flatFlat;
+        std::mutex flatMtx;
+        std::unique_ptr<FlatField::Table> flat;
+
+        // 'latest' holds this stream's previous filtered frame (hook thread).
+        bool denoisePrimed = false;
     };
+
+    static MIL_INT MFTYPE processingHook(MIL_INT hookType, MIL_ID eventId, void* userData);
+    static void tuneHookThread(Dig& d);
+    static void scheduleBlobs(Dig& d, uint64_t arrivedNs);
+    void postTriangulation(int camIdx, const std::vector<BlobDetector::Blob>& blobs,
+        const std::vector<BlobDetector::Marker>& markers, uint64_t arrivedNs);
+    void scheduleTriangulation();
+    static void scheduleBackground(Dig& d);
+    static void releaseBackground(Dig& d);
+    static void scheduleBoard(Dig& d, uint64_t arrivedNs);
+    static void scheduleUndistortMap(Dig& d);
+    static void scheduleFlatField(Dig& d);
+    static void captureFlatFrame(Dig& d, size_t rowBytes);
+    void endFlatCapture(Dig& d);
+    void stopStreaming(Dig& d);
+    static Demosaic::BayerPattern effectiveBayer(const Dig& d);
+    static void updateFrameLayout(Dig& d);
+    static void cacheNativeFormat(Dig& d);
+    bool allocRing(Dig& d);
+    bool openExport_NoLock(Dig& d);
+    static void freeRing(Dig& d);
+    void markLost(Dig& d);
+    Dig* lostDig_NoLock(int camIdx);   // lost or reconnecting: settings are recorded for the reconnect
+
+    void startWatchdog_NoLock();
+    void watchdogLoop();
+    void reconnect(int camIdx);
+
+    // setDcfProfiles() result: one source per discovered camera.
+    struct ResolvedProfile
+    {
+        std::string name;
+        bool userSet = false;
+        std::vector<MIL_STRING> perCam;
+    };
+    std::vector<ResolvedProfile> _profiles;
 #endif
 
     bool ensureSystem();
+    bool trySystem();
     bool discoverDigitizers_NoLock();
 #if defined(HAVE_MIL)
     bool allocDig(int camIdx);
@@ -134,10 +562,106 @@ private:
 private:
     mutable std::recursive_mutex _mtx;
     std::string _lastError;
+    std::atomic<uint64_t> _formatGen{ 1 };
+
+    // Watchdog thread; _wdMtx/_wdCv only pace and stop it.
+    std::thread _watchdog;
+    std::mutex _wdMtx;
+    std::condition_variable _wdCv;
+    bool _wdStop = false;
+    std::atomic<bool> _wdDone{ false };
+    std::atomic<uint32_t> _reconnects{ 0 };
+    std::atomic<bool> _sysFailed{ false };     // cooks skip MIL entirely until the watchdog recovers it
+    std::chrono::steady_clock::time_point _sysRetryAt;
+    int _sysRetryDelayMs = 0;
+
+    // setCaptureThreads(); hooks compare _captureGen with what their thread last applied.
+    mutable std::mutex _captureMtx;
+    ThreadTuning::CpuSet _captureCpus;
+    ThreadTuning::Priority _capturePriority = ThreadTuning::Priority::Normal;
+    std::atomic<uint64_t> _captureGen{ 0 };
+
+    // setFrameExport(), guarded by _mtx.
+    bool _exportEnabled = false;
+    std::string _exportPrefix;
+    int _exportSlots = 4;
+
+    // setBlobDetection(); hooks test _blobEnabled and copy the params under _blobMtx.
+    mutable std::mutex _blobMtx;
+    BlobDetector::Params _blobParams;
+    std::atomic<bool> _blobEnabled{ false };
+
+    // setTracking(), same scheme as the blob parameters.
+    mutable std::mutex _trackMtx;
+    Tracker::Params _trackParams;
+    std::atomic<bool> _trackEnabled{ false };
+
+    // setTriangulation(). Detection jobs post into _triInputs (by capture index) under
+    // _triMtx; the solve holding _triBusy owns the solver and the _triSet* copies.
+    struct TriInput
+    {
+        Triangulation::View view;
+        uint64_t timestampNs = 0;   // 0 = nothing posted
+        bool fresh = false;         // posted since the last solve
+    };
+    mutable std::mutex _triMtx;
+    Triangulation::Params _triParams;
+    Calibration::Rig _triRig;
+    std::vector<TriInput> _triInputs;
+    std::atomic<bool> _triEnabled{ false };
+    std::atomic<bool> _triBusy{ false };
+    Triangulation::Solver _triSolver;
+    Triangulation::Params _triSetParams;
+    Calibration::Rig _triSetRig;
+    std::vector<Triangulation::View> _triSet;
+    uint64_t _triSetNs = 0;
+    std::vector<Triangulation::Point> _triScratch;
+    mutable std::mutex _pointsMtx;
+    Triangulation::Result _points;  // published under _pointsMtx
+
+    // setBackgroundModel(), same scheme as the blob parameters.
+    mutable std::mutex _bgMtx;
+    BackgroundModel::Params _bgParams;
+    std::atomic<bool> _bgEnabled{ false };
+
+    // setCalibrationCapture(). Board jobs add views under _calibMtx; snapshots count the
+    // periods since _calibBaseNs, which clearing moves. A solve works on a copy of the
+    // views while it holds _calibSolving.
+    mutable std::mutex _calibMtx;
+    CalibrationSolver::Params _calibParams;
+    std::atomic<bool> _calibEnabled{ false };
+    uint64_t _calibBaseNs = 0;
+    std::vector<CalibrationSolver::View> _calibViews;
+    std::set<int> _calibSnapshots;
+    std::atomic<bool> _calibSolving{ false };
+    CalibrationStatus _calibResult;     // solves, solved, rms, message
+
+    // setUndistortion(); every call moves _undistortGen so cameras rebuild their maps.
+    mutable std::mutex _undistortMtx;
+    Calibration::Rig _undistortRig;
+    std::atomic<bool> _undistortEnabled{ false };
+    std::atomic<uint64_t> _undistortGen{ 0 };
+
+    // setFlatField() moves _flatGen and captureFlatReference() _flatCaptureGen, as for
+    // undistortion; _flatCapturing counts the cameras still averaging.
+    mutable std::mutex _flatMtx;
+    std::string _flatFolder;
+    FlatField::Reference _flatCaptureKind = FlatField::Reference::Dark;
+    int _flatCaptureFrames = 16;
+    std::string _flatError;
+    std::atomic<bool> _flatEnabled{ false };
+    std::atomic<uint64_t> _flatGen{ 0 };
+    std::atomic<uint64_t> _flatCaptureGen{ 0 };
+    std::atomic<int> _flatCapturing{ 0 };
+
+    // setDenoise(), same scheme as the blob parameters.
+    mutable std::mutex _denoiseMtx;
+    Denoise::Params _denoiseParams;
+    std::atomic<bool> _denoiseEnabled{ false };
 
 #if defined(HAVE_MIL)
     MIL_ID _appId = M_NULL;
     MIL_ID _sysId = M_NULL;
-    std::vector<Dig> _digs;
+    std::vector<std::unique_ptr<Dig>> _digs;  // stable addresses: hooks hold Dig*
 #endif
 };
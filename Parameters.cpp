@@ -7,6 +7,9 @@
 #include "Parameters.h"
 #include "CPlusPlus_Common.h"
 
+#include <algorithm>
+#include <cstring>
+
 using namespace TD;
 
 void SetupParameters(OP_ParameterManager* manager)
@@ -34,9 +37,9 @@ void SetupParameters(OP_ParameterManager* manager)
 		sp.name = OutputModeName;
 		sp.label = OutputModeLabel;
 		sp.defaultValue = "Selected";
-		const char* names[] = { "Selected", "Grid" };
-		const char* labels[] = { "Selected", "Grid (24-up)" };
-		manager->appendMenu(sp, 2, names, labels);
+		const char* names[] = { "Selected", "Grid", "All", "Array" };
+		const char* labels[] = { "Selected", "Grid (24-up)", "All Cameras (color buffers)", "All Cameras (2D array)" };
+		manager->appendMenu(sp, 4, names, labels);
 	}
 	{
 		OP_NumericParameter np;
@@ -56,6 +59,20 @@ void SetupParameters(OP_ParameterManager* manager)
 		sp.defaultValue = "";
 		manager->appendString(sp);
 	}
+	{
+		OP_StringParameter sp;
+		sp.name = DcfProfilesName;
+		sp.label = DcfProfilesLabel;
+		sp.defaultValue = "";
+		manager->appendString(sp);
+	}
+	{
+		OP_StringParameter sp;
+		sp.name = DcfProfileName;
+		sp.label = DcfProfileLabel;
+		sp.defaultValue = "";
+		manager->appendString(sp);
+	}
 	{
 		OP_NumericParameter np;
 		np.name = DeviceOffsetName;
@@ -67,6 +84,658 @@ void SetupParameters(OP_ParameterManager* manager)
 		np.defaultValues[0] = 0;
 		manager->appendInt(np);
 	}
+	{
+		OP_StringParameter sp;
+		sp.name = PixelFormatName;
+		sp.label = PixelFormatLabel;
+		sp.defaultValue = "Auto";
+		const char* names[] = { "Auto", "Rgba8", "Mono16", "Rgba16" };
+		const char* labels[] = { "Auto", "RGBA 8-bit", "Mono 16-bit", "RGBA 16-bit" };
+		manager->appendMenu(sp, 4, names, labels);
+	}
+	{
+		OP_StringParameter sp;
+		sp.name = BayerMapName;
+		sp.label = BayerMapLabel;
+		sp.defaultValue = "";
+		manager->appendString(sp);
+	}
+	{
+		OP_NumericParameter np;
+		np.name = RoiOffsetName;
+		np.label = RoiOffsetLabel;
+		for (int i = 0; i < 2; ++i)
+		{
+			np.minSliders[i] = 0;
+			np.maxSliders[i] = 2048;
+			np.minValues[i] = 0;
+			np.clampMins[i] = true;
+			np.defaultValues[i] = 0;
+		}
+		manager->appendInt(np, 2);
+	}
+	{
+		OP_NumericParameter np;
+		np.name = RoiSizeName;
+		np.label = RoiSizeLabel;
+		for (int i = 0; i < 2; ++i)
+		{
+			np.minSliders[i] = 0;
+			np.maxSliders[i] = 4096;
+			np.minValues[i] = 0;
+			np.clampMins[i] = true;
+			np.defaultValues[i] = 0;
+		}
+		manager->appendInt(np, 2);
+	}
+	{
+		OP_NumericParameter np;
+		np.name = BinningName;
+		np.label = BinningLabel;
+		np.minSliders[0] = 1;
+		np.maxSliders[0] = 4;
+		np.minValues[0] = 1;
+		np.maxValues[0] = 4;
+		np.clampMins[0] = true;
+		np.clampMaxes[0] = true;
+		np.defaultValues[0] = 1;
+		manager->appendInt(np);
+	}
+	{
+		OP_NumericParameter np;
+		np.name = DecimationName;
+		np.label = DecimationLabel;
+		np.minSliders[0] = 1;
+		np.maxSliders[0] = 4;
+		np.minValues[0] = 1;
+		np.maxValues[0] = 4;
+		np.clampMins[0] = true;
+		np.clampMaxes[0] = true;
+		np.defaultValues[0] = 1;
+		manager->appendInt(np);
+	}
+	{
+		OP_StringParameter sp;
+		sp.name = GeometryScopeName;
+		sp.label = GeometryScopeLabel;
+		sp.defaultValue = "Selected";
+		const char* names[] = { "Selected", "All" };
+		const char* labels[] = { "Selected Camera", "All Cameras" };
+		manager->appendMenu(sp, 2, names, labels);
+	}
+	{
+		OP_NumericParameter np;
+		np.name = BwPlannerName;
+		np.label = BwPlannerLabel;
+		np.defaultValues[0] = 0.0;
+		manager->appendToggle(np);
+	}
+	{
+		OP_NumericParameter np;
+		np.name = LinkCapacityName;
+		np.label = LinkCapacityLabel;
+		np.minSliders[0] = 100;
+		np.maxSliders[0] = 10000;
+		np.minValues[0] = 1;
+		np.clampMins[0] = true;
+		np.defaultValues[0] = 1000;
+		manager->appendFloat(np);
+	}
+	{
+		OP_NumericParameter np;
+		np.name = LinkUtilName;
+		np.label = LinkUtilLabel;
+		np.minSliders[0] = 0.1;
+		np.maxSliders[0] = 1.0;
+		np.minValues[0] = 0.01;
+		np.maxValues[0] = 1.0;
+		np.clampMins[0] = true;
+		np.clampMaxes[0] = true;
+		np.defaultValues[0] = 0.9;
+		manager->appendFloat(np);
+	}
+	{
+		OP_NumericParameter np;
+		np.name = CamsPerPortName;
+		np.label = CamsPerPortLabel;
+		np.minSliders[0] = 1;
+		np.maxSliders[0] = 24;
+		np.minValues[0] = 1;
+		np.clampMins[0] = true;
+		np.defaultValues[0] = 4;
+		manager->appendInt(np);
+	}
+	{
+		OP_NumericParameter np;
+		np.name = RequestedFpsName;
+		np.label = RequestedFpsLabel;
+		np.minSliders[0] = 1;
+		np.maxSliders[0] = 120;
+		np.minValues[0] = 0;
+		np.clampMins[0] = true;
+		np.defaultValues[0] = 30;
+		manager->appendFloat(np);
+	}
+	{
+		OP_StringParameter sp;
+		sp.name = CaptureCoresName;
+		sp.label = CaptureCoresLabel;
+		sp.defaultValue = "";
+		manager->appendString(sp);
+	}
+	{
+		OP_StringParameter sp;
+		sp.name = WorkerCoresName;
+		sp.label = WorkerCoresLabel;
+		sp.defaultValue = "";
+		manager->appendString(sp);
+	}
+	{
+		OP_StringParameter sp;
+		sp.name = CapturePriorityName;
+		sp.label = CapturePriorityLabel;
+		sp.defaultValue = "Normal";
+		const char* names[] = { "Normal", "High", "Timecritical" };
+		const char* labels[] = { "Normal", "High", "Time Critical" };
+		manager->appendMenu(sp, 3, names, labels);
+	}
+	{
+		OP_NumericParameter np;
+		np.name = HugePagesName;
+		np.label = HugePagesLabel;
+		np.defaultValues[0] = 0.0;
+		manager->appendToggle(np);
+	}
+	{
+		OP_StringParameter sp;
+		sp.name = FrameSourceName;
+		sp.label = FrameSourceLabel;
+		sp.defaultValue = "Inprocess";
+		const char* names[] = { "Inprocess", "Daemon" };
+		const char* labels[] = { "In-Process (MIL)", "Capture Daemon" };
+		manager->appendMenu(sp, 2, names, labels);
+	}
+	{
+		OP_NumericParameter np;
+		np.name = ShmExportName;
+		np.label = ShmExportLabel;
+		np.defaultValues[0] = 0.0;
+		manager->appendToggle(np);
+	}
+	{
+		OP_StringParameter sp;
+		sp.name = ShmPrefixName;
+		sp.label = ShmPrefixLabel;
+		sp.defaultValue = "GevIQ24";
+		manager->appendString(sp);
+	}
+	{
+		OP_NumericParameter np;
+		np.name = ShmSlotsName;
+		np.label = ShmSlotsLabel;
+		np.minSliders[0] = 2;
+		np.maxSliders[0] = 16;
+		np.minValues[0] = 2;
+		np.maxValues[0] = 64;
+		np.clampMins[0] = true;
+		np.clampMaxes[0] = true;
+		np.defaultValues[0] = 4;
+		manager->appendInt(np);
+	}
+	{
+		OP_NumericParameter np;
+		np.name = BlobDetectName;
+		np.label = BlobDetectLabel;
+		np.defaultValues[0] = 0.0;
+		manager->appendToggle(np);
+	}
+	{
+		OP_NumericParameter np;
+		np.name = BlobThresholdName;
+		np.label = BlobThresholdLabel;
+		np.minSliders[0] = 0;
+		np.maxSliders[0] = 255;
+		np.minValues[0] = 0;
+		np.maxValues[0] = 255;
+		np.clampMins[0] = true;
+		np.clampMaxes[0] = true;
+		np.defaultValues[0] = 200;
+		manager->appendInt(np);
+	}
+	{
+		OP_NumericParameter np;
+		np.name = BlobMinAreaName;
+		np.label = BlobMinAreaLabel;
+		np.minSliders[0] = 1;
+		np.maxSliders[0] = 1000;
+		np.minValues[0] = 1;
+		np.clampMins[0] = true;
+		np.defaultValues[0] = 4;
+		manager->appendInt(np);
+	}
+	{
+		OP_NumericParameter np;
+		np.name = BlobMaxAreaName;
+		np.label = BlobMaxAreaLabel;
+		np.minSliders[0] = 0;
+		np.maxSliders[0] = 100000;
+		np.minValues[0] = 0;
+		np.clampMins[0] = true;
+		np.defaultValues[0] = 0;
+		manager->appendInt(np);
+	}
+	{
+		OP_NumericParameter np;
+		np.name = BlobMaxName;
+		np.label = BlobMaxLabel;
+		np.minSliders[0] = 1;
+		np.maxSliders[0] = 32;
+		np.minValues[0] = 1;
+		np.maxValues[0] = 64;
+		np.clampMins[0] = true;
+		np.clampMaxes[0] = true;
+		np.defaultValues[0] = 8;
+		manager->appendInt(np);
+	}
+	{
+		OP_NumericParameter np;
+		np.name = BlobMarkersName;
+		np.label = BlobMarkersLabel;
+		np.defaultValues[0] = 0.0;
+		manager->appendToggle(np);
+	}
+	{
+		OP_NumericParameter np;
+		np.name = BlobCircleFitName;
+		np.label = BlobCircleFitLabel;
+		np.defaultValues[0] = 0.0;
+		manager->appendToggle(np);
+	}
+	{
+		OP_NumericParameter np;
+		np.name = TrackName;
+		np.label = TrackLabel;
+		np.defaultValues[0] = 0.0;
+		manager->appendToggle(np);
+	}
+	{
+		OP_NumericParameter np;
+		np.name = TrackNoiseName;
+		np.label = TrackNoiseLabel;
+		np.minSliders[0] = 0.05;
+		np.maxSliders[0] = 5.0;
+		np.minValues[0] = 0.01;
+		np.maxValues[0] = 50.0;
+		np.clampMins[0] = true;
+		np.clampMaxes[0] = true;
+		np.defaultValues[0] = 1.0;
+		manager->appendFloat(np);
+	}
+	{
+		OP_NumericParameter np;
+		np.name = TrackAccelName;
+		np.label = TrackAccelLabel;
+		np.minSliders[0] = 0.0;
+		np.maxSliders[0] = 5000.0;
+		np.minValues[0] = 1.0;
+		np.maxValues[0] = 100000.0;
+		np.clampMins[0] = true;
+		np.clampMaxes[0] = true;
+		np.defaultValues[0] = 500.0;
+		manager->appendFloat(np);
+	}
+	{
+		OP_NumericParameter np;
+		np.name = TrackGateName;
+		np.label = TrackGateLabel;
+		np.minSliders[0] = 1.0;
+		np.maxSliders[0] = 6.0;
+		np.minValues[0] = 0.5;
+		np.maxValues[0] = 20.0;
+		np.clampMins[0] = true;
+		np.clampMaxes[0] = true;
+		np.defaultValues[0] = 3.0;
+		manager->appendFloat(np);
+	}
+	{
+		OP_NumericParameter np;
+		np.name = TrackConfirmName;
+		np.label = TrackConfirmLabel;
+		np.minSliders[0] = 1;
+		np.maxSliders[0] = 10;
+		np.minValues[0] = 1;
+		np.clampMins[0] = true;
+		np.defaultValues[0] = 3;
+		manager->appendInt(np);
+	}
+	{
+		OP_NumericParameter np;
+		np.name = TrackCoastName;
+		np.label = TrackCoastLabel;
+		np.minSliders[0] = 0;
+		np.maxSliders[0] = 60;
+		np.minValues[0] = 0;
+		np.clampMins[0] = true;
+		np.defaultValues[0] = 10;
+		manager->appendInt(np);
+	}
+	{
+		OP_NumericParameter np;
+		np.name = TrackMaxName;
+		np.label = TrackMaxLabel;
+		np.minSliders[0] = 1;
+		np.maxSliders[0] = 1024;
+		np.minValues[0] = 1;
+		np.maxValues[0] = 4096;
+		np.clampMins[0] = true;
+		np.clampMaxes[0] = true;
+		np.defaultValues[0] = 256;
+		manager->appendInt(np);
+	}
+	{
+		OP_NumericParameter np;
+		np.name = TriangulateName;
+		np.label = TriangulateLabel;
+		np.defaultValues[0] = 0.0;
+		manager->appendToggle(np);
+	}
+	{
+		OP_StringParameter sp;
+		sp.name = CalibrationFileName;
+		sp.label = CalibrationFileLabel;
+		sp.defaultValue = "";
+		manager->appendFile(sp);
+	}
+	{
+		OP_NumericParameter np;
+		np.name = TriEpipolarName;
+		np.label = TriEpipolarLabel;
+		np.minSliders[0] = 0.5;
+		np.maxSliders[0] = 5.0;
+		np.minValues[0] = 0.05;
+		np.maxValues[0] = 50.0;
+		np.clampMins[0] = true;
+		np.clampMaxes[0] = true;
+		np.defaultValues[0] = 1.5;
+		manager->appendFloat(np);
+	}
+	{
+		OP_NumericParameter np;
+		np.name = TriMaxErrorName;
+		np.label = TriMaxErrorLabel;
+		np.minSliders[0] = 0.5;
+		np.maxSliders[0] = 5.0;
+		np.minValues[0] = 0.05;
+		np.maxValues[0] = 50.0;
+		np.clampMins[0] = true;
+		np.clampMaxes[0] = true;
+		np.defaultValues[0] = 1.5;
+		manager->appendFloat(np);
+	}
+	{
+		OP_NumericParameter np;
+		np.name = TriMinViewsName;
+		np.label = TriMinViewsLabel;
+		np.minSliders[0] = 2;
+		np.maxSliders[0] = 8;
+		np.minValues[0] = 2;
+		np.maxValues[0] = 24;
+		np.clampMins[0] = true;
+		np.clampMaxes[0] = true;
+		np.defaultValues[0] = 3;
+		manager->appendInt(np);
+	}
+	{
+		OP_NumericParameter np;
+		np.name = TriMergeName;
+		np.label = TriMergeLabel;
+		np.minSliders[0] = 1.0;
+		np.maxSliders[0] = 50.0;
+		np.minValues[0] = 0.001;
+		np.clampMins[0] = true;
+		np.defaultValues[0] = 10.0;
+		manager->appendFloat(np);
+	}
+	{
+		OP_NumericParameter np;
+		np.name = TriSyncName;
+		np.label = TriSyncLabel;
+		np.minSliders[0] = 0.0;
+		np.maxSliders[0] = 20.0;
+		np.minValues[0] = 0.0;
+		np.maxValues[0] = 100.0;
+		np.clampMins[0] = true;
+		np.clampMaxes[0] = true;
+		np.defaultValues[0] = 4.0;
+		manager->appendFloat(np);
+	}
+	{
+		OP_NumericParameter np;
+		np.name = TriMaxPointsName;
+		np.label = TriMaxPointsLabel;
+		np.minSliders[0] = 1;
+		np.maxSliders[0] = 256;
+		np.minValues[0] = 1;
+		np.maxValues[0] = 1024;
+		np.clampMins[0] = true;
+		np.clampMaxes[0] = true;
+		np.defaultValues[0] = 64;
+		manager->appendInt(np);
+	}
+	{
+		OP_NumericParameter np;
+		np.name = CalibrateName;
+		np.label = CalibrateLabel;
+		np.defaultValues[0] = 0.0;
+		manager->appendToggle(np);
+	}
+	{
+		OP_NumericParameter np;
+		np.name = CalibColsName;
+		np.label = CalibColsLabel;
+		np.minSliders[0] = 3;
+		np.maxSliders[0] = 20;
+		np.minValues[0] = 3;
+		np.maxValues[0] = 64;
+		np.clampMins[0] = true;
+		np.clampMaxes[0] = true;
+		np.defaultValues[0] = 9;
+		manager->appendInt(np);
+	}
+	{
+		OP_NumericParameter np;
+		np.name = CalibRowsName;
+		np.label = CalibRowsLabel;
+		np.minSliders[0] = 3;
+		np.maxSliders[0] = 20;
+		np.minValues[0] = 3;
+		np.maxValues[0] = 64;
+		np.clampMins[0] = true;
+		np.clampMaxes[0] = true;
+		np.defaultValues[0] = 6;
+		manager->appendInt(np);
+	}
+	{
+		OP_NumericParameter np;
+		np.name = CalibSquareName;
+		np.label = CalibSquareLabel;
+		np.minSliders[0] = 10.0;
+		np.maxSliders[0] = 200.0;
+		np.minValues[0] = 0.001;
+		np.clampMins[0] = true;
+		np.defaultValues[0] = 25.0;
+		manager->appendFloat(np);
+	}
+	{
+		OP_NumericParameter np;
+		np.name = CalibRateName;
+		np.label = CalibRateLabel;
+		np.minSliders[0] = 0.2;
+		np.maxSliders[0] = 10.0;
+		np.minValues[0] = 0.01;
+		np.maxValues[0] = 60.0;
+		np.clampMins[0] = true;
+		np.clampMaxes[0] = true;
+		np.defaultValues[0] = 2.0;
+		manager->appendFloat(np);
+	}
+	{
+		OP_NumericParameter np;
+		np.name = CalibMaxName;
+		np.label = CalibMaxLabel;
+		np.minSliders[0] = 10;
+		np.maxSliders[0] = 200;
+		np.minValues[0] = 1;
+		np.maxValues[0] = 1000;
+		np.clampMins[0] = true;
+		np.clampMaxes[0] = true;
+		np.defaultValues[0] = 60;
+		manager->appendInt(np);
+	}
+	{
+		OP_NumericParameter np;
+		np.name = CalibSolveName;
+		np.label = CalibSolveLabel;
+		manager->appendPulse(np);
+	}
+	{
+		OP_NumericParameter np;
+		np.name = CalibClearName;
+		np.label = CalibClearLabel;
+		manager->appendPulse(np);
+	}
+	{
+		OP_NumericParameter np;
+		np.name = UndistortName;
+		np.label = UndistortLabel;
+		np.defaultValues[0] = 0.0;
+		manager->appendToggle(np);
+	}
+	{
+		OP_NumericParameter np;
+		np.name = FlatFieldName;
+		np.label = FlatFieldLabel;
+		np.defaultValues[0] = 0.0;
+		manager->appendToggle(np);
+	}
+	{
+		OP_StringParameter sp;
+		sp.name = FlatFolderName;
+		sp.label = FlatFolderLabel;
+		sp.defaultValue = "";
+		manager->appendFolder(sp);
+	}
+	{
+		OP_NumericParameter np;
+		np.name = FlatFramesName;
+		np.label = FlatFramesLabel;
+		np.minSliders[0] = 1;
+		np.maxSliders[0] = 64;
+		np.minValues[0] = 1;
+		np.maxValues[0] = 1024;
+		np.clampMins[0] = true;
+		np.clampMaxes[0] = true;
+		np.defaultValues[0] = 16;
+		manager->appendInt(np);
+	}
+	{
+		OP_NumericParameter np;
+		np.name = CaptureDarkName;
+		np.label = CaptureDarkLabel;
+		manager->appendPulse(np);
+	}
+	{
+		OP_NumericParameter np;
+		np.name = CaptureFlatName;
+		np.label = CaptureFlatLabel;
+		manager->appendPulse(np);
+	}
+	{
+		OP_NumericParameter np;
+		np.name = DenoiseName;
+		np.label = DenoiseLabel;
+		np.defaultValues[0] = 0.0;
+		manager->appendToggle(np);
+	}
+	{
+		OP_NumericParameter np;
+		np.name = DenoiseStrengthName;
+		np.label = DenoiseStrengthLabel;
+		np.minSliders[0] = 0.0;
+		np.maxSliders[0] = 1.0;
+		np.minValues[0] = 0.0;
+		np.maxValues[0] = 1.0;
+		np.clampMins[0] = true;
+		np.clampMaxes[0] = true;
+		np.defaultValues[0] = 0.8;
+		manager->appendFloat(np);
+	}
+	{
+		OP_NumericParameter np;
+		np.name = DenoiseMotionName;
+		np.label = DenoiseMotionLabel;
+		np.minSliders[0] = 2;
+		np.maxSliders[0] = 64;
+		np.minValues[0] = 2;
+		np.maxValues[0] = 255;
+		np.clampMins[0] = true;
+		np.clampMaxes[0] = true;
+		np.defaultValues[0] = 24;
+		manager->appendInt(np);
+	}
+	{
+		OP_StringParameter sp;
+		sp.name = BgModelName;
+		sp.label = BgModelLabel;
+		sp.defaultValue = "Off";
+		const char* names[] = { "Off", "Average", "Mixture" };
+		const char* labels[] = { "Off", "Running Average", "Mixture of Gaussians" };
+		manager->appendMenu(sp, 3, names, labels);
+	}
+	{
+		OP_NumericParameter np;
+		np.name = BgLearnRateName;
+		np.label = BgLearnRateLabel;
+		np.minSliders[0] = 0.0;
+		np.maxSliders[0] = 0.1;
+		np.minValues[0] = 0.0001;
+		np.maxValues[0] = 0.5;
+		np.clampMins[0] = true;
+		np.clampMaxes[0] = true;
+		np.defaultValues[0] = 0.01;
+		manager->appendFloat(np);
+	}
+	{
+		OP_NumericParameter np;
+		np.name = BgDecimationName;
+		np.label = BgDecimationLabel;
+		np.minSliders[0] = 1;
+		np.maxSliders[0] = 30;
+		np.minValues[0] = 1;
+		np.clampMins[0] = true;
+		np.defaultValues[0] = 1;
+		manager->appendInt(np);
+	}
+	{
+		OP_NumericParameter np;
+		np.name = BgThresholdName;
+		np.label = BgThresholdLabel;
+		np.minSliders[0] = 1.0;
+		np.maxSliders[0] = 8.0;
+		np.minValues[0] = 0.5;
+		np.maxValues[0] = 15.0;
+		np.clampMins[0] = true;
+		np.clampMaxes[0] = true;
+		np.defaultValues[0] = 3.0;
+		manager->appendFloat(np);
+	}
+	{
+		OP_NumericParameter np;
+		np.name = BgSoftMaskName;
+		np.label = BgSoftMaskLabel;
+		np.defaultValues[0] = 0.0;
+		manager->appendToggle(np);
+	}
 	{
 		OP_StringParameter sp;
 		sp.name = DebugLevelName;
@@ -78,13 +747,126 @@ void SetupParameters(OP_ParameterManager* manager)
 	}
 }
 
-void GevIQ24Params::load(const OP_Inputs* inputs)
+// Stores 'v' into 'field' and flags 'bit' if it differs.
+template <typename T>
+static void track(T& field, const T& v, unsigned bit, unsigned& changes)
+{
+	if (field != v)
+	{
+		field = v;
+		changes |= bit;
+	}
+}
+
+// Strings are compared in place and only copied when they actually change.
+static void trackString(std::string& field, const char* v, unsigned bit, unsigned& changes)
 {
-	enable = inputs->getParInt(EnableName) != 0;
-	cameraIndex = inputs->getParInt(CameraIndexName);
-	outputMode = inputs->getParInt(OutputModeName);
-	gridCols = std::max(1, inputs->getParInt(GridColsName));
-	dcfPath = inputs->getParString(DcfPathName) ? inputs->getParString(DcfPathName) : "";
-	deviceOffset = inputs->getParInt(DeviceOffsetName);
-	debugLevel = inputs->getParInt(DebugLevelName);
+	if (!v)
+		v = "";
+	if (std::strcmp(field.c_str(), v) != 0)
+	{
+		field = v;
+		changes |= bit;
+	}
+}
+
+unsigned GevIQ24Params::load(const OP_Inputs* inputs)
+{
+	unsigned changes = Change_None;
+
+	track(enable, inputs->getParInt(EnableName) != 0, Change_Enable, changes);
+	track(cameraIndex, inputs->getParInt(CameraIndexName), Change_Camera, changes);
+	track(deviceOffset, inputs->getParInt(DeviceOffsetName), Change_Camera, changes);
+	track(outputMode, inputs->getParInt(OutputModeName), Change_Layout, changes);
+	track(gridCols, std::max(1, inputs->getParInt(GridColsName)), Change_Layout, changes);
+	track(pixelFormat, inputs->getParInt(PixelFormatName), Change_Layout, changes);
+	trackString(dcfPath, inputs->getParString(DcfPathName), Change_Dcf, changes);
+	trackString(dcfProfiles, inputs->getParString(DcfProfilesName), Change_Dcf, changes);
+	trackString(dcfProfile, inputs->getParString(DcfProfileName), Change_Dcf, changes);
+	trackString(bayerMap, inputs->getParString(BayerMapName), Change_Bayer, changes);
+
+	int x = 0, y = 0;
+	inputs->getParInt2(RoiOffsetName, x, y);
+	track(roiX, x, Change_Geometry, changes);
+	track(roiY, y, Change_Geometry, changes);
+	inputs->getParInt2(RoiSizeName, x, y);
+	track(roiW, x, Change_Geometry, changes);
+	track(roiH, y, Change_Geometry, changes);
+	track(binning, std::max(1, inputs->getParInt(BinningName)), Change_Geometry, changes);
+	track(decimation, std::max(1, inputs->getParInt(DecimationName)), Change_Geometry, changes);
+	track(geometryScope, inputs->getParInt(GeometryScopeName), Change_Geometry, changes);
+
+	track(bwPlanner, inputs->getParInt(BwPlannerName) != 0, Change_Bandwidth, changes);
+	track(linkMbps, inputs->getParDouble(LinkCapacityName), Change_Bandwidth, changes);
+	track(linkUtil, inputs->getParDouble(LinkUtilName), Change_Bandwidth, changes);
+	track(camsPerPort, std::max(1, inputs->getParInt(CamsPerPortName)), Change_Bandwidth, changes);
+	track(requestedFps, inputs->getParDouble(RequestedFpsName), Change_Bandwidth, changes);
+
+	trackString(captureCores, inputs->getParString(CaptureCoresName), Change_Threads, changes);
+	trackString(workerCores, inputs->getParString(WorkerCoresName), Change_Threads, changes);
+	track(capturePriority, inputs->getParInt(CapturePriorityName), Change_Threads, changes);
+	track(hugePages, inputs->getParInt(HugePagesName) != 0, Change_Memory, changes);
+
+	track(frameSource, inputs->getParInt(FrameSourceName), Change_Source, changes);
+	track(shmExport, inputs->getParInt(ShmExportName) != 0, Change_Export, changes);
+	trackString(shmPrefix, inputs->getParString(ShmPrefixName), Change_Export | Change_Source, changes);
+	track(shmSlots, inputs->getParInt(ShmSlotsName), Change_Export, changes);
+
+	track(blobDetect, inputs->getParInt(BlobDetectName) != 0, Change_Blobs, changes);
+	track(blobThreshold, inputs->getParInt(BlobThresholdName), Change_Blobs, changes);
+	track(blobMinArea, inputs->getParInt(BlobMinAreaName), Change_Blobs, changes);
+	track(blobMaxArea, inputs->getParInt(BlobMaxAreaName), Change_Blobs, changes);
+	track(blobMax, std::max(1, inputs->getParInt(BlobMaxName)), Change_Blobs, changes);
+	track(blobMarkers, inputs->getParInt(BlobMarkersName) != 0, Change_Blobs, changes);
+	track(blobCircleFit, inputs->getParInt(BlobCircleFitName) != 0, Change_Blobs, changes);
+
+	track(tracking, inputs->getParInt(TrackName) != 0, Change_Tracking, changes);
+	track(trackNoise, inputs->getParDouble(TrackNoiseName), Change_Tracking, changes);
+	track(trackAccel, inputs->getParDouble(TrackAccelName), Change_Tracking, changes);
+	track(trackGate, inputs->getParDouble(TrackGateName), Change_Tracking, changes);
+	track(trackConfirm, std::max(1, inputs->getParInt(TrackConfirmName)), Change_Tracking, changes);
+	track(trackCoast, std::max(0, inputs->getParInt(TrackCoastName)), Change_Tracking, changes);
+	track(trackMax, std::max(1, inputs->getParInt(TrackMaxName)), Change_Tracking, changes);
+
+	track(triangulate, inputs->getParInt(TriangulateName) != 0, Change_Triangulation, changes);
+	trackString(calibrationFile, inputs->getParFilePath(CalibrationFileName), Change_Triangulation | Change_Undistort, changes);
+	track(triEpipolar, inputs->getParDouble(TriEpipolarName), Change_Triangulation, changes);
+	track(triMaxError, inputs->getParDouble(TriMaxErrorName), Change_Triangulation, changes);
+	track(triMinViews, std::max(2, inputs->getParInt(TriMinViewsName)), Change_Triangulation, changes);
+	track(triMerge, inputs->getParDouble(TriMergeName), Change_Triangulation, changes);
+	track(triSyncMs, inputs->getParDouble(TriSyncName), Change_Triangulation, changes);
+	track(triMaxPoints, std::max(1, inputs->getParInt(TriMaxPointsName)), Change_Triangulation, changes);
+
+	track(calibrate, inputs->getParInt(CalibrateName) != 0, Change_Calibration, changes);
+	track(calibCols, inputs->getParInt(CalibColsName), Change_Calibration, changes);
+	track(calibRows, inputs->getParInt(CalibRowsName), Change_Calibration, changes);
+	track(calibSquare, inputs->getParDouble(CalibSquareName), Change_Calibration, changes);
+	track(calibRateHz, inputs->getParDouble(CalibRateName), Change_Calibration, changes);
+	track(calibMax, std::max(1, inputs->getParInt(CalibMaxName)), Change_Calibration, changes);
+
+	track(undistort, inputs->getParInt(UndistortName) != 0, Change_Undistort, changes);
+
+	track(flatField, inputs->getParInt(FlatFieldName) != 0, Change_FlatField, changes);
+	trackString(flatFolder, inputs->getParFilePath(FlatFolderName), Change_FlatField, changes);
+	track(flatFrames, std::max(1, inputs->getParInt(FlatFramesName)), Change_FlatField, changes);
+
+	track(denoise, inputs->getParInt(DenoiseName) != 0, Change_Denoise, changes);
+	track(denoiseStrength, inputs->getParDouble(DenoiseStrengthName), Change_Denoise, changes);
+	track(denoiseMotion, inputs->getParInt(DenoiseMotionName), Change_Denoise, changes);
+
+	// Switching the model on or off adds or removes mask color buffers.
+	track(bgModel, inputs->getParInt(BgModelName), Change_Background | Change_Layout, changes);
+	track(bgLearnRate, inputs->getParDouble(BgLearnRateName), Change_Background, changes);
+	track(bgDecimation, std::max(1, inputs->getParInt(BgDecimationName)), Change_Background, changes);
+	track(bgThreshold, inputs->getParDouble(BgThresholdName), Change_Background, changes);
+	track(bgSoftMask, inputs->getParInt(BgSoftMaskName) != 0, Change_Background, changes);
+
+	track(debugLevel, inputs->getParInt(DebugLevelName), Change_Debug, changes);
+
+	if (!loaded)
+	{
+		loaded = true;
+		changes = Change_All;
+	}
+	return changes;
 }
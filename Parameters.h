@@ -31,26 +31,366 @@ constexpr static char GridColsLabel[] = "Grid Columns";
 constexpr static char DcfPathName[] = "Dcfpath";
 constexpr static char DcfPathLabel[] = "DCF Path";
 
+constexpr static char DcfProfilesName[] = "Dcfprofiles";
+constexpr static char DcfProfilesLabel[] = "DCF Profiles";
+
+constexpr static char DcfProfileName[] = "Dcfprofile";
+constexpr static char DcfProfileLabel[] = "Active DCF Profile";
+
 constexpr static char DeviceOffsetName[] = "Deviceoffset";
 constexpr static char DeviceOffsetLabel[] = "Device Offset";
 
+constexpr static char PixelFormatName[] = "Pixelformat";
+constexpr static char PixelFormatLabel[] = "Pixel Format";
+
+constexpr static char BayerMapName[] = "Bayermap";
+constexpr static char BayerMapLabel[] = "Bayer Map";
+
+constexpr static char RoiOffsetName[] = "Roioffset";
+constexpr static char RoiOffsetLabel[] = "ROI Offset";
+
+constexpr static char RoiSizeName[] = "Roisize";
+constexpr static char RoiSizeLabel[] = "ROI Size";
+
+constexpr static char BinningName[] = "Binning";
+constexpr static char BinningLabel[] = "Binning";
+
+constexpr static char DecimationName[] = "Decimation";
+constexpr static char DecimationLabel[] = "Decimation";
+
+constexpr static char GeometryScopeName[] = "Geometryscope";
+constexpr static char GeometryScopeLabel[] = "Apply Geometry To";
+
+constexpr static char BwPlannerName[] = "Bwplanner";
+constexpr static char BwPlannerLabel[] = "Bandwidth Planner";
+
+constexpr static char LinkCapacityName[] = "Linkcapacity";
+constexpr static char LinkCapacityLabel[] = "Link Capacity (Mbps)";
+
+constexpr static char LinkUtilName[] = "Linkutil";
+constexpr static char LinkUtilLabel[] = "Max Link Utilization";
+
+constexpr static char CamsPerPortName[] = "Camsperport";
+constexpr static char CamsPerPortLabel[] = "Cameras per Port";
+
+constexpr static char RequestedFpsName[] = "Requestedfps";
+constexpr static char RequestedFpsLabel[] = "Requested FPS";
+
+constexpr static char CaptureCoresName[] = "Capturecores";
+constexpr static char CaptureCoresLabel[] = "Capture Cores";
+
+constexpr static char WorkerCoresName[] = "Workercores";
+constexpr static char WorkerCoresLabel[] = "Worker Cores";
+
+constexpr static char CapturePriorityName[] = "Capturepriority";
+constexpr static char CapturePriorityLabel[] = "Capture Priority";
+
+constexpr static char HugePagesName[] = "Hugepages";
+constexpr static char HugePagesLabel[] = "Large Page Frames";
+
+constexpr static char FrameSourceName[] = "Framesource";
+constexpr static char FrameSourceLabel[] = "Frame Source";
+
+constexpr static char ShmExportName[] = "Shmexport";
+constexpr static char ShmExportLabel[] = "Shared Memory Export";
+
+constexpr static char ShmPrefixName[] = "Shmprefix";
+constexpr static char ShmPrefixLabel[] = "Shared Memory Name";
+
+constexpr static char ShmSlotsName[] = "Shmslots";
+constexpr static char ShmSlotsLabel[] = "Shared Memory Slots";
+
+constexpr static char BlobDetectName[] = "Blobdetect";
+constexpr static char BlobDetectLabel[] = "Blob Detection";
+
+constexpr static char BlobThresholdName[] = "Blobthreshold";
+constexpr static char BlobThresholdLabel[] = "Blob Threshold";
+
+constexpr static char BlobMinAreaName[] = "Blobminarea";
+constexpr static char BlobMinAreaLabel[] = "Blob Min Area";
+
+constexpr static char BlobMaxAreaName[] = "Blobmaxarea";
+constexpr static char BlobMaxAreaLabel[] = "Blob Max Area";
+
+constexpr static char BlobMaxName[] = "Blobmax";
+constexpr static char BlobMaxLabel[] = "Blobs per Camera";
+
+constexpr static char BlobMarkersName[] = "Blobmarkers";
+constexpr static char BlobMarkersLabel[] = "Sub-pixel Markers";
+
+constexpr static char BlobCircleFitName[] = "Blobcirclefit";
+constexpr static char BlobCircleFitLabel[] = "Marker Circle Fit";
+
+constexpr static char TrackName[] = "Track";
+constexpr static char TrackLabel[] = "Marker Tracking";
+
+constexpr static char TrackNoiseName[] = "Tracknoise";
+constexpr static char TrackNoiseLabel[] = "Track Position Noise";
+
+constexpr static char TrackAccelName[] = "Trackaccel";
+constexpr static char TrackAccelLabel[] = "Track Acceleration";
+
+constexpr static char TrackGateName[] = "Trackgate";
+constexpr static char TrackGateLabel[] = "Track Gate";
+
+constexpr static char TrackConfirmName[] = "Trackconfirm";
+constexpr static char TrackConfirmLabel[] = "Track Confirm Frames";
+
+constexpr static char TrackCoastName[] = "Trackcoast";
+constexpr static char TrackCoastLabel[] = "Track Coast Frames";
+
+constexpr static char TrackMaxName[] = "Trackmax";
+constexpr static char TrackMaxLabel[] = "Max Tracks";
+
+constexpr static char TriangulateName[] = "Triangulate";
+constexpr static char TriangulateLabel[] = "Triangulation";
+
+constexpr static char CalibrationFileName[] = "Calibrationfile";
+constexpr static char CalibrationFileLabel[] = "Calibration File";
+
+constexpr static char TriEpipolarName[] = "Triepipolar";
+constexpr static char TriEpipolarLabel[] = "Epipolar Tolerance";
+
+constexpr static char TriMaxErrorName[] = "Trimaxerror";
+constexpr static char TriMaxErrorLabel[] = "Max Reprojection Error";
+
+constexpr static char TriMinViewsName[] = "Triminviews";
+constexpr static char TriMinViewsLabel[] = "Min Views per Point";
+
+constexpr static char TriMergeName[] = "Trimerge";
+constexpr static char TriMergeLabel[] = "Point Merge Distance";
+
+constexpr static char TriSyncName[] = "Trisync";
+constexpr static char TriSyncLabel[] = "Sync Window (ms)";
+
+constexpr static char TriMaxPointsName[] = "Trimaxpoints";
+constexpr static char TriMaxPointsLabel[] = "Points Shown";
+
+constexpr static char CalibrateName[] = "Calibrate";
+constexpr static char CalibrateLabel[] = "Calibration Capture";
+
+constexpr static char CalibColsName[] = "Calibcols";
+constexpr static char CalibColsLabel[] = "Board Inner Corners X";
+
+constexpr static char CalibRowsName[] = "Calibrows";
+constexpr static char CalibRowsLabel[] = "Board Inner Corners Y";
+
+constexpr static char CalibSquareName[] = "Calibsquare";
+constexpr static char CalibSquareLabel[] = "Board Square Size";
+
+constexpr static char CalibRateName[] = "Calibhz";
+constexpr static char CalibRateLabel[] = "Snapshots per Second";
+
+constexpr static char CalibMaxName[] = "Calibmax";
+constexpr static char CalibMaxLabel[] = "Max Snapshots";
+
+constexpr static char CalibSolveName[] = "Calibsolve";
+constexpr static char CalibSolveLabel[] = "Solve Calibration";
+
+constexpr static char CalibClearName[] = "Calibclear";
+constexpr static char CalibClearLabel[] = "Clear Snapshots";
+
+constexpr static char UndistortName[] = "Undistort";
+constexpr static char UndistortLabel[] = "Undistort Frames";
+
+constexpr static char FlatFieldName[] = "Flatfield";
+constexpr static char FlatFieldLabel[] = "Flat-Field Correction";
+
+constexpr static char FlatFolderName[] = "Flatfolder";
+constexpr static char FlatFolderLabel[] = "Flat-Field Folder";
+
+constexpr static char FlatFramesName[] = "Flatframes";
+constexpr static char FlatFramesLabel[] = "Reference Frames";
+
+constexpr static char CaptureDarkName[] = "Capturedark";
+constexpr static char CaptureDarkLabel[] = "Capture Dark Frame";
+
+constexpr static char CaptureFlatName[] = "Captureflat";
+constexpr static char CaptureFlatLabel[] = "Capture Flat Frame";
+
+constexpr static char DenoiseName[] = "Denoise";
+constexpr static char DenoiseLabel[] = "Temporal Denoise";
+
+constexpr static char DenoiseStrengthName[] = "Denoisestrength";
+constexpr static char DenoiseStrengthLabel[] = "Denoise Strength";
+
+constexpr static char DenoiseMotionName[] = "Denoisemotion";
+constexpr static char DenoiseMotionLabel[] = "Denoise Motion Threshold";
+
+constexpr static char BgModelName[] = "Bgmodel";
+constexpr static char BgModelLabel[] = "Background Model";
+
+constexpr static char BgLearnRateName[] = "Bglearnrate";
+constexpr static char BgLearnRateLabel[] = "Background Learning Rate";
+
+constexpr static char BgDecimationName[] = "Bgdecimation";
+constexpr static char BgDecimationLabel[] = "Background Update Every";
+
+constexpr static char BgThresholdName[] = "Bgthreshold";
+constexpr static char BgThresholdLabel[] = "Foreground Threshold";
+
+constexpr static char BgSoftMaskName[] = "Bgsoftmask";
+constexpr static char BgSoftMaskLabel[] = "Soft Mask";
+
 constexpr static char DebugLevelName[] = "Debuglevel";
 constexpr static char DebugLevelLabel[] = "Debug Level";
 
 constexpr static char DumpDevicesName[] = "Dumpdevices";
 
-// Small helper to read parameters
+// Output Mode menu indices
+enum OutputMode : int
+{
+	OutputMode_Selected = 0,
+	OutputMode_Grid = 1,
+	OutputMode_AllCameras = 2,	// one color buffer per camera
+	OutputMode_Array = 3,		// one 2D texture array, one layer per camera
+};
+
+// Pixel Format menu indices
+enum PixelFormatMode : int
+{
+	PixelFormat_Auto = 0,		// RGBA8 for 8-bit cameras, Mono16 when any camera is deeper
+	PixelFormat_RGBA8 = 1,
+	PixelFormat_Mono16 = 2,
+	PixelFormat_RGBA16 = 3,
+};
+
+// Apply Geometry To menu indices
+enum GeometryScope : int
+{
+	GeometryScope_Selected = 0,
+	GeometryScope_All = 1,
+};
+
+// Frame Source menu indices
+enum FrameSourceMode : int
+{
+	FrameSource_InProcess = 0,	// MIL runs inside TouchDesigner
+	FrameSource_Daemon = 1,		// read the capture daemon's rings named by Shared Memory Name
+};
+
+// Background Model menu indices
+enum BackgroundMode : int
+{
+	BackgroundMode_Off = 0,
+	BackgroundMode_Average = 1,	// BackgroundModel::Mode::RunningAverage
+	BackgroundMode_Mixture = 2,	// BackgroundModel::Mode::Mixture
+};
+
+// Capture Priority menu indices (ThreadTuning::Priority)
+enum CapturePriority : int
+{
+	CapturePriority_Normal = 0,
+	CapturePriority_High = 1,
+	CapturePriority_TimeCritical = 2,
+};
+
+// What changed since the previous load(); each bit maps to one subsystem to reconfigure.
+enum ParamChange : unsigned
+{
+	Change_None = 0,
+	Change_Enable = 1u << 0,
+	Change_Camera = 1u << 1,	// cameraIndex, deviceOffset: which digitizer(s) this TOP holds
+	Change_Layout = 1u << 2,	// outputMode, gridCols, pixelFormat: output size/format
+	Change_Dcf = 1u << 3,		// DCF path, profile table, active profile
+	Change_Bayer = 1u << 4,
+	Change_Geometry = 1u << 5,	// ROI, binning, decimation, scope
+	Change_Debug = 1u << 6,
+	Change_Bandwidth = 1u << 7,	// planner switch, link capacity/utilization, ports, fps
+	Change_Threads = 1u << 8,	// capture/worker cores, priority
+	Change_Memory = 1u << 9,	// frame arena page size
+	Change_Export = 1u << 10,	// shared-memory export switch, name, ring depth
+	Change_Source = 1u << 11,	// frame source, daemon name
+	Change_Blobs = 1u << 12,	// blob detection switch, threshold, area limits, count, marker mode
+	Change_Background = 1u << 13,	// background model, learning rate, decimation, threshold, mask type
+	Change_Tracking = 1u << 14,	// tracker switch, noise model, gate, track lifetimes
+	Change_Triangulation = 1u << 15,	// triangulation switch, calibration file, tolerances, sync window
+	Change_Calibration = 1u << 16,	// calibration capture switch, board, snapshot rate and count
+	Change_Undistort = 1u << 17,	// undistortion switch, calibration file
+	Change_FlatField = 1u << 18,	// flat-field switch, reference folder, frames per reference
+	Change_Denoise = 1u << 19,	// temporal denoise switch, strength, motion threshold
+	Change_All = ~0u,
+};
+
+// Parameter snapshot. load() refreshes it in place and reports what changed, so a
+// cook with untouched parameters costs a handful of integer compares.
 struct GevIQ24Params
 {
 	bool enable = true;
 	int cameraIndex = 0;     // 0..23
-	int outputMode = 0;      // 0=Selected, 1=Grid (composite)
+	int outputMode = 0;      // OutputMode: Selected, Grid (composite), All cameras
 	int gridCols = 6;        // for grid mode (e.g. 6 -> 6x4 = 24)
 	std::string dcfPath;     // optional: path to DCF (or leave empty for M_DEFAULT)
+	std::string dcfProfiles; // "name=source; ..." where source is a DCF path ({cam} = index) or userset:Name
+	std::string dcfProfile;  // active profile name, empty = dcfPath
 	int deviceOffset = 0;    // add to cameraIndex to map to MIL dig dev numbers
+	int pixelFormat = 0;     // PixelFormatMode
+	std::string bayerMap;    // per-camera Bayer overrides, e.g. "0=RGGB 5=BGGR" (others: Auto)
+	int roiX = 0, roiY = 0;  // camera-side ROI offset (pixels after binning/decimation)
+	int roiW = 0, roiH = 0;  // camera-side ROI size, 0 = full
+	int binning = 1;         // 1..4, horizontal and vertical
+	int decimation = 1;      // 1..4, horizontal and vertical
+	int geometryScope = 0;   // GeometryScope
+	bool bwPlanner = false;  // plan and apply frame-rate caps / packet delays for all cameras
+	double linkMbps = 1000.0;
+	double linkUtil = 0.9;   // fraction of the link the plan may fill
+	int camsPerPort = 4;     // cameras are assigned to ports in index order
+	double requestedFps = 30.0;
+	std::string captureCores; // hook threads, camera N on the Nth core: "4-11", "numa:1", empty = unpinned
+	std::string workerCores;  // WorkerPool threads, same syntax
+	int capturePriority = 0;  // CapturePriority, applies to hook and worker threads
+	bool hugePages = false;   // back new frame arena slabs with large pages (needs SeLockMemoryPrivilege)
+	int frameSource = 0;      // FrameSourceMode
+	bool shmExport = false;   // publish frames to SharedFrames rings for other processes
+	std::string shmPrefix = "GevIQ24";  // export rings, or the daemon's rings to read
+	int shmSlots = 4;         // frames per camera ring
+	bool blobDetect = false;  // per-camera blob detection on worker threads, results in the Info CHOP
+	int blobThreshold = 200;  // 8-bit level; brighter pixels are foreground
+	int blobMinArea = 4;
+	int blobMaxArea = 0;      // 0 = no limit
+	int blobMax = 8;          // blobs per camera kept and shown
+	bool blobMarkers = false; // refine blobs to intensity-weighted, background-subtracted centroids
+	bool blobCircleFit = false; // markers: circle center from the blob's sub-pixel edge
+	bool tracking = false;    // Kalman tracks with persistent IDs per camera, fed by blob detection
+	double trackNoise = 1.0;  // detection position noise, pixels
+	double trackAccel = 500.0; // expected acceleration, pixels / s^2
+	double trackGate = 3.0;   // association gate, standard deviations
+	int trackConfirm = 3;     // detections before a track is reported
+	int trackCoast = 10;      // frames a track survives without a detection
+	int trackMax = 256;       // tracks per camera
+	bool triangulate = false; // 3D points from all calibrated cameras' detections, in the Info CHOP
+	std::string calibrationFile; // Calibration::load() file; camera N is capture index N
+	double triEpipolar = 1.5; // pair correspondence tolerance, pixels
+	double triMaxError = 1.5; // reprojection error a view of a point may have, pixels
+	int triMinViews = 3;      // cameras a point needs
+	double triMerge = 10.0;   // calibration units (usually mm): candidates this close are one point
+	double triSyncMs = 4.0;   // detections this far behind a set's newest are left out
+	int triMaxPoints = 64;    // points shown
+	bool calibrate = false;   // look for the checkerboard in every camera; Calibsolve writes calibrationFile
+	int calibCols = 9;        // inner corners
+	int calibRows = 6;
+	double calibSquare = 25.0; // square size, in the units the rig should use (usually mm)
+	double calibRateHz = 2.0; // snapshots per second
+	int calibMax = 60;        // snapshots kept
+	bool undistort = false;   // remove the calibrationFile's lens distortion from every calibrated camera
+	bool flatField = false;   // dark / flat correction of mono cameras from references in flatFolder
+	std::string flatFolder;   // cam<N>_dark.pgm, cam<N>_flat.pgm; camera N is capture index N
+	int flatFrames = 16;      // frames averaged per captured reference
+	bool denoise = false;     // motion-adaptive temporal filter on every camera's 8-bit frames
+	double denoiseStrength = 0.8; // weight of the previous frame where nothing moves
+	int denoiseMotion = 24;   // gray levels of change that count fully as motion
+	int bgModel = 0;          // BackgroundMode; not Off adds a foreground mask color buffer per camera
+	double bgLearnRate = 0.01; // weight of each model update
+	int bgDecimation = 1;     // feed the model every Nth frame
+	double bgThreshold = 3.0; // foreground beyond this many standard deviations
+	bool bgSoftMask = false;  // mask is deviation / (2 * threshold) instead of 0/1
 	int debugLevel = 0;      // 0=Off, 1=Basic, 2=Verbose
 
-	void load(const TD::OP_Inputs* inputs);
+	// Returns a ParamChange mask; the first call reports Change_All.
+	unsigned load(const TD::OP_Inputs* inputs);
+
+private:
+	bool loaded = false;
 };
 
 void SetupParameters(TD::OP_ParameterManager* manager);
@@ -0,0 +1,354 @@
+#include "PixelConvert.h"
+
+#include <cstring>
+
+#if defined(_M_X64) || defined(_M_AMD64) || defined(__x86_64__) || defined(__SSE2__)
+#define PIXELCONVERT_SSE2 1
+#include <emmintrin.h>
+#include <tmmintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#define PIXELCONVERT_TARGET_SSSE3
+#else
+#include <cpuid.h>
+#define PIXELCONVERT_TARGET_SSSE3 __attribute__((target("ssse3")))
+#endif
+#endif
+
+namespace PixelConvert
+{
+
+#if defined(PIXELCONVERT_SSE2)
+static bool cpuHasSsse3()
+{
+#if defined(_MSC_VER)
+    int info[4] = {};
+    __cpuid(info, 1);
+    return (info[2] & (1 << 9)) != 0;
+#else
+    unsigned a = 0, b = 0, c = 0, d = 0;
+    if (!__get_cpuid(1, &a, &b, &c, &d))
+        return false;
+    return (c & bit_SSSE3) != 0;
+#endif
+}
+
+static const bool kHasSsse3 = cpuHasSsse3();
+#endif
+
+void gray8ToRGBA8(const uint8_t* src, uint8_t* dst, size_t n)
+{
+    size_t i = 0;
+#if defined(PIXELCONVERT_SSE2)
+    const __m128i alpha = _mm_set1_epi16((short)0xFF00);
+    for (; i + 16 <= n; i += 16)
+    {
+        const __m128i g = _mm_loadu_si128((const __m128i*)(src + i));
+        // (g,g) pairs and (g,255) pairs, then interleave to g,g,g,255.
+        const __m128i gg_lo = _mm_unpacklo_epi8(g, g);
+        const __m128i gg_hi = _mm_unpackhi_epi8(g, g);
+        const __m128i ga_lo = _mm_or_si128(_mm_unpacklo_epi8(g, _mm_setzero_si128()), alpha);
+        const __m128i ga_hi = _mm_or_si128(_mm_unpackhi_epi8(g, _mm_setzero_si128()), alpha);
+        __m128i* out = (__m128i*)(dst + i * 4);
+        _mm_storeu_si128(out + 0, _mm_unpacklo_epi16(gg_lo, ga_lo));
+        _mm_storeu_si128(out + 1, _mm_unpackhi_epi16(gg_lo, ga_lo));
+        _mm_storeu_si128(out + 2, _mm_unpacklo_epi16(gg_hi, ga_hi));
+        _mm_storeu_si128(out + 3, _mm_unpackhi_epi16(gg_hi, ga_hi));
+    }
+#endif
+    for (; i < n; ++i)
+    {
+        const uint8_t g = src[i];
+        dst[i * 4 + 0] = g;
+        dst[i * 4 + 1] = g;
+        dst[i * 4 + 2] = g;
+        dst[i * 4 + 3] = 255;
+    }
+}
+
+void gray8ToGray16(const uint8_t* src, uint16_t* dst, size_t n)
+{
+    size_t i = 0;
+#if defined(PIXELCONVERT_SSE2)
+    for (; i + 16 <= n; i += 16)
+    {
+        const __m128i g = _mm_loadu_si128((const __m128i*)(src + i));
+        // (g << 8) | g == g * 257
+        _mm_storeu_si128((__m128i*)(dst + i), _mm_unpacklo_epi8(g, g));
+        _mm_storeu_si128((__m128i*)(dst + i + 8), _mm_unpackhi_epi8(g, g));
+    }
+#endif
+    for (; i < n; ++i)
+        dst[i] = (uint16_t)(src[i] * 257u);
+}
+
+#if defined(PIXELCONVERT_SSE2)
+// Four 16-bit mono lanes -> g,g,g,a RGBA16 (8 lanes in, 32 lanes out).
+static inline void storeGray16AsRGBA16(__m128i g, __m128i alpha, uint16_t* dst)
+{
+    const __m128i gg_lo = _mm_unpacklo_epi16(g, g);
+    const __m128i gg_hi = _mm_unpackhi_epi16(g, g);
+    const __m128i ga_lo = _mm_unpacklo_epi16(g, alpha);
+    const __m128i ga_hi = _mm_unpackhi_epi16(g, alpha);
+    __m128i* out = (__m128i*)dst;
+    _mm_storeu_si128(out + 0, _mm_unpacklo_epi32(gg_lo, ga_lo));
+    _mm_storeu_si128(out + 1, _mm_unpackhi_epi32(gg_lo, ga_lo));
+    _mm_storeu_si128(out + 2, _mm_unpacklo_epi32(gg_hi, ga_hi));
+    _mm_storeu_si128(out + 3, _mm_unpackhi_epi32(gg_hi, ga_hi));
+}
+#endif
+
+void gray8ToRGBA16(const uint8_t* src, uint16_t* dst, size_t n)
+{
+    size_t i = 0;
+#if defined(PIXELCONVERT_SSE2)
+    const __m128i alpha = _mm_set1_epi16((short)0xFFFF);
+    for (; i + 16 <= n; i += 16)
+    {
+        const __m128i g = _mm_loadu_si128((const __m128i*)(src + i));
+        storeGray16AsRGBA16(_mm_unpacklo_epi8(g, g), alpha, dst + i * 4);
+        storeGray16AsRGBA16(_mm_unpackhi_epi8(g, g), alpha, dst + i * 4 + 32);
+    }
+#endif
+    for (; i < n; ++i)
+    {
+        const uint16_t g = (uint16_t)(src[i] * 257u);
+        dst[i * 4 + 0] = g;
+        dst[i * 4 + 1] = g;
+        dst[i * 4 + 2] = g;
+        dst[i * 4 + 3] = 0xFFFF;
+    }
+}
+
+void gray16ToRGBA8(const uint16_t* src, uint8_t* dst, size_t n)
+{
+    size_t i = 0;
+#if defined(PIXELCONVERT_SSE2)
+    for (; i + 16 <= n; i += 16)
+    {
+        const __m128i a = _mm_srli_epi16(_mm_loadu_si128((const __m128i*)(src + i)), 8);
+        const __m128i b = _mm_srli_epi16(_mm_loadu_si128((const __m128i*)(src + i + 8)), 8);
+        const __m128i g = _mm_packus_epi16(a, b);
+        gray8ToRGBA8((const uint8_t*)&g, dst + i * 4, 16);
+    }
+#endif
+    for (; i < n; ++i)
+    {
+        const uint8_t g = (uint8_t)(src[i] >> 8);
+        dst[i * 4 + 0] = g;
+        dst[i * 4 + 1] = g;
+        dst[i * 4 + 2] = g;
+        dst[i * 4 + 3] = 255;
+    }
+}
+
+void gray16ToRGBA16(const uint16_t* src, uint16_t* dst, size_t n)
+{
+    size_t i = 0;
+#if defined(PIXELCONVERT_SSE2)
+    const __m128i alpha = _mm_set1_epi16((short)0xFFFF);
+    for (; i + 8 <= n; i += 8)
+        storeGray16AsRGBA16(_mm_loadu_si128((const __m128i*)(src + i)), alpha, dst + i * 4);
+#endif
+    for (; i < n; ++i)
+    {
+        const uint16_t g = src[i];
+        dst[i * 4 + 0] = g;
+        dst[i * 4 + 1] = g;
+        dst[i * 4 + 2] = g;
+        dst[i * 4 + 3] = 0xFFFF;
+    }
+}
+
+void rgba8ToGray16(const uint8_t* src, uint16_t* dst, size_t n)
+{
+    size_t i = 0;
+#if defined(PIXELCONVERT_SSE2)
+    const __m128i weights = _mm_setr_epi16(77, 150, 29, 0, 77, 150, 29, 0);
+    const __m128i zero = _mm_setzero_si128();
+    for (; i + 8 <= n; i += 8)
+    {
+        const __m128i a = _mm_loadu_si128((const __m128i*)(src + i * 4));
+        const __m128i b = _mm_loadu_si128((const __m128i*)(src + i * 4 + 16));
+        // Per pixel: (r*77 + g*150) and (b*29 + a*0) as 32-bit pairs, summed by the hadd below.
+        const __m128i s0 = _mm_madd_epi16(_mm_unpacklo_epi8(a, zero), weights);
+        const __m128i s1 = _mm_madd_epi16(_mm_unpackhi_epi8(a, zero), weights);
+        const __m128i s2 = _mm_madd_epi16(_mm_unpacklo_epi8(b, zero), weights);
+        const __m128i s3 = _mm_madd_epi16(_mm_unpackhi_epi8(b, zero), weights);
+        // Horizontal pair sums without SSSE3: shuffle partners next to each other and add.
+        const __m128i p01 = _mm_add_epi32(_mm_castps_si128(_mm_shuffle_ps(_mm_castsi128_ps(s0), _mm_castsi128_ps(s1), _MM_SHUFFLE(2, 0, 2, 0))),
+            _mm_castps_si128(_mm_shuffle_ps(_mm_castsi128_ps(s0), _mm_castsi128_ps(s1), _MM_SHUFFLE(3, 1, 3, 1))));
+        const __m128i p23 = _mm_add_epi32(_mm_castps_si128(_mm_shuffle_ps(_mm_castsi128_ps(s2), _mm_castsi128_ps(s3), _MM_SHUFFLE(2, 0, 2, 0))),
+            _mm_castps_si128(_mm_shuffle_ps(_mm_castsi128_ps(s2), _mm_castsi128_ps(s3), _MM_SHUFFLE(3, 1, 3, 1))));
+        // luma8 = sum >> 8 (max 255), then * 257 via (y << 8) | y.
+        const __m128i y = _mm_packs_epi32(_mm_srli_epi32(p01, 8), _mm_srli_epi32(p23, 8));
+        _mm_storeu_si128((__m128i*)(dst + i), _mm_or_si128(_mm_slli_epi16(y, 8), y));
+    }
+#endif
+    for (; i < n; ++i)
+    {
+        const unsigned y = (src[i * 4 + 0] * 77u + src[i * 4 + 1] * 150u + src[i * 4 + 2] * 29u) >> 8;
+        dst[i] = (uint16_t)(y * 257u);
+    }
+}
+
+void gray16ToGray8(const uint16_t* src, uint8_t* dst, size_t n)
+{
+    size_t i = 0;
+#if defined(PIXELCONVERT_SSE2)
+    for (; i + 16 <= n; i += 16)
+    {
+        const __m128i a = _mm_srli_epi16(_mm_loadu_si128((const __m128i*)(src + i)), 8);
+        const __m128i b = _mm_srli_epi16(_mm_loadu_si128((const __m128i*)(src + i + 8)), 8);
+        _mm_storeu_si128((__m128i*)(dst + i), _mm_packus_epi16(a, b));
+    }
+#endif
+    for (; i < n; ++i)
+        dst[i] = (uint8_t)(src[i] >> 8);
+}
+
+void rgba8ToGray8(const uint8_t* src, uint8_t* dst, size_t n)
+{
+    size_t i = 0;
+#if defined(PIXELCONVERT_SSE2)
+    const __m128i weights = _mm_setr_epi16(77, 150, 29, 0, 77, 150, 29, 0);
+    const __m128i zero = _mm_setzero_si128();
+    for (; i + 8 <= n; i += 8)
+    {
+        // Same pair sums as rgba8ToGray16, packed down to bytes instead of widened.
+        const __m128i a = _mm_loadu_si128((const __m128i*)(src + i * 4));
+        const __m128i b = _mm_loadu_si128((const __m128i*)(src + i * 4 + 16));
+        const __m128i s0 = _mm_madd_epi16(_mm_unpacklo_epi8(a, zero), weights);
+        const __m128i s1 = _mm_madd_epi16(_mm_unpackhi_epi8(a, zero), weights);
+        const __m128i s2 = _mm_madd_epi16(_mm_unpacklo_epi8(b, zero), weights);
+        const __m128i s3 = _mm_madd_epi16(_mm_unpackhi_epi8(b, zero), weights);
+        const __m128i p01 = _mm_add_epi32(_mm_castps_si128(_mm_shuffle_ps(_mm_castsi128_ps(s0), _mm_castsi128_ps(s1), _MM_SHUFFLE(2, 0, 2, 0))),
+            _mm_castps_si128(_mm_shuffle_ps(_mm_castsi128_ps(s0), _mm_castsi128_ps(s1), _MM_SHUFFLE(3, 1, 3, 1))));
+        const __m128i p23 = _mm_add_epi32(_mm_castps_si128(_mm_shuffle_ps(_mm_castsi128_ps(s2), _mm_castsi128_ps(s3), _MM_SHUFFLE(2, 0, 2, 0))),
+            _mm_castps_si128(_mm_shuffle_ps(_mm_castsi128_ps(s2), _mm_castsi128_ps(s3), _MM_SHUFFLE(3, 1, 3, 1))));
+        const __m128i y = _mm_packs_epi32(_mm_srli_epi32(p01, 8), _mm_srli_epi32(p23, 8));
+        _mm_storel_epi64((__m128i*)(dst + i), _mm_packus_epi16(y, y));
+    }
+#endif
+    for (; i < n; ++i)
+        dst[i] = (uint8_t)((src[i * 4 + 0] * 77u + src[i * 4 + 1] * 150u + src[i * 4 + 2] * 29u) >> 8);
+}
+
+void shiftLeft16(const uint16_t* src, uint16_t* dst, size_t n, int shift)
+{
+    if (shift <= 0)
+    {
+        if (src != dst)
+            std::memmove(dst, src, n * sizeof(uint16_t));
+        return;
+    }
+
+    size_t i = 0;
+#if defined(PIXELCONVERT_SSE2)
+    const __m128i cnt = _mm_cvtsi32_si128(shift);
+    for (; i + 8 <= n; i += 8)
+        _mm_storeu_si128((__m128i*)(dst + i), _mm_sll_epi16(_mm_loadu_si128((const __m128i*)(src + i)), cnt));
+#endif
+    for (; i < n; ++i)
+        dst[i] = (uint16_t)(src[i] << shift);
+}
+
+#if defined(PIXELCONVERT_SSE2)
+// 8 pixels from 12 bytes per iteration. Each 16-bit lane gathers the two bytes a
+// pixel straddles; even pixels keep the low 12 bits, odd pixels drop the low nibble.
+PIXELCONVERT_TARGET_SSSE3
+static size_t unpackMono12pSsse3(const uint8_t* src, uint16_t* dst, size_t n)
+{
+    const __m128i shuf = _mm_setr_epi8(0, 1, 1, 2, 3, 4, 4, 5, 6, 7, 7, 8, 9, 10, 10, 11);
+    const __m128i evenMask = _mm_setr_epi16(0x0FFF, 0, 0x0FFF, 0, 0x0FFF, 0, 0x0FFF, 0);
+
+    size_t i = 0;
+    // The 16-byte load reads 4 bytes past the 12 consumed; stop while that stays in bounds.
+    for (; i + 8 <= n && (i + 8) / 2 * 3 + 4 <= n / 2 * 3; i += 8)
+    {
+        const __m128i raw = _mm_loadu_si128((const __m128i*)(src + i / 2 * 3));
+        const __m128i v = _mm_shuffle_epi8(raw, shuf);
+        const __m128i even = _mm_and_si128(v, evenMask);
+        const __m128i odd = _mm_andnot_si128(evenMask, _mm_srli_epi16(v, 4));
+        _mm_storeu_si128((__m128i*)(dst + i), _mm_slli_epi16(_mm_or_si128(even, odd), 4));
+    }
+    return i;
+}
+#endif
+
+void unpackMono12p(const uint8_t* src, uint16_t* dst, size_t n)
+{
+    size_t i = 0;
+#if defined(PIXELCONVERT_SSE2)
+    if (kHasSsse3)
+        i = unpackMono12pSsse3(src, dst, n);
+#endif
+    for (; i + 2 <= n; i += 2)
+    {
+        const uint8_t* p = src + i / 2 * 3;
+        dst[i + 0] = (uint16_t)((p[0] | ((p[1] & 0x0F) << 8)) << 4);
+        dst[i + 1] = (uint16_t)(((p[1] >> 4) | (p[2] << 4)) << 4);
+    }
+    if (i < n)
+    {
+        const uint8_t* p = src + i / 2 * 3;
+        dst[i] = (uint16_t)((p[0] | ((p[1] & 0x0F) << 8)) << 4);
+    }
+}
+
+void unpackMono12Packed(const uint8_t* src, uint16_t* dst, size_t n)
+{
+    size_t i = 0;
+    for (; i + 2 <= n; i += 2)
+    {
+        const uint8_t* p = src + i / 2 * 3;
+        dst[i + 0] = (uint16_t)(((p[0] << 4) | (p[1] & 0x0F)) << 4);
+        dst[i + 1] = (uint16_t)(((p[2] << 4) | (p[1] >> 4)) << 4);
+    }
+    if (i < n)
+    {
+        const uint8_t* p = src + i / 2 * 3;
+        dst[i] = (uint16_t)(((p[0] << 4) | (p[1] & 0x0F)) << 4);
+    }
+}
+
+void unpackMono10p(const uint8_t* src, uint16_t* dst, size_t n)
+{
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4)
+    {
+        const uint8_t* p = src + i / 4 * 5;
+        const uint64_t bits = (uint64_t)p[0] | ((uint64_t)p[1] << 8) | ((uint64_t)p[2] << 16)
+            | ((uint64_t)p[3] << 24) | ((uint64_t)p[4] << 32);
+        dst[i + 0] = (uint16_t)(((bits >> 0) & 0x3FF) << 6);
+        dst[i + 1] = (uint16_t)(((bits >> 10) & 0x3FF) << 6);
+        dst[i + 2] = (uint16_t)(((bits >> 20) & 0x3FF) << 6);
+        dst[i + 3] = (uint16_t)(((bits >> 30) & 0x3FF) << 6);
+    }
+    // Tail: walk the bit stream one pixel at a time.
+    for (; i < n; ++i)
+    {
+        const size_t bit = i * 10;
+        const uint8_t* p = src + bit / 8;
+        const unsigned v = (unsigned)p[0] | ((unsigned)p[1] << 8);
+        dst[i] = (uint16_t)(((v >> (bit % 8)) & 0x3FF) << 6);
+    }
+}
+
+void unpackMono10Packed(const uint8_t* src, uint16_t* dst, size_t n)
+{
+    size_t i = 0;
+    for (; i + 2 <= n; i += 2)
+    {
+        const uint8_t* p = src + i / 2 * 3;
+        dst[i + 0] = (uint16_t)(((p[0] << 2) | (p[1] & 0x03)) << 6);
+        dst[i + 1] = (uint16_t)(((p[2] << 2) | ((p[1] >> 4) & 0x03)) << 6);
+    }
+    if (i < n)
+    {
+        const uint8_t* p = src + i / 2 * 3;
+        dst[i] = (uint16_t)(((p[0] << 2) | (p[1] & 0x03)) << 6);
+    }
+}
+
+}
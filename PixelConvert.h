@@ -0,0 +1,43 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+
+// Row conversion kernels for the capture and copy-out paths.
+//
+// All kernels work on 'n' pixels of one row and accept unaligned pointers. The
+// SSE2 paths handle 8 or 16 pixels per iteration with a scalar tail; SSE2 is part
+// of the x64 baseline, so no runtime dispatch is needed for them.
+namespace PixelConvert
+{
+    // 8-bit mono -> RGBA8 (alpha 255).
+    void gray8ToRGBA8(const uint8_t* src, uint8_t* dst, size_t n);
+
+    // 8-bit mono -> 16-bit mono / RGBA16, scaled by 257 so 255 maps to 65535.
+    void gray8ToGray16(const uint8_t* src, uint16_t* dst, size_t n);
+    void gray8ToRGBA16(const uint8_t* src, uint16_t* dst, size_t n);
+
+    // 16-bit mono -> RGBA8 (high byte) / RGBA16 (alpha 65535).
+    void gray16ToRGBA8(const uint16_t* src, uint8_t* dst, size_t n);
+    void gray16ToRGBA16(const uint16_t* src, uint16_t* dst, size_t n);
+
+    // RGBA8 -> 16-bit luma (BT.601 weights 77/150/29 per 256, scaled by 257).
+    void rgba8ToGray16(const uint8_t* src, uint16_t* dst, size_t n);
+
+    // 8-bit mono for analysis: high byte of 16-bit samples / RGBA8 luma (same weights).
+    void gray16ToGray8(const uint16_t* src, uint8_t* dst, size_t n);
+    void rgba8ToGray8(const uint8_t* src, uint8_t* dst, size_t n);
+
+    // Left-aligns N-bit samples stored in 16-bit words (dst = src << shift).
+    void shiftLeft16(const uint16_t* src, uint16_t* dst, size_t n, int shift);
+
+    // GenICam packed mono formats -> 16-bit, left-aligned to the full 16-bit range.
+    // Mono12p:      LSB-first bit stream, 2 px / 3 bytes (SSSE3 when available).
+    // Mono12Packed: GigE Vision legacy, 2 px / 3 bytes, shared middle byte of low nibbles.
+    // Mono10p:      LSB-first bit stream, 4 px / 5 bytes.
+    // Mono10Packed: GigE Vision legacy, 2 px / 3 bytes, shared middle byte of low bits.
+    void unpackMono12p(const uint8_t* src, uint16_t* dst, size_t n);
+    void unpackMono12Packed(const uint8_t* src, uint16_t* dst, size_t n);
+    void unpackMono10p(const uint8_t* src, uint16_t* dst, size_t n);
+    void unpackMono10Packed(const uint8_t* src, uint16_t* dst, size_t n);
+}
@@ -0,0 +1,355 @@
+#include "SharedFrames.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+
+#if defined(_WIN32)
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace SharedFrames
+{
+
+static const size_t kPage = 4096;
+
+static size_t roundUp(size_t v, size_t to)
+{
+    return (v + to - 1) / to * to;
+}
+
+std::string directoryName(const std::string& prefix, int camIdx)
+{
+#if defined(_WIN32)
+    return "Local\\" + prefix + ".cam" + std::to_string(camIdx);
+#else
+    return "/" + prefix + ".cam" + std::to_string(camIdx);
+#endif
+}
+
+std::string manifestName(const std::string& prefix)
+{
+#if defined(_WIN32)
+    return "Local\\" + prefix + ".manifest";
+#else
+    return "/" + prefix + ".manifest";
+#endif
+}
+
+std::string ringName(const std::string& prefix, int camIdx, uint32_t generation)
+{
+    return directoryName(prefix, camIdx) + ".g" + std::to_string(generation);
+}
+
+uint64_t nowNs()
+{
+    return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// --- Mapping ---------------------------------------------------------------------
+
+bool Mapping::create(const std::string& name, size_t bytes, bool exclusive)
+{
+    close();
+#if defined(_WIN32)
+    // Sections live while anyone maps them; an old reader can keep a name alive.
+    const unsigned long long size = bytes;
+    HANDLE h = CreateFileMappingA(INVALID_HANDLE_VALUE, nullptr, PAGE_READWRITE,
+        (DWORD)(size >> 32), (DWORD)(size & 0xffffffffu), name.c_str());
+    if (h && exclusive && GetLastError() == ERROR_ALREADY_EXISTS)
+    {
+        CloseHandle(h);
+        return false;
+    }
+    if (!h)
+        return false;
+    void* p = MapViewOfFile(h, FILE_MAP_ALL_ACCESS, 0, 0, bytes);
+    if (!p)
+    {
+        CloseHandle(h);
+        return false;
+    }
+    _handle = h;
+#else
+    if (exclusive)
+        shm_unlink(name.c_str());   // a crashed publisher may have left one behind
+    const int fd = shm_open(name.c_str(), O_CREAT | O_RDWR | (exclusive ? O_EXCL : 0), 0644);
+    if (fd < 0)
+        return false;
+    struct stat st = {};
+    void* p = MAP_FAILED;
+    if (fstat(fd, &st) == 0 && ((size_t)st.st_size >= bytes || ftruncate(fd, (off_t)bytes) == 0))
+        p = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (p == MAP_FAILED)
+    {
+        if (exclusive)
+            shm_unlink(name.c_str());
+        return false;
+    }
+    if (exclusive)
+        _unlinkName = name;
+#endif
+    // New mappings are zero-filled by the OS.
+    _base = static_cast<uint8_t*>(p);
+    _bytes = bytes;
+    return true;
+}
+
+bool Mapping::open(const std::string& name, bool writable)
+{
+    close();
+#if defined(_WIN32)
+    HANDLE h = OpenFileMappingA(writable ? FILE_MAP_ALL_ACCESS : FILE_MAP_READ, FALSE, name.c_str());
+    if (!h)
+        return false;
+    void* p = MapViewOfFile(h, writable ? FILE_MAP_ALL_ACCESS : FILE_MAP_READ, 0, 0, 0);
+    MEMORY_BASIC_INFORMATION mbi = {};
+    if (!p || VirtualQuery(p, &mbi, sizeof(mbi)) == 0)
+    {
+        if (p)
+            UnmapViewOfFile(p);
+        CloseHandle(h);
+        return false;
+    }
+    _handle = h;
+    _bytes = mbi.RegionSize;
+#else
+    const int fd = shm_open(name.c_str(), writable ? O_RDWR : O_RDONLY, 0);
+    if (fd < 0)
+        return false;
+    struct stat st = {};
+    void* p = MAP_FAILED;
+    if (fstat(fd, &st) == 0 && st.st_size > 0)
+        p = mmap(nullptr, (size_t)st.st_size, writable ? PROT_READ | PROT_WRITE : PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (p == MAP_FAILED)
+        return false;
+    _bytes = (size_t)st.st_size;
+#endif
+    _base = static_cast<uint8_t*>(p);
+    return true;
+}
+
+void Mapping::close()
+{
+    if (!_base)
+        return;
+#if defined(_WIN32)
+    UnmapViewOfFile(_base);
+    CloseHandle(static_cast<HANDLE>(_handle));
+#else
+    munmap(_base, _bytes);
+    if (!_unlinkName.empty())
+        shm_unlink(_unlinkName.c_str());   // readers keep their mapping until they let go
+#endif
+    _base = nullptr;
+    _bytes = 0;
+    _handle = nullptr;
+    _unlinkName.clear();
+}
+
+// --- Writer ----------------------------------------------------------------------
+
+bool Writer::open(const std::string& prefix, int camIdx, int slotCount)
+{
+    close();
+    _prefix = prefix;
+    _camIdx = camIdx;
+    _slotCount = std::max(2, slotCount);
+    // The directory outlives publishers so readers that wait on it see the next one.
+    if (!_dir.create(directoryName(prefix, camIdx), sizeof(Directory), false))
+        return false;
+
+    Directory* dir = reinterpret_cast<Directory*>(_dir.data());
+    if (dir->magic != kMagic || dir->version != kVersion)
+        dir->lastGeneration = 0;
+    dir->magic = kMagic;
+    dir->version = kVersion;
+    dir->camIdx = (uint32_t)camIdx;
+    dir->generation.store(0, std::memory_order_release);
+    _generation = dir->lastGeneration;
+    return true;
+}
+
+void Writer::close()
+{
+    if (_dir.data())
+        reinterpret_cast<Directory*>(_dir.data())->generation.store(0, std::memory_order_release);
+    _ring.close();
+    _dir.close();
+    _frame = 0;
+}
+
+bool Writer::newGeneration(size_t slotBytes)
+{
+    Directory* dir = reinterpret_cast<Directory*>(_dir.data());
+    dir->generation.store(0, std::memory_order_release);
+    _ring.close();
+
+    const size_t headerBytes = roundUp(sizeof(RingHeader) + sizeof(SlotHeader) * (size_t)_slotCount, kPage);
+    slotBytes = roundUp(slotBytes, kPage);
+    // Skip names an old reader still holds open with a different size.
+    uint32_t gen = _generation;
+    bool created = false;
+    for (int attempt = 0; attempt < 16 && !created; ++attempt)
+    {
+        gen = gen + 1 == 0 ? 1 : gen + 1;
+        created = _ring.create(ringName(_prefix, _camIdx, gen), headerBytes + slotBytes * (size_t)_slotCount, true);
+    }
+    dir->lastGeneration = gen;
+    _generation = gen;
+    if (!created)
+        return false;
+
+    RingHeader* rh = reinterpret_cast<RingHeader*>(_ring.data());
+    rh->magic = kMagic;
+    rh->version = kVersion;
+    rh->generation = gen;
+    rh->slotCount = (uint32_t)_slotCount;
+    rh->slotBytes = slotBytes;
+    rh->dataOffset = headerBytes;
+    rh->latest.store(0, std::memory_order_relaxed);
+    SlotHeader* slots = reinterpret_cast<SlotHeader*>(rh + 1);
+    for (int i = 0; i < _slotCount; ++i)
+        slots[i].seq.store(0, std::memory_order_relaxed);
+
+    _frame = 0;
+    dir->generation.store(gen, std::memory_order_release);
+    return true;
+}
+
+bool Writer::publish(const uint8_t* pixels, uint32_t width, uint32_t height, uint32_t stride,
+    PixelFormat format, uint64_t timestampNs)
+{
+    if (!isOpen() || !pixels)
+        return false;
+
+    const size_t bytes = (size_t)stride * height;
+    RingHeader* rh = reinterpret_cast<RingHeader*>(_ring.data());
+    if (!rh || bytes > rh->slotBytes)
+    {
+        if (!newGeneration(bytes))
+            return false;
+        rh = reinterpret_cast<RingHeader*>(_ring.data());
+    }
+
+    const uint64_t frame = ++_frame;
+    SlotHeader& slot = reinterpret_cast<SlotHeader*>(rh + 1)[frame % rh->slotCount];
+    uint8_t* dst = _ring.data() + rh->dataOffset + (size_t)(frame % rh->slotCount) * rh->slotBytes;
+
+    // Seqlock: odd while the slot is rewritten, even (2 * frame) once it is whole again.
+    slot.seq.store(2 * frame - 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    slot.frameNumber = frame;
+    slot.timestampNs = timestampNs;
+    slot.bytes = bytes;
+    slot.width = width;
+    slot.height = height;
+    slot.stride = stride;
+    slot.format = (uint32_t)format;
+    std::memcpy(dst, pixels, bytes);
+    slot.seq.store(2 * frame, std::memory_order_release);
+
+    rh->latest.store(frame, std::memory_order_release);
+    return true;
+}
+
+// --- Reader ----------------------------------------------------------------------
+
+bool Reader::open(const std::string& prefix, int camIdx)
+{
+    close();
+    _prefix = prefix;
+    _camIdx = camIdx;
+    if (!_dir.open(directoryName(prefix, camIdx), false))
+        return false;
+
+    const Directory* dir = reinterpret_cast<const Directory*>(_dir.data());
+    if (_dir.size() < sizeof(Directory) || dir->magic != kMagic || dir->version != kVersion)
+    {
+        _dir.close();
+        return false;
+    }
+    return true;
+}
+
+void Reader::close()
+{
+    _ring.close();
+    _dir.close();
+    _generation = 0;
+}
+
+bool Reader::followGeneration()
+{
+    const Directory* dir = reinterpret_cast<const Directory*>(_dir.data());
+    const uint32_t gen = dir->generation.load(std::memory_order_acquire);
+    if (gen == _generation && _ring.data())
+        return true;
+
+    _ring.close();
+    _generation = 0;
+    if (gen == 0 || !_ring.open(ringName(_prefix, _camIdx, gen), false))
+        return false;
+
+    const RingHeader* rh = reinterpret_cast<const RingHeader*>(_ring.data());
+    if (_ring.size() < sizeof(RingHeader) || rh->magic != kMagic || rh->version != kVersion ||
+        rh->dataOffset + rh->slotBytes * rh->slotCount > _ring.size())
+    {
+        _ring.close();
+        return false;
+    }
+    _generation = gen;
+    return true;
+}
+
+bool Reader::latest(Frame& out, const Frame* after)
+{
+    if (!isOpen() || !followGeneration())
+        return false;
+
+    const RingHeader* rh = reinterpret_cast<const RingHeader*>(_ring.data());
+    const uint64_t frame = rh->latest.load(std::memory_order_acquire);
+    if (frame == 0 || (after && after->generation == _generation && after->frameNumber >= frame))
+        return false;
+
+    const SlotHeader& slot = reinterpret_cast<const SlotHeader*>(rh + 1)[frame % rh->slotCount];
+    const uint64_t seq = slot.seq.load(std::memory_order_acquire);
+    if (seq != 2 * frame)
+        return false;   // already being reused: the writer is a lap ahead
+
+    Frame f;
+    f.data = _ring.data() + rh->dataOffset + (size_t)(frame % rh->slotCount) * rh->slotBytes;
+    f.width = slot.width;
+    f.height = slot.height;
+    f.stride = slot.stride;
+    f.format = (PixelFormat)slot.format;
+    f.bytes = slot.bytes;
+    f.frameNumber = slot.frameNumber;
+    f.timestampNs = slot.timestampNs;
+    f.generation = _generation;
+    f.slot = &slot;
+    f.seq = seq;
+    if (!stillValid(f) || f.bytes > rh->slotBytes)
+        return false;
+
+    out = f;
+    return true;
+}
+
+bool Reader::stillValid(const Frame& f) const
+{
+    if (!f.slot || f.generation != _generation)
+        return false;
+    std::atomic_thread_fence(std::memory_order_acquire);
+    return f.slot->seq.load(std::memory_order_relaxed) == f.seq;
+}
+
+}
@@ -0,0 +1,184 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// Per-camera frame rings in shared memory, for tracking/recording processes that
+// want frames without going through TouchDesigner.
+//
+// Each camera has a small directory mapping "<prefix>.cam<N>" that names the current
+// ring generation, and the ring itself, "<prefix>.cam<N>.g<gen>". A new generation is
+// created when frames outgrow the ring's slots (format change); readers follow it on
+// their next call. Slots are guarded by a seqlock, so the writer never waits for
+// readers and readers never lock: a reader takes a pointer straight into the mapping
+// and checks afterwards that the slot wasn't reused while it looked.
+//
+// Windows uses named file mappings ("Local\" namespace), other platforms POSIX shm.
+// This header and SharedFrames.cpp have no MIL or TouchDesigner dependency; reader
+// processes compile just these two files.
+namespace SharedFrames
+{
+    constexpr uint32_t kMagic = 0x46514947;   // "GIQF"
+    constexpr uint32_t kVersion = 1;
+
+    enum class PixelFormat : uint32_t
+    {
+        None = 0,
+        Mono8 = 1,
+        Mono16 = 2,     // samples left-aligned to 16 bits
+        RGBA8 = 3,      // demosaiced Bayer cameras
+    };
+
+    static_assert(std::atomic<uint64_t>::is_always_lock_free, "shared atomics must be address-free");
+    static_assert(std::atomic<uint32_t>::is_always_lock_free, "shared atomics must be address-free");
+
+    // "<prefix>.cam<N>": which ring generation is live (0 = export stopped).
+    struct alignas(64) Directory
+    {
+        uint32_t magic;
+        uint32_t version;
+        uint32_t camIdx;
+        std::atomic<uint32_t> generation;
+        uint32_t lastGeneration;    // writer bookkeeping: ring names are never reused
+    };
+
+    struct alignas(64) SlotHeader
+    {
+        std::atomic<uint64_t> seq;  // 2*frameNumber when complete, odd while written, 0 = never
+        uint64_t frameNumber;       // 1, 2, 3... per ring
+        uint64_t timestampNs;       // publisher's steady clock (QPC / CLOCK_MONOTONIC)
+        uint64_t bytes;
+        uint32_t width;
+        uint32_t height;
+        uint32_t stride;            // bytes per row
+        uint32_t format;            // PixelFormat
+    };
+
+    // "<prefix>.cam<N>.g<gen>": header, slotCount SlotHeaders, then page-aligned slot data.
+    struct alignas(64) RingHeader
+    {
+        uint32_t magic;
+        uint32_t version;
+        uint32_t generation;
+        uint32_t slotCount;
+        uint64_t slotBytes;         // capacity of each slot
+        uint64_t dataOffset;        // from the start of the mapping to slot 0
+        std::atomic<uint64_t> latest;   // newest complete frameNumber (0 = none yet)
+    };
+
+    // "<prefix>.manifest": published by a capture daemon (daemon/CaptureDaemon.cpp) so
+    // clients know how many cameras it serves and that it is still alive.
+    struct alignas(64) Manifest
+    {
+        uint32_t magic;
+        uint32_t version;
+        uint32_t pid;
+        std::atomic<uint32_t> cameraCount;
+        std::atomic<uint64_t> heartbeatNs;  // nowNs() of the daemon's last service pass
+    };
+
+    // A named shared-memory mapping (platform handle kept opaque).
+    class Mapping
+    {
+    public:
+        Mapping() = default;
+        ~Mapping() { close(); }
+        Mapping(const Mapping&) = delete;
+        Mapping& operator=(const Mapping&) = delete;
+
+        // 'exclusive' fails (Windows) or replaces (POSIX) an existing mapping of that
+        // name and removes the name again on close; otherwise an existing one is reused.
+        bool create(const std::string& name, size_t bytes, bool exclusive);
+        bool open(const std::string& name, bool writable);
+        void close();
+
+        uint8_t* data() const { return _base; }
+        size_t size() const { return _bytes; }
+
+    private:
+        uint8_t* _base = nullptr;
+        size_t _bytes = 0;
+        void* _handle = nullptr;    // HANDLE on Windows
+        std::string _unlinkName;    // POSIX: creator removes the name on close
+    };
+
+    // Publisher side; one per camera. Not thread-safe: call from one thread at a time.
+    class Writer
+    {
+    public:
+        bool open(const std::string& prefix, int camIdx, int slotCount);
+        void close();
+        bool isOpen() const { return _dir.data() != nullptr; }
+
+        // Copies one frame into the next slot. Starts a new ring generation when the
+        // frame doesn't fit the current slots. Returns false if shared memory failed.
+        bool publish(const uint8_t* pixels, uint32_t width, uint32_t height, uint32_t stride,
+            PixelFormat format, uint64_t timestampNs);
+
+    private:
+        bool newGeneration(size_t slotBytes);
+
+        std::string _prefix;
+        int _camIdx = 0;
+        int _slotCount = 4;
+        uint32_t _generation = 0;
+        uint64_t _frame = 0;
+        Mapping _dir;
+        Mapping _ring;
+    };
+
+    // Consumer side. Frames are views into shared memory: no copy is made.
+    class Reader
+    {
+    public:
+        struct Frame
+        {
+            const uint8_t* data = nullptr;
+            uint32_t width = 0;
+            uint32_t height = 0;
+            uint32_t stride = 0;
+            PixelFormat format = PixelFormat::None;
+            uint64_t bytes = 0;
+            uint64_t frameNumber = 0;
+            uint64_t timestampNs = 0;
+            uint32_t generation = 0;    // frame numbers restart with each generation
+
+        private:
+            friend class Reader;
+            const SlotHeader* slot = nullptr;
+            uint64_t seq = 0;
+        };
+
+        // False until a publisher has exported this camera; retry later.
+        bool open(const std::string& prefix, int camIdx);
+        void close();
+        bool isOpen() const { return _dir.data() != nullptr; }
+
+        // Newest complete frame, if it is not 'after' (pass the last frame you handled
+        // to poll for new ones). Follows ring generations transparently.
+        bool latest(Frame& out, const Frame* after = nullptr);
+
+        // True if the writer has not started overwriting the frame's slot. Check after
+        // consuming the pixels and drop the result if it fails (the ring lapped you).
+        bool stillValid(const Frame& f) const;
+
+    private:
+        bool followGeneration();
+
+        std::string _prefix;
+        int _camIdx = 0;
+        uint32_t _generation = 0;
+        Mapping _dir;
+        Mapping _ring;
+    };
+
+    // "<prefix>.cam<N>" and "<prefix>.cam<N>.g<gen>", with the platform's namespace.
+    std::string directoryName(const std::string& prefix, int camIdx);
+    std::string manifestName(const std::string& prefix);
+    std::string ringName(const std::string& prefix, int camIdx, uint32_t generation);
+
+    // The clock publishers stamp frames with, for latency measurements in readers.
+    uint64_t nowNs();
+}
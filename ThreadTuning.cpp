@@ -0,0 +1,144 @@
+#include "ThreadTuning.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+#include <sstream>
+
+#if defined(_WIN32)
+#include <Windows.h>
+#endif
+
+namespace ThreadTuning
+{
+
+bool parseCpuSet(const std::string& text, CpuSet& out, std::string& err)
+{
+    out = CpuSet();
+    err.clear();
+
+    std::string s;
+    for (char c : text)
+        if (!std::isspace((unsigned char)c))
+            s.push_back((char)std::tolower((unsigned char)c));
+    if (s.empty())
+        return true;
+
+    if (s.compare(0, 5, "numa:") == 0)
+    {
+        char* end = nullptr;
+        const long node = std::strtol(s.c_str() + 5, &end, 10);
+        if (end == s.c_str() + 5 || *end != '\0' || node < 0)
+        {
+            err = "bad NUMA node in '" + text + "'";
+            return false;
+        }
+        out.numaNode = (int)node;
+        return true;
+    }
+
+    std::istringstream in(s);
+    std::string item;
+    while (std::getline(in, item, ','))
+    {
+        char* end = nullptr;
+        const long lo = std::strtol(item.c_str(), &end, 10);
+        long hi = lo;
+        if (end != item.c_str() && *end == '-')
+        {
+            const char* rest = end + 1;
+            hi = std::strtol(rest, &end, 10);
+            if (end == rest)
+                end = nullptr;
+        }
+        if (!end || end == item.c_str() || *end != '\0' || lo < 0 || hi < lo || hi > 1023)
+        {
+            err = "bad core list '" + text + "' (use e.g. 4-11,16 or numa:1)";
+            out = CpuSet();
+            return false;
+        }
+        for (long c = lo; c <= hi; ++c)
+            out.cores.push_back((int)c);
+    }
+    return true;
+}
+
+bool pinCurrentThread(const CpuSet& cpus, int slot)
+{
+#if !defined(_WIN32)
+    // Placement is Windows-only; elsewhere only "no pinning" succeeds.
+    (void)slot;
+    return cpus.empty();
+#else
+    GROUP_AFFINITY ga = {};
+
+    if (cpus.numaNode >= 0)
+    {
+        if (!GetNumaNodeProcessorMaskEx((USHORT)cpus.numaNode, &ga))
+            return false;
+    }
+    else if (!cpus.cores.empty())
+    {
+        // Windows numbers logical processors per group of 64.
+        const int core = cpus.cores[(size_t)std::max(0, slot) % cpus.cores.size()];
+        ga.Group = (WORD)(core / 64);
+        ga.Mask = (uintptr_t)1 << (core % 64);
+    }
+    else
+    {
+        // No pinning: back to the process-wide mask (group 0 covers up to 64 cores).
+        DWORD_PTR processMask = 0, systemMask = 0;
+        if (!GetProcessAffinityMask(GetCurrentProcess(), &processMask, &systemMask))
+            return false;
+        return SetThreadAffinityMask(GetCurrentThread(), processMask) != 0;
+    }
+
+    return SetThreadGroupAffinity(GetCurrentThread(), &ga, nullptr) != 0;
+#endif
+}
+
+bool setCurrentThreadPriority(Priority p)
+{
+#if !defined(_WIN32)
+    return p == Priority::Normal;
+#else
+    int level = 0;   // THREAD_PRIORITY_NORMAL
+    switch (p)
+    {
+    case Priority::High:         level = THREAD_PRIORITY_HIGHEST; break;
+    case Priority::TimeCritical: level = THREAD_PRIORITY_TIME_CRITICAL; break;
+    case Priority::Normal:
+    default:                     break;
+    }
+    return SetThreadPriority(GetCurrentThread(), level) != 0;
+#endif
+}
+
+void LatencyStats::add(double us)
+{
+    const auto now = std::chrono::steady_clock::now();
+    std::lock_guard<std::mutex> lk(_mtx);
+
+    if (now - _start >= std::chrono::seconds(1))
+    {
+        _last.count = _count;
+        _last.meanUs = _count ? _sumUs / (double)_count : 0.0;
+        _last.maxUs = _maxUs;
+        _count = 0;
+        _sumUs = 0.0;
+        _maxUs = 0.0;
+        _start = now;
+    }
+
+    ++_count;
+    _sumUs += us;
+    _maxUs = std::max(_maxUs, us);
+}
+
+LatencyStats::Window LatencyStats::last() const
+{
+    std::lock_guard<std::mutex> lk(_mtx);
+    return _last;
+}
+
+}
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// CPU placement, priority and latency bookkeeping for capture-side threads
+// (MIL processing hooks and WorkerPool workers).
+namespace ThreadTuning
+{
+    // Where a set of threads may run. Either explicit cores (thread N gets
+    // cores[N % size], so threads spread one per core) or a whole NUMA node.
+    struct CpuSet
+    {
+        std::vector<int> cores;
+        int numaNode = -1;
+
+        bool empty() const { return cores.empty() && numaNode < 0; }
+        bool operator==(const CpuSet& o) const { return cores == o.cores && numaNode == o.numaNode; }
+        bool operator!=(const CpuSet& o) const { return !(*this == o); }
+    };
+
+    enum class Priority
+    {
+        Normal,
+        High,           // THREAD_PRIORITY_HIGHEST
+        TimeCritical,   // THREAD_PRIORITY_TIME_CRITICAL (real-time band under REALTIME_PRIORITY_CLASS)
+    };
+
+    // Parses "" (no pinning), "4-11,16" (core list with ranges) or "numa:1".
+    // Returns false and fills 'err' on malformed input.
+    bool parseCpuSet(const std::string& text, CpuSet& out, std::string& err);
+
+    // Pins the calling thread; 'slot' picks the core from an explicit list.
+    // An empty set restores the process affinity. Returns false if the OS refused.
+    bool pinCurrentThread(const CpuSet& cpus, int slot);
+
+    bool setCurrentThreadPriority(Priority p);
+
+    // Applies both; returns false if either failed.
+    inline bool tuneCurrentThread(const CpuSet& cpus, int slot, Priority p)
+    {
+        const bool pinned = pinCurrentThread(cpus, slot);
+        return setCurrentThreadPriority(p) && pinned;
+    }
+
+    // Latency samples of one thread, published in one-second windows so any number
+    // of readers see the same numbers without resetting them for each other.
+    class LatencyStats
+    {
+    public:
+        struct Window
+        {
+            uint64_t count = 0;
+            double meanUs = 0.0;
+            double maxUs = 0.0;
+        };
+
+        void add(double us);
+        Window last() const;    // most recently completed window
+
+    private:
+        mutable std::mutex _mtx;
+        std::chrono::steady_clock::time_point _start = std::chrono::steady_clock::now();
+        uint64_t _count = 0;
+        double _sumUs = 0.0;
+        double _maxUs = 0.0;
+        Window _last;
+    };
+}
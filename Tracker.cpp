@@ -0,0 +1,391 @@
+#include "Tracker.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#if defined(_M_X64) || defined(_M_AMD64) || defined(__x86_64__) || defined(__SSE2__)
+#define TRACKER_SSE2 1
+#include <emmintrin.h>
+#endif
+
+namespace Tracker
+{
+
+static const double kForbidden = 1e9;   // cost of a pair outside the gate within a cluster
+
+void MultiTracker::reset()
+{
+    for (auto* v : { &_x, &_y, &_vx, &_vy, &_p00, &_p01, &_p11 })
+        v->clear();
+    _id.clear();
+    _hits.clear();
+    _misses.clear();
+    _age.clear();
+    _match.clear();
+    _lastNs = 0;
+}
+
+uint32_t MultiTracker::find(uint32_t a)
+{
+    while (_parent[a] != a)
+    {
+        _parent[a] = _parent[_parent[a]];
+        a = _parent[a];
+    }
+    return a;
+}
+
+void MultiTracker::predict(float dt, const Params& p)
+{
+    // x' = x + v dt; P' = F P F^T + q [dt^3/3 dt^2/2; dt^2/2 dt] (white acceleration).
+    const float q = p.accelSigma * p.accelSigma;
+    const float q00 = q * dt * dt * dt / 3.0f, q01 = q * dt * dt / 2.0f, q11 = q * dt;
+    const size_t n = _id.size();
+    float* x = _x.data();
+    float* y = _y.data();
+    const float* vx = _vx.data();
+    const float* vy = _vy.data();
+    float* p00 = _p00.data();
+    float* p01 = _p01.data();
+    float* p11 = _p11.data();
+    size_t i = 0;
+#if defined(TRACKER_SSE2)
+    const __m128 vdt = _mm_set1_ps(dt), two = _mm_set1_ps(2.0f);
+    const __m128 vq00 = _mm_set1_ps(q00), vq01 = _mm_set1_ps(q01), vq11 = _mm_set1_ps(q11);
+    for (; i + 4 <= n; i += 4)
+    {
+        _mm_storeu_ps(x + i, _mm_add_ps(_mm_loadu_ps(x + i), _mm_mul_ps(_mm_loadu_ps(vx + i), vdt)));
+        _mm_storeu_ps(y + i, _mm_add_ps(_mm_loadu_ps(y + i), _mm_mul_ps(_mm_loadu_ps(vy + i), vdt)));
+        const __m128 a = _mm_loadu_ps(p00 + i), b = _mm_loadu_ps(p01 + i), c = _mm_loadu_ps(p11 + i);
+        const __m128 cdt = _mm_mul_ps(vdt, c);
+        _mm_storeu_ps(p00 + i, _mm_add_ps(_mm_add_ps(a, _mm_mul_ps(vdt, _mm_add_ps(_mm_mul_ps(two, b), cdt))), vq00));
+        _mm_storeu_ps(p01 + i, _mm_add_ps(_mm_add_ps(b, cdt), vq01));
+        _mm_storeu_ps(p11 + i, _mm_add_ps(c, vq11));
+    }
+#endif
+    for (; i < n; ++i)
+    {
+        x[i] += vx[i] * dt;
+        y[i] += vy[i] * dt;
+        p00[i] += dt * (2.0f * p01[i] + dt * p11[i]) + q00;
+        p01[i] += dt * p11[i] + q01;
+        p11[i] += q11;
+    }
+}
+
+void MultiTracker::gate(const Detection* dets, int count, const Params& p)
+{
+    // Innovation covariance is S = p00 + r on both axes, so the squared Mahalanobis
+    // distance is |z - x|^2 / S. Cost = d^2 + 2 ln S is the pair's negative
+    // log-likelihood up to a constant, comparable across tracks of different certainty.
+    const float r = p.measurementSigma * p.measurementSigma;
+    const float gate2 = p.gateSigma * p.gateSigma;
+    _edges.clear();
+    _d2.resize((size_t)count);
+    _dx.resize((size_t)count);
+    _dy.resize((size_t)count);
+    for (int j = 0; j < count; ++j)
+    {
+        _dx[j] = dets[j].x;
+        _dy[j] = dets[j].y;
+    }
+
+    const size_t n = _id.size();
+    const float* dx = _dx.data();
+    const float* dy = _dy.data();
+    float* d2 = _d2.data();
+    for (size_t i = 0; i < n; ++i)
+    {
+        const float tx = _x[i], ty = _y[i];
+        const float s = _p00[i] + r;
+        const float invS = 1.0f / s;
+        int j = 0;
+#if defined(TRACKER_SSE2)
+        const __m128 vtx = _mm_set1_ps(tx), vty = _mm_set1_ps(ty), vinv = _mm_set1_ps(invS);
+        for (; j + 4 <= count; j += 4)
+        {
+            const __m128 ex = _mm_sub_ps(_mm_loadu_ps(dx + j), vtx);
+            const __m128 ey = _mm_sub_ps(_mm_loadu_ps(dy + j), vty);
+            _mm_storeu_ps(d2 + j, _mm_mul_ps(_mm_add_ps(_mm_mul_ps(ex, ex), _mm_mul_ps(ey, ey)), vinv));
+        }
+#endif
+        for (; j < count; ++j)
+        {
+            const float ex = dx[j] - tx, ey = dy[j] - ty;
+            d2[j] = (ex * ex + ey * ey) * invS;
+        }
+        const float logS2 = 2.0f * std::log(s);
+        for (int j = 0; j < count; ++j)
+            if (d2[j] <= gate2)
+                _edges.push_back(Edge{ (int)i, j, d2[j] + logS2 });
+    }
+}
+
+void MultiTracker::solveCluster(const std::vector<int>& edges)
+{
+    // Local rows (tracks) and columns (detections) of this cluster.
+    _rows.clear();
+    _cols.clear();
+    for (int e : edges)
+    {
+        _rows.push_back(_edges[e].track);
+        _cols.push_back(_edges[e].det);
+    }
+    std::sort(_rows.begin(), _rows.end());
+    _rows.erase(std::unique(_rows.begin(), _rows.end()), _rows.end());
+    std::sort(_cols.begin(), _cols.end());
+    _cols.erase(std::unique(_cols.begin(), _cols.end()), _cols.end());
+
+    // The solver below needs rows <= columns; transpose otherwise.
+    const bool transposed = _rows.size() > _cols.size();
+    const int n = (int)(transposed ? _cols.size() : _rows.size());
+    const int m = (int)(transposed ? _rows.size() : _cols.size());
+    _cost.assign((size_t)n * m, kForbidden);
+    for (int e : edges)
+    {
+        const int r = (int)(std::lower_bound(_rows.begin(), _rows.end(), _edges[e].track) - _rows.begin());
+        const int c = (int)(std::lower_bound(_cols.begin(), _cols.end(), _edges[e].det) - _cols.begin());
+        if (transposed)
+            _cost[(size_t)c * m + r] = _edges[e].cost;
+        else
+            _cost[(size_t)r * m + c] = _edges[e].cost;
+    }
+
+    // Hungarian method, shortest augmenting paths with potentials: O(n^2 m).
+    // 1-based, row 0 / column 0 are the virtual start.
+    const double inf = std::numeric_limits<double>::infinity();
+    _u.assign((size_t)n + 1, 0.0);
+    _v.assign((size_t)m + 1, 0.0);
+    _p.assign((size_t)m + 1, 0);
+    _way.assign((size_t)m + 1, 0);
+    for (int i = 1; i <= n; ++i)
+    {
+        _p[0] = i;
+        int j0 = 0;
+        _minv.assign((size_t)m + 1, inf);
+        _used.assign((size_t)m + 1, 0);
+        do
+        {
+            _used[j0] = 1;
+            const int i0 = _p[j0];
+            double delta = inf;
+            int j1 = 0;
+            for (int j = 1; j <= m; ++j)
+            {
+                if (_used[j])
+                    continue;
+                const double cur = _cost[(size_t)(i0 - 1) * m + (j - 1)] - _u[i0] - _v[j];
+                if (cur < _minv[j])
+                {
+                    _minv[j] = cur;
+                    _way[j] = j0;
+                }
+                if (_minv[j] < delta)
+                {
+                    delta = _minv[j];
+                    j1 = j;
+                }
+            }
+            for (int j = 0; j <= m; ++j)
+            {
+                if (_used[j])
+                {
+                    _u[_p[j]] += delta;
+                    _v[j] -= delta;
+                }
+                else
+                    _minv[j] -= delta;
+            }
+            j0 = j1;
+        } while (_p[j0] != 0);
+        do
+        {
+            const int j1 = _way[j0];
+            _p[j0] = _p[j1];
+            j0 = j1;
+        } while (j0 != 0);
+    }
+
+    // Pairs the solver could only fill with forbidden cost stay unmatched.
+    for (int j = 1; j <= m; ++j)
+    {
+        const int i = _p[j];
+        if (i == 0 || _cost[(size_t)(i - 1) * m + (j - 1)] >= kForbidden)
+            continue;
+        const int track = transposed ? _rows[j - 1] : _rows[i - 1];
+        const int det = transposed ? _cols[i - 1] : _cols[j - 1];
+        _match[track] = det;
+        _detMatched[det] = 1;
+    }
+}
+
+void MultiTracker::assign(int count)
+{
+    const size_t n = _id.size();
+    _match.assign(n, -1);
+    _detMatched.assign((size_t)count, 0);
+
+    // Connected components of the candidate graph; nodes are tracks, then detections.
+    _parent.resize(n + (size_t)count);
+    for (uint32_t i = 0; i < (uint32_t)_parent.size(); ++i)
+        _parent[i] = i;
+    for (const Edge& e : _edges)
+    {
+        const uint32_t a = find((uint32_t)e.track), b = find((uint32_t)(n + e.det));
+        if (a != b)
+            _parent[std::max(a, b)] = std::min(a, b);
+    }
+
+    // Edges grouped by cluster; a cluster whose only edge is a single pair needs no solver.
+    _clusterOf.assign(_parent.size(), -1);
+    size_t clusters = 0;
+    for (size_t e = 0; e < _edges.size(); ++e)
+    {
+        const uint32_t root = find((uint32_t)_edges[e].track);
+        if (_clusterOf[root] < 0)
+        {
+            _clusterOf[root] = (int)clusters++;
+            if (_clusters.size() < clusters)
+                _clusters.emplace_back();
+            _clusters[clusters - 1].clear();
+        }
+        _clusters[_clusterOf[root]].push_back((int)e);
+    }
+    for (size_t c = 0; c < clusters; ++c)
+    {
+        const std::vector<int>& edges = _clusters[c];
+        if (edges.size() == 1)
+        {
+            _match[_edges[edges[0]].track] = _edges[edges[0]].det;
+            _detMatched[_edges[edges[0]].det] = 1;
+        }
+        else
+            solveCluster(edges);
+    }
+}
+
+void MultiTracker::correct(const Detection* dets, const Params& p)
+{
+    const float r = p.measurementSigma * p.measurementSigma;
+    const size_t n = _id.size();
+    for (size_t i = 0; i < n; ++i)
+    {
+        ++_age[i];
+        const int j = _match[i];
+        if (j < 0)
+        {
+            ++_misses[i];
+            continue;
+        }
+        ++_hits[i];
+        _misses[i] = 0;
+
+        // K = P H^T / S with H = [1 0]; P' = (I - K H) P.
+        const float s = _p00[i] + r;
+        const float k0 = _p00[i] / s, k1 = _p01[i] / s;
+        const float ex = dets[j].x - _x[i], ey = dets[j].y - _y[i];
+        _x[i] += k0 * ex;
+        _y[i] += k0 * ey;
+        _vx[i] += k1 * ex;
+        _vy[i] += k1 * ey;
+        const float p00 = _p00[i], p01 = _p01[i];
+        _p00[i] = (1.0f - k0) * p00;
+        _p01[i] = (1.0f - k0) * p01;
+        _p11[i] -= k1 * p01;
+    }
+}
+
+void MultiTracker::removeTrack(size_t i)
+{
+    // Swap-remove keeps the arrays dense; track order carries no meaning.
+    const size_t last = _id.size() - 1;
+    _x[i] = _x[last]; _y[i] = _y[last];
+    _vx[i] = _vx[last]; _vy[i] = _vy[last];
+    _p00[i] = _p00[last]; _p01[i] = _p01[last]; _p11[i] = _p11[last];
+    _id[i] = _id[last];
+    _hits[i] = _hits[last]; _misses[i] = _misses[last]; _age[i] = _age[last];
+    _match[i] = _match[last];
+    for (auto* v : { &_x, &_y, &_vx, &_vy, &_p00, &_p01, &_p11 })
+        v->pop_back();
+    _id.pop_back();
+    _hits.pop_back();
+    _misses.pop_back();
+    _age.pop_back();
+    _match.pop_back();
+}
+
+void MultiTracker::prune(const Params& p)
+{
+    for (size_t i = 0; i < _id.size();)
+    {
+        const bool tentative = _hits[i] < p.confirmHits;
+        if (_misses[i] > (tentative ? 0 : p.maxMisses))
+            removeTrack(i);
+        else
+            ++i;
+    }
+}
+
+void MultiTracker::spawn(const Detection* dets, int count, const Params& p)
+{
+    const float r = p.measurementSigma * p.measurementSigma;
+    const float vv = p.initVelocitySigma * p.initVelocitySigma;
+    for (int j = 0; j < count && (int)_id.size() < p.maxTracks; ++j)
+    {
+        if (_detMatched[j])
+            continue;
+        _x.push_back(dets[j].x);
+        _y.push_back(dets[j].y);
+        _vx.push_back(0.0f);
+        _vy.push_back(0.0f);
+        _p00.push_back(r);
+        _p01.push_back(0.0f);
+        _p11.push_back(vv);
+        _id.push_back(_nextId++);
+        _hits.push_back(1);
+        _misses.push_back(0);
+        _age.push_back(1);
+        _match.push_back(j);
+    }
+}
+
+void MultiTracker::update(const Detection* dets, int count, uint64_t timestampNs, const Params& p, std::vector<Track>& out)
+{
+    out.clear();
+    if (!dets)
+        count = 0;
+
+    // Frame interval from arrival times; bounded so a stall doesn't blow up the covariance.
+    float dt = 0.0f;
+    if (_lastNs != 0 && timestampNs > _lastNs)
+        dt = std::min(1.0f, (float)((double)(timestampNs - _lastNs) * 1e-9));
+    _lastNs = timestampNs;
+
+    predict(dt, p);
+    gate(dets, count, p);
+    assign(count);
+    correct(dets, p);
+    prune(p);
+    spawn(dets, count, p);
+
+    for (size_t i = 0; i < _id.size(); ++i)
+    {
+        if (_hits[i] < p.confirmHits)
+            continue;
+        Track t;
+        t.id = _id[i];
+        t.x = _x[i];
+        t.y = _y[i];
+        t.vx = _vx[i];
+        t.vy = _vy[i];
+        t.sigma = std::sqrt(_p00[i]);
+        t.age = _age[i];
+        t.misses = _misses[i];
+        t.detection = _match[i];
+        out.push_back(t);
+    }
+    std::sort(out.begin(), out.end(), [](const Track& a, const Track& b) { return a.id < b.id; });
+}
+
+}
@@ -0,0 +1,111 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Multi-object tracker for one camera's detections: persistent IDs across frames.
+//
+// Each track is a constant-velocity Kalman filter in image space. The axes share their
+// noise model, so x and y carry the same 2x2 (position, velocity) covariance and a track
+// is seven floats. Tracks are kept as structure of arrays, so prediction runs four
+// tracks and gating four detections per SSE2 iteration.
+//
+// Association: detections within the Mahalanobis gate of a track are candidate pairs.
+// Candidates split into independent clusters (union-find), and each cluster is solved
+// exactly with the Hungarian method on the pairs' negative log-likelihood, so cost grows
+// with cluster size rather than with the total track count. Unmatched detections start
+// tentative tracks; tracks are confirmed after confirmHits matches and dropped after
+// maxMisses frames without one (tentative ones after their first miss).
+namespace Tracker
+{
+    struct Params
+    {
+        bool enabled = false;
+        float measurementSigma = 1.0f;  // detection position noise, pixels
+        float accelSigma = 500.0f;      // process noise, pixels / s^2
+        float initVelocitySigma = 500.0f;   // velocity uncertainty of a new track, pixels / s
+        float gateSigma = 3.0f;         // Mahalanobis gate, standard deviations
+        int confirmHits = 3;
+        int maxMisses = 10;
+        int maxTracks = 1024;
+    };
+
+    struct Detection
+    {
+        float x = 0.0f;
+        float y = 0.0f;
+    };
+
+    struct Track
+    {
+        uint32_t id = 0;        // unique per camera, never reused
+        float x = 0.0f;         // filtered position, pixels
+        float y = 0.0f;
+        float vx = 0.0f;        // velocity, pixels / s
+        float vy = 0.0f;
+        float sigma = 0.0f;     // position standard deviation per axis
+        int age = 0;            // frames since birth
+        int misses = 0;         // consecutive frames without a detection
+        int detection = -1;     // index of this frame's detection, -1 when coasting
+    };
+
+    // One camera's confirmed tracks after a frame.
+    struct Result
+    {
+        std::vector<Track> tracks;  // ascending id
+        uint64_t frameSeq = 0;
+        uint64_t timestampNs = 0;
+        double trackUs = 0.0;       // time spent in update()
+    };
+
+    class MultiTracker
+    {
+    public:
+        // Advances every track to timestampNs, associates the frame's detections and
+        // writes the confirmed tracks to 'out'.
+        void update(const Detection* dets, int count, uint64_t timestampNs, const Params& p, std::vector<Track>& out);
+
+        void reset();
+        size_t trackCount() const { return _id.size(); }
+
+    private:
+        void predict(float dt, const Params& p);
+        void gate(const Detection* dets, int count, const Params& p);
+        void assign(int count);
+        void solveCluster(const std::vector<int>& edges);
+        void correct(const Detection* dets, const Params& p);
+        void spawn(const Detection* dets, int count, const Params& p);
+        void prune(const Params& p);
+        void removeTrack(size_t i);
+        uint32_t find(uint32_t a);
+
+        // Track state, one entry per track.
+        std::vector<float> _x, _y, _vx, _vy;
+        std::vector<float> _p00, _p01, _p11;    // covariance of (position, velocity), both axes
+        std::vector<uint32_t> _id;
+        std::vector<int> _hits, _misses, _age;
+        std::vector<int> _match;                // detection assigned this frame, -1 = none
+
+        // Per-frame scratch.
+        struct Edge
+        {
+            int track;
+            int det;
+            float cost;
+        };
+        std::vector<Edge> _edges;
+        std::vector<float> _dx, _dy;        // detection positions as arrays
+        std::vector<float> _d2;             // one track's Mahalanobis distances to every detection
+        std::vector<uint32_t> _parent;      // union-find over tracks, then detections
+        std::vector<int> _detMatched;
+        std::vector<std::vector<int>> _clusters;    // edge indices per cluster root
+        std::vector<int> _clusterOf;
+        std::vector<double> _cost, _u, _v, _minv;
+        std::vector<int> _p, _way, _rows, _cols;
+        std::vector<char> _used;
+
+        uint64_t _lastNs = 0;
+        uint32_t _nextId = 1;
+    };
+}
@@ -0,0 +1,645 @@
+#include "Triangulation.h"
+#include "WorkerPool.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace Triangulation
+{
+
+static const double kPi = 3.14159265358979323846;
+
+// Rays closer than this (sine) to a pair's baseline say nothing about depth.
+static const double kMinBaselineSine = 0.02;
+
+// Widens the epipolar-angle prefilter over its small-angle estimate; the exact test
+// after it is the reprojection check.
+static const double kAngleSlack = 1.25;
+
+// Cameras each camera is matched against. Every extra pair adds candidates (and ghosts)
+// but no new points once a marker is seen by a few well-separated pairs.
+static const int kPartners = 8;
+
+// Smallest detection grid cell, pixels; finer grids cost more to build than they save.
+static const float kMinCell = 32.0f;
+
+static void cross(const double a[3], const double b[3], double out[3])
+{
+    out[0] = a[1] * b[2] - a[2] * b[1];
+    out[1] = a[2] * b[0] - a[0] * b[2];
+    out[2] = a[0] * b[1] - a[1] * b[0];
+}
+
+static double dot(const double a[3], const double b[3])
+{
+    return a[0] * b[0] + a[1] * b[1] + a[2] * b[2];
+}
+
+static bool normalize(double a[3])
+{
+    const double n = std::sqrt(dot(a, a));
+    if (n < 1e-12)
+        return false;
+    a[0] /= n;
+    a[1] /= n;
+    a[2] /= n;
+    return true;
+}
+
+// Normalized image coordinates of X in a camera; false behind it.
+static bool toNormalized(const Calibration::Camera& c, const double X[3], double& xn, double& yn)
+{
+    const double* R = c.R;
+    const double z = R[6] * X[0] + R[7] * X[1] + R[8] * X[2] + c.t[2];
+    if (z <= 1e-9)
+        return false;
+    xn = (R[0] * X[0] + R[1] * X[1] + R[2] * X[2] + c.t[0]) / z;
+    yn = (R[3] * X[0] + R[4] * X[1] + R[5] * X[2] + c.t[1]) / z;
+    return true;
+}
+
+// Batches of 'grain' items over the pool; the caller takes part.
+template <typename Fn>
+static void parallelChunks(int count, int grain, const Fn& fn)
+{
+    WorkerPool& pool = WorkerPool::instance();
+    const int chunks = std::max(1, std::min(pool.threadCount() + 1, count / std::max(1, grain)));
+    if (chunks == 1)
+    {
+        fn(0, count);
+        return;
+    }
+    pool.parallelFor(chunks, [&](int c)
+        {
+            fn((int)((int64_t)count * c / chunks), (int)((int64_t)count * (c + 1) / chunks));
+        });
+}
+
+void Solver::prepare(Rays& r, const View& v, const Params& p)
+{
+    const Calibration::Camera& c = *r.cam;
+    Calibration::center(c, r.C);
+    const size_t n = std::min(v.u.size(), v.v.size());
+    r.xn.resize(n);
+    r.yn.resize(n);
+    r.dx.resize(n);
+    r.dy.resize(n);
+    r.dz.resize(n);
+    const double* R = c.R;
+    for (size_t i = 0; i < n; ++i)
+    {
+        double xn, yn;
+        Calibration::undistort(c, v.u[i], v.v[i], xn, yn);
+        r.xn[i] = (float)xn;
+        r.yn[i] = (float)yn;
+        // R^T (xn, yn, 1)
+        double d[3] = { R[0] * xn + R[3] * yn + R[6], R[1] * xn + R[4] * yn + R[7], R[2] * xn + R[5] * yn + R[8] };
+        normalize(d);
+        r.dx[i] = (float)d[0];
+        r.dy[i] = (float)d[1];
+        r.dz[i] = (float)d[2];
+    }
+
+    // Grid over ideal pixels, cells at least as wide as the widest search radius so a
+    // lookup reads 3x3 cells. Detections outside the image land in the border cells.
+    r.cell = std::max(kMinCell, 2.0f * std::max(p.epipolarTolerance, p.maxError));
+    const int w = c.width > 0 ? c.width : (int)(2.0 * c.cx) + 1;
+    const int h = c.height > 0 ? c.height : (int)(2.0 * c.cy) + 1;
+    r.gw = std::max(1, (int)std::ceil(w / r.cell));
+    r.gh = std::max(1, (int)std::ceil(h / r.cell));
+    r.cellStart.assign((size_t)r.gw * r.gh + 1, 0);
+    r.order.resize(n);
+    thread_local std::vector<int> cellOf;
+    cellOf.resize(n);
+    for (size_t i = 0; i < n; ++i)
+    {
+        const int gx = std::min(r.gw - 1, std::max(0, (int)std::floor((r.xn[i] * c.fx + c.cx) / r.cell)));
+        const int gy = std::min(r.gh - 1, std::max(0, (int)std::floor((r.yn[i] * c.fy + c.cy) / r.cell)));
+        cellOf[i] = gy * r.gw + gx;
+        ++r.cellStart[cellOf[i] + 1];
+    }
+    for (size_t k = 1; k < r.cellStart.size(); ++k)
+        r.cellStart[k] += r.cellStart[k - 1];
+    thread_local std::vector<int> fill;
+    fill.assign(r.cellStart.begin(), r.cellStart.end() - 1);
+    for (size_t i = 0; i < n; ++i)
+        r.order[fill[cellOf[i]]++] = (int)i;
+}
+
+void Solver::choosePairs(int views)
+{
+    // Depth is best conditioned between cameras looking across each other, so each camera
+    // takes the partners whose optical axes (third row of R) are closest to perpendicular.
+    _pairs.clear();
+    thread_local std::vector<char> chosen;
+    thread_local std::vector<std::pair<double, int>> score;
+    chosen.assign((size_t)views * views, 0);
+    for (int a = 0; a < views; ++a)
+    {
+        const double* Ra = _rays[a].cam->R;
+        score.clear();
+        for (int b = 0; b < views; ++b)
+        {
+            if (b == a)
+                continue;
+            double s[3];
+            cross(Ra + 6, _rays[b].cam->R + 6, s);
+            score.emplace_back(dot(s, s), b);
+        }
+        const int keep = std::min((int)score.size(), kPartners);
+        std::partial_sort(score.begin(), score.begin() + keep, score.end(),
+            [](const std::pair<double, int>& x, const std::pair<double, int>& y) { return x.first > y.first; });
+        for (int k = 0; k < keep; ++k)
+        {
+            const int lo = std::min(a, score[k].second), hi = std::max(a, score[k].second);
+            char& c = chosen[(size_t)lo * views + hi];
+            if (!c)
+            {
+                c = 1;
+                _pairs.emplace_back(lo, hi);
+            }
+        }
+    }
+}
+
+void Solver::matchPair(int a, int b, const Params& p, std::vector<Candidate>& out) const
+{
+    out.clear();
+    const Rays& A = _rays[a];
+    const Rays& B = _rays[b];
+    const int na = (int)A.xn.size(), nb = (int)B.xn.size();
+    if (na == 0 || nb == 0)
+        return;
+
+    // Epipolar planes all contain the baseline; (v, w) span the directions across it,
+    // and a ray's plane is atan2(d.w, d.v).
+    double u[3] = { B.C[0] - A.C[0], B.C[1] - A.C[1], B.C[2] - A.C[2] };
+    if (!normalize(u))
+        return;
+    double axis[3] = { 0, 0, 0 };
+    axis[std::fabs(u[0]) < std::fabs(u[1]) ? (std::fabs(u[0]) < std::fabs(u[2]) ? 0 : 2) : (std::fabs(u[1]) < std::fabs(u[2]) ? 1 : 2)] = 1.0;
+    double v[3], w[3];
+    cross(u, axis, v);
+    normalize(v);
+    cross(u, v, w);
+
+    const Calibration::Camera& ca = *A.cam;
+    const Calibration::Camera& cb = *B.cam;
+    const double tolA = kAngleSlack * p.epipolarTolerance / (0.5 * (ca.fx + ca.fy));
+    const double tolB = kAngleSlack * p.epipolarTolerance / (0.5 * (cb.fx + cb.fy));
+
+    // Hash B's rays by plane angle, one bucket per ray on average.
+    int buckets = 16;
+    while (buckets < nb)
+        buckets <<= 1;
+    const double width = 2.0 * kPi / buckets;
+    thread_local std::vector<float> psiB, deltaB;
+    thread_local std::vector<int> start, order, bucketOf;
+    psiB.resize(nb);
+    deltaB.resize(nb);
+    bucketOf.resize(nb);
+    start.assign((size_t)buckets + 1, 0);
+    order.resize(nb);
+    double maxDeltaB = 0.0;
+    for (int j = 0; j < nb; ++j)
+    {
+        const double d[3] = { B.dx[j], B.dy[j], B.dz[j] };
+        const double along = dot(d, u);
+        const double s = std::sqrt(std::max(0.0, 1.0 - along * along));
+        if (s < kMinBaselineSine)
+        {
+            bucketOf[j] = -1;
+            continue;
+        }
+        const double psi = std::atan2(dot(d, w), dot(d, v));
+        psiB[j] = (float)psi;
+        deltaB[j] = (float)(tolB / s);
+        maxDeltaB = std::max(maxDeltaB, (double)deltaB[j]);
+        bucketOf[j] = std::min(buckets - 1, (int)((psi + kPi) / width));
+        ++start[bucketOf[j] + 1];
+    }
+    for (int k = 0; k < buckets; ++k)
+        start[k + 1] += start[k];
+    thread_local std::vector<int> fill;
+    fill.assign(start.begin(), start.end() - 1);
+    for (int j = 0; j < nb; ++j)
+        if (bucketOf[j] >= 0)
+            order[fill[bucketOf[j]]++] = j;
+
+    const double tol2 = (double)p.epipolarTolerance * p.epipolarTolerance;
+    for (int i = 0; i < na; ++i)
+    {
+        const double da[3] = { A.dx[i], A.dy[i], A.dz[i] };
+        const double along = dot(da, u);
+        const double s = std::sqrt(std::max(0.0, 1.0 - along * along));
+        if (s < kMinBaselineSine)
+            continue;
+        const double psi = std::atan2(dot(da, w), dot(da, v));
+        const double deltaA = tolA / s;
+        const double range = deltaA + maxDeltaB;
+        int k0 = (int)std::floor((psi - range + kPi) / width);
+        int k1 = (int)std::floor((psi + range + kPi) / width);
+        if (k1 - k0 + 1 >= buckets)
+        {
+            k0 = 0;
+            k1 = buckets - 1;
+        }
+        for (int k = k0; k <= k1; ++k)
+        {
+            const int bucket = k & (buckets - 1);
+            for (int o = start[bucket]; o < start[bucket + 1]; ++o)
+            {
+                const int j = order[o];
+                double diff = std::fabs(psi - psiB[j]);
+                if (diff > kPi)
+                    diff = 2.0 * kPi - diff;
+                if (diff > deltaA + deltaB[j])
+                    continue;
+
+                // Closest points of the two rays; both must lie in front.
+                const double db[3] = { B.dx[j], B.dy[j], B.dz[j] };
+                const double w0[3] = { A.C[0] - B.C[0], A.C[1] - B.C[1], A.C[2] - B.C[2] };
+                const double bb = dot(da, db), dd = dot(da, w0), ee = dot(db, w0);
+                const double den = 1.0 - bb * bb;
+                if (den < 1e-12)
+                    continue;
+                const double la = (bb * ee - dd) / den, mb = (ee - bb * dd) / den;
+                if (la <= 0.0 || mb <= 0.0)
+                    continue;
+                const double X[3] = {
+                    0.5 * (A.C[0] + la * da[0] + B.C[0] + mb * db[0]),
+                    0.5 * (A.C[1] + la * da[1] + B.C[1] + mb * db[1]),
+                    0.5 * (A.C[2] + la * da[2] + B.C[2] + mb * db[2]) };
+
+                double xa, ya, xb, yb;
+                if (!toNormalized(ca, X, xa, ya) || !toNormalized(cb, X, xb, yb))
+                    continue;
+                const double ex = (xa - A.xn[i]) * ca.fx, ey = (ya - A.yn[i]) * ca.fy;
+                const double fx = (xb - B.xn[j]) * cb.fx, fy = (yb - B.yn[j]) * cb.fy;
+                if (ex * ex + ey * ey > tol2 || fx * fx + fy * fy > tol2)
+                    continue;
+                out.push_back(Candidate{ { (float)X[0], (float)X[1], (float)X[2] }, a, i, b, j });
+            }
+        }
+    }
+}
+
+int Solver::nearest(int view, double u, double v, double radius) const
+{
+    const Rays& r = _rays[view];
+    const char* claimed = _claimed[view].data();
+    const int gx = std::min(r.gw - 1, std::max(0, (int)std::floor(u / r.cell)));
+    const int gy = std::min(r.gh - 1, std::max(0, (int)std::floor(v / r.cell)));
+    const Calibration::Camera& c = *r.cam;
+    double best = radius * radius;
+    int found = -1;
+    for (int y = std::max(0, gy - 1); y <= std::min(r.gh - 1, gy + 1); ++y)
+        for (int x = std::max(0, gx - 1); x <= std::min(r.gw - 1, gx + 1); ++x)
+        {
+            const int cell = y * r.gw + x;
+            for (int o = r.cellStart[cell]; o < r.cellStart[cell + 1]; ++o)
+            {
+                const int i = r.order[o];
+                if (claimed[i])
+                    continue;
+                const double du = r.xn[i] * c.fx + c.cx - u, dv = r.yn[i] * c.fy + c.cy - v;
+                const double d2 = du * du + dv * dv;
+                if (d2 <= best)
+                {
+                    best = d2;
+                    found = i;
+                }
+            }
+        }
+    return found;
+}
+
+int Solver::gather(const double X[3], double radius, Obs* obs) const
+{
+    int count = 0;
+    for (int k = 0; k < (int)_rays.size(); ++k)
+    {
+        const Calibration::Camera& c = *_rays[k].cam;
+        double xn, yn;
+        if (!toNormalized(c, X, xn, yn))
+            continue;
+        const int i = nearest(k, xn * c.fx + c.cx, yn * c.fy + c.cy, radius);
+        if (i >= 0)
+            obs[count++] = Obs{ k, i };
+    }
+    return count;
+}
+
+bool Solver::refine(double X[3], Obs* obs, int& count, const Params& p, double& rms) const
+{
+    const double maxErr2 = (double)p.maxError * p.maxError;
+    while (count >= std::max(2, p.minViews))
+    {
+        // Linear least squares in pixel units: each view contributes
+        //   fx (xn r3 - r1) . X = fx (t1 - xn t3),  fy (yn r3 - r2) . X = fy (t2 - yn t3).
+        double M[6] = {}, rhs[3] = {};  // M: xx xy xz yy yz zz
+        for (int k = 0; k < count; ++k)
+        {
+            const Rays& r = _rays[obs[k].view];
+            const Calibration::Camera& c = *r.cam;
+            const double* R = c.R;
+            const double xn = r.xn[obs[k].index], yn = r.yn[obs[k].index];
+            const double rows[2][4] = {
+                { c.fx * (xn * R[6] - R[0]), c.fx * (xn * R[7] - R[1]), c.fx * (xn * R[8] - R[2]), c.fx * (c.t[0] - xn * c.t[2]) },
+                { c.fy * (yn * R[6] - R[3]), c.fy * (yn * R[7] - R[4]), c.fy * (yn * R[8] - R[5]), c.fy * (c.t[1] - yn * c.t[2]) } };
+            for (const auto& a : rows)
+            {
+                M[0] += a[0] * a[0]; M[1] += a[0] * a[1]; M[2] += a[0] * a[2];
+                M[3] += a[1] * a[1]; M[4] += a[1] * a[2]; M[5] += a[2] * a[2];
+                rhs[0] += a[0] * a[3]; rhs[1] += a[1] * a[3]; rhs[2] += a[2] * a[3];
+            }
+        }
+        const double c00 = M[3] * M[5] - M[4] * M[4];
+        const double c01 = M[2] * M[4] - M[1] * M[5];
+        const double c02 = M[1] * M[4] - M[2] * M[3];
+        const double det = M[0] * c00 + M[1] * c01 + M[2] * c02;
+        if (std::fabs(det) <= 1e-12 * std::fabs(M[0] * M[3] * M[5]))
+            return false;
+        const double c11 = M[0] * M[5] - M[2] * M[2];
+        const double c12 = M[1] * M[2] - M[0] * M[4];
+        const double c22 = M[0] * M[3] - M[1] * M[1];
+        X[0] = (c00 * rhs[0] + c01 * rhs[1] + c02 * rhs[2]) / det;
+        X[1] = (c01 * rhs[0] + c11 * rhs[1] + c12 * rhs[2]) / det;
+        X[2] = (c02 * rhs[0] + c12 * rhs[1] + c22 * rhs[2]) / det;
+
+        // Reprojection errors; the worst view goes if it is over the limit.
+        double sum = 0.0, worst = -1.0;
+        int worstAt = -1;
+        for (int k = 0; k < count; ++k)
+        {
+            const Rays& r = _rays[obs[k].view];
+            const Calibration::Camera& c = *r.cam;
+            double xn, yn;
+            double e2 = 1e30;
+            if (toNormalized(c, X, xn, yn))
+            {
+                const double ex = (xn - r.xn[obs[k].index]) * c.fx, ey = (yn - r.yn[obs[k].index]) * c.fy;
+                e2 = ex * ex + ey * ey;
+            }
+            sum += e2;
+            if (e2 > worst)
+            {
+                worst = e2;
+                worstAt = k;
+            }
+        }
+        if (worst <= maxErr2)
+        {
+            rms = std::sqrt(sum / count);
+            return true;
+        }
+        obs[worstAt] = obs[--count];
+    }
+    return false;
+}
+
+void Solver::verify(const Candidate& c, const Params& p, Verified& v, Obs* obs) const
+{
+    v.views = 0;
+    double X[3] = { c.X[0], c.X[1], c.X[2] };
+    int count = gather(X, 2.0 * std::max(p.epipolarTolerance, p.maxError), obs);
+    double rms = 0.0;
+    if (!refine(X, obs, count, p, rms))
+        return;
+    // Once more around the solved position, with the final tolerance.
+    count = gather(X, p.maxError, obs);
+    if (!refine(X, obs, count, p, rms))
+        return;
+    std::copy(X, X + 3, v.X);
+    v.error = rms;
+    v.views = count;
+}
+
+void Solver::solve(const Calibration::Rig& rig, const std::vector<View>& views, const Params& p, std::vector<Point>& out)
+{
+    out.clear();
+    _candidateCount = 0;
+
+    // 1. Rays per calibrated camera.
+    _src.clear();
+    for (const View& v : views)
+        if (rig.camera(v.camera) && !v.u.empty())
+            _src.push_back(&v);
+    const int nViews = (int)_src.size();
+    if (nViews < std::max(2, p.minViews))
+        return;
+    _rays.resize((size_t)nViews);
+    _claimed.resize((size_t)nViews);
+    for (int k = 0; k < nViews; ++k)
+    {
+        _rays[k].cam = rig.camera(_src[k]->camera);
+        _rays[k].camera = _src[k]->camera;
+    }
+    parallelChunks(nViews, 1, [&](int begin, int end)
+        {
+            for (int k = begin; k < end; ++k)
+            {
+                prepare(_rays[k], *_src[k], p);
+                _claimed[k].assign(_rays[k].xn.size(), 0);
+            }
+        });
+
+    // 2. Pair candidates.
+    choosePairs(nViews);
+    if (_pairCandidates.size() < _pairs.size())
+        _pairCandidates.resize(_pairs.size());
+    parallelChunks((int)_pairs.size(), 4, [&](int begin, int end)
+        {
+            for (int k = begin; k < end; ++k)
+                matchPair(_pairs[k].first, _pairs[k].second, p, _pairCandidates[k]);
+        });
+    _flat.clear();
+    for (size_t k = 0; k < _pairs.size(); ++k)
+        for (const Candidate& c : _pairCandidates[k])
+            _flat.push_back(&c);
+    _candidateCount = _flat.size();
+    if (_flat.empty())
+        return;
+
+    // 3. Voxel hash, then the candidate count of each occupied voxel's neighborhood.
+    const double cell = std::max(1e-6, (double)p.mergeDistance);
+    const int64_t kBias = 1 << 20;
+    auto pack = [&](const float X[3]) -> uint64_t
+    {
+        uint64_t key = 1ull << 63;
+        for (int i = 0; i < 3; ++i)
+        {
+            const int64_t v = std::min(kBias - 2, std::max(1 - kBias, (int64_t)std::floor(X[i] / cell)));
+            key |= (uint64_t)(v + kBias) << (42 - 21 * i);
+        }
+        return key;
+    };
+    auto neighbor = [](uint64_t key, int dx, int dy, int dz) -> uint64_t
+    {
+        // Coordinates are biased and clamped away from the field edges, so no carries.
+        return key + ((uint64_t)(int64_t)dx << 42) + ((uint64_t)(int64_t)dy << 21) + (uint64_t)(int64_t)dz;
+    };
+    int bits = 4;
+    while ((1ull << bits) < 2 * _flat.size())
+        ++bits;
+    const size_t mask = ((size_t)1 << bits) - 1;
+    auto find = [&](uint64_t key) -> size_t
+    {
+        size_t s = (size_t)((key * 0x9E3779B97F4A7C15ull) >> (64 - bits));
+        while (_keys[s] != 0 && _keys[s] != key)
+            s = (s + 1) & mask;
+        return s;
+    };
+    _keys.assign(mask + 1, 0);
+    _counts.assign(mask + 1, 0);
+    _support.assign(mask + 1, 0);
+    _stamp.assign(mask + 1, 0);
+    _slotOf.resize(_flat.size());
+    for (size_t c = 0; c < _flat.size(); ++c)
+    {
+        const uint64_t key = pack(_flat[c]->X);
+        const size_t s = find(key);
+        _keys[s] = key;
+        ++_counts[s];
+        _slotOf[c] = (int)s;
+    }
+    for (size_t s = 0; s <= mask; ++s)
+    {
+        if (_keys[s] == 0)
+            continue;
+        int support = 0;
+        for (int dz = -1; dz <= 1; ++dz)
+            for (int dy = -1; dy <= 1; ++dy)
+                for (int dx = -1; dx <= 1; ++dx)
+                    support += _counts[find(neighbor(_keys[s], dx, dy, dz))];
+        _support[s] = support;
+    }
+
+    // A point seen by k >= 3 cameras leaves several candidates; with minViews >= 3 a lone
+    // pair candidate is almost always a ghost from an epipolar coincidence.
+    const int need = p.minViews >= 3 ? 2 : 1;
+    _seeds.clear();
+    for (size_t c = 0; c < _flat.size(); ++c)
+        if (_support[_slotOf[c]] >= need)
+            _seeds.emplace_back(_support[_slotOf[c]], (int)c);
+    std::sort(_seeds.begin(), _seeds.end(), [](const std::pair<int, int>& a, const std::pair<int, int>& b)
+        {
+            return a.first != b.first ? a.first > b.first : a.second < b.second;
+        });
+    _pending.clear();
+    for (const auto& s : _seeds)
+        _pending.push_back(s.second);
+
+    // 4. Waves of seeds. Seeds whose detections a point already took are dropped, a seed
+    // near one already in the wave waits for the next (it is likely the same point), and
+    // a voxel whose seed failed gives up its other candidates.
+    const int wave = 16 * (WorkerPool::instance().threadCount() + 1);
+    _verified.resize((size_t)wave);
+    _obs.resize((size_t)wave * nViews);
+    _kept.resize((size_t)nViews);
+    const int kDead = -1;
+    const int weakViews = 2 * std::max(2, p.minViews);
+    _weak.clear();
+    _weakFirst.clear();
+    _weakObs.clear();
+    auto accept = [&](Verified v, const Obs* obs)
+    {
+        if ((int)out.size() >= p.maxPoints)
+            return;
+        int count = 0;
+        for (int o = 0; o < v.views; ++o)
+            if (!_claimed[obs[o].view][obs[o].index])
+                _kept[count++] = obs[o];
+        // Lost views to a better point: re-solve what is left, or give up.
+        if (count != v.views && !refine(v.X, _kept.data(), count, p, v.error))
+            return;
+
+        Point pt;
+        pt.x = (float)v.X[0];
+        pt.y = (float)v.X[1];
+        pt.z = (float)v.X[2];
+        pt.error = (float)v.error;
+        pt.views = count;
+        for (int o = 0; o < count; ++o)
+        {
+            _claimed[_kept[o].view][_kept[o].index] = 1;
+            const int camera = _rays[_kept[o].view].camera;
+            if (camera < 32)
+                pt.cameras |= 1u << camera;
+        }
+        out.push_back(pt);
+    };
+    for (int round = 1; !_pending.empty() && (int)out.size() < p.maxPoints; ++round)
+    {
+        _batch.clear();
+        _deferred.clear();
+        size_t next = 0;
+        for (; next < _pending.size() && (int)_batch.size() < wave; ++next)
+        {
+            const int c = _pending[next];
+            const Candidate& cand = *_flat[c];
+            const int s = _slotOf[c];
+            if (_claimed[cand.a][cand.i] || _claimed[cand.b][cand.j] || _stamp[s] == kDead)
+                continue;
+            if (_stamp[s] == round)
+            {
+                _deferred.push_back(c);
+                continue;
+            }
+            _batch.push_back(c);
+            for (int dz = -1; dz <= 1; ++dz)
+                for (int dy = -1; dy <= 1; ++dy)
+                    for (int dx = -1; dx <= 1; ++dx)
+                    {
+                        const size_t t = find(neighbor(_keys[s], dx, dy, dz));
+                        if (_keys[t] != 0 && _stamp[t] != kDead)
+                            _stamp[t] = round;
+                    }
+        }
+        _deferred.insert(_deferred.end(), _pending.begin() + next, _pending.end());
+        _pending.swap(_deferred);
+
+        const int n = (int)_batch.size();
+        parallelChunks(n, 8, [&](int begin, int end)
+            {
+                for (int k = begin; k < end; ++k)
+                    verify(*_flat[_batch[k]], p, _verified[k], &_obs[(size_t)k * nViews]);
+            });
+
+        // Accept in seed order; a detection serves one point. Points with few views wait
+        // until every seed is done: ghosts from epipolar coincidences look like those, and
+        // the detections they would take usually belong to a point still to come.
+        for (int k = 0; k < n; ++k)
+        {
+            const Verified& v = _verified[k];
+            const Obs* obs = &_obs[(size_t)k * nViews];
+            if (v.views == 0)
+                _stamp[_slotOf[_batch[k]]] = kDead;
+            else if (v.views < weakViews)
+            {
+                _stamp[_slotOf[_batch[k]]] = kDead;
+                _weakFirst.push_back((int)_weakObs.size());
+                _weakObs.insert(_weakObs.end(), obs, obs + v.views);
+                _weak.push_back(v);
+            }
+            else
+                accept(v, obs);
+        }
+    }
+
+    _batch.clear();
+    for (int k = 0; k < (int)_weak.size(); ++k)
+        _batch.push_back(k);
+    std::sort(_batch.begin(), _batch.end(), [&](int a, int b)
+        {
+            const Verified& va = _weak[a];
+            const Verified& vb = _weak[b];
+            return va.views != vb.views ? va.views > vb.views : va.error < vb.error;
+        });
+    for (int k : _batch)
+        accept(_weak[k], &_weakObs[_weakFirst[k]]);
+
+    std::stable_sort(out.begin(), out.end(), [](const Point& a, const Point& b) { return a.views > b.views; });
+}
+
+}
@@ -0,0 +1,147 @@
+#pragma once
+
+#include "Calibration.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// 3D points from one synchronized set of per-camera 2D detections.
+//
+// 1. Every detection becomes an undistorted ray.
+// 2. Each camera is paired with the kPartners cameras whose optical axes are closest to
+//    perpendicular to its own (the best-conditioned depth). For every pair, rays are
+//    hashed by the angle of their epipolar plane; the planes through the baseline form
+//    a pencil, so corresponding rays share an angle. A ray of one camera then meets only
+//    the few rays of the other in its buckets. A ray pair whose midpoint reprojects
+//    within epipolarTolerance in both cameras is a candidate.
+// 3. Candidates are hashed into mergeDistance voxels. A point seen by k cameras leaves
+//    many candidates close together, while ghosts from epipolar coincidences are scattered,
+//    so a candidate's support is the candidate count of its 3x3x3 voxel neighborhood.
+// 4. Candidates are tried best-supported first, in waves. A wave takes at most one
+//    candidate per voxel neighborhood whose two detections are still free. Each one is
+//    reprojected into every camera and takes the nearest free detection (a grid hash per
+//    camera). It is solved by linear least squares, and the worst view is dropped while
+//    any exceeds maxError. Accepted points claim their detections, so the other
+//    candidates of a point, and the ghosts it caused, are skipped without any work.
+//    Points with few views are accepted last, most views first.
+//
+// Steps 1 and 2 are spread over the WorkerPool per camera and per camera pair, and the
+// candidates of a wave are verified in parallel.
+namespace Triangulation
+{
+    struct Params
+    {
+        bool enabled = false;
+        float epipolarTolerance = 1.5f; // pixels, pair candidates
+        float maxError = 1.5f;          // pixels, reprojection error of a view in a point
+        int minViews = 3;               // cameras a point needs
+        float mergeDistance = 10.0f;    // world units: candidates this close are one point
+        float syncWindowMs = 4.0f;      // set assembly (MilManager): detections this close to the newest
+        int maxPoints = 1024;
+    };
+
+    // One camera's detections, distorted pixel coordinates.
+    struct View
+    {
+        int camera = -1;
+        std::vector<float> u;
+        std::vector<float> v;
+    };
+
+    struct Point
+    {
+        float x = 0.0f, y = 0.0f, z = 0.0f;
+        float error = 0.0f;     // RMS reprojection error over its views, pixels
+        int views = 0;
+        uint32_t cameras = 0;   // bit N: camera N contributed (cameras 0..31)
+    };
+
+    // One frame set's points.
+    struct Result
+    {
+        std::vector<Point> points;  // most views first
+        uint64_t timestampNs = 0;   // arrival of the newest frame in the set
+        int cameras = 0;            // cameras in the set
+        size_t candidates = 0;      // pair correspondences before merging
+        double solveUs = 0.0;
+    };
+
+    class Solver
+    {
+    public:
+        // Replaces 'out' with the points of one set of views. Views of cameras the rig
+        // doesn't calibrate are ignored.
+        void solve(const Calibration::Rig& rig, const std::vector<View>& views, const Params& p, std::vector<Point>& out);
+
+        // Pair candidates found by the last solve(), for profiling.
+        size_t candidateCount() const { return _candidateCount; }
+
+    private:
+        // A view's detections as rays, plus a grid over their ideal (undistorted) pixels.
+        struct Rays
+        {
+            const Calibration::Camera* cam = nullptr;
+            int camera = -1;
+            double C[3] = {};
+            std::vector<float> xn, yn;      // undistorted normalized coordinates
+            std::vector<float> dx, dy, dz;  // unit directions, world
+            float cell = 0.0f;              // grid cell, pixels
+            int gw = 0, gh = 0;
+            std::vector<int> cellStart;     // gw * gh + 1 offsets into 'order'
+            std::vector<int> order;         // detections sorted by cell
+        };
+
+        struct Candidate
+        {
+            float X[3];
+            int a, i;       // view and detection in one camera
+            int b, j;       // and in the other
+        };
+
+        struct Obs
+        {
+            int view;
+            int index;
+        };
+
+        struct Verified
+        {
+            double X[3];
+            double error;       // RMS, pixels
+            int views;          // obs in _obs[slot * viewCount ..], 0 = rejected
+        };
+
+        void prepare(Rays& r, const View& v, const Params& p);
+        void choosePairs(int views);
+        void matchPair(int a, int b, const Params& p, std::vector<Candidate>& out) const;
+        int nearest(int view, double u, double v, double radius) const;
+        int gather(const double X[3], double radius, Obs* obs) const;
+        bool refine(double X[3], Obs* obs, int& count, const Params& p, double& rms) const;
+        void verify(const Candidate& c, const Params& p, Verified& v, Obs* obs) const;
+
+        std::vector<const View*> _src;      // calibrated views with detections, read by the pool
+        std::vector<Rays> _rays;
+        std::vector<std::vector<char>> _claimed;    // per view and detection: used by a point
+        std::vector<std::pair<int, int>> _pairs;
+        std::vector<std::vector<Candidate>> _pairCandidates;
+        std::vector<const Candidate*> _flat;
+        std::vector<int> _slotOf;           // candidate -> voxel slot
+
+        // Voxel hash (open addressing), key 0 = empty slot.
+        std::vector<uint64_t> _keys;
+        std::vector<int> _counts;
+        std::vector<int> _support;
+        std::vector<int> _stamp;            // wave that last took a neighbor of this voxel
+
+        std::vector<std::pair<int, int>> _seeds;    // (support, candidate), best first
+        std::vector<int> _pending, _deferred, _batch;
+        std::vector<Verified> _verified;
+        std::vector<Obs> _obs;
+        std::vector<Obs> _kept;
+        std::vector<Verified> _weak;        // few-view points, accepted last
+        std::vector<int> _weakFirst;        // their obs in _weakObs
+        std::vector<Obs> _weakObs;
+        size_t _candidateCount = 0;
+    };
+}
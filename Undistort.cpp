@@ -0,0 +1,461 @@
+#include "Undistort.h"
+#include "WorkerPool.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#if defined(_M_X64) || defined(_M_AMD64) || defined(__x86_64__) || defined(__SSE2__)
+#define UNDISTORT_SSE2 1
+#include <emmintrin.h>
+#include <tmmintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#define UNDISTORT_TARGET_SSSE3
+#else
+#include <cpuid.h>
+#define UNDISTORT_TARGET_SSSE3 __attribute__((target("ssse3")))
+#endif
+#endif
+
+namespace Undistort
+{
+
+static const int kSubpixel = 32;    // map resolution and bilinear weight scale
+
+#if defined(UNDISTORT_SSE2)
+static bool cpuHasSsse3()
+{
+#if defined(_MSC_VER)
+    int info[4] = {};
+    __cpuid(info, 1);
+    return (info[2] & (1 << 9)) != 0;
+#else
+    unsigned a = 0, b = 0, c = 0, d = 0;
+    if (!__get_cpuid(1, &a, &b, &c, &d))
+        return false;
+    return (c & bit_SSSE3) != 0;
+#endif
+}
+
+static const bool kHasSsse3 = cpuHasSsse3();
+#endif
+
+bool build(const Calibration::Camera& c, Map& out)
+{
+    const int w = c.width, h = c.height;
+    if (w < 2 || h < 2 || !(c.fx > 0.0) || !(c.fy > 0.0))
+        return false;
+
+    out.width = w;
+    out.height = h;
+    out.dx.assign((size_t)w * (size_t)h, 0);
+    out.dy.assign((size_t)w * (size_t)h, 0);
+    out.spans.assign((size_t)h * 2, 0);
+
+    // The source stays inside the last 2x2 neighborhood, so samples never read past the frame.
+    const int maxX = (w - 1) * kSubpixel - 1;
+    const int maxY = (h - 1) * kSubpixel - 1;
+    for (int y = 0; y < h; ++y)
+    {
+        const double yn = (y - c.cy) / c.fy;
+        int first = w, last = -1;
+        for (int x = 0; x < w; ++x)
+        {
+            const double xn = (x - c.cx) / c.fx;
+            const double r2 = xn * xn + yn * yn;
+            // Past the turning point of the radial polynomial, rays far outside the view
+            // land back inside the frame.
+            if (1.0 + r2 * (3.0 * c.k1 + r2 * (5.0 * c.k2 + r2 * 7.0 * c.k3)) <= 0.0)
+                continue;
+            double u = 0.0, v = 0.0;
+            Calibration::distort(c, xn, yn, u, v);
+            if (!(u >= 0.0 && u <= w - 1 && v >= 0.0 && v <= h - 1))
+                continue;
+
+            const int sx = std::min((int)std::lround(u * kSubpixel), maxX);
+            const int sy = std::min((int)std::lround(v * kSubpixel), maxY);
+            const int ox = sx - x * kSubpixel, oy = sy - y * kSubpixel;
+            if (ox < INT16_MIN || ox > INT16_MAX || oy < INT16_MIN || oy > INT16_MAX)
+                return false;
+            out.dx[(size_t)y * w + x] = (int16_t)ox;
+            out.dy[(size_t)y * w + x] = (int16_t)oy;
+            first = std::min(first, x);
+            last = x;
+        }
+        // Invalid pixels between the ends (none for ordinary lenses) sample themselves.
+        out.spans[(size_t)y * 2] = last >= 0 ? first : 0;
+        out.spans[(size_t)y * 2 + 1] = last + 1;
+    }
+    return true;
+}
+
+// a + (b - a) * f / 32, rounded; the SIMD paths round identically.
+static inline int lerp(int a, int b, int f)
+{
+    return (a * (kSubpixel - f) + b * f + kSubpixel / 2) >> 5;
+}
+
+static inline uint16_t load16(const uint8_t* p)
+{
+    uint16_t v;
+    std::memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+#if defined(UNDISTORT_SSE2)
+// Rounded weighted sums of sample pairs: lanes a0 b0 a1 b1 ..., weights (32 - f, f) alike.
+// Samples stay below 32768, so the signed multiply-add is exact.
+static inline __m128i pairSums(__m128i lo, __m128i hi, __m128i wlo, __m128i whi)
+{
+    const __m128i round = _mm_set1_epi32(kSubpixel / 2);
+    const __m128i sLo = _mm_srai_epi32(_mm_add_epi32(_mm_madd_epi16(lo, wlo), round), 5);
+    const __m128i sHi = _mm_srai_epi32(_mm_add_epi32(_mm_madd_epi16(hi, whi), round), 5);
+    return _mm_packs_epi32(sLo, sHi);
+}
+
+// lerp() on 8 lanes.
+static inline __m128i lerp8(__m128i a, __m128i b, __m128i f)
+{
+    const __m128i wa = _mm_sub_epi16(_mm_set1_epi16(kSubpixel), f);
+    return pairSums(_mm_unpacklo_epi16(a, b), _mm_unpackhi_epi16(a, b),
+        _mm_unpacklo_epi16(wa, f), _mm_unpackhi_epi16(wa, f));
+}
+#endif
+
+#if defined(UNDISTORT_SSE2)
+// Both rows of 8 pixels' 2x2 neighborhoods as (left, right) sample pairs, one 16-bit lane
+// per pixel, loaded straight into the lanes (a round trip through memory stalls on store
+// forwarding).
+static inline void gatherMono8(const uint8_t* src, size_t pitch, int y, const int16_t* dxr, const int16_t* dyr,
+    int x, __m128i& t, __m128i& b)
+{
+    t = _mm_setzero_si128();
+    b = _mm_setzero_si128();
+#define UNDISTORT_GATHER(i) \
+    { \
+        const uint8_t* p = src + (size_t)(y + (dyr[x + i] >> 5)) * pitch + (x + i + (dxr[x + i] >> 5)); \
+        t = _mm_insert_epi16(t, load16(p), i); \
+        b = _mm_insert_epi16(b, load16(p + pitch), i); \
+    }
+    UNDISTORT_GATHER(0) UNDISTORT_GATHER(1) UNDISTORT_GATHER(2) UNDISTORT_GATHER(3)
+    UNDISTORT_GATHER(4) UNDISTORT_GATHER(5) UNDISTORT_GATHER(6) UNDISTORT_GATHER(7)
+#undef UNDISTORT_GATHER
+}
+
+// Blends the gathered pairs of 8 pixels with their map fractions.
+static inline __m128i blend8(__m128i tlo, __m128i thi, __m128i blo, __m128i bhi, __m128i ox, __m128i oy)
+{
+    const __m128i fracMask = _mm_set1_epi16(kSubpixel - 1);
+    const __m128i fx = _mm_and_si128(ox, fracMask);
+    const __m128i wx = _mm_sub_epi16(_mm_set1_epi16(kSubpixel), fx);
+    const __m128i wlo = _mm_unpacklo_epi16(wx, fx);
+    const __m128i whi = _mm_unpackhi_epi16(wx, fx);
+    return lerp8(pairSums(tlo, thi, wlo, whi), pairSums(blo, bhi, wlo, whi), _mm_and_si128(oy, fracMask));
+}
+
+// 8-bit samples round once: the horizontal sums (at most 255 * 32) stay exact in 16 bits,
+// and the vertical blend rounds them to the result.
+static inline __m128i horizontalMono8(__m128i pairs, __m128i ox)
+{
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i fx = _mm_and_si128(ox, _mm_set1_epi16(kSubpixel - 1));
+    const __m128i wx = _mm_sub_epi16(_mm_set1_epi16(kSubpixel), fx);
+    const __m128i lo = _mm_madd_epi16(_mm_unpacklo_epi8(pairs, zero), _mm_unpacklo_epi16(wx, fx));
+    const __m128i hi = _mm_madd_epi16(_mm_unpackhi_epi8(pairs, zero), _mm_unpackhi_epi16(wx, fx));
+    return _mm_packs_epi32(lo, hi);
+}
+
+static inline void storeMono8(__m128i ht, __m128i hb, __m128i oy, uint8_t* out)
+{
+    const __m128i round = _mm_set1_epi32(kSubpixel * kSubpixel / 2);
+    const __m128i fy = _mm_and_si128(oy, _mm_set1_epi16(kSubpixel - 1));
+    const __m128i wy = _mm_sub_epi16(_mm_set1_epi16(kSubpixel), fy);
+    const __m128i lo = _mm_madd_epi16(_mm_unpacklo_epi16(ht, hb), _mm_unpacklo_epi16(wy, fy));
+    const __m128i hi = _mm_madd_epi16(_mm_unpackhi_epi16(ht, hb), _mm_unpackhi_epi16(wy, fy));
+    const __m128i v = _mm_packs_epi32(_mm_srai_epi32(_mm_add_epi32(lo, round), 10), _mm_srai_epi32(_mm_add_epi32(hi, round), 10));
+    _mm_storel_epi64((__m128i*)out, _mm_packus_epi16(v, v));
+}
+
+static inline void gatherMono16(const uint8_t* src, size_t pitch, int y, const int16_t* dxr, const int16_t* dyr,
+    int x, __m128i& tlo, __m128i& thi, __m128i& blo, __m128i& bhi)
+{
+    uint32_t t[8], b[8];
+    for (int i = 0; i < 8; ++i)
+    {
+        const uint8_t* p = src + (size_t)(y + (dyr[x + i] >> 5)) * pitch + (size_t)(x + i + (dxr[x + i] >> 5)) * 2;
+        std::memcpy(&t[i], p, 4);
+        std::memcpy(&b[i], p + pitch, 4);
+    }
+    tlo = _mm_setr_epi32((int)t[0], (int)t[1], (int)t[2], (int)t[3]);
+    thi = _mm_setr_epi32((int)t[4], (int)t[5], (int)t[6], (int)t[7]);
+    blo = _mm_setr_epi32((int)b[0], (int)b[1], (int)b[2], (int)b[3]);
+    bhi = _mm_setr_epi32((int)b[4], (int)b[5], (int)b[6], (int)b[7]);
+}
+
+static inline void storeMono16(__m128i tlo, __m128i thi, __m128i blo, __m128i bhi, __m128i ox, __m128i oy,
+    __m128i inCount, __m128i outCount, uint16_t* out)
+{
+    const __m128i v = blend8(_mm_srl_epi16(tlo, inCount), _mm_srl_epi16(thi, inCount),
+        _mm_srl_epi16(blo, inCount), _mm_srl_epi16(bhi, inCount), ox, oy);
+    _mm_storeu_si128((__m128i*)out, _mm_sll_epi16(v, outCount));
+}
+
+// Where 8 neighboring pixels sample a short run of source columns on at most two
+// consecutive rows (most of a smooth map), loads of the run and byte shuffles replace the
+// gather. 'rel' is each pixel's left column from pixel 0's, minus 'rebase', and must be in
+// [0, maxRel]; 'lower' marks the pixels whose top row is one below 'row'.
+static inline bool findRun(__m128i ox, __m128i oy, int x, const int16_t* dxr, const int16_t* dyr,
+    __m128i rebase, int maxRel, int& row, __m128i& rel, __m128i& lower)
+{
+    const __m128i lanes = _mm_setr_epi16(0, 1, 2, 3, 4, 5, 6, 7);
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i one = _mm_set1_epi16(1);
+    row = std::min(dyr[x] >> 5, dyr[x + 7] >> 5);
+    const __m128i dr = _mm_sub_epi16(_mm_srai_epi16(oy, 5), _mm_set1_epi16((short)row));
+    lower = _mm_cmpeq_epi16(dr, one);
+    rel = _mm_add_epi16(_mm_srai_epi16(ox, 5), lanes);
+    rel = _mm_sub_epi16(rel, _mm_add_epi16(_mm_set1_epi16((short)(dxr[x] >> 5)), rebase));
+    const __m128i outside = _mm_or_si128(
+        _mm_or_si128(_mm_cmplt_epi16(rel, zero), _mm_cmpgt_epi16(rel, _mm_set1_epi16((short)maxRel))),
+        _mm_or_si128(_mm_cmplt_epi16(dr, zero), _mm_cmpgt_epi16(dr, one)));
+    return _mm_movemask_epi8(outside) == 0;
+}
+
+static inline __m128i select(__m128i mask, __m128i a, __m128i b)
+{
+    return _mm_or_si128(_mm_and_si128(mask, a), _mm_andnot_si128(mask, b));
+}
+
+UNDISTORT_TARGET_SSSE3
+static int mono8RowSsse3(const uint8_t* src, size_t pitch, int w, int y, const int16_t* dxr, const int16_t* dyr,
+    int x0, int x1, uint8_t* out)
+{
+    const __m128i one = _mm_set1_epi16(1);
+    const __m128i fracMask = _mm_set1_epi16(kSubpixel - 1);
+    const __m128i full = _mm_set1_epi16(kSubpixel);
+    int x = x0;
+    for (; x + 8 <= x1; x += 8)
+    {
+        const __m128i ox = _mm_loadu_si128((const __m128i*)(dxr + x));
+        const __m128i oy = _mm_loadu_si128((const __m128i*)(dyr + x));
+        const int start = x + (dxr[x] >> 5);
+        int row = 0;
+        __m128i rel, lower, t, b;
+        if (start + 16 <= w && findRun(ox, oy, x, dxr, dyr, _mm_setzero_si128(), 14, row, rel, lower))
+        {
+            // Lane i picks bytes rel and rel + 1.
+            const __m128i ctl = _mm_or_si128(rel, _mm_slli_epi16(_mm_add_epi16(rel, one), 8));
+            const uint8_t* p = src + (size_t)(y + row) * pitch + start;
+            t = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)p), ctl);
+            b = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)(p + pitch)), ctl);
+            if (_mm_movemask_epi8(lower))
+            {
+                t = select(lower, b, t);
+                b = select(lower, _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)(p + 2 * pitch)), ctl), b);
+            }
+        }
+        else
+            gatherMono8(src, pitch, y, dxr, dyr, x, t, b);
+
+        // Unsigned pairs times byte weights (32 - fx, fx): the horizontal blend in one step.
+        const __m128i fx = _mm_and_si128(ox, fracMask);
+        const __m128i wx = _mm_or_si128(_mm_sub_epi16(full, fx), _mm_slli_epi16(fx, 8));
+        storeMono8(_mm_maddubs_epi16(t, wx), _mm_maddubs_epi16(b, wx), oy, out + x);
+    }
+    return x;
+}
+
+// 16-bit runs are 8 samples per load, so each half of the 8 pixels has its own run,
+// the second starting at pixel 4's left column.
+UNDISTORT_TARGET_SSSE3
+static int mono16RowSsse3(const uint8_t* src, size_t pitch, int w, int y, const int16_t* dxr, const int16_t* dyr,
+    int x0, int x1, int inShift, int outShift, uint16_t* out)
+{
+    const __m128i inCount = _mm_cvtsi32_si128(inShift);
+    const __m128i outCount = _mm_cvtsi32_si128(outShift);
+    const __m128i one = _mm_set1_epi16(1);
+    const __m128i nextPair = _mm_set1_epi16(0x0202);
+    const __m128i highHalf = _mm_setr_epi16(0, 0, 0, 0, -1, -1, -1, -1);
+    int x = x0;
+    for (; x + 8 <= x1; x += 8)
+    {
+        const __m128i ox = _mm_loadu_si128((const __m128i*)(dxr + x));
+        const __m128i oy = _mm_loadu_si128((const __m128i*)(dyr + x));
+        const int start = x + (dxr[x] >> 5);
+        const int start4 = x + 4 + (dxr[x + 4] >> 5);
+        const short d = (short)(start4 - start);
+        int row = 0;
+        __m128i rel, lower, tlo, thi, blo, bhi;
+        if (start + 8 <= w && start4 + 8 <= w
+            && findRun(ox, oy, x, dxr, dyr, _mm_and_si128(_mm_set1_epi16(d), highHalf), 6, row, rel, lower))
+        {
+            // Lane i picks bytes 2 rel .. 2 rel + 3: its left and right samples.
+            const __m128i rel2 = _mm_slli_epi16(rel, 1);
+            const __m128i pair = _mm_or_si128(rel2, _mm_slli_epi16(_mm_add_epi16(rel2, one), 8));
+            const __m128i ctlLo = _mm_unpacklo_epi16(pair, _mm_add_epi8(pair, nextPair));
+            const __m128i ctlHi = _mm_unpackhi_epi16(pair, _mm_add_epi8(pair, nextPair));
+            const uint8_t* row0 = src + (size_t)(y + row) * pitch;
+            const uint8_t* p0 = row0 + (size_t)start * 2;
+            const uint8_t* p4 = row0 + (size_t)start4 * 2;
+            tlo = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)p0), ctlLo);
+            thi = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)p4), ctlHi);
+            blo = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)(p0 + pitch)), ctlLo);
+            bhi = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)(p4 + pitch)), ctlHi);
+            if (_mm_movemask_epi8(lower))
+            {
+                // Per-pixel masks, widened to the pixels' 32-bit pairs.
+                const __m128i lowerLo = _mm_unpacklo_epi16(lower, lower);
+                const __m128i lowerHi = _mm_unpackhi_epi16(lower, lower);
+                tlo = select(lowerLo, blo, tlo);
+                thi = select(lowerHi, bhi, thi);
+                blo = select(lowerLo, _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)(p0 + 2 * pitch)), ctlLo), blo);
+                bhi = select(lowerHi, _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)(p4 + 2 * pitch)), ctlHi), bhi);
+            }
+        }
+        else
+            gatherMono16(src, pitch, y, dxr, dyr, x, tlo, thi, blo, bhi);
+        storeMono16(tlo, thi, blo, bhi, ox, oy, inCount, outCount, out + x);
+    }
+    return x;
+}
+#endif
+
+static void mono8Row(const uint8_t* src, size_t pitch, int w, int y, const int16_t* dxr, const int16_t* dyr,
+    int x0, int x1, uint8_t* out)
+{
+    int x = x0;
+#if defined(UNDISTORT_SSE2)
+    if (kHasSsse3)
+        x = mono8RowSsse3(src, pitch, w, y, dxr, dyr, x0, x1, out);
+    for (; x + 8 <= x1; x += 8)
+    {
+        __m128i t, b;
+        gatherMono8(src, pitch, y, dxr, dyr, x, t, b);
+        const __m128i ox = _mm_loadu_si128((const __m128i*)(dxr + x));
+        storeMono8(horizontalMono8(t, ox), horizontalMono8(b, ox), _mm_loadu_si128((const __m128i*)(dyr + x)), out + x);
+    }
+#endif
+    for (; x < x1; ++x)
+    {
+        const int ox = dxr[x], oy = dyr[x];
+        const uint8_t* p = src + (size_t)(y + (oy >> 5)) * pitch + (x + (ox >> 5));
+        const int fx = ox & (kSubpixel - 1), fy = oy & (kSubpixel - 1);
+        const int ht = p[0] * (kSubpixel - fx) + p[1] * fx;
+        const int hb = p[pitch] * (kSubpixel - fx) + p[pitch + 1] * fx;
+        out[x] = (uint8_t)((ht * (kSubpixel - fy) + hb * fy + kSubpixel * kSubpixel / 2) >> 10);
+    }
+}
+
+// 16-bit samples are interpolated at 15 bits: 'inShift' drops a full-range sample's low
+// bit, 'outShift' left-aligns the result.
+static void mono16Row(const uint8_t* src, size_t pitch, int w, int y, const int16_t* dxr, const int16_t* dyr,
+    int x0, int x1, int inShift, int outShift, uint8_t* out)
+{
+    uint16_t* out16 = reinterpret_cast<uint16_t*>(out);
+    int x = x0;
+#if defined(UNDISTORT_SSE2)
+    if (kHasSsse3)
+        x = mono16RowSsse3(src, pitch, w, y, dxr, dyr, x0, x1, inShift, outShift, out16);
+    const __m128i inCount = _mm_cvtsi32_si128(inShift);
+    const __m128i outCount = _mm_cvtsi32_si128(outShift);
+    for (; x + 8 <= x1; x += 8)
+    {
+        __m128i tlo, thi, blo, bhi;
+        gatherMono16(src, pitch, y, dxr, dyr, x, tlo, thi, blo, bhi);
+        storeMono16(tlo, thi, blo, bhi, _mm_loadu_si128((const __m128i*)(dxr + x)), _mm_loadu_si128((const __m128i*)(dyr + x)),
+            inCount, outCount, out16 + x);
+    }
+#endif
+    for (; x < x1; ++x)
+    {
+        const int ox = dxr[x], oy = dyr[x];
+        const uint8_t* p = src + (size_t)(y + (oy >> 5)) * pitch + (size_t)(x + (ox >> 5)) * 2;
+        const int fx = ox & (kSubpixel - 1), fy = oy & (kSubpixel - 1);
+        const int tl = load16(p) >> inShift, tr = load16(p + 2) >> inShift;
+        const int bl = load16(p + pitch) >> inShift, br = load16(p + pitch + 2) >> inShift;
+        out16[x] = (uint16_t)(lerp(lerp(tl, tr, fx), lerp(bl, br, fx), fy) << outShift);
+    }
+}
+
+// RGBA rows interpolate vertically first: one 8-byte load holds a pixel's left and right
+// neighbors, so the vertical blend runs on both at once.
+static void rgba8Row(const uint8_t* src, size_t pitch, int y, const int16_t* dxr, const int16_t* dyr,
+    int x0, int x1, uint8_t* out)
+{
+    int x = x0;
+#if defined(UNDISTORT_SSE2)
+    const __m128i zero = _mm_setzero_si128();
+    for (; x + 2 <= x1; x += 2)
+    {
+        const int ox0 = dxr[x], oy0 = dyr[x], ox1 = dxr[x + 1], oy1 = dyr[x + 1];
+        const uint8_t* p0 = src + (size_t)(y + (oy0 >> 5)) * pitch + (size_t)(x + (ox0 >> 5)) * 4;
+        const uint8_t* p1 = src + (size_t)(y + (oy1 >> 5)) * pitch + (size_t)(x + 1 + (ox1 >> 5)) * 4;
+        const __m128i t = _mm_unpacklo_epi64(_mm_loadl_epi64((const __m128i*)p0), _mm_loadl_epi64((const __m128i*)p1));
+        const __m128i b = _mm_unpacklo_epi64(_mm_loadl_epi64((const __m128i*)(p0 + pitch)),
+            _mm_loadl_epi64((const __m128i*)(p1 + pitch)));
+
+        // v0 = pixel 0's left and right samples, v1 = pixel 1's.
+        const __m128i v0 = lerp8(_mm_unpacklo_epi8(t, zero), _mm_unpacklo_epi8(b, zero), _mm_set1_epi16((short)(oy0 & (kSubpixel - 1))));
+        const __m128i v1 = lerp8(_mm_unpackhi_epi8(t, zero), _mm_unpackhi_epi8(b, zero), _mm_set1_epi16((short)(oy1 & (kSubpixel - 1))));
+        const short fx0 = (short)(ox0 & (kSubpixel - 1)), fx1 = (short)(ox1 & (kSubpixel - 1));
+        const __m128i fx = _mm_set_epi16(fx1, fx1, fx1, fx1, fx0, fx0, fx0, fx0);
+        const __m128i v = lerp8(_mm_unpacklo_epi64(v0, v1), _mm_unpackhi_epi64(v0, v1), fx);
+        _mm_storel_epi64((__m128i*)(out + (size_t)x * 4), _mm_packus_epi16(v, v));
+    }
+#endif
+    for (; x < x1; ++x)
+    {
+        const int ox = dxr[x], oy = dyr[x];
+        const uint8_t* p = src + (size_t)(y + (oy >> 5)) * pitch + (size_t)(x + (ox >> 5)) * 4;
+        const int fx = ox & (kSubpixel - 1), fy = oy & (kSubpixel - 1);
+        for (int ch = 0; ch < 4; ++ch)
+            out[(size_t)x * 4 + ch] = (uint8_t)lerp(lerp(p[ch], p[pitch + ch], fy), lerp(p[4 + ch], p[pitch + 4 + ch], fy), fx);
+    }
+}
+
+void remapRows(const uint8_t* src, size_t srcPitch, int bytesPerPixel, int bits, const Map& m,
+    uint8_t* dst, size_t dstPitch, int y0, int y1)
+{
+    const int w = m.width;
+    const int inShift = bits > 15 ? 1 : 0;
+    const int outShift = 16 - std::max(9, std::min(16, bits)) + inShift;
+    for (int y = y0; y < y1; ++y)
+    {
+        const int x0 = m.spans[(size_t)y * 2];
+        const int x1 = m.spans[(size_t)y * 2 + 1];
+        uint8_t* out = dst + (size_t)y * dstPitch;
+        const int16_t* dxr = m.dx.data() + (size_t)y * w;
+        const int16_t* dyr = m.dy.data() + (size_t)y * w;
+
+        // Outside the span the source is out of view.
+        std::memset(out, 0, (size_t)x0 * bytesPerPixel);
+        std::memset(out + (size_t)x1 * bytesPerPixel, 0, (size_t)(w - x1) * bytesPerPixel);
+        if (bytesPerPixel == 4)
+            rgba8Row(src, srcPitch, y, dxr, dyr, x0, x1, out);
+        else if (bytesPerPixel == 2)
+            mono16Row(src, srcPitch, w, y, dxr, dyr, x0, x1, inShift, outShift, out);
+        else
+            mono8Row(src, srcPitch, w, y, dxr, dyr, x0, x1, out);
+    }
+}
+
+void remap(const uint8_t* src, size_t srcPitch, int bytesPerPixel, int bits, const Map& m,
+    uint8_t* dst, size_t dstPitch)
+{
+    // Same banding as Demosaic::bilinear.
+    const int kRowsPerBand = 64;
+    const int h = m.height;
+    WorkerPool& pool = WorkerPool::instance();
+    const int bands = std::max(1, std::min(pool.threadCount() + 1, h / kRowsPerBand));
+    const int rowsPerBand = (h + bands - 1) / bands;
+
+    pool.parallelFor(bands, [&](int b)
+        {
+            const int y0 = b * rowsPerBand;
+            const int y1 = std::min(h, y0 + rowsPerBand);
+            remapRows(src, srcPitch, bytesPerPixel, bits, m, dst, dstPitch, y0, y1);
+        });
+}
+
+}
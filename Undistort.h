@@ -0,0 +1,42 @@
+#pragma once
+
+#include "Calibration.h"
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+
+// Lens undistortion by precomputed maps, applied while converting a frame.
+//
+// A map holds, for every output pixel, the offset to the distorted source position in
+// 1/32 pixel (two int16 planes, 4 bytes per pixel): output pixels follow the camera's
+// fx fy cx cy with no distortion. Samples are bilinear with 5-bit weights, so an output
+// row costs one gather of each pixel's 2x2 neighborhood plus a few SSE2 multiply-adds per
+// 8 samples. Output pixels whose source falls outside the frame (or beyond the point
+// where the radial model folds back) read 0.
+namespace Undistort
+{
+    struct Map
+    {
+        int width = 0;
+        int height = 0;
+        std::vector<int16_t> dx;        // source x - output x, 1/32 pixel
+        std::vector<int16_t> dy;
+        std::vector<int32_t> spans;     // per row: first valid x, one past the last
+    };
+
+    // Builds the map of a camera at its calibrated size. False for cameras without a
+    // usable model (no size, no focal length) or with sources more than 1023 px away.
+    bool build(const Calibration::Camera& c, Map& out);
+
+    // Remaps output rows [y0, y1) of a frame of the map's size. Samples are 1 byte (mono8),
+    // 4 (RGBA8) or 2: 16-bit words holding 'bits' significant bits, right-aligned, which
+    // come out left-aligned as unpackRow() produces them. Rows outside the band are read,
+    // so bands can be processed concurrently.
+    void remapRows(const uint8_t* src, size_t srcPitch, int bytesPerPixel, int bits, const Map& m,
+        uint8_t* dst, size_t dstPitch, int y0, int y1);
+
+    // Whole frame, split into row bands across the WorkerPool.
+    void remap(const uint8_t* src, size_t srcPitch, int bytesPerPixel, int bits, const Map& m,
+        uint8_t* dst, size_t dstPitch);
+}
@@ -0,0 +1,153 @@
+#include "WorkerPool.h"
+
+#include <algorithm>
+#include <atomic>
+#include <memory>
+
+WorkerPool& WorkerPool::instance()
+{
+    // Intentionally leaked: joining threads from a DLL's static destructors can
+    // deadlock under the loader lock, and the OS reclaims them at process exit.
+    static WorkerPool* g = new WorkerPool();
+    return *g;
+}
+
+WorkerPool::WorkerPool()
+{
+    const unsigned hw = std::thread::hardware_concurrency();
+    const int n = std::max(1, (int)hw - 1);   // leave a core for TD's main thread
+
+    _threads.reserve(n);
+    _latency.reserve(n);
+    for (int i = 0; i < n; ++i)
+        _latency.push_back(std::make_unique<ThreadTuning::LatencyStats>());
+    for (int i = 0; i < n; ++i)
+    {
+        _threads.emplace_back([this, i] { workerLoop(i); });
+        _threads.back().detach();
+    }
+}
+
+void WorkerPool::workerLoop(int index)
+{
+    uint64_t appliedGen = 0;
+    for (;;)
+    {
+        Job job;
+        bool retune = false;
+        ThreadTuning::CpuSet cpus;
+        ThreadTuning::Priority priority = ThreadTuning::Priority::Normal;
+        {
+            std::unique_lock<std::mutex> lk(_mtx);
+            _cv.wait(lk, [&] { return !_queue.empty() || appliedGen != _tuneGen; });
+            if (appliedGen != _tuneGen)
+            {
+                retune = true;
+                cpus = _cpus;
+                priority = _priority;
+                appliedGen = _tuneGen;
+            }
+            else
+            {
+                job = std::move(_queue.front());
+                _queue.pop_front();
+            }
+        }
+
+        if (retune)
+        {
+            ThreadTuning::tuneCurrentThread(cpus, index, priority);
+            continue;
+        }
+
+        const auto started = std::chrono::steady_clock::now();
+        _latency[index]->add(std::chrono::duration<double, std::micro>(started - job.queued).count());
+        job.fn();
+    }
+}
+
+void WorkerPool::submit(std::function<void()> fn)
+{
+    {
+        std::lock_guard<std::mutex> lk(_mtx);
+        _queue.push_back({ std::move(fn), std::chrono::steady_clock::now() });
+    }
+    _cv.notify_one();
+}
+
+void WorkerPool::configure(const ThreadTuning::CpuSet& cpus, ThreadTuning::Priority priority)
+{
+    {
+        std::lock_guard<std::mutex> lk(_mtx);
+        if (_tuneGen != 0 && cpus == _cpus && priority == _priority)
+            return;
+        _cpus = cpus;
+        _priority = priority;
+        ++_tuneGen;
+    }
+    _cv.notify_all();
+}
+
+std::vector<ThreadTuning::LatencyStats::Window> WorkerPool::latency() const
+{
+    std::vector<ThreadTuning::LatencyStats::Window> out;
+    out.reserve(_latency.size());
+    for (const auto& l : _latency)
+        out.push_back(l->last());
+    return out;
+}
+
+void WorkerPool::parallelFor(int count, const std::function<void(int)>& fn)
+{
+    if (count <= 0)
+        return;
+    if (count == 1)
+    {
+        fn(0);
+        return;
+    }
+
+    // Indices are claimed dynamically, so helpers that start late simply find no work.
+    struct Batch
+    {
+        std::atomic<int> next{ 0 };
+        std::atomic<int> done{ 0 };
+        int count = 0;
+        const std::function<void(int)>* fn = nullptr;
+        std::mutex mtx;
+        std::condition_variable cv;
+    };
+    auto batch = std::make_shared<Batch>();
+    batch->count = count;
+    batch->fn = &fn;
+
+    auto drain = [](Batch& b)
+        {
+            int i;
+            while ((i = b.next.fetch_add(1)) < b.count)
+            {
+                (*b.fn)(i);
+                if (b.done.fetch_add(1) + 1 == b.count)
+                {
+                    std::lock_guard<std::mutex> lk(b.mtx);
+                    b.cv.notify_all();
+                }
+            }
+        };
+
+    const int helpers = std::min(count - 1, threadCount());
+    {
+        std::lock_guard<std::mutex> lk(_mtx);
+        const auto now = std::chrono::steady_clock::now();
+        for (int h = 0; h < helpers; ++h)
+            _queue.push_back({ [batch, drain] { drain(*batch); }, now });
+    }
+    if (helpers > 0)
+        _cv.notify_all();
+
+    drain(*batch);
+
+    // fn lives on our stack, so wait for calls still running on helpers.
+    std::unique_lock<std::mutex> lk(batch->mtx);
+    batch->cv.wait(lk, [&] { return batch->done.load() == batch->count; });
+}
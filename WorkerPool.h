@@ -0,0 +1,65 @@
+#pragma once
+
+#include <functional>
+#include <thread>
+#include <vector>
+#include <deque>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <memory>
+#include <cstdint>
+
+#include "ThreadTuning.h"
+
+// Process-wide pool of worker threads for per-camera pixel work.
+//
+// parallelFor() can be called concurrently from any thread (cooks, MIL hooks, other
+// workers). The calling thread always works on its own batch too, so a batch finishes
+// even when every worker is busy elsewhere.
+class WorkerPool
+{
+public:
+    static WorkerPool& instance();
+
+    int threadCount() const { return (int)_threads.size(); }
+
+    // Runs fn(i) for every i in [0, count) and returns once all calls have finished.
+    void parallelFor(int count, const std::function<void(int)>& fn);
+
+    // Queues fn to run on a worker thread and returns immediately.
+    void submit(std::function<void()> fn);
+
+    // Pins worker N to cpus.cores[N % size] (or anywhere on a NUMA node) and sets
+    // their priority. Idle workers apply it right away, busy ones after their job.
+    void configure(const ThreadTuning::CpuSet& cpus, ThreadTuning::Priority priority);
+
+    // Queue-to-start latency of each worker's jobs, in worker order.
+    std::vector<ThreadTuning::LatencyStats::Window> latency() const;
+
+private:
+    WorkerPool();
+    ~WorkerPool() = delete;   // never destroyed, see instance()
+
+    WorkerPool(const WorkerPool&) = delete;
+    WorkerPool& operator=(const WorkerPool&) = delete;
+
+    void workerLoop(int index);
+
+    struct Job
+    {
+        std::function<void()> fn;
+        std::chrono::steady_clock::time_point queued;
+    };
+
+    std::vector<std::thread> _threads;
+    std::vector<std::unique_ptr<ThreadTuning::LatencyStats>> _latency;   // one per worker
+    mutable std::mutex _mtx;
+    std::condition_variable _cv;
+    std::deque<Job> _queue;
+
+    // Guarded by _mtx; workers re-apply when _tuneGen moves past what they last applied.
+    ThreadTuning::CpuSet _cpus;
+    ThreadTuning::Priority _priority = ThreadTuning::Priority::Normal;
+    uint64_t _tuneGen = 0;
+};
@@ -0,0 +1,212 @@
+// Checks and times BandwidthPlanner on synthetic camera inventories.
+//
+// A few fixed inventories (an oversubscribed 24-camera rig, an undersubscribed one, a port
+// mixing bit depths and packet sizes, a camera asking for 0 fps) and many random ones are
+// planned, and every plan is checked: wire bytes of a known frame, no port over its
+// budget, caps never above the request, uncapped cameras keeping their request, capped
+// cameras on a port sharing equally and at least as much as the uncapped ones, ports with
+// capped cameras filled to their budget, and inter-packet delays that still fit a whole
+// frame into the frame period. Prints the fixed plans and the time per 24-camera plan;
+// exits non-zero if any check fails.
+//
+//   BandwidthPlannerBench [random inventories]
+
+#include "../BandwidthPlanner.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+namespace
+{
+    using BandwidthPlanner::Camera;
+    using BandwidthPlanner::Link;
+    using BandwidthPlanner::Plan;
+
+    // Ethernet framing per packet beyond the IP packet, as the planner counts it.
+    const double kFraming = 38.0;
+
+    int failures = 0;
+
+    void expect(bool ok, const char* what, const char* scenario, int camIdx = -1)
+    {
+        if (ok)
+            return;
+        ++failures;
+        if (camIdx >= 0)
+            std::printf("  FAIL %s: %s (camera %d)\n", scenario, what, camIdx);
+        else
+            std::printf("  FAIL %s: %s\n", scenario, what);
+    }
+
+    Camera camera(int camIdx, int port, int w, int h, int wireBits, double fps, int packetSize)
+    {
+        Camera c;
+        c.camIdx = camIdx;
+        c.port = port;
+        c.width = w;
+        c.height = h;
+        c.wireBits = wireBits;
+        c.requestedFps = fps;
+        c.packetSize = packetSize;
+        return c;
+    }
+
+    // Every invariant of a plan for 'cams' on 'link'.
+    void check(const char* scenario, const std::vector<Camera>& cams, const Link& link, const Plan& plan)
+    {
+        const double capacityBps = link.capacityMbps * 1e6 / 8.0;
+        const double budgetMbps = link.capacityMbps * link.maxUtilization;
+        expect(plan.cameras.size() == cams.size(), "one camera plan per camera", scenario);
+
+        for (const auto& port : plan.ports)
+        {
+            // Rounding a cap down to 0.01 fps leaves at most that much of each camera unused.
+            double slackMbps = 0.0, minCapped = 1e30, maxCapped = 0.0, maxUncapped = 0.0;
+            bool anyCapped = false;
+            for (size_t i = 0; i < cams.size(); ++i)
+            {
+                const Camera& c = cams[i];
+                const auto& p = plan.cameras[i];
+                if (c.port != port.port)
+                    continue;
+
+                expect(p.camIdx == c.camIdx, "plans keep the input order", scenario, c.camIdx);
+                expect(p.capFps <= c.requestedFps + 1e-9 && p.capFps >= 0.0, "cap within 0..requested", scenario, c.camIdx);
+                expect(p.capped == (p.capFps < c.requestedFps), "capped flag matches the cap", scenario, c.camIdx);
+                expect(std::abs(p.mbps - p.frameBytes * p.capFps * 8.0 / 1e6) < 1e-6, "load is frame bytes at the cap", scenario, c.camIdx);
+
+                if (p.capped)
+                {
+                    anyCapped = true;
+                    minCapped = std::min(minCapped, p.mbps);
+                    maxCapped = std::max(maxCapped, p.mbps);
+                    slackMbps += p.frameBytes * 0.01 * 8.0 / 1e6;
+                }
+                else
+                    maxUncapped = std::max(maxUncapped, p.mbps);
+
+                // A delay never stretches a frame's packets past the frame period. (Without one,
+                // full-size packets may not fit: the last packet of a frame is usually short.)
+                const double packetNs = (c.packetSize + kFraming) * 1e9 / capacityBps;
+                expect(p.interPacketDelayNs >= 0.0, "delay not negative", scenario, c.camIdx);
+                if (p.capFps > 0.0 && p.interPacketDelayNs > 0.0)
+                    expect(p.packetsPerFrame * (packetNs + p.interPacketDelayNs) <= 1e9 / p.capFps + 1.0,
+                        "delayed frame fits its period", scenario, c.camIdx);
+                if (port.cameras == 1)
+                    expect(p.interPacketDelayNs == 0.0, "lone camera sends back to back", scenario, c.camIdx);
+            }
+
+            expect(port.plannedMbps <= budgetMbps + 1e-6, "port within its budget", scenario);
+            expect(std::abs(port.utilization - port.plannedMbps / link.capacityMbps) < 1e-9, "utilization is planned / capacity", scenario);
+            if (anyCapped)
+            {
+                expect(port.plannedMbps >= budgetMbps - slackMbps - 1e-6, "oversubscribed port filled to its budget", scenario);
+                // What one camera's rounding leaves goes to the cameras served after it.
+                expect(maxCapped - minCapped <= 2.0 * slackMbps + 1e-6, "capped cameras share equally", scenario);
+                expect(minCapped >= maxUncapped - slackMbps - 1e-6, "capped cameras get at least the uncapped loads", scenario);
+            }
+            else
+                expect(std::abs(port.plannedMbps - port.requestedMbps) < 1e-6, "undersubscribed port keeps every request", scenario);
+        }
+    }
+
+    void print(const char* scenario, const Plan& plan)
+    {
+        std::printf("%s\n", scenario);
+        for (const auto& port : plan.ports)
+        {
+            std::printf("  port %d: %d camera(s), requested %.0f Mbps, planned %.0f Mbps, utilization %.3f\n",
+                port.port, port.cameras, port.requestedMbps, port.plannedMbps, port.utilization);
+            for (const auto& p : plan.cameras)
+                if (p.port == port.port)
+                    std::printf("    cam %2d: %5d packets, %.1f -> %.2f fps%s, %.0f Mbps, delay %.0f ns\n", p.camIdx,
+                        p.packetsPerFrame, p.requestedFps, p.capFps, p.capped ? " (capped)" : "", p.mbps, p.interPacketDelayNs);
+        }
+    }
+
+    void run(const char* scenario, const std::vector<Camera>& cams, const Link& link)
+    {
+        const Plan plan = BandwidthPlanner::plan(cams, link);
+        print(scenario, plan);
+        check(scenario, cams, link, plan);
+    }
+}
+
+int main(int argc, char** argv)
+{
+    const int randomRuns = argc > 1 ? std::max(0, std::atoi(argv[1])) : 2000;
+    const Link link;    // 1 Gbit/s, 90% usable
+
+    // 1920x1200 mono8 in 1500-byte packets: 1464-byte payloads, 1574 packets of 74 bytes of
+    // headers and framing, plus a 64-byte leader/trailer payload in two more packets.
+    {
+        int packets = 0;
+        const double bytes = BandwidthPlanner::frameWireBytes(camera(0, 0, 1920, 1200, 8, 30.0, 1500), &packets);
+        expect(packets == 1574 && bytes == 2304000.0 + 1574 * 74.0 + 64.0 + 2 * 74.0, "wire bytes of a 1920x1200 mono8 frame", "frameWireBytes");
+
+        // Mono12p is 1.5x the pixels; jumbo packets cut the per-packet overhead.
+        const double mono12 = BandwidthPlanner::frameWireBytes(camera(0, 0, 1920, 1200, 12, 30.0, 1500));
+        const double jumbo = BandwidthPlanner::frameWireBytes(camera(0, 0, 1920, 1200, 8, 30.0, 9000));
+        expect(std::abs(mono12 - 1.5 * 2304000.0) < 0.06 * 1.5 * 2304000.0 && mono12 > 1.5 * 2304000.0, "Mono12p wire bytes", "frameWireBytes");
+        expect(jumbo < bytes && jumbo > 2304000.0, "jumbo packets carry less overhead", "frameWireBytes");
+    }
+
+    // 24 cameras, 4 per port, each asking for 581 Mbps: every port oversubscribed 2.6x.
+    std::vector<Camera> rig;
+    for (int i = 0; i < 24; ++i)
+        rig.push_back(camera(i, i / 4, 1920, 1200, 8, 30.0, 1500));
+    run("oversubscribed: 24 x 1920x1200 mono8 @ 30 fps, 4 per port", rig, link);
+
+    std::vector<Camera> light;
+    for (int i = 0; i < 8; ++i)
+        light.push_back(camera(i, i / 2, 640, 480, 8, 60.0, 1500));
+    run("undersubscribed: 8 x 640x480 mono8 @ 60 fps, 2 per port", light, link);
+
+    // One port: a small camera that keeps its request, and two deep ones that split the rest.
+    const std::vector<Camera> mixed = {
+        camera(0, 0, 640, 480, 8, 30.0, 1500),
+        camera(1, 0, 1920, 1200, 12, 30.0, 9000),
+        camera(2, 0, 1920, 1200, 16, 60.0, 1500),
+        camera(3, 1, 2448, 2048, 12, 20.0, 8192),
+        camera(4, 1, 1280, 1024, 8, 0.0, 1500),
+    };
+    run("mixed: bit depths 8/12/16, packets 1500/8192/9000, one camera at 0 fps", mixed, link);
+
+    // Random inventories: any size, depth, rate, packet size and port sharing.
+    std::mt19937 rng(5);
+    std::uniform_int_distribution<int> count(1, 24), ports(1, 8), dim(64, 4096), pick(0, 3);
+    std::uniform_real_distribution<double> fps(0.0, 240.0), util(0.3, 1.0), capacity(100.0, 10000.0);
+    const int depths[4] = { 8, 10, 12, 16 };
+    const int packets[4] = { 576, 1500, 8192, 9000 };
+    const int before = failures;
+    for (int run = 0; run < randomRuns; ++run)
+    {
+        Link l;
+        l.capacityMbps = capacity(rng);
+        l.maxUtilization = util(rng);
+        std::vector<Camera> cams;
+        const int n = count(rng), np = ports(rng);
+        for (int i = 0; i < n; ++i)
+            cams.push_back(camera(i, i % np, dim(rng), dim(rng), depths[pick(rng)], fps(rng), packets[pick(rng)]));
+        check("random", cams, l, BandwidthPlanner::plan(cams, l));
+        if (failures > before + 20)
+            break;
+    }
+    std::printf("random: %d inventories, %d failed check(s)\n", randomRuns, failures - before);
+
+    const int reps = 20000;
+    const auto t0 = std::chrono::steady_clock::now();
+    size_t sink = 0;
+    for (int i = 0; i < reps; ++i)
+        sink += BandwidthPlanner::plan(rig, link).ports.size();
+    const double us = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - t0).count() / reps;
+    std::printf("24-camera plan: %.2f us (%zu)\n", us, sink / reps);
+
+    std::printf("%s: %d failed check(s)\n", failures ? "FAIL" : "OK", failures);
+    return failures ? 1 : 0;
+}
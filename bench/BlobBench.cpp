@@ -0,0 +1,146 @@
+// Throughput of BlobDetector::Labeler on synthetic marker frames.
+//
+// Frames are 8-bit mono with bright discs (markers) on a noisy dark background, the
+// same input the capture hook hands the detector. Built with OpenCV (HAVE_OPENCV), the
+// same frames also go through cv::threshold + cv::connectedComponentsWithStats
+// (8-connectivity) and the component counts are compared.
+//
+//   BlobBench [width] [height] [markers] [frames]
+
+#include "../BlobDetector.h"
+
+#if defined(HAVE_OPENCV)
+#include <opencv2/core.hpp>
+#include <opencv2/imgproc.hpp>
+#endif
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+namespace
+{
+    struct Frame
+    {
+        std::vector<uint8_t> pixels;
+        int width = 0;
+        int height = 0;
+    };
+
+    Frame makeFrame(int w, int h, int markers, std::mt19937& rng)
+    {
+        Frame f;
+        f.width = w;
+        f.height = h;
+        f.pixels.resize((size_t)w * h);
+
+        std::uniform_int_distribution<int> noise(0, 40);
+        for (auto& p : f.pixels)
+            p = (uint8_t)noise(rng);
+
+        std::uniform_real_distribution<float> px(0.0f, (float)w), py(0.0f, (float)h), pr(1.5f, 6.0f);
+        for (int i = 0; i < markers; ++i)
+        {
+            const float cx = px(rng), cy = py(rng), r = pr(rng);
+            const int x0 = std::max(0, (int)(cx - r)), x1 = std::min(w - 1, (int)(cx + r) + 1);
+            const int y0 = std::max(0, (int)(cy - r)), y1 = std::min(h - 1, (int)(cy + r) + 1);
+            for (int y = y0; y <= y1; ++y)
+                for (int x = x0; x <= x1; ++x)
+                {
+                    const float dx = x - cx, dy = y - cy;
+                    const float d2 = (dx * dx + dy * dy) / (r * r);
+                    if (d2 <= 1.0f)
+                        f.pixels[(size_t)y * w + x] = (uint8_t)std::min(255.0f, 160.0f + 95.0f * (1.0f - d2));
+                }
+        }
+        return f;
+    }
+
+    double nowMs()
+    {
+        using namespace std::chrono;
+        return duration<double, std::milli>(steady_clock::now().time_since_epoch()).count();
+    }
+}
+
+int main(int argc, char** argv)
+{
+    const int w = argc > 1 ? std::atoi(argv[1]) : 1920;
+    const int h = argc > 2 ? std::atoi(argv[2]) : 1200;
+    const int markers = argc > 3 ? std::atoi(argv[3]) : 200;
+    const int frames = argc > 4 ? std::max(1, std::atoi(argv[4])) : 200;
+    if (w <= 0 || h <= 0 || markers < 0)
+    {
+        std::fprintf(stderr, "usage: BlobBench [width] [height] [markers] [frames]\n");
+        return 2;
+    }
+
+    // A handful of distinct frames so the timing isn't one frame sitting in cache.
+    std::mt19937 rng(12345);
+    std::vector<Frame> set;
+    for (int i = 0; i < 8; ++i)
+        set.push_back(makeFrame(w, h, markers, rng));
+
+    BlobDetector::Params p;
+    p.threshold = 128;
+    p.minArea = 1;
+    p.maxBlobs = 1 << 20;
+
+    BlobDetector::Labeler labeler;
+    std::vector<BlobDetector::Blob> blobs;
+    std::vector<size_t> rleCounts(set.size());
+    size_t runs = 0;
+
+    for (size_t i = 0; i < set.size(); ++i)     // warm-up, sizes the scratch vectors
+    {
+        labeler.detect(set[i].pixels.data(), (size_t)w, w, h, p, blobs);
+        rleCounts[i] = blobs.size();
+    }
+
+    double t0 = nowMs();
+    for (int i = 0; i < frames; ++i)
+    {
+        const Frame& f = set[i % set.size()];
+        labeler.detect(f.pixels.data(), (size_t)w, w, h, p, blobs);
+        runs += labeler.runCount();
+    }
+    const double rleMs = (nowMs() - t0) / frames;
+
+    std::printf("%dx%d, %d markers, %d frames\n", w, h, markers, frames);
+    std::printf("  run-length labeler : %8.3f ms/frame  %6zu blobs  %7zu runs  (%.1f cameras at 60 fps per core)\n",
+        rleMs, rleCounts[0], runs / frames, 1000.0 / 60.0 / rleMs);
+
+#if defined(HAVE_OPENCV)
+    cv::Mat bin, labels, stats, centroids;
+    std::vector<size_t> cvCounts(set.size());
+    for (size_t i = 0; i < set.size(); ++i)
+    {
+        const cv::Mat src(h, w, CV_8UC1, set[i].pixels.data());
+        cv::threshold(src, bin, p.threshold - 1, 255, cv::THRESH_BINARY);
+        cvCounts[i] = (size_t)cv::connectedComponentsWithStats(bin, labels, stats, centroids, 8, CV_32S) - 1;
+    }
+
+    t0 = nowMs();
+    for (int i = 0; i < frames; ++i)
+    {
+        const Frame& f = set[i % set.size()];
+        const cv::Mat src(h, w, CV_8UC1, const_cast<uint8_t*>(f.pixels.data()));
+        cv::threshold(src, bin, p.threshold - 1, 255, cv::THRESH_BINARY);
+        cv::connectedComponentsWithStats(bin, labels, stats, centroids, 8, CV_32S);
+    }
+    const double cvMs = (nowMs() - t0) / frames;
+
+    std::printf("  OpenCV CCL + stats : %8.3f ms/frame  %6zu blobs  (%.2fx)\n", cvMs, cvCounts[0], cvMs / rleMs);
+    if (cvCounts != rleCounts)
+    {
+        std::fprintf(stderr, "component counts differ from OpenCV\n");
+        return 1;
+    }
+#else
+    std::printf("  (built without OpenCV; no connectedComponentsWithStats comparison)\n");
+#endif
+    return 0;
+}
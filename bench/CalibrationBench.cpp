@@ -0,0 +1,345 @@
+// Accuracy and cost of BoardDetector and CalibrationSolver on rendered checkerboards.
+//
+// Cameras stand on a ring (radius 3 m, alternating 2.4 / 3.0 m high) aimed just above the
+// floor center, with 1280x800 sensors and mild barrel distortion. A 9 x 6 board of 120 mm
+// squares is rendered into every camera for each snapshot: the first lies flat at the
+// center, the others are moved around the volume and tilted up to 40 degrees. Renders
+// are 2x2 supersampled, blurred and given Gaussian noise; the back of the board is plain.
+// Reports the detection rate, time and corner error against the true projections, then
+// the solve time, the intrinsic errors and the camera poses relative to camera 0 (which
+// do not depend on the world the solver picks).
+//
+//   CalibrationBench [snapshots] [cameras] [noise gray levels]
+
+#include "../BoardDetector.h"
+#include "../CalibrationSolver.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+namespace
+{
+    const int kWidth = 1280, kHeight = 800;
+    const double kPi = 3.14159265358979323846;
+
+    Calibration::Rig makeRig(int cameras)
+    {
+        Calibration::Rig rig;
+        rig.cameras.resize((size_t)cameras);
+        const double target[3] = { 0.0, 0.0, 300.0 };
+        for (int i = 0; i < cameras; ++i)
+        {
+            Calibration::Camera& c = rig.cameras[i];
+            c.valid = true;
+            c.width = kWidth;
+            c.height = kHeight;
+            c.fx = 1000.0 + 6.0 * i;
+            c.fy = c.fx * 1.002;
+            c.cx = 639.5 + 4.0 * (i % 3 - 1);
+            c.cy = 399.5 - 3.0 * (i % 2);
+            c.k1 = -0.12;
+            c.k2 = 0.04;
+            c.p1 = 0.0005;
+            c.p2 = -0.0003;
+
+            const double a = 2.0 * kPi * i / cameras;
+            const double pos[3] = { 3000.0 * std::cos(a), 3000.0 * std::sin(a), (i & 1) ? 3000.0 : 2400.0 };
+            double f[3] = { target[0] - pos[0], target[1] - pos[1], target[2] - pos[2] };
+            const double fl = std::sqrt(f[0] * f[0] + f[1] * f[1] + f[2] * f[2]);
+            for (double& v : f)
+                v /= fl;
+            double r[3] = { f[1], -f[0], 0.0 };
+            const double rl = std::sqrt(r[0] * r[0] + r[1] * r[1]);
+            r[0] /= rl;
+            r[1] /= rl;
+            const double d[3] = { f[1] * r[2] - f[2] * r[1], f[2] * r[0] - f[0] * r[2], f[0] * r[1] - f[1] * r[0] };
+            const double* rows[3] = { r, d, f };
+            for (int k = 0; k < 3; ++k)
+            {
+                for (int j = 0; j < 3; ++j)
+                    c.R[k * 3 + j] = rows[k][j];
+                c.t[k] = -(rows[k][0] * pos[0] + rows[k][1] * pos[1] + rows[k][2] * pos[2]);
+            }
+        }
+        return rig;
+    }
+
+    void multiply(const double A[9], const double B[9], double out[9])
+    {
+        for (int i = 0; i < 3; ++i)
+            for (int j = 0; j < 3; ++j)
+                out[i * 3 + j] = A[i * 3] * B[j] + A[i * 3 + 1] * B[3 + j] + A[i * 3 + 2] * B[6 + j];
+    }
+
+    void axisAngle(const double axis[3], double angle, double R[9])
+    {
+        const double x = axis[0], y = axis[1], z = axis[2];
+        const double c = std::cos(angle), s = std::sin(angle), C = 1.0 - c;
+        const double m[9] = { c + x * x * C, x * y * C - z * s, x * z * C + y * s,
+                              y * x * C + z * s, c + y * y * C, y * z * C - x * s,
+                              z * x * C - y * s, z * y * C + x * s, c + z * z * C };
+        std::copy(m, m + 9, R);
+    }
+
+    // Board -> world: printed face up (board Z down), then tilted, turned and moved.
+    struct BoardPose
+    {
+        double R[9];
+        double t[3];
+    };
+
+    std::vector<BoardPose> makeSnapshots(int count, const CalibrationSolver::Params& p, std::mt19937& rng)
+    {
+        std::uniform_real_distribution<double> u01(0.0, 1.0);
+        const double flip[9] = { 1, 0, 0, 0, -1, 0, 0, 0, -1 };
+        const double center[3] = { 0.5 * (p.cols - 1) * p.square, 0.5 * (p.rows - 1) * p.square, 0.0 };
+        std::vector<BoardPose> out;
+        for (int s = 0; s < count; ++s)
+        {
+            double R[9], tilt[9], turn[9], tmp[9];
+            const double z[3] = { 0, 0, 1 };
+            const double h = 2.0 * kPi * u01(rng);
+            const double axis[3] = { std::cos(h), std::sin(h), 0.0 };
+            axisAngle(axis, s == 0 ? 0.0 : 40.0 * kPi / 180.0 * u01(rng), tilt);
+            axisAngle(z, s == 0 ? 0.0 : 2.0 * kPi * u01(rng), turn);
+            multiply(turn, flip, tmp);
+            multiply(tilt, tmp, R);
+            const double at[3] = { s == 0 ? 0.0 : 1000.0 * (u01(rng) - 0.5), s == 0 ? 0.0 : 1000.0 * (u01(rng) - 0.5),
+                s == 0 ? 0.0 : 800.0 * u01(rng) };
+            BoardPose b;
+            std::copy(R, R + 9, b.R);
+            for (int i = 0; i < 3; ++i)
+                b.t[i] = at[i] - (R[i * 3] * center[0] + R[i * 3 + 1] * center[1] + R[i * 3 + 2] * center[2]);
+            out.push_back(b);
+        }
+        return out;
+    }
+
+    // Normalized undistorted rays at the 2x2 subsamples of every pixel (x -/+ 0.25).
+    void rayMap(const Calibration::Camera& c, std::vector<float>& map)
+    {
+        map.resize((size_t)kWidth * kHeight * 8);
+        for (int y = 0; y < 2 * kHeight; ++y)
+            for (int x = 0; x < 2 * kWidth; ++x)
+            {
+                double xn, yn;
+                Calibration::undistort(c, 0.5 * x - 0.25, 0.5 * y - 0.25, xn, yn);
+                float* m = &map[((size_t)y * 2 * kWidth + x) * 2];
+                m[0] = (float)xn;
+                m[1] = (float)yn;
+            }
+    }
+
+    void render(const Calibration::Camera& c, const std::vector<float>& map, const BoardPose& b, const CalibrationSolver::Params& p,
+        float noise, std::mt19937& rng, std::vector<uint8_t>& img)
+    {
+        // Board -> camera, then everything in board coordinates.
+        double R[9], t[3];
+        multiply(c.R, b.R, R);
+        for (int i = 0; i < 3; ++i)
+            t[i] = c.R[i * 3] * b.t[0] + c.R[i * 3 + 1] * b.t[1] + c.R[i * 3 + 2] * b.t[2] + c.t[i];
+        double o[3];    // camera center
+        for (int i = 0; i < 3; ++i)
+            o[i] = -(R[i] * t[0] + R[3 + i] * t[1] + R[6 + i] * t[2]);
+        const bool front = o[2] < 0.0;  // the printed face looks along -Z
+        const double sq = p.square;
+
+        std::vector<float> level((size_t)kWidth * kHeight);
+        for (int y = 0; y < kHeight; ++y)
+            for (int x = 0; x < kWidth; ++x)
+            {
+                float sum = 0.0f;
+                for (int s = 0; s < 4; ++s)
+                {
+                    const float* m = &map[((size_t)(2 * y + (s >> 1)) * 2 * kWidth + 2 * x + (s & 1)) * 2];
+                    const double d[3] = { R[0] * m[0] + R[3] * m[1] + R[6], R[1] * m[0] + R[4] * m[1] + R[7], R[2] * m[0] + R[5] * m[1] + R[8] };
+                    float v = 90.0f;
+                    if (std::fabs(d[2]) > 1e-12)
+                    {
+                        const double lambda = -o[2] / d[2];
+                        const double X = o[0] + lambda * d[0], Y = o[1] + lambda * d[1];
+                        if (lambda > 0.0 && X > -2.0 * sq && X < (p.cols + 1) * sq && Y > -2.0 * sq && Y < (p.rows + 1) * sq)
+                        {
+                            v = 200.0f;
+                            if (front && X > -sq && X < p.cols * sq && Y > -sq && Y < p.rows * sq)
+                                v = (((int)std::floor(X / sq) + (int)std::floor(Y / sq)) & 1) ? 220.0f : 30.0f;
+                        }
+                    }
+                    sum += v;
+                }
+                level[(size_t)y * kWidth + x] = 0.25f * sum;
+            }
+
+        std::normal_distribution<float> gauss(0.0f, noise);
+        img.resize(level.size());
+        for (int y = 0; y < kHeight; ++y)
+            for (int x = 0; x < kWidth; ++x)
+            {
+                // 3x3 binomial blur (clamped), then noise.
+                float v = 0.0f;
+                for (int dy = -1; dy <= 1; ++dy)
+                    for (int dx = -1; dx <= 1; ++dx)
+                    {
+                        const int yy = std::min(kHeight - 1, std::max(0, y + dy)), xx = std::min(kWidth - 1, std::max(0, x + dx));
+                        v += level[(size_t)yy * kWidth + xx] * (float)((2 - std::abs(dx)) * (2 - std::abs(dy)));
+                    }
+                v = v / 16.0f + gauss(rng);
+                img[(size_t)y * kWidth + x] = (uint8_t)std::min(255.0f, std::max(0.0f, v + 0.5f));
+            }
+    }
+
+    double nowMs()
+    {
+        using namespace std::chrono;
+        return duration<double, std::milli>(steady_clock::now().time_since_epoch()).count();
+    }
+
+    double angleBetween(const double A[9], const double B[9])
+    {
+        // Angle of A B^T.
+        double tr = 0.0;
+        for (int i = 0; i < 3; ++i)
+            for (int k = 0; k < 3; ++k)
+                tr += A[i * 3 + k] * B[i * 3 + k];
+        return std::acos(std::max(-1.0, std::min(1.0, 0.5 * (tr - 1.0)))) * 180.0 / kPi;
+    }
+
+    // Camera i relative to camera 0: rotation R_i R_0^T and the center in camera 0's frame.
+    void relative(const Calibration::Rig& rig, int i, double R[9], double C[3])
+    {
+        const Calibration::Camera& a = rig.cameras[0];
+        const Calibration::Camera& b = rig.cameras[i];
+        const double At[9] = { a.R[0], a.R[3], a.R[6], a.R[1], a.R[4], a.R[7], a.R[2], a.R[5], a.R[8] };
+        multiply(b.R, At, R);
+        double w[3];
+        Calibration::center(b, w);
+        for (int k = 0; k < 3; ++k)
+            C[k] = a.R[k * 3] * w[0] + a.R[k * 3 + 1] * w[1] + a.R[k * 3 + 2] * w[2] + a.t[k];
+    }
+}
+
+int main(int argc, char** argv)
+{
+    const int snapshots = argc > 1 ? std::atoi(argv[1]) : 30;
+    const int cameras = argc > 2 ? std::atoi(argv[2]) : 8;
+    const float noise = argc > 3 ? (float)std::atof(argv[3]) : 2.0f;
+    if (snapshots < 1 || cameras < 2 || cameras > 32 || noise < 0.0f)
+    {
+        std::fprintf(stderr, "usage: CalibrationBench [snapshots] [cameras] [noise gray levels]\n");
+        return 2;
+    }
+
+    CalibrationSolver::Params p;
+    p.square = 120.0;
+    BoardDetector::Params bp;
+    bp.cols = p.cols;
+    bp.rows = p.rows;
+    std::mt19937 rng(4242);
+    const Calibration::Rig truth = makeRig(cameras);
+    const std::vector<BoardPose> boards = makeSnapshots(snapshots, p, rng);
+    std::printf("%d cameras %dx%d, %d snapshots, %dx%d board of %.0f mm squares, noise %.1f\n",
+        cameras, kWidth, kHeight, snapshots, p.cols, p.rows, p.square, noise);
+
+    BoardDetector::Detector detector;
+    std::vector<float> map;
+    std::vector<uint8_t> img;
+    std::vector<CalibrationSolver::View> views;
+    double detectMs = 0.0, err2 = 0.0, worst = 0.0;
+    int attempts = 0, boardsInView = 0;
+    size_t corners = 0;
+    for (int c = 0; c < cameras; ++c)
+    {
+        rayMap(truth.cameras[c], map);
+        for (int s = 0; s < snapshots; ++s)
+        {
+            // Whole board projected inside the frame and facing the camera?
+            std::vector<double> expected;
+            bool inView = true;
+            for (int j = 0; j < p.rows && inView; ++j)
+                for (int i = 0; i < p.cols && inView; ++i)
+                {
+                    const double X[3] = { i * p.square, j * p.square, 0.0 };
+                    double W[3], u, v;
+                    for (int k = 0; k < 3; ++k)
+                        W[k] = boards[s].R[k * 3] * X[0] + boards[s].R[k * 3 + 1] * X[1] + boards[s].t[k];
+                    inView = Calibration::project(truth.cameras[c], W, u, v) && u > 8 && v > 8 && u < kWidth - 9 && v < kHeight - 9;
+                    expected.push_back(u);
+                    expected.push_back(v);
+                }
+            render(truth.cameras[c], map, boards[s], p, noise, rng, img);
+
+            CalibrationSolver::View view;
+            view.camera = c;
+            view.snapshot = s;
+            view.width = kWidth;
+            view.height = kHeight;
+            const double t0 = nowMs();
+            const bool found = detector.detect(img.data(), (size_t)kWidth, kWidth, kHeight, bp, view.corners);
+            detectMs += nowMs() - t0;
+            ++attempts;
+
+            const double nx = truth.cameras[c].R[6] * boards[s].R[2] + truth.cameras[c].R[7] * boards[s].R[5] + truth.cameras[c].R[8] * boards[s].R[8];
+            if (inView && nx < 0.0)
+                inView = false;     // seen from the back
+            boardsInView += inView ? 1 : 0;
+            if (!found)
+                continue;
+            if (!inView || expected.size() != view.corners.size() * 2)
+            {
+                std::printf("  camera %d snapshot %d: board found where none is fully visible\n", c, s);
+                continue;
+            }
+            for (size_t k = 0; k < view.corners.size(); ++k)
+            {
+                const double dx = view.corners[k].x - expected[k * 2], dy = view.corners[k].y - expected[k * 2 + 1];
+                err2 += dx * dx + dy * dy;
+                worst = std::max(worst, std::sqrt(dx * dx + dy * dy));
+            }
+            corners += view.corners.size();
+            views.push_back(std::move(view));
+        }
+    }
+    std::printf("detect: %.2f ms/frame, %zu of %d fully visible boards found, corner error %.3f px RMS, %.3f px worst\n",
+        detectMs / attempts, views.size(), boardsInView, corners ? std::sqrt(err2 / corners) : 0.0, worst);
+
+    Calibration::Rig rig;
+    CalibrationSolver::Report report;
+    std::string err;
+    const double t0 = nowMs();
+    const bool ok = CalibrationSolver::solve(p, views, rig, report, err);
+    const double solveMs = nowMs() - t0;
+    if (!ok)
+    {
+        std::printf("solve failed after %.0f ms: %s\n", solveMs, err.c_str());
+        return 1;
+    }
+    std::printf("solve: %.0f ms, %s\n", solveMs, report.summary.c_str());
+    if (!rig.camera(0))
+    {
+        std::printf("camera 0 not in the rig; no pose comparison\n");
+        return 1;
+    }
+    for (int c = 0; c < cameras; ++c)
+    {
+        const Calibration::Camera* s = rig.camera(c);
+        const Calibration::Camera& t = truth.cameras[c];
+        if (!s)
+        {
+            std::printf("  camera %2d: not calibrated\n", c);
+            continue;
+        }
+        double Rs[9], Cs[3], Rt[9], Ct[3];
+        relative(rig, c, Rs, Cs);
+        relative(truth, c, Rt, Ct);
+        const double dc = std::sqrt((Cs[0] - Ct[0]) * (Cs[0] - Ct[0]) + (Cs[1] - Ct[1]) * (Cs[1] - Ct[1]) + (Cs[2] - Ct[2]) * (Cs[2] - Ct[2]));
+        std::printf("  camera %2d: fx %+7.3f%%  fy %+7.3f%%  cx %+6.2f  cy %+6.2f  k1 %+.4f  rotation %.4f deg  center %6.2f mm  rms %.3f px\n",
+            c, 100.0 * (s->fx - t.fx) / t.fx, 100.0 * (s->fy - t.fy) / t.fy, s->cx - t.cx, s->cy - t.cy, s->k1 - t.k1,
+            angleBetween(Rs, Rt), dc, s->rms);
+    }
+    return 0;
+}
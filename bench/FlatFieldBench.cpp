@@ -0,0 +1,152 @@
+// Cost and accuracy of FlatField correction against the plain conversion copy.
+//
+// A 1920x1200 sensor with strong vignetting (half the response in the corners) and a
+// per-pixel dark offset sees an even scene. References are averaged from noisy frames as
+// a capture would, then a frame is corrected; the bench reports how far the corrected
+// frame is from flat (its mean and worst deviation from its own mean, against the raw
+// frame's) and the time per frame for mono8 and 12-bit samples next to
+// PixelConvert::gray8ToRGBA8 and shiftLeft16 over the same frame.
+//
+//   FlatFieldBench [frames] [reference frames]
+
+#include "../FlatField.h"
+#include "../PixelConvert.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+namespace
+{
+    const int kWidth = 1920, kHeight = 1200;
+
+    template <typename Fn>
+    double msPerFrame(int frames, Fn fn)
+    {
+        const auto t0 = std::chrono::steady_clock::now();
+        for (int i = 0; i < frames; ++i)
+            fn();
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count() / frames;
+    }
+
+    // Mean and worst deviation from the frame's mean, in 'unit' steps.
+    void flatness(const std::vector<double>& v, double& mean, double& meanDev, double& worstDev)
+    {
+        mean = 0.0;
+        for (double x : v)
+            mean += x;
+        mean /= (double)v.size();
+        meanDev = worstDev = 0.0;
+        for (double x : v)
+        {
+            meanDev += std::abs(x - mean);
+            worstDev = std::max(worstDev, std::abs(x - mean));
+        }
+        meanDev /= (double)v.size();
+    }
+}
+
+int main(int argc, char** argv)
+{
+    const int frames = argc > 1 ? std::max(1, std::atoi(argv[1])) : 50;
+    const int refFrames = argc > 2 ? std::max(1, std::atoi(argv[2])) : 16;
+    const size_t n = (size_t)kWidth * kHeight;
+
+    // Response and dark offset per pixel, in 12-bit units.
+    std::mt19937 rng(7);
+    std::vector<double> response(n), dark(n);
+    std::uniform_real_distribution<double> fpn(0.0, 40.0);
+    for (int y = 0; y < kHeight; ++y)
+        for (int x = 0; x < kWidth; ++x)
+        {
+            const double r2 = (std::pow(x - 959.5, 2) + std::pow(y - 599.5, 2)) / (std::pow(959.5, 2) + std::pow(599.5, 2));
+            const size_t i = (size_t)y * kWidth + x;
+            response[i] = 1.0 - 0.5 * r2;
+            dark[i] = 60.0 + fpn(rng);
+        }
+
+    std::normal_distribution<double> noise(0.0, 6.0);
+    auto expose = [&](double level, int bpp, std::vector<uint8_t>& out)
+    {
+        out.resize(n * bpp);
+        for (size_t i = 0; i < n; ++i)
+        {
+            const double v = std::min(4095.0, std::max(0.0, dark[i] + level * response[i] + noise(rng)));
+            if (bpp == 2)
+                reinterpret_cast<uint16_t*>(out.data())[i] = (uint16_t)((uint16_t)std::lround(v) << 4);
+            else
+                out[i] = (uint8_t)std::lround(v / 16.0);
+        }
+    };
+
+    for (int bpp = 1; bpp <= 2; ++bpp)
+    {
+        // References as a capture averages them, in the frame layout.
+        FlatField::Frame darkRef, flatRef;
+        FlatField::Accumulator acc;
+        std::vector<uint8_t> frame;
+        acc.reset(kWidth, kHeight, bpp);
+        for (int i = 0; i < refFrames; ++i)
+        {
+            expose(0.0, bpp, frame);
+            acc.add(frame.data(), (size_t)kWidth * bpp);
+        }
+        acc.mean(darkRef);
+        acc.reset(kWidth, kHeight, bpp);
+        for (int i = 0; i < refFrames; ++i)
+        {
+            expose(3200.0, bpp, frame);
+            acc.add(frame.data(), (size_t)kWidth * bpp);
+        }
+        acc.mean(flatRef);
+        FlatField::Table table;
+        FlatField::build(&darkRef, &flatRef, table);
+
+        // A noise-free scene at a third of the flat's level, before and after.
+        noise = std::normal_distribution<double>(0.0, 0.0);
+        expose(1100.0, bpp, frame);
+        noise = std::normal_distribution<double>(0.0, 6.0);
+        std::vector<uint8_t> out(frame.size());
+        const size_t pitch = (size_t)kWidth * bpp;
+        for (int y = 0; y < kHeight; ++y)
+            FlatField::correctRow(table, y, frame.data() + y * pitch, 16, out.data() + y * pitch);
+        std::vector<double> raw(n), fixedUp(n);
+        const double unit = bpp == 2 ? 16.0 : 1.0;      // 12-bit levels, left-aligned
+        for (size_t i = 0; i < n; ++i)
+        {
+            raw[i] = bpp == 2 ? reinterpret_cast<const uint16_t*>(frame.data())[i] / unit : frame[i];
+            fixedUp[i] = bpp == 2 ? reinterpret_cast<const uint16_t*>(out.data())[i] / unit : out[i];
+        }
+        double rawMean, rawDev, rawWorst, mean, dev, worst;
+        flatness(raw, rawMean, rawDev, rawWorst);
+        flatness(fixedUp, mean, dev, worst);
+        const char* name = bpp == 2 ? "12-bit" : "mono8";
+        std::printf("%s: raw %.1f +- %.1f (worst %.1f), corrected %.1f +- %.2f (worst %.1f) %s levels\n",
+            name, rawMean, rawDev, rawWorst, mean, dev, worst, bpp == 2 ? "12-bit" : "gray");
+
+        std::vector<uint8_t> copy(n * 4);
+        const double copyMs = msPerFrame(frames, [&]
+            {
+                for (int y = 0; y < kHeight; ++y)
+                {
+                    if (bpp == 2)
+                        PixelConvert::shiftLeft16(reinterpret_cast<const uint16_t*>(frame.data() + y * pitch),
+                            reinterpret_cast<uint16_t*>(copy.data() + y * pitch), (size_t)kWidth, 0);
+                    else
+                        PixelConvert::gray8ToRGBA8(frame.data() + y * pitch, copy.data() + (size_t)y * kWidth * 4, (size_t)kWidth);
+                }
+            });
+        const double fixMs = msPerFrame(frames, [&]
+            {
+                for (int y = 0; y < kHeight; ++y)
+                    FlatField::correctRow(table, y, frame.data() + y * pitch, 16, out.data() + y * pitch);
+            });
+        std::printf("%s, one thread, ms/frame: %s %.2f, correctRow %.2f\n", name,
+            bpp == 2 ? "shiftLeft16" : "gray8ToRGBA8", copyMs, fixMs);
+    }
+    return 0;
+}
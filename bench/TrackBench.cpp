@@ -0,0 +1,140 @@
+// Cost and ID stability of Tracker::MultiTracker on synthetic marker motion.
+//
+// Targets move across a 1920x1200 image at constant velocity with random acceleration;
+// one that leaves the image is replaced by a new target elsewhere. Each frame detects every target with Gaussian position noise,
+// drops some detections and adds uniform clutter, and hands the list to the tracker in
+// random order, as the detection job would. Reports the update time per frame, the
+// share of target detections claimed by a confirmed track and the number of ID switches
+// (a target's detections claimed by a different track ID than last time).
+//
+//   TrackBench [targets] [frames] [fps] [noise px] [dropout] [clutter]
+
+#include "../Tracker.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+namespace
+{
+    struct Target
+    {
+        float x, y, vx, vy;
+    };
+
+    double nowMs()
+    {
+        using namespace std::chrono;
+        return duration<double, std::milli>(steady_clock::now().time_since_epoch()).count();
+    }
+}
+
+int main(int argc, char** argv)
+{
+    const int targets = argc > 1 ? std::atoi(argv[1]) : 300;
+    const int frames = argc > 2 ? std::max(1, std::atoi(argv[2])) : 2000;
+    const float fps = argc > 3 ? (float)std::atof(argv[3]) : 60.0f;
+    const float noise = argc > 4 ? (float)std::atof(argv[4]) : 0.5f;
+    const float dropout = argc > 5 ? (float)std::atof(argv[5]) : 0.05f;
+    const int clutter = argc > 6 ? std::atoi(argv[6]) : 10;
+    if (targets < 0 || fps <= 0.0f || noise < 0.0f || dropout < 0.0f || dropout >= 1.0f || clutter < 0)
+    {
+        std::fprintf(stderr, "usage: TrackBench [targets] [frames] [fps] [noise px] [dropout] [clutter]\n");
+        return 2;
+    }
+
+    const float w = 1920.0f, h = 1200.0f, dt = 1.0f / fps;
+    std::mt19937 rng(12345);
+    std::uniform_real_distribution<float> ux(0.0f, w), uy(0.0f, h), u01(0.0f, 1.0f);
+    std::normal_distribution<float> speed(0.0f, 150.0f), accel(0.0f, 600.0f), meas(0.0f, 1.0f);
+
+    std::vector<Target> truth((size_t)targets);
+    for (Target& t : truth)
+        t = Target{ ux(rng), uy(rng), speed(rng), speed(rng) };
+
+    Tracker::Params p;
+    p.enabled = true;
+    p.measurementSigma = std::max(0.25f, noise);
+    Tracker::MultiTracker tracker;
+    std::vector<Tracker::Detection> dets;
+    std::vector<int> source;    // target each detection came from, -1 = clutter
+    std::vector<Tracker::Track> tracks;
+    std::vector<uint32_t> lastId((size_t)targets, 0);
+
+    double totalMs = 0.0, worstMs = 0.0;
+    size_t covered = 0, samples = 0, switches = 0;
+    const int warmup = 30;
+    uint64_t ns = 1;
+    for (int f = 0; f < frames; ++f)
+    {
+        for (size_t i = 0; i < truth.size(); ++i)
+        {
+            Target& t = truth[i];
+            t.vx += accel(rng) * dt;
+            t.vy += accel(rng) * dt;
+            t.x += t.vx * dt;
+            t.y += t.vy * dt;
+            if (t.x < 0.0f || t.x >= w || t.y < 0.0f || t.y >= h)
+            {
+                t = Target{ ux(rng), uy(rng), speed(rng), speed(rng) };
+                lastId[i] = 0;
+            }
+        }
+
+        dets.clear();
+        source.clear();
+        for (int i = 0; i < targets; ++i)
+        {
+            if (u01(rng) < dropout)
+                continue;
+            dets.push_back(Tracker::Detection{ truth[i].x + noise * meas(rng), truth[i].y + noise * meas(rng) });
+            source.push_back(i);
+        }
+        for (int i = 0; i < clutter; ++i)
+        {
+            dets.push_back(Tracker::Detection{ ux(rng), uy(rng) });
+            source.push_back(-1);
+        }
+        for (size_t i = dets.size(); i > 1; --i)
+        {
+            const size_t j = std::uniform_int_distribution<size_t>(0, i - 1)(rng);
+            std::swap(dets[i - 1], dets[j]);
+            std::swap(source[i - 1], source[j]);
+        }
+
+        ns += (uint64_t)(1e9 / fps);
+        const double t0 = nowMs();
+        tracker.update(dets.data(), (int)dets.size(), ns, p, tracks);
+        const double ms = nowMs() - t0;
+
+        if (f < warmup)
+            continue;
+        totalMs += ms;
+        worstMs = std::max(worstMs, ms);
+
+        for (const Tracker::Track& t : tracks)
+        {
+            const int i = t.detection >= 0 ? source[t.detection] : -1;
+            if (i < 0)
+                continue;
+            ++covered;
+            if (lastId[i] != 0 && lastId[i] != t.id)
+                ++switches;
+            lastId[i] = t.id;
+        }
+        samples += dets.size() - (size_t)clutter;
+    }
+
+    const int timed = std::max(1, frames - warmup);
+    std::printf("%d targets, %d clutter, %.0f fps, noise %.2f px, dropout %.0f%%, %d frames\n",
+        targets, clutter, fps, noise, dropout * 100.0f, frames);
+    std::printf("  update   : %8.3f ms/frame mean  %8.3f ms worst  (%zu live tracks)\n",
+        totalMs / timed, worstMs, tracker.trackCount());
+    std::printf("  coverage : %7.2f%% of target detections   %zu ID switches\n",
+        samples ? 100.0 * covered / samples : 0.0, switches);
+    return 0;
+}
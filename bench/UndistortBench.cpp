@@ -0,0 +1,118 @@
+// Cost and accuracy of Undistort's remap against the plain conversion copy.
+//
+// A 1920x1200 camera with strong barrel distortion looks at a smooth synthetic pattern.
+// The source frame holds the pattern at every distorted pixel, so an undistorted output
+// pixel should read the pattern at the position its map points to; the bench reports the
+// mean and worst difference. Times one frame per sample format on one thread, next to
+// PixelConvert::gray8ToRGBA8 over the same frame, then the row-banded remap() on the pool.
+//
+//   UndistortBench [frames] [k1]
+
+#include "../Undistort.h"
+#include "../PixelConvert.h"
+#include "../WorkerPool.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+namespace
+{
+    const int kWidth = 1920, kHeight = 1200;
+
+    double pattern(double u, double v)
+    {
+        return 128.0 + 100.0 * std::sin(u / 23.0) * std::cos(v / 31.0);
+    }
+
+    template <typename Fn>
+    double msPerFrame(int frames, Fn fn)
+    {
+        const auto t0 = std::chrono::steady_clock::now();
+        for (int i = 0; i < frames; ++i)
+            fn();
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count() / frames;
+    }
+}
+
+int main(int argc, char** argv)
+{
+    const int frames = argc > 1 ? std::max(1, std::atoi(argv[1])) : 50;
+    const double k1 = argc > 2 ? std::atof(argv[2]) : -0.28;
+
+    Calibration::Camera cam;
+    cam.valid = true;
+    cam.width = kWidth;
+    cam.height = kHeight;
+    cam.fx = cam.fy = 1100.0;
+    cam.cx = 959.5;
+    cam.cy = 599.5;
+    cam.k1 = k1;
+    cam.k2 = 0.09;
+    cam.p1 = 0.0007;
+    cam.p2 = -0.0004;
+
+    Undistort::Map map;
+    const auto b0 = std::chrono::steady_clock::now();
+    if (!Undistort::build(cam, map))
+    {
+        std::printf("map could not be built\n");
+        return 1;
+    }
+    const double buildMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - b0).count();
+    size_t valid = 0;
+    for (int y = 0; y < kHeight; ++y)
+        valid += (size_t)(map.spans[(size_t)y * 2 + 1] - map.spans[(size_t)y * 2]);
+
+    const size_t n = (size_t)kWidth * kHeight;
+    std::vector<uint8_t> mono8(n), rgba8(n * 4), out(n * 4);
+    std::vector<uint16_t> mono12(n);
+    for (int y = 0; y < kHeight; ++y)
+        for (int x = 0; x < kWidth; ++x)
+        {
+            const double g = pattern(x, y);
+            const size_t i = (size_t)y * kWidth + x;
+            mono8[i] = (uint8_t)std::lround(g);
+            mono12[i] = (uint16_t)std::lround(g * 16.0);
+            for (int ch = 0; ch < 4; ++ch)
+                rgba8[i * 4 + ch] = ch == 3 ? 255 : mono8[i];
+        }
+
+    // Accuracy: each output pixel against the pattern at its mapped source position.
+    Undistort::remapRows(mono8.data(), kWidth, 1, 8, map, out.data(), kWidth, 0, kHeight);
+    double sum = 0.0, worst = 0.0;
+    for (int y = 0; y < kHeight; ++y)
+        for (int x = map.spans[(size_t)y * 2]; x < map.spans[(size_t)y * 2 + 1]; ++x)
+        {
+            const size_t i = (size_t)y * kWidth + x;
+            const double want = pattern(x + map.dx[i] / 32.0, y + map.dy[i] / 32.0);
+            const double err = std::abs(out[i] - want);
+            sum += err;
+            worst = std::max(worst, err);
+        }
+
+    std::printf("%dx%d, k1 %.2f: map %.1f MB, built in %.0f ms, %.1f%% of pixels in view\n", kWidth, kHeight, k1,
+        (double)(map.dx.size() + map.dy.size()) * 2.0 / (1 << 20), buildMs, 100.0 * valid / n);
+    std::printf("mono8 error vs pattern: %.2f mean, %.2f worst gray levels\n", sum / (double)valid, worst);
+
+    const double copyMs = msPerFrame(frames, [&]
+        {
+            for (int y = 0; y < kHeight; ++y)
+                PixelConvert::gray8ToRGBA8(mono8.data() + (size_t)y * kWidth, out.data() + (size_t)y * kWidth * 4, kWidth);
+        });
+    const double m8 = msPerFrame(frames, [&]
+        { Undistort::remapRows(mono8.data(), kWidth, 1, 8, map, out.data(), kWidth, 0, kHeight); });
+    const double m16 = msPerFrame(frames, [&]
+        { Undistort::remapRows((const uint8_t*)mono12.data(), kWidth * 2, 2, 12, map, out.data(), kWidth * 2, 0, kHeight); });
+    const double c32 = msPerFrame(frames, [&]
+        { Undistort::remapRows(rgba8.data(), kWidth * 4, 4, 8, map, out.data(), kWidth * 4, 0, kHeight); });
+    const double pooled = msPerFrame(frames, [&]
+        { Undistort::remap(mono8.data(), kWidth, 1, 8, map, out.data(), kWidth); });
+
+    std::printf("one thread, ms/frame: gray8ToRGBA8 %.2f, remap mono8 %.2f, mono12 %.2f, rgba8 %.2f\n", copyMs, m8, m16, c32);
+    std::printf("remap mono8 on the pool (%d workers): %.2f ms/frame\n", WorkerPool::instance().threadCount(), pooled);
+    return 0;
+}
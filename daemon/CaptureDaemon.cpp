@@ -0,0 +1,243 @@
+// Standalone capture process for the GevIQ 24 TOP.
+//
+// Owns the MIL system and every camera, streams them continuously and publishes each
+// frame into SharedFrames rings under --prefix. The TOP (Frame Source = Capture
+// Daemon) and any other reader attach to those rings, so TouchDesigner can crash or
+// reload the plugin without stopping acquisition, and a crash here does not take
+// TouchDesigner down with it.
+//
+// A manifest mapping "<prefix>.manifest" carries the camera count and a heartbeat;
+// clients treat a heartbeat older than two seconds as a dead daemon.
+
+#include "../MilManager.h"
+#include "../Calibration.h"
+#include "../Denoise.h"
+#include "../SharedFrames.h"
+#include "../ThreadTuning.h"
+#include "../WorkerPool.h"
+#include "../FrameArena.h"
+
+#include <Windows.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace
+{
+    struct Options
+    {
+        std::string prefix = "GevIQ24";
+        int slots = 4;
+        std::string dcf;            // DCF path ({cam} = index) or "userset:Name", empty = M_DEFAULT
+        std::string captureCores;   // ThreadTuning::parseCpuSet syntax
+        std::string workerCores;
+        ThreadTuning::Priority priority = ThreadTuning::Priority::High;
+        bool hugePages = false;
+        std::string undistort;      // calibration file, empty = frames are not undistorted
+        std::string flatField;      // reference folder, empty = no flat-field correction
+        Denoise::Params denoise;    // Denoise::weights() clamps strength and threshold
+        bool dump = false;
+    };
+
+    std::atomic<bool> g_stop{ false };
+
+    BOOL WINAPI onConsoleCtrl(DWORD)
+    {
+        // Ctrl+C and Ctrl+Break stop cleanly. On window close the OS ends the process
+        // shortly after we return; clients notice through the heartbeat.
+        g_stop = true;
+        return TRUE;
+    }
+
+    void usage()
+    {
+        std::printf(
+            "CaptureDaemon [options]\n"
+            "  --prefix NAME          shared-memory name (TOP: Shared Memory Name), default GevIQ24\n"
+            "  --slots N              frames per camera ring, 2..64, default 4\n"
+            "  --dcf SOURCE           DCF path ({cam} = camera index) or userset:Name\n"
+            "  --capture-cores LIST   hook threads, e.g. 4-11 or numa:1\n"
+            "  --worker-cores LIST    conversion workers, same syntax\n"
+            "  --priority P           normal | high | timecritical, default high\n"
+            "  --huge-pages           back frame memory with large pages\n"
+            "  --undistort FILE       undistort frames with this calibration file\n"
+            "  --flat-field FOLDER    flat-field correct mono cameras with the references there\n"
+            "  --denoise              temporal denoise of 8-bit frames\n"
+            "  --denoise-strength F   0..1, default 0.8\n"
+            "  --denoise-motion N     gray levels, 2..255, default 24\n"
+            "  --dump                 print the MIL device probe and exit\n");
+    }
+
+    bool parseArgs(int argc, char** argv, Options& o)
+    {
+        for (int i = 1; i < argc; ++i)
+        {
+            const std::string a = argv[i];
+            const bool hasValue = i + 1 < argc;
+            if (a == "--prefix" && hasValue) o.prefix = argv[++i];
+            else if (a == "--slots" && hasValue) o.slots = std::max(2, std::min(64, std::atoi(argv[++i])));
+            else if (a == "--dcf" && hasValue) o.dcf = argv[++i];
+            else if (a == "--capture-cores" && hasValue) o.captureCores = argv[++i];
+            else if (a == "--worker-cores" && hasValue) o.workerCores = argv[++i];
+            else if (a == "--priority" && hasValue)
+            {
+                const std::string p = argv[++i];
+                if (p == "normal") o.priority = ThreadTuning::Priority::Normal;
+                else if (p == "high") o.priority = ThreadTuning::Priority::High;
+                else if (p == "timecritical") o.priority = ThreadTuning::Priority::TimeCritical;
+                else return false;
+            }
+            else if (a == "--huge-pages") o.hugePages = true;
+            else if (a == "--undistort" && hasValue) o.undistort = argv[++i];
+            else if (a == "--flat-field" && hasValue) o.flatField = argv[++i];
+            else if (a == "--denoise") o.denoise.enabled = true;
+            else if (a == "--denoise-strength" && hasValue) o.denoise.strength = (float)std::atof(argv[++i]);
+            else if (a == "--denoise-motion" && hasValue) o.denoise.motionThreshold = std::atoi(argv[++i]);
+            else if (a == "--dump") o.dump = true;
+            else return false;
+        }
+        return !o.prefix.empty();
+    }
+}
+
+int main(int argc, char** argv)
+{
+    Options opt;
+    if (!parseArgs(argc, argv, opt))
+    {
+        usage();
+        return 2;
+    }
+
+    MilManager& mil = MilManager::instance();
+    if (!mil.builtWithMil())
+    {
+        std::fprintf(stderr, "CaptureDaemon was built without HAVE_MIL.\n");
+        return 1;
+    }
+    if (opt.dump)
+    {
+        std::printf("%s\n", mil.dumpDevices().c_str());
+        return 0;
+    }
+
+    // One daemon per name: a live heartbeat means someone else already serves it.
+    SharedFrames::Mapping manifestMap;
+    if (!manifestMap.create(SharedFrames::manifestName(opt.prefix), sizeof(SharedFrames::Manifest), false))
+    {
+        std::fprintf(stderr, "Cannot create %s.\n", SharedFrames::manifestName(opt.prefix).c_str());
+        return 1;
+    }
+    SharedFrames::Manifest* manifest = reinterpret_cast<SharedFrames::Manifest*>(manifestMap.data());
+    const uint64_t beat = manifest->heartbeatNs.load(std::memory_order_acquire);
+    if (manifest->magic == SharedFrames::kMagic && beat != 0 && SharedFrames::nowNs() < beat + 2000000000ull)
+    {
+        std::fprintf(stderr, "Another capture daemon (pid %u) is serving '%s'.\n", manifest->pid, opt.prefix.c_str());
+        return 1;
+    }
+    manifest->magic = SharedFrames::kMagic;
+    manifest->version = SharedFrames::kVersion;
+    manifest->pid = (uint32_t)GetCurrentProcessId();
+    manifest->cameraCount.store(0, std::memory_order_release);
+    manifest->heartbeatNs.store(SharedFrames::nowNs(), std::memory_order_release);
+
+    SetConsoleCtrlHandler(onConsoleCtrl, TRUE);
+
+    // Same order as the TOP's reconfigure(): memory, threads, profile, then cameras.
+    FrameArena::instance().setLargePages(opt.hugePages);
+
+    ThreadTuning::CpuSet captureCpus, workerCpus;
+    std::string err;
+    if (!ThreadTuning::parseCpuSet(opt.captureCores, captureCpus, err))
+        std::fprintf(stderr, "--capture-cores: %s\n", err.c_str());
+    if (!ThreadTuning::parseCpuSet(opt.workerCores, workerCpus, err))
+        std::fprintf(stderr, "--worker-cores: %s\n", err.c_str());
+    mil.setCaptureThreads(captureCpus, opt.priority);
+    WorkerPool::instance().configure(workerCpus, opt.priority);
+
+    if (!mil.setDcfProfiles({ MilManager::DcfProfile{ std::string(), opt.dcf } }))
+        std::fprintf(stderr, "%s\n", mil.lastError().c_str());
+    mil.setFrameExport(true, opt.prefix, opt.slots);
+
+    // Frame processing is set before any camera streams, so the first frames published
+    // are already processed.
+    if (!opt.flatField.empty())
+        mil.setFlatField(true, opt.flatField);
+    if (!opt.undistort.empty())
+    {
+        Calibration::Rig rig;
+        if (Calibration::load(opt.undistort, rig, err))
+            mil.setUndistortion(true, rig);
+        else
+            std::fprintf(stderr, "--undistort: %s\n", err.c_str());
+    }
+    if (opt.denoise.enabled)
+        mil.setDenoise(opt.denoise);
+
+    // The heartbeat is the process being alive; slow MIL calls below (DCF allocation of
+    // many cameras) must not make clients give up on us.
+    std::thread heartbeat([manifest]
+        {
+            while (!g_stop)
+            {
+                manifest->heartbeatNs.store(SharedFrames::nowNs(), std::memory_order_release);
+                std::this_thread::sleep_for(std::chrono::milliseconds(250));
+            }
+        });
+
+    std::printf("Capture daemon serving '%s' (pid %lu). Ctrl+C to stop.\n", opt.prefix.c_str(), GetCurrentProcessId());
+
+    int held = 0;
+    std::string lastStatus;
+    auto nextStatus = std::chrono::steady_clock::now();
+    while (!g_stop)
+    {
+        // Discovery can grow the camera set; newly found cameras get the profile first.
+        const int n = mil.cameraCount();
+        for (; held < n; ++held)
+        {
+            double ms = 0.0;
+            if (!mil.applyDcfProfile(held, std::string(), ms))
+                std::fprintf(stderr, "cam %d: %s\n", held, mil.lastError().c_str());
+            mil.retainCamera(held);
+        }
+        for (int cam = 0; cam < n && !g_stop; ++cam)
+            mil.ensureStreaming(cam);   // lost cameras fail fast; the watchdog brings them back
+        manifest->cameraCount.store((uint32_t)n, std::memory_order_release);
+
+        const auto now = std::chrono::steady_clock::now();
+        if (now >= nextStatus)
+        {
+            nextStatus = now + std::chrono::seconds(5);
+            const MilManager::Health h = mil.health();
+            std::string status = mil.summaryLine() + " | cameras " + std::to_string(n)
+                + ", lost " + std::to_string(h.lost) + ", reconnects " + std::to_string(h.reconnects);
+            if (!mil.lastError().empty())
+                status += " | " + mil.lastError();
+            if (status != lastStatus)
+                std::printf("%s\n", status.c_str());
+            lastStatus.swap(status);
+        }
+
+        std::this_thread::sleep_for(std::chrono::milliseconds(250));
+    }
+
+    std::printf("Stopping.\n");
+    heartbeat.join();
+
+    // Clients see the heartbeat stop at once rather than after the timeout.
+    manifest->cameraCount.store(0, std::memory_order_release);
+    manifest->heartbeatNs.store(0, std::memory_order_release);
+    mil.setFrameExport(false, opt.prefix, opt.slots);
+    for (int cam = 0; cam < held; ++cam)
+        mil.releaseCamera(cam);
+    manifestMap.close();
+    return 0;
+}